@@ -0,0 +1,223 @@
+#include "bench.h"
+#include "goose.h"
+#include "goose_publisher.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#if BENCH_PERF_COUNTERS
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#define BENCH_MAX_SAMPLES 64
+
+static FILE* out;
+static const char* filter;
+static size_t sample_count = 21;
+static uint64_t min_sample_ns = 5000000ULL;
+static size_t result_count = 0;
+
+// Hardware cache miss counter, or -1 when the host exposes no PMU to this process
+static int cache_miss_fd = -1;
+
+static void cache_miss_open(void)
+{
+#if BENCH_PERF_COUNTERS
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.size = sizeof(attr);
+    attr.config = PERF_COUNT_HW_CACHE_MISSES;
+    attr.disabled = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    cache_miss_fd = (int)syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+#endif
+}
+
+// Cache misses over `iterations` calls of fn, or -1.0 when not counted
+static double cache_miss_count(bench_fn fn, void* ctx, size_t iterations)
+{
+#if BENCH_PERF_COUNTERS
+    uint64_t count = 0;
+    if (cache_miss_fd < 0) return -1.0;
+    ioctl(cache_miss_fd, PERF_EVENT_IOC_RESET, 0);
+    ioctl(cache_miss_fd, PERF_EVENT_IOC_ENABLE, 0);
+    fn(ctx, iterations);
+    ioctl(cache_miss_fd, PERF_EVENT_IOC_DISABLE, 0);
+    if (read(cache_miss_fd, &count, sizeof(count)) != (ssize_t)sizeof(count)) return -1.0;
+    return (double)count;
+#else
+    (void)fn;
+    (void)ctx;
+    (void)iterations;
+    return -1.0;
+#endif
+}
+
+uint64_t bench_now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+static const void* volatile sink;
+
+void bench_sink(const void* p)
+{
+    sink = p;
+}
+
+int bench_enabled(const char* name)
+{
+    return !filter || strstr(name, filter) != NULL;
+}
+
+static int compare_double(const void* a, const void* b)
+{
+    double x = *(const double*)a;
+    double y = *(const double*)b;
+    return (x > y) - (x < y);
+}
+
+static uint64_t time_iterations(bench_fn fn, void* ctx, size_t iterations)
+{
+    uint64_t start = bench_now_ns();
+    fn(ctx, iterations);
+    return bench_now_ns() - start;
+}
+
+void bench_run(const char* name, const char* params, bench_fn fn, void* ctx, double items_per_op, const char* unit)
+{
+    if (!bench_enabled(name)) return;
+
+    // Warm up and grow the batch until one sample is long enough to time reliably
+    size_t iterations = 1;
+    while (time_iterations(fn, ctx, iterations) < min_sample_ns && iterations < ((size_t)1 << 40))
+    {
+        iterations *= 2;
+    }
+
+    double samples[BENCH_MAX_SAMPLES];
+    double sum = 0.0;
+    for (size_t i = 0; i < sample_count; i++)
+    {
+        samples[i] = (double)time_iterations(fn, ctx, iterations) / (double)iterations;
+        sum += samples[i];
+    }
+
+    double mean = sum / (double)sample_count;
+    double variance = 0.0;
+    for (size_t i = 0; i < sample_count; i++)
+    {
+        variance += (samples[i] - mean) * (samples[i] - mean);
+    }
+    double stddev = sample_count > 1 ? sqrt(variance / (double)(sample_count - 1)) : 0.0;
+
+    qsort(samples, sample_count, sizeof(double), compare_double);
+    double median = samples[sample_count / 2];
+    double p90 = samples[(sample_count * 9) / 10 < sample_count ? (sample_count * 9) / 10 : sample_count - 1];
+
+    // Allocation profile of a separate pass so the counters do not skew the timings
+    size_t alloc_iterations = iterations < 1000 ? iterations : 1000;
+    bench_alloc_reset();
+    fn(ctx, alloc_iterations);
+    bench_alloc_counters allocs = bench_alloc_read();
+
+    // And another for the cache miss counter, reported only where it opened
+    double cache_misses = cache_miss_count(fn, ctx, iterations);
+
+    fprintf(out, "%s\n    {\"name\": \"%s\", \"params\": %s, \"iterations\": %zu, \"samples\": %zu,\n",
+        result_count ? "," : "", name, params, iterations, sample_count);
+    fprintf(out, "     \"ns_per_op\": {\"min\": %.2f, \"median\": %.2f, \"mean\": %.2f, \"p90\": %.2f, \"max\": %.2f, \"stddev\": %.2f},\n",
+        samples[0], median, mean, p90, samples[sample_count - 1], stddev);
+    fprintf(out, "     \"ops_per_sec\": %.1f, \"%s_per_sec\": %.1f",
+        median > 0.0 ? 1e9 / median : 0.0, unit, median > 0.0 ? items_per_op * 1e9 / median : 0.0);
+    if (bench_alloc_tracking())
+    {
+        fprintf(out, ",\n     \"allocs_per_op\": %.2f, \"alloc_bytes_per_op\": %.1f, \"peak_alloc_bytes\": %zu",
+            (double)allocs.allocs / (double)alloc_iterations,
+            (double)allocs.bytes / (double)alloc_iterations,
+            allocs.peak_bytes);
+    }
+    if (cache_misses >= 0.0)
+    {
+        fprintf(out, ",\n     \"cache_misses_per_op\": %.2f", cache_misses / (double)iterations);
+    }
+    fprintf(out, "}");
+    fflush(out);
+
+    result_count++;
+}
+
+static void usage(const char* argv0)
+{
+    fprintf(stderr, "usage: %s [--out FILE] [--filter NAME] [--quick]\n", argv0);
+}
+
+int main(int argc, char** argv)
+{
+    const char* out_path = NULL;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--out") == 0 && i + 1 < argc)
+        {
+            out_path = argv[++i];
+        }
+        else if (strcmp(argv[i], "--filter") == 0 && i + 1 < argc)
+        {
+            filter = argv[++i];
+        }
+        else if (strcmp(argv[i], "--quick") == 0)
+        {
+            sample_count = 5;
+            min_sample_ns = 1000000ULL;
+        }
+        else
+        {
+            usage(argv[0]);
+            return 2;
+        }
+    }
+
+    out = out_path ? fopen(out_path, "w") : stdout;
+    if (!out)
+    {
+        perror(out_path);
+        return 1;
+    }
+
+    cache_miss_open();
+
+    fprintf(out, "{\n  \"schema\": 1,\n  \"config\": {\"max_goose_messages\": %d, \"max_dataset_entries\": %d, \"alloc_tracking\": %s, \"cache_misses\": %s, \"samples\": %zu, \"min_sample_ns\": %llu},\n  \"results\": [",
+        MAX_GOOSE_MESSAGES, MAX_NUM_DATASET_ENTRIES, bench_alloc_tracking() ? "true" : "false",
+        cache_miss_fd >= 0 ? "true" : "false", sample_count, (unsigned long long)min_sample_ns);
+
+    bench_ber();
+    bench_goose();
+    bench_publisher();
+    bench_image_startup();
+    bench_auth();
+    bench_pcap_capture_files();
+    bench_gateway();
+    bench_dataset();
+#if BENCH_EVENT_LOG
+    bench_event_log();
+#endif
+
+    fprintf(out, "\n  ]\n}\n");
+
+    if (out != stdout)
+    {
+        fclose(out);
+    }
+
+    return 0;
+}
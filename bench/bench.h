@@ -0,0 +1,43 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Runs `iterations` operations of a benchmark case
+typedef void (*bench_fn)(void* ctx, size_t iterations);
+
+typedef struct
+{
+    size_t allocs;
+    size_t frees;
+    size_t bytes;
+    size_t current_bytes;
+    size_t peak_bytes;
+} bench_alloc_counters;
+
+uint64_t bench_now_ns(void);
+
+// Measures fn and appends one result object to the JSON report.
+// params is a JSON object literal describing the case, items_per_op scales the
+// throughput figure (frames, bytes, ticks...) named by unit.
+void bench_run(const char* name, const char* params, bench_fn fn, void* ctx, double items_per_op, const char* unit);
+
+// Nonzero if the case name passes the --filter given on the command line
+int bench_enabled(const char* name);
+
+int bench_alloc_tracking(void);
+void bench_alloc_reset(void);
+bench_alloc_counters bench_alloc_read(void);
+
+// Keeps the compiler from discarding a computed value
+void bench_sink(const void* p);
+
+void bench_ber(void);
+void bench_goose(void);
+void bench_publisher(void);
+void bench_image_startup(void);
+void bench_auth(void);
+void bench_pcap_capture_files(void);
+void bench_gateway(void);
+void bench_dataset(void);
+void bench_event_log(void);
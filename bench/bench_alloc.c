@@ -0,0 +1,103 @@
+#include "bench.h"
+
+#ifdef BENCH_ALLOC_TRACKING
+
+#include <malloc.h>
+
+// Linked with -Wl,--wrap so every allocation made by the library lands here
+void* __real_malloc(size_t size);
+void* __real_calloc(size_t count, size_t size);
+void* __real_realloc(void* ptr, size_t size);
+void __real_free(void* ptr);
+
+static bench_alloc_counters counters;
+
+static void account_alloc(void* ptr)
+{
+    if (!ptr) return;
+
+    size_t size = malloc_usable_size(ptr);
+    counters.allocs++;
+    counters.bytes += size;
+    counters.current_bytes += size;
+    if (counters.current_bytes > counters.peak_bytes)
+    {
+        counters.peak_bytes = counters.current_bytes;
+    }
+}
+
+static void account_free(void* ptr)
+{
+    if (!ptr) return;
+
+    size_t size = malloc_usable_size(ptr);
+    counters.frees++;
+    // Blocks allocated before tracking started can drive this below zero
+    counters.current_bytes = counters.current_bytes > size ? counters.current_bytes - size : 0;
+}
+
+void* __wrap_malloc(size_t size)
+{
+    void* ptr = __real_malloc(size);
+    account_alloc(ptr);
+    return ptr;
+}
+
+void* __wrap_calloc(size_t count, size_t size)
+{
+    void* ptr = __real_calloc(count, size);
+    account_alloc(ptr);
+    return ptr;
+}
+
+void* __wrap_realloc(void* ptr, size_t size)
+{
+    account_free(ptr);
+    void* new_ptr = __real_realloc(ptr, size);
+    account_alloc(new_ptr);
+    return new_ptr;
+}
+
+void __wrap_free(void* ptr)
+{
+    account_free(ptr);
+    __real_free(ptr);
+}
+
+int bench_alloc_tracking(void)
+{
+    return 1;
+}
+
+void bench_alloc_reset(void)
+{
+    counters.allocs = 0;
+    counters.frees = 0;
+    counters.bytes = 0;
+    counters.current_bytes = 0;
+    counters.peak_bytes = 0;
+}
+
+bench_alloc_counters bench_alloc_read(void)
+{
+    return counters;
+}
+
+#else
+
+int bench_alloc_tracking(void)
+{
+    return 0;
+}
+
+void bench_alloc_reset(void)
+{
+}
+
+bench_alloc_counters bench_alloc_read(void)
+{
+    bench_alloc_counters empty = { 0 };
+    return empty;
+}
+
+#endif
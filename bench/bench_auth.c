@@ -0,0 +1,103 @@
+#include "bench.h"
+#include "goose.h"
+#include "goose_auth.h"
+#include <stdio.h>
+#include <string.h>
+
+goose_handle* bench_goose_handle(size_t entries);
+
+static const uint8_t bench_key[] = "bench substation key 0123456789";
+
+typedef struct
+{
+    goose_handle* handle;
+    goose_auth_keyring* keyring;
+    size_t unsigned_length;
+} bench_auth_case;
+
+static void run_goose_auth_sign(void* ctx, size_t iterations)
+{
+    bench_auth_case* auth = (bench_auth_case*)ctx;
+    for (size_t i = 0; i < iterations; i++)
+    {
+        size_t length = goose_auth_sign(auth->keyring, auth->handle->byte_stream, auth->unsigned_length, sizeof(auth->handle->byte_stream));
+        bench_sink(&length);
+    }
+}
+
+static void run_goose_auth_verify(void* ctx, size_t iterations)
+{
+    bench_auth_case* auth = (bench_auth_case*)ctx;
+    for (size_t i = 0; i < iterations; i++)
+    {
+        int result = goose_auth_verify(auth->keyring, auth->handle->byte_stream, auth->handle->length);
+        bench_sink(&result);
+    }
+}
+
+// HMAC from the raw key, hashing both pad blocks for every frame
+static void run_goose_hmac_sha256(void* ctx, size_t iterations)
+{
+    bench_auth_case* auth = (bench_auth_case*)ctx;
+    size_t app_id_offset = MAC_ADDRESS_SIZE * 2 + ETHERTYPE_SIZE;
+    uint8_t mac[GOOSE_SHA256_SIZE];
+
+    for (size_t i = 0; i < iterations; i++)
+    {
+        goose_hmac_sha256(bench_key, sizeof(bench_key) - 1, &auth->handle->byte_stream[app_id_offset], auth->unsigned_length - app_id_offset, mac);
+        bench_sink(mac);
+    }
+}
+
+static void run_goose_encode_signed(void* ctx, size_t iterations)
+{
+    bench_auth_case* auth = (bench_auth_case*)ctx;
+    for (size_t i = 0; i < iterations; i++)
+    {
+        goose_encode(auth->handle);
+        bench_sink(auth->handle->byte_stream);
+    }
+}
+
+static void run_goose_auth_key_set(void* ctx, size_t iterations)
+{
+    bench_auth_case* auth = (bench_auth_case*)ctx;
+    for (size_t i = 0; i < iterations; i++)
+    {
+        goose_auth_key_set(auth->keyring, (uint32_t)i, bench_key, sizeof(bench_key) - 1);
+    }
+    goose_auth_key_set(auth->keyring, 1, bench_key, sizeof(bench_key) - 1);
+}
+
+void bench_auth(void)
+{
+    char params[96];
+    bench_auth_case auth;
+
+    auth.keyring = goose_auth_keyring_create();
+    if (!auth.keyring) return;
+    goose_auth_key_set(auth.keyring, 1, bench_key, sizeof(bench_key) - 1);
+
+    for (size_t entries = 1; entries <= MAX_NUM_DATASET_ENTRIES; entries *= 4)
+    {
+        auth.handle = bench_goose_handle(entries);
+        if (!auth.handle) break;
+
+        goose_encode(auth.handle);
+        auth.unsigned_length = auth.handle->length;
+        goose_auth_enable(auth.handle, auth.keyring);
+        goose_encode(auth.handle);
+
+        snprintf(params, sizeof(params), "{\"dataset_entries\": %zu, \"frame_bytes\": %zu}", entries, auth.handle->length);
+        bench_run("goose_auth_sign", params, run_goose_auth_sign, &auth, 1.0, "frames");
+        bench_run("goose_auth_verify", params, run_goose_auth_verify, &auth, 1.0, "frames");
+        bench_run("goose_hmac_sha256", params, run_goose_hmac_sha256, &auth, 1.0, "frames");
+        bench_run("goose_encode_signed", params, run_goose_encode_signed, &auth, 1.0, "frames");
+
+        goose_free(auth.handle);
+    }
+
+    bench_run("goose_auth_key_set", "{}", run_goose_auth_key_set, &auth, 1.0, "keys");
+
+    goose_auth_keyring_free(auth.keyring);
+}
@@ -0,0 +1,103 @@
+#include "bench.h"
+#include "ber.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define BER_MANY_COUNT 16
+
+typedef struct
+{
+    ber objects[BER_MANY_COUNT];
+    size_t count;
+    uint8_t* encoded;
+    size_t encoded_len;
+} ber_ctx;
+
+static void run_ber_encode(void* ctx, size_t iterations)
+{
+    ber_ctx* c = (ber_ctx*)ctx;
+    for (size_t i = 0; i < iterations; i++)
+    {
+        uint8_t* bytes = NULL;
+        size_t len = ber_encode(&c->objects[0], &bytes);
+        bench_sink(bytes);
+        (void)len;
+        free(bytes);
+    }
+}
+
+static void run_ber_encode_many(void* ctx, size_t iterations)
+{
+    ber_ctx* c = (ber_ctx*)ctx;
+    for (size_t i = 0; i < iterations; i++)
+    {
+        uint8_t* bytes = NULL;
+        ber_encode_many(c->objects, c->count, &bytes);
+        bench_sink(bytes);
+        free(bytes);
+    }
+}
+
+static void run_ber_decode_many(void* ctx, size_t iterations)
+{
+    ber_ctx* c = (ber_ctx*)ctx;
+    for (size_t i = 0; i < iterations; i++)
+    {
+        ber* decoded = ber_decode_many(c->encoded, c->encoded_len, c->count);
+        bench_sink(decoded);
+        ber_free_many(decoded, c->count);
+    }
+}
+
+static void ber_ctx_init(ber_ctx* c, size_t count, size_t value_size)
+{
+    uint8_t* value = (uint8_t*)malloc(value_size);
+    for (size_t i = 0; i < value_size; i++)
+    {
+        value[i] = (uint8_t)i;
+    }
+
+    c->count = count;
+    for (size_t i = 0; i < count; i++)
+    {
+        ber_init(&c->objects[i], 0x89);
+        ber_set(&c->objects[i], value, value_size);
+    }
+    free(value);
+
+    c->encoded = NULL;
+    c->encoded_len = ber_encode_many(c->objects, count, &c->encoded);
+}
+
+static void ber_ctx_free(ber_ctx* c)
+{
+    for (size_t i = 0; i < c->count; i++)
+    {
+        free(c->objects[i].value);
+    }
+    free(c->encoded);
+}
+
+void bench_ber(void)
+{
+    static const size_t value_sizes[] = { 1, 4, 16, 64, 127, 128, 255, 256, 1024, 4096 };
+    char params[128];
+
+    for (size_t i = 0; i < sizeof(value_sizes) / sizeof(value_sizes[0]); i++)
+    {
+        size_t size = value_sizes[i];
+        ber_ctx c;
+
+        ber_ctx_init(&c, 1, size);
+        snprintf(params, sizeof(params), "{\"value_size\": %zu}", size);
+        bench_run("ber_encode", params, run_ber_encode, &c, (double)c.encoded_len, "bytes");
+        ber_ctx_free(&c);
+
+        ber_ctx_init(&c, BER_MANY_COUNT, size);
+        snprintf(params, sizeof(params), "{\"value_size\": %zu, \"count\": %d}", size, BER_MANY_COUNT);
+        bench_run("ber_encode_many", params, run_ber_encode_many, &c, (double)c.encoded_len, "bytes");
+        bench_run("ber_decode_many", params, run_ber_decode_many, &c, (double)c.encoded_len, "bytes");
+        ber_ctx_free(&c);
+    }
+}
@@ -0,0 +1,128 @@
+#include <cstdio>
+#include <cstring>
+#include "goose_dataset.hpp"
+
+extern "C" {
+#include "bench.h"
+}
+
+// A state change of a Bool, Int32, Float32, Quality dataset: through the typed frame, and
+// through goose_all_data_entry_modify and goose_encode as C callers do it today
+
+using Trip = iec61850::GooseDataset<iec61850::Bool, iec61850::Int32, iec61850::Float32, iec61850::Quality>;
+
+static const char* bench_dataset_gocbref = "BENCH/LLN0$GO$Trip";
+
+struct bench_dataset_case
+{
+    iec61850::GooseFrame<Trip>* frame;
+    goose_handle* handle;
+};
+
+static void run_goose_dataset_set(void* ctx, size_t iterations)
+{
+    bench_dataset_case* bench = static_cast<bench_dataset_case*>(ctx);
+    iec61850::GooseFrame<Trip>& frame = *bench->frame;
+
+    for (size_t i = 0; i < iterations; i++)
+    {
+        frame.set<0>((i & 1) != 0);
+        frame.set<1>(static_cast<int32_t>(i));
+        frame.set<2>(static_cast<float>(i) * 0.5f);
+        frame.set<3>(static_cast<uint16_t>(i & 0x1fff));
+        frame.st_num(static_cast<uint32_t>(i));
+    }
+    bench_sink(frame.handle()->frame);
+}
+
+static void run_goose_dataset_commit(void* ctx, size_t iterations)
+{
+    bench_dataset_case* bench = static_cast<bench_dataset_case*>(ctx);
+    iec61850::GooseFrame<Trip>& frame = *bench->frame;
+
+    for (size_t i = 0; i < iterations; i++)
+    {
+        frame.set<0>((i & 1) != 0);
+        frame.set<1>(static_cast<int32_t>(i));
+        frame.set<2>(static_cast<float>(i) * 0.5f);
+        frame.set<3>(static_cast<uint16_t>(i & 0x1fff));
+        frame.st_num(static_cast<uint32_t>(i));
+        frame.commit();
+    }
+    bench_sink(frame.bytes());
+}
+
+static void run_goose_dataset_c(void* ctx, size_t iterations)
+{
+    bench_dataset_case* bench = static_cast<bench_dataset_case*>(ctx);
+    goose_handle* handle = bench->handle;
+
+    for (size_t i = 0; i < iterations; i++)
+    {
+        uint8_t boolean = (uint8_t)(i & 1);
+        uint32_t int32 = goose_htonl((uint32_t)i);
+        float value = (float)i * 0.5f;
+        uint32_t bits;
+        uint8_t float32[5] = { 0x08 };
+        memcpy(&bits, &value, sizeof(bits));
+        bits = goose_htonl(bits);
+        memcpy(float32 + 1, &bits, sizeof(bits));
+        uint16_t quality_net = goose_htons((uint16_t)(i & 0x1fff));
+        uint8_t quality[3] = { 0x03 };
+        memcpy(quality + 1, &quality_net, sizeof(quality_net));
+        uint32_t st_num = goose_htonl((uint32_t)i);
+
+        goose_all_data_entry_modify(handle, 0, 0x83, sizeof(boolean), &boolean);
+        goose_all_data_entry_modify(handle, 1, 0x85, sizeof(int32), (uint8_t*)&int32);
+        goose_all_data_entry_modify(handle, 2, 0x87, sizeof(float32), float32);
+        goose_all_data_entry_modify(handle, 3, 0x84, sizeof(quality), quality);
+        ber_set(&(handle->frame->pdu_list.st_num), (uint8_t*)&st_num, sizeof(st_num));
+        goose_encode(handle);
+    }
+    bench_sink(handle->byte_stream);
+}
+
+extern "C" void bench_dataset(void)
+{
+    const uint8_t source[MAC_ADDRESS_SIZE] = { 0x00, 0x30, 0xa7, 0x03, 0xc1, 0x53 };
+    const uint8_t destination[MAC_ADDRESS_SIZE] = GOOSE_MULTICAST_ADDRESS(0x00, 0x01);
+    char params[96];
+
+    iec61850::GooseFrame<Trip> frame(source, destination, 0x0001);
+    frame.gocbref(bench_dataset_gocbref).dataset("BENCH/LLN0$Trip").go_id("Trip").time_allowed_to_live(2000).conf_rev(1);
+    frame.encode();
+
+    // Same control block, built field by field
+    uint8_t source_bytes[MAC_ADDRESS_SIZE];
+    uint8_t destination_bytes[MAC_ADDRESS_SIZE];
+    uint8_t app_id[APP_ID_SIZE] = { 0x00, 0x01 };
+    memcpy(source_bytes, source, sizeof(source_bytes));
+    memcpy(destination_bytes, destination, sizeof(destination_bytes));
+    goose_handle* handle = goose_init(source_bytes, destination_bytes, app_id);
+    if (!handle) return;
+
+    uint8_t zero[5] = {};
+    uint8_t time_allowed_to_live[2] = { 0x07, 0xd0 };
+    uint8_t conf_rev[4] = { 0, 0, 0, 1 };
+    ber_set(&(handle->frame->pdu_list.gocbref), (uint8_t*)bench_dataset_gocbref, strlen(bench_dataset_gocbref));
+    ber_set(&(handle->frame->pdu_list.dataset), (uint8_t*)"BENCH/LLN0$Trip", 15);
+    ber_set(&(handle->frame->pdu_list.go_id), (uint8_t*)"Trip", 4);
+    ber_set(&(handle->frame->pdu_list.time_allowed_to_live), time_allowed_to_live, sizeof(time_allowed_to_live));
+    ber_set(&(handle->frame->pdu_list.st_num), zero, 4);
+    ber_set(&(handle->frame->pdu_list.sq_num), zero, 4);
+    ber_set(&(handle->frame->pdu_list.conf_rev), conf_rev, sizeof(conf_rev));
+    goose_all_data_entry_add(handle, 0x83, 1, zero);
+    goose_all_data_entry_add(handle, 0x85, 4, zero);
+    goose_all_data_entry_add(handle, 0x87, 5, zero);
+    goose_all_data_entry_add(handle, 0x84, 3, zero);
+    goose_encode(handle);
+
+    bench_dataset_case bench = { &frame, handle };
+    snprintf(params, sizeof(params), "{\"dataset\": \"Bool, Int32, Float32, Quality\", \"frame_bytes\": %zu}", frame.size());
+
+    bench_run("goose_dataset_set", params, run_goose_dataset_set, &bench, 1.0, "updates");
+    bench_run("goose_dataset_set_commit", params, run_goose_dataset_commit, &bench, 1.0, "updates");
+    bench_run("goose_dataset_c_modify_encode", params, run_goose_dataset_c, &bench, 1.0, "updates");
+
+    goose_free(handle);
+}
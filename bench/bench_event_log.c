@@ -0,0 +1,172 @@
+#include "bench.h"
+#include "goose.h"
+#include "goose_event_log.h"
+#include <dirent.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+goose_handle* bench_goose_handle(size_t entries);
+
+#define BENCH_EVENT_LOG_RECORDS (1u << 20)
+#define BENCH_EVENT_LOG_STREAMS 64
+#define BENCH_EVENT_LOG_QUEUE (1u << 16)
+#define BENCH_EVENT_LOG_SEGMENT (64u * 1024 * 1024)
+#define BENCH_EVENT_LOG_BASE_NS 1700000000000000000ULL
+#define BENCH_EVENT_LOG_SPACING_NS 80000000ULL	// 2^20 records are about a day at this rate
+#define BENCH_EVENT_LOG_DIRECTORY 64
+
+typedef struct
+{
+    char directory[BENCH_EVENT_LOG_DIRECTORY];
+    goose_event_log* log;
+    goose_event_log_stream stream;
+    goose_frame_view view;
+    goose_event_log_filter filter;
+    uint64_t sum;
+} bench_event_log_case;
+
+static void bench_event_log_remove(const char* directory)
+{
+    DIR* dir = opendir(directory);
+    struct dirent* entry;
+    char path[BENCH_EVENT_LOG_DIRECTORY + sizeof(entry->d_name)];
+
+    while (dir && (entry = readdir(dir)) != NULL)
+    {
+        if (entry->d_name[0] != '.' && snprintf(path, sizeof(path), "%s/%s", directory, entry->d_name) < (int)sizeof(path))
+        {
+            unlink(path);
+        }
+    }
+    if (dir)
+    {
+        closedir(dir);
+    }
+    rmdir(directory);
+}
+
+static goose_event_log* bench_event_log_open(const char* directory, const char* prefix)
+{
+    goose_event_log_params params = { directory, prefix, BENCH_EVENT_LOG_SEGMENT, BENCH_EVENT_LOG_QUEUE };
+    return goose_event_log_open(&params);
+}
+
+// Receive side append with the drain run inline whenever the ring fills up
+static void run_goose_event_log_append(void* ctx, size_t iterations)
+{
+    bench_event_log_case* bench = (bench_event_log_case*)ctx;
+
+    for (size_t i = 0; i < iterations; i++)
+    {
+        bench->view.all_data_list.entries[0].value[0] = (uint8_t)i;
+        if (goose_event_log_append(&bench->stream, &bench->view, i) != 0)
+        {
+            goose_event_log_drain(bench->log);
+            goose_event_log_append(&bench->stream, &bench->view, i);
+        }
+    }
+}
+
+static int bench_event_log_visit(const goose_event_log_segment* segment, size_t record, void* context)
+{
+    bench_event_log_case* bench = (bench_event_log_case*)context;
+    bench->sum += segment->values[0][record];
+    return 0;
+}
+
+static void run_goose_event_log_query(void* ctx, size_t iterations)
+{
+    bench_event_log_case* bench = (bench_event_log_case*)ctx;
+
+    for (size_t i = 0; i < iterations; i++)
+    {
+        goose_event_log_query(bench->directory, "day", &bench->filter, bench_event_log_visit, bench);
+    }
+    bench_sink(&bench->sum);
+}
+
+// A day of state changes, round robin over the streams
+static int bench_event_log_day(bench_event_log_case* bench)
+{
+    goose_event_log* log = bench_event_log_open(bench->directory, "day");
+    goose_event_log_event event;
+
+    if (!log) return -1;
+    memset(&event, 0x0, sizeof(event));
+    event.member_count = 8;
+
+    for (uint32_t i = 0; i < BENCH_EVENT_LOG_RECORDS; i++)
+    {
+        event.stream_id = i % BENCH_EVENT_LOG_STREAMS;
+        event.st_num = i / BENCH_EVENT_LOG_STREAMS;
+        event.time_ns = BENCH_EVENT_LOG_BASE_NS + i * BENCH_EVENT_LOG_SPACING_NS;
+        event.changed = 1ULL << (i % 8);
+        event.values[i % 8] = i;
+        while (goose_event_log_push(log, &event) != 0)
+        {
+            goose_event_log_drain(log);
+        }
+    }
+
+    goose_event_log_close(log);
+    return 0;
+}
+
+void bench_event_log(void)
+{
+    char params[128];
+    bench_event_log_case bench;
+    memset(&bench, 0x0, sizeof(bench));
+
+    snprintf(bench.directory, sizeof(bench.directory), "/tmp/goose_event_log_XXXXXX");
+    if (!mkdtemp(bench.directory)) return;
+
+    goose_handle* handle = bench_goose_handle(8);
+    if (!handle)
+    {
+        rmdir(bench.directory);
+        return;
+    }
+    goose_encode(handle);
+    goose_decode(handle->byte_stream, handle->length, &bench.view);
+    goose_decode_all_data(&bench.view);
+
+    if (bench_enabled("goose_event_log_append"))
+    {
+        bench.log = bench_event_log_open(bench.directory, "append");
+        if (bench.log)
+        {
+            goose_event_log_stream_init(&bench.stream, bench.log, 1);
+            snprintf(params, sizeof(params), "{\"members\": %zu, \"queue\": %u}", bench.view.all_data_list.entry_count, BENCH_EVENT_LOG_QUEUE);
+            bench_run("goose_event_log_append", params, run_goose_event_log_append, &bench, 1.0, "events");
+            goose_event_log_close(bench.log);
+        }
+    }
+
+    if (bench_enabled("goose_event_log_query") && bench_event_log_day(&bench) == 0)
+    {
+        uint64_t last_ns = BENCH_EVENT_LOG_BASE_NS + (uint64_t)(BENCH_EVENT_LOG_RECORDS - 1) * BENCH_EVENT_LOG_SPACING_NS;
+        uint32_t stream = 5;
+        struct
+        {
+            const char* name;
+            goose_event_log_filter filter;
+        } cases[] = {
+            { "all", { 0, UINT64_MAX, NULL, 0 } },
+            { "one_stream", { 0, UINT64_MAX, &stream, 1 } },
+            { "one_hour", { last_ns - 3600000000000ULL, last_ns, NULL, 0 } },
+        };
+
+        for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++)
+        {
+            bench.filter = cases[i].filter;
+            snprintf(params, sizeof(params), "{\"filter\": \"%s\", \"records\": %u, \"streams\": %d}", cases[i].name, BENCH_EVENT_LOG_RECORDS, BENCH_EVENT_LOG_STREAMS);
+            bench_run("goose_event_log_query", params, run_goose_event_log_query, &bench, (double)BENCH_EVENT_LOG_RECORDS, "records");
+        }
+    }
+
+    goose_free(handle);
+    bench_event_log_remove(bench.directory);
+}
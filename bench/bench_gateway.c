@@ -0,0 +1,130 @@
+#include "bench.h"
+#include "goose.h"
+#include "goose_auth.h"
+#include "goose_gateway.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+goose_handle* bench_goose_handle(size_t entries);
+
+// One receive slot per stream, round robin, each frame forwarded and popped as a
+// transmit thread would. The slots keep their rewritten frames, so every pass after the
+// first retags and re-signs in place.
+
+#define BENCH_GATEWAY_STREAMS 4096
+#define BENCH_GATEWAY_SLOT 256
+#define BENCH_GATEWAY_HEADROOM 8
+
+static const uint8_t bench_gateway_key[] = "bench substation key 0123456789";
+
+typedef struct
+{
+    goose_gateway* gateway;
+    goose_gateway_frame frames[BENCH_GATEWAY_STREAMS];
+    uint8_t* slots;
+    size_t next;
+} bench_gateway_case;
+
+static void run_goose_gateway(void* ctx, size_t iterations)
+{
+    bench_gateway_case* bench = (bench_gateway_case*)ctx;
+    goose_gateway_frame out;
+    size_t next = bench->next;
+
+    for (size_t i = 0; i < iterations; i++)
+    {
+        goose_gateway_input(bench->gateway, &bench->frames[next]);
+        if (goose_gateway_pop(bench->gateway, &out))
+        {
+            bench->frames[(size_t)out.tag] = out;
+        }
+        next = (next + 1) % BENCH_GATEWAY_STREAMS;
+    }
+    bench->next = next;
+    bench_sink(bench->slots);
+}
+
+// Fills every slot with its stream's frame, VLAN tagged, APPID 0x1000 + stream and a
+// source MAC of its own
+static int bench_gateway_load(bench_gateway_case* bench, goose_handle* handle)
+{
+    for (size_t i = 0; i < BENCH_GATEWAY_STREAMS; i++)
+    {
+        handle->frame->app_id[0] = (uint8_t)((0x1000 + i) >> 8);
+        handle->frame->app_id[1] = (uint8_t)(0x1000 + i);
+        handle->frame->source[4] = (uint8_t)(i >> 8);
+        handle->frame->source[5] = (uint8_t)i;
+        goose_encode(handle);
+        if (BENCH_GATEWAY_HEADROOM + handle->length + GOOSE_AUTH_EXTENSION_SIZE > BENCH_GATEWAY_SLOT) return -1;
+
+        uint8_t* slot = bench->slots + i * BENCH_GATEWAY_SLOT;
+        memcpy(slot + BENCH_GATEWAY_HEADROOM, handle->byte_stream, handle->length);
+        bench->frames[i] = (goose_gateway_frame){ slot, BENCH_GATEWAY_SLOT, BENCH_GATEWAY_HEADROOM, handle->length, 0, (void*)i };
+    }
+    bench->next = 0;
+    return 0;
+}
+
+static void bench_gateway_case_run(const char* name, goose_handle* handle, uint8_t flags, const goose_auth_keyring* sign, uint8_t* slots)
+{
+    char params[128];
+    bench_gateway_case* bench = (bench_gateway_case*)malloc(sizeof(bench_gateway_case));
+    if (!bench) return;
+
+    bench->slots = slots;
+    bench->gateway = goose_gateway_create(64);
+    if (!bench->gateway || bench_gateway_load(bench, handle) != 0)
+    {
+        goose_gateway_free(bench->gateway);
+        free(bench);
+        return;
+    }
+
+    for (size_t i = 0; i < BENCH_GATEWAY_STREAMS; i++)
+    {
+        goose_gateway_rule rule = { 0 };
+        rule.flags = GOOSE_GATEWAY_SET_DESTINATION | GOOSE_GATEWAY_SET_VLAN | flags;
+        rule.app_id = (uint16_t)(0x1000 + i);
+        memcpy(rule.source, bench->slots + i * BENCH_GATEWAY_SLOT + BENCH_GATEWAY_HEADROOM + MAC_ADDRESS_SIZE, MAC_ADDRESS_SIZE);
+        memcpy(rule.destination, (uint8_t[])GOOSE_MULTICAST_ADDRESS(0x01, 0x00), MAC_ADDRESS_SIZE);
+        rule.destination[5] = (uint8_t)i;
+        rule.vlan_priority = 6;
+        rule.vlan_id = (uint16_t)(1 + i % 16);
+        rule.sign = sign;
+        rule.port = (uint16_t)(i % 4);
+        goose_gateway_rule_add(bench->gateway, &rule);
+    }
+
+    snprintf(params, sizeof(params), "{\"streams\": %d, \"frame_bytes\": %zu, \"signed\": %s}",
+        BENCH_GATEWAY_STREAMS, bench->frames[0].length, sign ? "true" : "false");
+    bench_run(name, params, run_goose_gateway, bench, 1.0, "frames");
+
+    goose_gateway_free(bench->gateway);
+    free(bench);
+}
+
+void bench_gateway(void)
+{
+    goose_handle* handle = bench_goose_handle(8);
+    uint8_t* slots = (uint8_t*)malloc((size_t)BENCH_GATEWAY_STREAMS * BENCH_GATEWAY_SLOT);
+    goose_auth_keyring* keyring = goose_auth_keyring_create();
+    if (!handle || !slots || !keyring)
+    {
+        goose_free(handle);
+        free(slots);
+        goose_auth_keyring_free(keyring);
+        return;
+    }
+    goose_vlan_set(handle, 4, 0x001);
+    goose_auth_key_set(keyring, 1, bench_gateway_key, sizeof(bench_gateway_key) - 1);
+
+    bench_gateway_case_run("goose_gateway_rewrite", handle, 0, NULL, slots);
+    bench_gateway_case_run("goose_gateway_rewrite_match_source", handle, GOOSE_GATEWAY_MATCH_SOURCE, NULL, slots);
+    bench_gateway_case_run("goose_gateway_rewrite_restamp", handle, GOOSE_GATEWAY_RESTAMP, NULL, slots);
+    bench_gateway_case_run("goose_gateway_rewrite_sign", handle, GOOSE_GATEWAY_RESTAMP, keyring, slots);
+
+    goose_auth_keyring_free(keyring);
+    free(slots);
+    goose_free(handle);
+}
@@ -0,0 +1,144 @@
+#include "bench.h"
+#include "goose.h"
+#include <stdio.h>
+#include <string.h>
+
+static void run_goose_encode_full(void* ctx, size_t iterations)
+{
+    goose_handle* handle = (goose_handle*)ctx;
+    for (size_t i = 0; i < iterations; i++)
+    {
+        goose_encode_full(handle);
+        bench_sink(handle->byte_stream);
+    }
+}
+
+// One member in the middle of the dataset flips, then goose_encode rewrites it in place
+static void run_goose_encode_member(void* ctx, size_t iterations)
+{
+    goose_handle* handle = (goose_handle*)ctx;
+    size_t index = handle->frame->pdu_list.all_data_list.entry_count / 2;
+    for (size_t i = 0; i < iterations; i++)
+    {
+        uint8_t value = (uint8_t)(i & 1);
+        goose_all_data_entry_modify(handle, index, 0x83, sizeof(value), &value);
+        goose_encode(handle);
+        bench_sink(handle->byte_stream);
+    }
+}
+
+// The same member alternates between visible strings of different lengths, so every
+// encode moves the rest of allData
+static void run_goose_encode_member_resize(void* ctx, size_t iterations)
+{
+    goose_handle* handle = (goose_handle*)ctx;
+    size_t index = handle->frame->pdu_list.all_data_list.entry_count / 2;
+    uint8_t text[] = "breaker open";
+    for (size_t i = 0; i < iterations; i++)
+    {
+        goose_all_data_entry_modify(handle, index, 0x8a, (i & 1) ? sizeof(text) - 1 : 4, text);
+        goose_encode(handle);
+        bench_sink(handle->byte_stream);
+    }
+}
+
+#define BENCH_BATCH_SIZE 64
+
+typedef struct
+{
+    goose_handle* handles[BENCH_BATCH_SIZE];
+    size_t count;
+} bench_batch;
+
+static void bench_batch_output(uint8_t* byte_stream, size_t length)
+{
+    bench_sink(byte_stream);
+    (void)length;
+}
+
+static void run_goose_encode_batch(void* ctx, size_t iterations)
+{
+    bench_batch* batch = (bench_batch*)ctx;
+    for (size_t i = 0; i < iterations; i++)
+    {
+        goose_encode_batch(batch->handles, batch->count, bench_batch_output, NULL, NULL);
+    }
+}
+
+// Builds a control block shaped like the one in test/main.c with `entries` booleans
+goose_handle* bench_goose_handle(size_t entries)
+{
+    uint8_t source[MAC_ADDRESS_SIZE] = { 0x00, 0x30, 0xa7, 0x03, 0xc1, 0x53 };
+    uint8_t destination[MAC_ADDRESS_SIZE] = GOOSE_MULTICAST_ADDRESS(0x00, 0x01);
+    uint8_t app_id[APP_ID_SIZE] = { 0x00, 0x05 };
+    const char* gocbref = "CPC UNIFEI/LLN0$GO$TestDataSet";
+    const char* dataset = "CPC UNIFEI/LLN0$TestDataSet";
+    const char* go_id = "CPC UNIFEI GOID";
+
+    goose_handle* handle = goose_init(source, destination, app_id);
+    if (!handle) return NULL;
+
+    uint16_t time_allowed_to_live = goose_htons(2000);
+    uint64_t t = goose_htonll(1695149275408396764ULL);
+    uint32_t st_num = goose_htonl(1);
+    uint32_t sq_num = goose_htonl(0);
+    uint8_t simulation = 0;
+    uint8_t conf_rev = 1;
+    uint8_t nds_com = 0;
+
+    ber_set(&(handle->frame->pdu_list.gocbref), (uint8_t*)gocbref, strlen(gocbref));
+    ber_set(&(handle->frame->pdu_list.dataset), (uint8_t*)dataset, strlen(dataset));
+    ber_set(&(handle->frame->pdu_list.go_id), (uint8_t*)go_id, strlen(go_id));
+    ber_set(&(handle->frame->pdu_list.time_allowed_to_live), (uint8_t*)&time_allowed_to_live, sizeof(time_allowed_to_live));
+    ber_set(&(handle->frame->pdu_list.t), (uint8_t*)&t, sizeof(t));
+    ber_set(&(handle->frame->pdu_list.st_num), (uint8_t*)&st_num, sizeof(st_num));
+    ber_set(&(handle->frame->pdu_list.sq_num), (uint8_t*)&sq_num, sizeof(sq_num));
+    ber_set(&(handle->frame->pdu_list.simulation), &simulation, sizeof(simulation));
+    ber_set(&(handle->frame->pdu_list.conf_rev), &conf_rev, sizeof(conf_rev));
+    ber_set(&(handle->frame->pdu_list.nds_com), &nds_com, sizeof(nds_com));
+
+    uint8_t boolean_false = 0;
+    for (size_t i = 0; i < entries; i++)
+    {
+        goose_all_data_entry_add(handle, 0x83, sizeof(boolean_false), &boolean_false);
+    }
+
+    return handle;
+}
+
+void bench_goose(void)
+{
+    char params[64];
+
+    // Up to the library's dataset size: 16 members in bench, 128 in bench_large
+    for (size_t entries = 1; entries <= MAX_NUM_DATASET_ENTRIES; entries *= 2)
+    {
+        goose_handle* handle = bench_goose_handle(entries);
+        if (!handle) return;
+
+        goose_encode(handle);
+        snprintf(params, sizeof(params), "{\"dataset_entries\": %zu, \"frame_bytes\": %zu}", entries, handle->length);
+        bench_run("goose_encode_full", params, run_goose_encode_full, handle, 1.0, "frames");
+        bench_run("goose_encode_member", params, run_goose_encode_member, handle, 1.0, "frames");
+        bench_run("goose_encode_member_resize", params, run_goose_encode_member_resize, handle, 1.0, "frames");
+
+        goose_free(handle);
+    }
+
+    if (!bench_enabled("goose_encode_batch")) return;
+
+    bench_batch batch;
+    batch.count = BENCH_BATCH_SIZE;
+    for (size_t n = 0; n < batch.count; n++)
+    {
+        batch.handles[n] = bench_goose_handle(8);
+    }
+
+    snprintf(params, sizeof(params), "{\"frames\": %zu, \"dataset_entries\": 8}", batch.count);
+    bench_run("goose_encode_batch", params, run_goose_encode_batch, &batch, (double)batch.count, "frames");
+
+    for (size_t n = 0; n < batch.count; n++)
+    {
+        goose_free(batch.handles[n]);
+    }
+}
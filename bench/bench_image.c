@@ -0,0 +1,138 @@
+#include "bench.h"
+#include "goose_image.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+goose_handle* bench_goose_handle(size_t entries);
+
+#define BENCH_IMAGE_PUBLISHERS 1024
+
+typedef struct
+{
+    const uint8_t* bytes;
+    size_t size;
+} bench_image;
+
+// Description shaped like bench_goose_handle: eight booleans per control block
+static char* bench_image_description(size_t publishers)
+{
+    size_t capacity = 512 + publishers * 512;
+    char* text = (char*)malloc(capacity);
+    if (!text) return NULL;
+
+    size_t length = (size_t)snprintf(text, capacity, "dataset Bench\n");
+    for (size_t i = 0; i < 8; i++)
+    {
+        length += (size_t)snprintf(text + length, capacity - length, "    bool false\n");
+    }
+    length += (size_t)snprintf(text + length, capacity - length, "end\n");
+
+    for (size_t i = 0; i < publishers; i++)
+    {
+        length += (size_t)snprintf(text + length, capacity - length,
+            "publisher bench_gocb_%zu\n"
+            "    source 00:30:a7:03:c1:53\n"
+            "    destination 01:0c:cd:01:%02zx:%02zx\n"
+            "    app_id 0x%04zx\n"
+            "    gocbref \"CPC UNIFEI/LLN0$GO$TestDataSet%zu\"\n"
+            "    datset \"CPC UNIFEI/LLN0$TestDataSet\"\n"
+            "    go_id \"CPC UNIFEI GOID\"\n"
+            "    dataset Bench\n"
+            "end\n",
+            i, (i >> 8) & 0xff, i & 0xff, i & 0x3fff, i);
+    }
+
+    return text;
+}
+
+static void run_image_compile(void* ctx, size_t iterations)
+{
+    const char* text = (const char*)ctx;
+    for (size_t i = 0; i < iterations; i++)
+    {
+        uint8_t* bytes;
+        size_t size;
+        goose_image_compile(text, &bytes, &size, NULL, 0);
+        bench_sink(bytes);
+        free(bytes);
+    }
+}
+
+static void run_image_attach(void* ctx, size_t iterations)
+{
+    bench_image* image_bytes = (bench_image*)ctx;
+    for (size_t i = 0; i < iterations; i++)
+    {
+        goose_image image;
+        goose_image_attach(image_bytes->bytes, image_bytes->size, &image);
+        bench_sink(image.header);
+    }
+}
+
+// Startup from the image: validate it and make a ready-to-send handle per publisher
+static void run_image_handles(void* ctx, size_t iterations)
+{
+    static goose_handle* handles[BENCH_IMAGE_PUBLISHERS];
+    bench_image* image_bytes = (bench_image*)ctx;
+
+    for (size_t i = 0; i < iterations; i++)
+    {
+        goose_image image;
+        goose_image_attach(image_bytes->bytes, image_bytes->size, &image);
+        for (size_t n = 0; n < BENCH_IMAGE_PUBLISHERS; n++)
+        {
+            handles[n] = goose_image_handle(&image, n);
+        }
+        for (size_t n = 0; n < BENCH_IMAGE_PUBLISHERS; n++)
+        {
+            goose_free(handles[n]);
+        }
+    }
+}
+
+// The same control blocks built field by field and encoded, as without an image
+static void run_built_handles(void* ctx, size_t iterations)
+{
+    static goose_handle* handles[BENCH_IMAGE_PUBLISHERS];
+    (void)ctx;
+
+    for (size_t i = 0; i < iterations; i++)
+    {
+        for (size_t n = 0; n < BENCH_IMAGE_PUBLISHERS; n++)
+        {
+            handles[n] = bench_goose_handle(8);
+            goose_encode(handles[n]);
+        }
+        for (size_t n = 0; n < BENCH_IMAGE_PUBLISHERS; n++)
+        {
+            goose_free(handles[n]);
+        }
+    }
+}
+
+void bench_image_startup(void)
+{
+    char params[96];
+    bench_image image_bytes;
+    uint8_t* bytes;
+
+    if (!bench_enabled("goose_image") && !bench_enabled("goose_handles_built")) return;
+
+    char* text = bench_image_description(BENCH_IMAGE_PUBLISHERS);
+    if (!text || goose_image_compile(text, &bytes, &image_bytes.size, NULL, 0) != 0)
+    {
+        free(text);
+        return;
+    }
+    image_bytes.bytes = bytes;
+
+    snprintf(params, sizeof(params), "{\"publishers\": %d, \"image_bytes\": %zu}", BENCH_IMAGE_PUBLISHERS, image_bytes.size);
+    bench_run("goose_image_compile", params, run_image_compile, text, BENCH_IMAGE_PUBLISHERS, "control_blocks");
+    bench_run("goose_image_attach", params, run_image_attach, &image_bytes, BENCH_IMAGE_PUBLISHERS, "control_blocks");
+    bench_run("goose_image_handles", params, run_image_handles, &image_bytes, BENCH_IMAGE_PUBLISHERS, "control_blocks");
+    bench_run("goose_handles_built", params, run_built_handles, NULL, BENCH_IMAGE_PUBLISHERS, "control_blocks");
+
+    free(bytes);
+    free(text);
+}
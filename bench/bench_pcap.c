@@ -0,0 +1,152 @@
+#include "bench.h"
+#include "goose.h"
+#include "goose_pcap.h"
+#include "goose_analysis.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+goose_handle* bench_goose_handle(size_t entries);
+
+#define BENCH_PCAP_FRAMES 4096
+#define BENCH_PCAP_STREAMS 64
+
+#if defined(__unix__) || defined(__APPLE__)
+#define BENCH_PCAP_SINK "/dev/null"
+#else
+#define BENCH_PCAP_SINK "NUL"
+#endif
+
+typedef struct
+{
+    uint8_t* capture;	// Classic pcap in memory
+    size_t size;
+    goose_pcap_reader reader;
+    goose_pcap_writer writer;
+    goose_handle* handle;
+} bench_pcap;
+
+// BENCH_PCAP_FRAMES frames of 8 booleans, round robin over BENCH_PCAP_STREAMS APPIDs, 1 ms apart
+static int bench_pcap_capture(bench_pcap* pcap)
+{
+    goose_handle* handle = pcap->handle;
+
+    goose_encode(handle);
+    size_t record_size = 16 + handle->length;
+    pcap->size = 24 + BENCH_PCAP_FRAMES * record_size;
+    pcap->capture = (uint8_t*)malloc(pcap->size);
+    if (!pcap->capture) return -1;
+
+    uint32_t header[6] = { GOOSE_PCAP_MAGIC_NS, 0x00040002u, 0, 0, GOOSE_PCAP_SNAPLEN, GOOSE_PCAP_LINKTYPE_ETHERNET };
+    memcpy(pcap->capture, header, sizeof(header));
+
+    uint8_t* out = pcap->capture + 24;
+    for (uint32_t i = 0; i < BENCH_PCAP_FRAMES; i++)
+    {
+        uint32_t sq_num = goose_htonl(i / BENCH_PCAP_STREAMS);
+        ber_set(&(handle->frame->pdu_list.sq_num), (uint8_t*)&sq_num, sizeof(sq_num));
+        handle->frame->app_id[1] = (uint8_t)(i % BENCH_PCAP_STREAMS);
+        goose_encode(handle);
+
+        uint32_t record[4] = { 1700000000u, (i % 1000) * 1000000u, (uint32_t)handle->length, (uint32_t)handle->length };
+        memcpy(out, record, sizeof(record));
+        memcpy(out + 16, handle->byte_stream, handle->length);
+        out += record_size;
+    }
+
+    return 0;
+}
+
+static void run_goose_pcap_write(void* ctx, size_t iterations)
+{
+    bench_pcap* pcap = (bench_pcap*)ctx;
+    for (size_t i = 0; i < iterations; i++)
+    {
+        goose_pcap_write(&pcap->writer, pcap->handle->byte_stream, pcap->handle->length, i);
+    }
+}
+
+static void run_goose_pcap_next(void* ctx, size_t iterations)
+{
+    bench_pcap* pcap = (bench_pcap*)ctx;
+    goose_pcap_record record;
+
+    for (size_t i = 0; i < iterations; i++)
+    {
+        goose_pcap_reader_rewind(&pcap->reader);
+        while (goose_pcap_next(&pcap->reader, &record) == 1)
+        {
+            bench_sink(record.frame);
+        }
+    }
+}
+
+static void run_goose_analysis_add(void* ctx, size_t iterations)
+{
+    bench_pcap* pcap = (bench_pcap*)ctx;
+    goose_pcap_record record;
+    goose_analysis analysis;
+
+    for (size_t i = 0; i < iterations; i++)
+    {
+        goose_analysis_init(&analysis);
+        goose_pcap_reader_rewind(&pcap->reader);
+        while (goose_pcap_next(&pcap->reader, &record) == 1)
+        {
+            goose_analysis_add(&analysis, record.frame, record.length, record.timestamp_ns);
+        }
+        bench_sink(analysis.streams);
+        goose_analysis_free(&analysis);
+    }
+}
+
+static void bench_pcap_output(uint8_t* byte_stream, size_t length)
+{
+    bench_sink(byte_stream);
+    (void)length;
+}
+
+static void run_goose_pcap_replay(void* ctx, size_t iterations)
+{
+    bench_pcap* pcap = (bench_pcap*)ctx;
+    goose_pcap_replay_params params = { GOOSE_PCAP_REPLAY_FAST, bench_pcap_output, NULL };
+
+    for (size_t i = 0; i < iterations; i++)
+    {
+        goose_pcap_reader_rewind(&pcap->reader);
+        goose_pcap_replay(&pcap->reader, &params);
+    }
+}
+
+void bench_pcap_capture_files(void)
+{
+    char params[96];
+    bench_pcap pcap;
+
+    pcap.handle = bench_goose_handle(8);
+    if (!pcap.handle) return;
+
+    if (bench_pcap_capture(&pcap) != 0 || goose_pcap_reader_attach(&pcap.reader, pcap.capture, pcap.size) != 0)
+    {
+        free(pcap.capture);
+        goose_free(pcap.handle);
+        return;
+    }
+    snprintf(params, sizeof(params), "{\"frames\": %d, \"streams\": %d, \"capture_bytes\": %zu}", BENCH_PCAP_FRAMES, BENCH_PCAP_STREAMS, pcap.size);
+
+    bench_run("goose_pcap_next", params, run_goose_pcap_next, &pcap, (double)BENCH_PCAP_FRAMES, "frames");
+    bench_run("goose_analysis_add", params, run_goose_analysis_add, &pcap, (double)BENCH_PCAP_FRAMES, "frames");
+    bench_run("goose_pcap_replay", params, run_goose_pcap_replay, &pcap, (double)BENCH_PCAP_FRAMES, "frames");
+
+    for (goose_pcap_format format = GOOSE_PCAP_CLASSIC; format <= GOOSE_PCAP_NG; format++)
+    {
+        if (goose_pcap_writer_open(&pcap.writer, BENCH_PCAP_SINK, format) != 0) break;
+
+        snprintf(params, sizeof(params), "{\"format\": \"%s\", \"frame_bytes\": %zu}", format == GOOSE_PCAP_CLASSIC ? "pcap" : "pcapng", pcap.handle->length);
+        bench_run("goose_pcap_write", params, run_goose_pcap_write, &pcap, 1.0, "frames");
+        goose_pcap_writer_close(&pcap.writer);
+    }
+
+    free(pcap.capture);
+    goose_free(pcap.handle);
+}
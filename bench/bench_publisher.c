@@ -0,0 +1,130 @@
+#include "bench.h"
+#include "goose_publisher.h"
+#include <stdio.h>
+
+goose_handle* bench_goose_handle(size_t entries);
+
+static size_t frames_out = 0;
+
+static void count_output(uint8_t* byte_stream, size_t length)
+{
+    bench_sink(byte_stream);
+    (void)length;
+    frames_out++;
+}
+
+static void run_publisher_process(void* ctx, size_t iterations)
+{
+    (void)ctx;
+    for (size_t i = 0; i < iterations; i++)
+    {
+        goose_publisher_process();
+    }
+}
+
+static void run_publisher_next_deadline(void* ctx, size_t iterations)
+{
+    (void)ctx;
+    for (size_t i = 0; i < iterations; i++)
+    {
+        uint64_t next = goose_publisher_next_deadline();
+        bench_sink(&next);
+    }
+}
+
+static void run_iec_time_stamp(void* ctx, size_t iterations)
+{
+    uint8_t t[IEC_TIME_UTC_SIZE];
+    (void)ctx;
+    for (size_t i = 0; i < iterations; i++)
+    {
+        iec_time_stamp(t);
+        bench_sink(t);
+    }
+}
+
+static void run_publisher_notify(void* ctx, size_t iterations)
+{
+    const char* name = (const char*)ctx;
+    for (size_t i = 0; i < iterations; i++)
+    {
+        goose_publisher_notify(name);
+    }
+}
+
+// Notify path with and without T stamping, the difference is the cost of the timestamp
+static void bench_publisher_notify(void)
+{
+    const char* names[] = { "bench_notify", "bench_notify_stamped" };
+    char params[64];
+
+    if (!bench_enabled("iec_time_stamp") && !bench_enabled("goose_publisher_notify")) return;
+
+    bench_run("iec_time_stamp", "{}", run_iec_time_stamp, NULL, 1.0, "stamps");
+
+    goose_publisher_init(count_output);
+
+    for (uint8_t stamped = 0; stamped <= 1; stamped++)
+    {
+        goose_message_params message = { 0 };
+        message.name = names[stamped];
+        message.handle = bench_goose_handle(8);
+        message.default_time_allowed_to_live = 1000;
+        message.time_stamping = stamped;
+        goose_publisher_register(message);
+
+        snprintf(params, sizeof(params), "{\"time_stamping\": %s}", stamped ? "true" : "false");
+        bench_run("goose_publisher_notify", params, run_publisher_notify, (void*)names[stamped], 1.0, "notifies");
+
+        goose_publisher_deregister(names[stamped]);
+        goose_free(message.handle);
+    }
+}
+
+static void bench_publisher_process(void)
+{
+    static char names[MAX_GOOSE_MESSAGES][32];
+    goose_handle* handles[MAX_GOOSE_MESSAGES];
+    char params[96];
+
+    if (!bench_enabled("goose_publisher_process") && !bench_enabled("goose_publisher_next_deadline")) return;
+
+    goose_publisher_init(count_output);
+
+    for (size_t count = 1; count <= MAX_GOOSE_MESSAGES; count++)
+    {
+        size_t slot = count - 1;
+        snprintf(names[slot], sizeof(names[slot]), "bench_gocb_%zu", slot);
+        handles[slot] = bench_goose_handle(8);
+
+        goose_message_params message = { 0 };
+        message.name = names[slot];
+        message.handle = handles[slot];
+        message.default_time_allowed_to_live = 1000;
+        message.updated = 1;
+        goose_publisher_register(message);
+
+        // Only sweep powers of two plus the full table to keep the report short
+        if ((count & (count - 1)) != 0 && count != MAX_GOOSE_MESSAGES) continue;
+
+        // Transmission rate at this load, so tick costs can be compared per frame
+        frames_out = 0;
+        run_publisher_process(NULL, 10000);
+
+        snprintf(params, sizeof(params), "{\"messages\": %zu, \"frames_per_10k_ticks\": %zu}", count, frames_out);
+        bench_run("goose_publisher_process", params, run_publisher_process, NULL, 1.0, "ticks");
+        bench_run("goose_publisher_next_deadline", params, run_publisher_next_deadline, NULL, 1.0, "calls");
+    }
+
+    for (size_t slot = 0; slot < MAX_GOOSE_MESSAGES; slot++)
+    {
+        goose_publisher_deregister(names[slot]);
+        goose_free(handles[slot]);
+    }
+}
+
+void bench_publisher(void)
+{
+    bench_publisher_notify();
+    bench_publisher_process();
+}
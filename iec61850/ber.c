@@ -8,6 +8,7 @@ void ber_init(ber* obj, uint8_t tag)
     obj->tag = tag;
     obj->length = 0x0;
     obj->value = NULL;
+    obj->borrowed = 0;
 }
 
 static inline size_t parse_length(uint8_t* all_bytes, size_t len, size_t* length_bytes_count)
@@ -100,6 +101,7 @@ ber* ber_decode(uint8_t* bytes, size_t len)
     if (!element) return NULL;
 
     element->tag = bytes[0];
+    element->borrowed = 0;
 
     element->length = parse_length(bytes, len, NULL);
     if (element->length == 0)
@@ -203,6 +205,7 @@ ber* ber_decode_many(uint8_t* bytes, size_t len, size_t count) {
         decoded_objects[i].tag = tag;
         decoded_objects[i].length = length;
         decoded_objects[i].value = value;
+        decoded_objects[i].borrowed = 0;
     }
 
     return decoded_objects;  // Return the array of decoded objects
@@ -258,7 +261,7 @@ void ber_free(ber* obj)
 {
     if (obj)
     {
-        if (obj->value)
+        if (obj->value && !obj->borrowed)
         {
             free(obj->value);  // Free the value buffer
         }
@@ -272,7 +275,7 @@ void ber_free_many(ber* obj, size_t count)
     {
         for (size_t i = 0; i < count; i++)
         {
-            if (obj[i].value)
+            if (obj[i].value && !obj[i].borrowed)
             {
                 free(obj[i].value);  // Free the value field for each `ber`
             }
@@ -283,11 +286,12 @@ void ber_free_many(ber* obj, size_t count)
 
 void ber_set(ber* obj, uint8_t* bytes, size_t len)
 {
-    if (obj->value)
+    if (obj->value && !obj->borrowed)
     {
         free(obj->value);
     }
 
+    obj->borrowed = 0;
     obj->value = (uint8_t*)malloc(len);
     if (!obj->value)
     {
@@ -297,4 +301,68 @@ void ber_set(ber* obj, uint8_t* bytes, size_t len)
     memcpy(obj->value, bytes, len);
 
     obj->length = len;
+}
+
+// Reads the tag and length of the TLV at bytes without copying the value.
+// Returns the header size, or 0 if the header or the value runs past len.
+size_t ber_decode_header(uint8_t* bytes, size_t len, uint8_t* tag, size_t* length)
+{
+    if (len < 2) return 0;
+
+    size_t header_len = 2;
+    size_t value_len = bytes[1];
+
+    if (value_len & 0x80)
+    {
+        size_t num_length_bytes = value_len & 0x7F;
+        if (num_length_bytes == 0 || num_length_bytes > sizeof(uint32_t) || 2 + num_length_bytes > len)
+        {
+            return 0;
+        }
+
+        value_len = 0;
+        for (size_t i = 0; i < num_length_bytes; i++)
+        {
+            value_len = (value_len << 8) | bytes[2 + i];
+        }
+        header_len += num_length_bytes;
+    }
+
+    if (value_len > len - header_len) return 0;
+
+    if (tag) *tag = bytes[0];
+    if (length) *length = value_len;
+
+    return header_len;
+}
+
+// Writes the tag and length of a TLV the way ber_encode does, short form up to 127 and
+// the fewest long form bytes above. Returns the header size; bytes may be NULL to only
+// compute it.
+size_t ber_encode_header(uint8_t* bytes, uint8_t tag, size_t length)
+{
+    size_t num_bytes = 0;
+    for (size_t tmp_len = length; length > 127 && tmp_len > 0; tmp_len >>= 8)
+    {
+        num_bytes++;
+    }
+
+    if (bytes)
+    {
+        bytes[0] = tag;
+        if (num_bytes == 0)
+        {
+            bytes[1] = (uint8_t)length;
+        }
+        else
+        {
+            bytes[1] = (uint8_t)(0x80 | num_bytes);
+            for (size_t i = 0; i < num_bytes; i++)
+            {
+                bytes[1 + num_bytes - i] = (uint8_t)(length >> (8 * i));
+            }
+        }
+    }
+
+    return 2 + num_bytes;
 }
\ No newline at end of file
@@ -9,6 +9,7 @@ typedef struct
     uint8_t tag;
     size_t length;
     uint8_t* value;
+    uint8_t borrowed;   // value points into memory the ber does not own; ber_set and the frees leave it alone
 } ber;
 
 void ber_init(ber* obj, uint8_t tag);
@@ -18,4 +19,6 @@ ber* ber_decode_many(uint8_t* bytes, size_t len, size_t count);
 size_t ber_encode(ber* obj, uint8_t** out_bytes);
 size_t ber_encode_many(ber* obj, size_t count, uint8_t** out_bytes);
 void ber_free(ber* obj);
-void ber_free_many(ber* obj, size_t count);
\ No newline at end of file
+void ber_free_many(ber* obj, size_t count);
+size_t ber_decode_header(uint8_t* bytes, size_t len, uint8_t* tag, size_t* length);
+size_t ber_encode_header(uint8_t* bytes, uint8_t tag, size_t length);
\ No newline at end of file
@@ -1,4 +1,6 @@
 ﻿#include "goose.h"
+#include "goose_auth.h"
+#include "goose_stats.h"
 #include "ber.h"
 #include <string.h>
 
@@ -57,8 +59,9 @@ goose_handle* goose_init(uint8_t source[MAC_ADDRESS_SIZE], uint8_t destination[M
 	memcpy(handle->frame->destination, destination, MAC_ADDRESS_SIZE);
 	handle->frame->ethertype[0] = GOOSE_ETHERTYPE_0;
 	handle->frame->ethertype[1] = GOOSE_ETHERTYPE_1;
-	handle->frame->app_id[0] = 0x0;
-	handle->frame->app_id[1] = 0x0;
+	memcpy(handle->frame->app_id, app_id, APP_ID_SIZE);
+	handle->frame->vlan_tagged = 0x0;
+	memset(handle->frame->vlan_tag, 0x0, VLAN_TAG_SIZE);
 	handle->frame->len = 0x0;
 	handle->frame->reserved_1[0] = 0x0;
 	handle->frame->reserved_1[1] = 0x0;
@@ -86,10 +89,162 @@ goose_handle* goose_init(uint8_t source[MAC_ADDRESS_SIZE], uint8_t destination[M
 	handle->frame->pdu_list.all_data_list.entry_count = 0x0;
 	memset(&(handle->byte_stream), 0x0, sizeof(handle->byte_stream));
 	handle->length = 0x0;
+	memset(handle->field_offset, 0x0, sizeof(handle->field_offset));
+	handle->keyring = NULL;
+	memset(&(handle->layout), 0x0, sizeof(handle->layout));
+	handle->values = NULL;
 
 	return handle;
 }
 
+// Tag the frame with an 802.1Q header carrying user priority (0-7) and VLAN ID (0-4095)
+void goose_vlan_set(goose_handle* handle, uint8_t priority, uint16_t vlan_id)
+{
+	if (!handle || priority > VLAN_MAX_PRIORITY || vlan_id > VLAN_MAX_ID)
+		return;
+
+	uint16_t tci = (uint16_t)((priority << 13) | vlan_id);
+
+	handle->frame->vlan_tag[0] = VLAN_TPID_0;
+	handle->frame->vlan_tag[1] = VLAN_TPID_1;
+	handle->frame->vlan_tag[2] = (uint8_t)(tci >> 8);
+	handle->frame->vlan_tag[3] = (uint8_t)(tci & 0xff);
+	handle->frame->vlan_tagged = 1;
+}
+
+// Go back to an untagged frame
+void goose_vlan_clear(goose_handle* handle)
+{
+	if (!handle)
+		return;
+
+	handle->frame->vlan_tagged = 0;
+	memset(handle->frame->vlan_tag, 0x0, VLAN_TAG_SIZE);
+}
+
+// User priority of the frame, untagged frames are ranked at the GOOSE default
+uint8_t goose_vlan_priority(const goose_handle* handle)
+{
+	if (!handle || !handle->frame->vlan_tagged)
+		return GOOSE_DEFAULT_VLAN_PRIORITY;
+
+	return (uint8_t)(handle->frame->vlan_tag[2] >> 5);
+}
+
+// Set T to an 8-byte UtcTime. Once T holds one, later calls overwrite it in place and
+// also patch the last encoded frame, which has the same layout as long as T keeps its size.
+void goose_t_set(goose_handle* handle, const uint8_t t[IEC_TIME_UTC_SIZE])
+{
+	if (!handle)
+		return;
+
+	ber* field = &handle->frame->pdu_list.t;
+	if (!field->value || field->length != IEC_TIME_UTC_SIZE)
+	{
+		ber_set(field, (uint8_t*)t, IEC_TIME_UTC_SIZE);
+		return;
+	}
+
+	memcpy(field->value, t, IEC_TIME_UTC_SIZE);
+
+	size_t offset = handle->field_offset[TAG_T - TAG_GOCBREF];
+	if (handle->length && offset)
+	{
+		memcpy(&(handle->byte_stream[offset]), t, IEC_TIME_UTC_SIZE);
+
+		// T is covered by the MAC
+		if (handle->keyring)
+		{
+			handle->length = goose_auth_sign(handle->keyring, handle->byte_stream, handle->length, sizeof(handle->byte_stream));
+		}
+	}
+}
+
+// Record where each PDU field value and allData member landed in the encoded frame
+static void goose_field_offsets(goose_handle* handle, size_t pdu_offset)
+{
+	uint8_t tag;
+	size_t length;
+	size_t offset = pdu_offset;
+	goose_layout* layout = &(handle->layout);
+
+	memset(handle->field_offset, 0x0, sizeof(handle->field_offset));
+	layout->valid = 0;
+
+	size_t header = ber_decode_header(&(handle->byte_stream[offset]), handle->length - offset, &tag, &length);
+	if (!header)
+		return;
+	offset += header;
+
+	while (offset < handle->length)
+	{
+		header = ber_decode_header(&(handle->byte_stream[offset]), handle->length - offset, &tag, &length);
+		if (!header)
+			return;
+
+		if (tag >= TAG_GOCBREF && tag <= TAG_NUM_DATASET_ENTRIES)
+		{
+			handle->field_offset[tag - TAG_GOCBREF] = offset + header;
+			layout->field_length[tag - TAG_GOCBREF] = length;
+		}
+		else if (tag == TAG_ALL_DATA)
+		{
+			handle->field_offset[GOOSE_PDU_FIELD_COUNT - 1] = offset + header;
+			layout->field_length[GOOSE_PDU_FIELD_COUNT - 1] = length;
+		}
+		offset += header + length;
+	}
+
+	offset = handle->field_offset[GOOSE_PDU_FIELD_COUNT - 1];
+	size_t all_data_end = offset + layout->field_length[GOOSE_PDU_FIELD_COUNT - 1];
+	size_t count = 0;
+	while (offset && offset < all_data_end && count < MAX_NUM_DATASET_ENTRIES)
+	{
+		header = ber_decode_header(&(handle->byte_stream[offset]), all_data_end - offset, &tag, &length);
+		if (!header)
+			return;
+
+		layout->member_offset[count++] = offset;
+		offset += header + length;
+	}
+	layout->member_offset[count] = offset;
+	layout->member_count = count;
+	layout->pdu_offset = pdu_offset;
+	layout->vlan_tagged = handle->frame->vlan_tagged;
+
+	// Every field present and allData last, as goose_encode_full lays them out
+	layout->valid = offset == handle->length && count == handle->frame->pdu_list.all_data_list.entry_count;
+	for (size_t k = 0; k < GOOSE_PDU_FIELD_COUNT; k++)
+	{
+		layout->valid &= handle->field_offset[k] != 0;
+	}
+}
+
+// Record the layout of a frame placed in byte_stream by other means than goose_encode_full,
+// such as a precompiled template, so the next goose_encode only rewrites what changed
+void goose_layout_record(goose_handle* handle)
+{
+	size_t vlan_size = handle->frame->vlan_tagged ? VLAN_TAG_SIZE : 0;
+	size_t pdu_offset = MAC_ADDRESS_SIZE * 2 + vlan_size + ETHERTYPE_SIZE + APP_ID_SIZE + sizeof(handle->frame->len) + 2 * RESERVED_SIZE;
+
+	memset(&(handle->layout), 0x0, sizeof(handle->layout));
+	if (handle->length > pdu_offset)
+	{
+		goose_field_offsets(handle, pdu_offset);
+	}
+}
+
+// Frees a field or member value unless it points into the handle's values block
+static void goose_value_free(ber* field)
+{
+	if (!field->borrowed)
+	{
+		free(field->value);
+	}
+	field->value = NULL;
+	field->borrowed = 0;
+}
+
 // Function to add a new entry to all_data_list by type and value
 void goose_all_data_entry_add(goose_handle* handle, uint8_t type, size_t length, uint8_t* value)
 {
@@ -127,7 +282,7 @@ void goose_all_data_entry_modify(goose_handle* handle, size_t index, uint8_t new
 	ber* entry_data = &all_data_list->entries[index];
 
 	// Free the old value before modifying
-	free(entry_data->value);
+	goose_value_free(entry_data);
 
 	// Update the tag and reallocate for the new value
 	ber_init(entry_data, new_type);
@@ -149,7 +304,7 @@ void goose_all_data_entry_remove(goose_handle* handle, size_t index)
 	goose_all_data* all_data_list = &handle->frame->pdu_list.all_data_list;
 
 	// Free the memory allocated for the value in the BER entry
-	free(all_data_list->entries[index].value);
+	goose_value_free(&(all_data_list->entries[index]));
 
 	// Shift the remaining entries in the array to fill the gap
 	for (size_t j = index; j < all_data_list->entry_count - 1; j++)
@@ -160,7 +315,172 @@ void goose_all_data_entry_remove(goose_handle* handle, size_t index)
 	all_data_list->entry_count--;  // Decrement entry count
 }
 
+// Re-emits the TLV at start when it differs from field. A size change moves the rest of
+// the goosePdu with one memmove and rewrites the allData (when in_all_data) and goosePdu
+// lengths. Returns -1 when an enclosing length would change its own size or the frame
+// would not fit, which leaves the layout to a full encode.
+static int goose_layout_patch(goose_handle* handle, size_t start, const ber* field, int in_all_data, size_t* value_offset)
+{
+	goose_layout* layout = &(handle->layout);
+	uint8_t* bytes = handle->byte_stream;
+	size_t end = layout->member_offset[layout->member_count];
+	uint8_t tag;
+	size_t length;
+
+	size_t old_header = ber_decode_header(&bytes[start], end - start, &tag, &length);
+	if (!old_header)
+		return -1;
+
+	if (tag == field->tag && length == field->length)
+	{
+		if (length && memcmp(&bytes[start + old_header], field->value, length) != 0)
+		{
+			memcpy(&bytes[start + old_header], field->value, length);
+		}
+		*value_offset = start + old_header;
+		return 0;
+	}
+
+	size_t old_size = old_header + length;
+	size_t new_header = ber_encode_header(NULL, field->tag, field->length);
+	size_t new_size = new_header + field->length;
+	if (end - old_size + new_size > sizeof(handle->byte_stream))
+		return -1;
+
+	size_t pdu = layout->pdu_offset;
+	size_t pdu_length;
+	size_t pdu_header = ber_decode_header(&bytes[pdu], end - pdu, &tag, &pdu_length);
+	pdu_length = pdu_length - old_size + new_size;
+	if (!pdu_header || ber_encode_header(NULL, tag, pdu_length) != pdu_header)
+		return -1;
+
+	size_t all_data = handle->field_offset[GOOSE_PDU_FIELD_COUNT - 1];
+	size_t all_data_length = layout->field_length[GOOSE_PDU_FIELD_COUNT - 1];
+	size_t all_data_header = ber_encode_header(NULL, TAG_ALL_DATA, all_data_length);
+	all_data_length = all_data_length - old_size + new_size;
+	if (in_all_data && ber_encode_header(NULL, TAG_ALL_DATA, all_data_length) != all_data_header)
+		return -1;
+
+	memmove(&bytes[start + new_size], &bytes[start + old_size], end - start - old_size);
+	ber_encode_header(&bytes[start], field->tag, field->length);
+	if (field->length)
+	{
+		memcpy(&bytes[start + new_header], field->value, field->length);
+	}
+
+	ber_encode_header(&bytes[pdu], bytes[pdu], pdu_length);
+	if (in_all_data)
+	{
+		ber_encode_header(&bytes[all_data - all_data_header], bytes[all_data - all_data_header], all_data_length);
+		layout->field_length[GOOSE_PDU_FIELD_COUNT - 1] = all_data_length;
+	}
+
+	// Everything after the TLV moved by the same amount
+	for (size_t k = 0; k < GOOSE_PDU_FIELD_COUNT; k++)
+	{
+		if (handle->field_offset[k] > start)
+			handle->field_offset[k] = handle->field_offset[k] - old_size + new_size;
+	}
+	for (size_t i = 0; i <= layout->member_count; i++)
+	{
+		if (layout->member_offset[i] > start)
+			layout->member_offset[i] = layout->member_offset[i] - old_size + new_size;
+	}
+
+	*value_offset = start + new_header;
+	return 0;
+}
+
+// Brings the last encoded frame up to date with the C structures instead of encoding
+// it again: the header is copied, and only fields and allData members whose tag, length
+// or value differ from the encoded ones are written. The result is byte for byte what
+// goose_encode_full produces. Returns -1 when the frame needs a full encode, after a
+// VLAN tag or members were added or removed, or when a length changes form.
+int goose_encode_changes(goose_handle* handle)
+{
+	goose_layout* layout = &(handle->layout);
+	goose_frame* frame = handle->frame;
+	uint8_t* bytes = handle->byte_stream;
+	size_t offset = 0;
+
+	if (!layout->valid || !handle->length || layout->vlan_tagged != frame->vlan_tagged || layout->member_count != frame->pdu_list.all_data_list.entry_count)
+		return -1;
+
+	memcpy(&bytes[offset], frame->destination, MAC_ADDRESS_SIZE);
+	offset += MAC_ADDRESS_SIZE;
+	memcpy(&bytes[offset], frame->source, MAC_ADDRESS_SIZE);
+	offset += MAC_ADDRESS_SIZE;
+	if (frame->vlan_tagged)
+	{
+		memcpy(&bytes[offset], frame->vlan_tag, VLAN_TAG_SIZE);
+		offset += VLAN_TAG_SIZE;
+	}
+	memcpy(&bytes[offset], frame->ethertype, ETHERTYPE_SIZE);
+	offset += ETHERTYPE_SIZE;
+	memcpy(&bytes[offset], frame->app_id, APP_ID_SIZE);
+	offset += APP_ID_SIZE + sizeof(frame->len);
+	memcpy(&bytes[offset], frame->reserved_1, RESERVED_SIZE);
+	offset += RESERVED_SIZE;
+	memcpy(&bytes[offset], frame->reserved_2, RESERVED_SIZE);
+
+	// Same order as goose_pdu; numDatSetEntries follows the member count, allData its members
+	ber* fields = (ber*)&(frame->pdu_list);
+	uint16_t num_dataset_entries = goose_htons((uint16_t)layout->member_count);
+	for (size_t k = 0; k < GOOSE_PDU_FIELD_COUNT - 1; k++)
+	{
+		ber field = fields[k];
+		if (k == TAG_NUM_DATASET_ENTRIES - TAG_GOCBREF)
+		{
+			field.value = (uint8_t*)&num_dataset_entries;
+			field.length = sizeof(num_dataset_entries);
+		}
+
+		size_t start = handle->field_offset[k] - ber_encode_header(NULL, field.tag, layout->field_length[k]);
+		if (goose_layout_patch(handle, start, &field, 0, &(handle->field_offset[k])) != 0)
+			return -1;
+		layout->field_length[k] = field.length;
+	}
+
+	size_t value_offset;
+	for (size_t i = 0; i < layout->member_count; i++)
+	{
+		// Most members are short and unchanged, checked here without decoding the header
+		const ber* entry = &(frame->pdu_list.all_data_list.entries[i]);
+		const uint8_t* member = &bytes[layout->member_offset[i]];
+		if (entry->length < 0x80 && member[0] == entry->tag && member[1] == entry->length
+			&& (!entry->length || memcmp(&member[2], entry->value, entry->length) == 0))
+			continue;
+
+		if (goose_layout_patch(handle, layout->member_offset[i], entry, 1, &value_offset) != 0)
+			return -1;
+	}
+
+	size_t end = layout->member_offset[layout->member_count];
+	uint16_t total_goose_len = (uint16_t)(end - layout->pdu_offset + APP_ID_SIZE + sizeof(frame->len) + 2 * RESERVED_SIZE);
+	frame->len = goose_htons(total_goose_len);
+	memcpy(&bytes[layout->pdu_offset - 2 * RESERVED_SIZE - sizeof(frame->len)], &(frame->len), sizeof(frame->len));
+	handle->length = end;
+
+	if (handle->keyring)
+	{
+		handle->length = goose_auth_sign(handle->keyring, bytes, handle->length, sizeof(handle->byte_stream));
+		layout->valid = handle->length != 0;
+	}
+	return 0;
+}
+
+// Encodes the frame from the C structures. After the first call only what changed is
+// rewritten, see goose_encode_changes.
 void goose_encode(goose_handle* handle)
+{
+	if (goose_encode_changes(handle) != 0)
+	{
+		goose_encode_full(handle);
+	}
+}
+
+// Encodes every field from scratch and records the layout for goose_encode
+void goose_encode_full(goose_handle* handle)
 {
 	uint8_t* temp_bytes = NULL;
 	size_t temp_bytes_len = 0;
@@ -168,9 +488,11 @@ void goose_encode(goose_handle* handle)
 
 	// Reset length and start serializing into the static byte stream
 	handle->length = 0;
+	handle->layout.valid = 0;
 
 	// Calculate the base frame size and ensure it fits in the byte stream
-	size_t header_size = MAC_ADDRESS_SIZE * 2 + ETHERTYPE_SIZE + APP_ID_SIZE + sizeof(handle->frame->len) + 2 * RESERVED_SIZE;
+	size_t vlan_size = handle->frame->vlan_tagged ? VLAN_TAG_SIZE : 0;
+	size_t header_size = MAC_ADDRESS_SIZE * 2 + vlan_size + ETHERTYPE_SIZE + APP_ID_SIZE + sizeof(handle->frame->len) + 2 * RESERVED_SIZE;
 
 	// Encode all_data entries and PDU fields
 	handle->frame->pdu_list.all_data.length = ber_encode_many(
@@ -192,7 +514,7 @@ void goose_encode(goose_handle* handle)
 	temp_bytes_len = ber_encode(&(handle->frame->pdu), &temp_bytes);
 
 	// Ensure the PDU fits in the static byte stream
-	if (offset + temp_bytes_len > sizeof(handle->byte_stream))
+	if (header_size + temp_bytes_len > sizeof(handle->byte_stream))
 	{
 		// Data exceeds byte stream size
 		handle->length = 0;
@@ -200,7 +522,7 @@ void goose_encode(goose_handle* handle)
 		return;
 	}
 
-	uint16_t total_goose_len = temp_bytes_len + header_size - (MAC_ADDRESS_SIZE * 2 + ETHERTYPE_SIZE);
+	uint16_t total_goose_len = temp_bytes_len + header_size - (MAC_ADDRESS_SIZE * 2 + vlan_size + ETHERTYPE_SIZE);
 	handle->frame->len = goose_htons(total_goose_len);
 
 	// Manually serialize the frame fields
@@ -210,6 +532,9 @@ void goose_encode(goose_handle* handle)
 	memcpy(&(handle->byte_stream[offset]), handle->frame->source, MAC_ADDRESS_SIZE);
 	offset += MAC_ADDRESS_SIZE;
 
+	memcpy(&(handle->byte_stream[offset]), handle->frame->vlan_tag, vlan_size);
+	offset += vlan_size;
+
 	memcpy(&(handle->byte_stream[offset]), handle->frame->ethertype, ETHERTYPE_SIZE);
 	offset += ETHERTYPE_SIZE;
 
@@ -231,11 +556,75 @@ void goose_encode(goose_handle* handle)
 	// Update the total length
 	handle->length = offset + temp_bytes_len;
 
+	goose_field_offsets(handle, offset);
+
+	// Append the IEC 62351-6 extension, a frame that cannot be signed is not sent
+	if (handle->keyring)
+	{
+		handle->length = goose_auth_sign(handle->keyring, handle->byte_stream, handle->length, sizeof(handle->byte_stream));
+		handle->layout.valid &= handle->length != 0;
+	}
+
 	// Free temporary buffer
 	free(temp_bytes);
 }
 
 
+// Encode a batch of frames and pass each to output as soon as it is ready, in order.
+// Frames flagged in encoded (when not NULL) are output as they are, see goose_retransmit_patch.
+// encode_ns (when not NULL) receives each frame's encode time, 0 for those not encoded.
+void goose_encode_batch(goose_handle** handles, size_t count, void (*output)(uint8_t* byte_stream, size_t length), const uint8_t* encoded, uint64_t* encode_ns)
+{
+	for (size_t i = 0; i < count; i++)
+	{
+		if (encode_ns)
+		{
+			encode_ns[i] = 0;
+		}
+		if (!encoded || !encoded[i])
+		{
+			uint64_t start_ns = encode_ns ? goose_stats_now_ns() : 0;
+			goose_encode(handles[i]);
+			if (encode_ns)
+			{
+				encode_ns[i] = goose_stats_now_ns() - start_ns;
+			}
+		}
+
+		if (output && handles[i]->length)
+		{
+			output(handles[i]->byte_stream, handles[i]->length);
+		}
+	}
+}
+
+// Rewrite sqNum and timeAllowedtoLive in the last encoded frame and leave every other
+// field as it was encoded, so a retransmission repeats its state even when the dataset
+// has been changed since. Both fields must keep the width they were encoded with.
+// Returns 0, or -1 when there is no encoded frame to patch.
+int goose_retransmit_patch(goose_handle* handle, uint32_t sq_num, uint16_t time_allowed_to_live)
+{
+	const goose_layout* layout = &(handle->layout);
+	size_t sq = TAG_SQ_NUM - TAG_GOCBREF;
+	size_t tatl = TAG_TIME_ALLOWED_TO_LIVE - TAG_GOCBREF;
+
+	if (!layout->valid || !handle->length || layout->field_length[sq] != sizeof(sq_num) || layout->field_length[tatl] != sizeof(time_allowed_to_live))
+		return -1;
+
+	uint32_t sq_num_net = goose_htonl(sq_num);
+	uint16_t time_allowed_to_live_net = goose_htons(time_allowed_to_live);
+	memcpy(&(handle->byte_stream[handle->field_offset[sq]]), &sq_num_net, sizeof(sq_num_net));
+	memcpy(&(handle->byte_stream[handle->field_offset[tatl]]), &time_allowed_to_live_net, sizeof(time_allowed_to_live_net));
+
+	// Both are covered by the MAC
+	if (handle->keyring)
+	{
+		handle->length = goose_auth_sign(handle->keyring, handle->byte_stream, handle->length, sizeof(handle->byte_stream));
+		handle->layout.valid = handle->length != 0;
+	}
+	return 0;
+}
+
 
 void goose_free(goose_handle* handle)
 {
@@ -244,32 +633,146 @@ void goose_free(goose_handle* handle)
 	if (handle->frame)
 	{
 		// Free each PDU field if it was allocated
-		free(handle->frame->pdu_list.gocbref.value);
-		free(handle->frame->pdu_list.time_allowed_to_live.value);
-		free(handle->frame->pdu_list.dataset.value);
-		free(handle->frame->pdu_list.go_id.value);
-		free(handle->frame->pdu_list.t.value);
-		free(handle->frame->pdu_list.st_num.value);
-		free(handle->frame->pdu_list.sq_num.value);
-		free(handle->frame->pdu_list.simulation.value);
-		free(handle->frame->pdu_list.conf_rev.value);
-		free(handle->frame->pdu_list.nds_com.value);
-		free(handle->frame->pdu_list.num_dataset_entries.value);
-		free(handle->frame->pdu_list.all_data.value);
-		free(handle->frame->pdu.value);
+		ber* fields = (ber*)&(handle->frame->pdu_list);
+		for (size_t k = 0; k < GOOSE_PDU_FIELD_COUNT; k++)
+		{
+			goose_value_free(&fields[k]);
+		}
+		goose_value_free(&(handle->frame->pdu));
 
 		// Free the all_data_list entries
 		for (size_t i = 0; i < handle->frame->pdu_list.all_data_list.entry_count; i++)
 		{
 			// Free the value associated with each BER entry
-			free(handle->frame->pdu_list.all_data_list.entries[i].value);
+			goose_value_free(&(handle->frame->pdu_list.all_data_list.entries[i]));
 		}
 
 		// Free the frame structure
 		free(handle->frame);
 	}
 
+	// Values borrowed from a template live in one block, see goose_image_handle
+	free(handle->values);
+
 	// Finally, free the handle itself
 	free(handle);
 }
 
+
+
+// Parses the Ethernet header and the goosePdu fields in place. allData is left
+// undecoded so subscribers can skip it when the state number has not changed.
+// Returns 0 on success, -1 if the frame is not a well formed GOOSE frame.
+int goose_decode(uint8_t* bytes, size_t len, goose_frame_view* view)
+{
+	size_t offset = MAC_ADDRESS_SIZE * 2;
+
+	if (!bytes || !view || len < offset + ETHERTYPE_SIZE)
+		return -1;
+
+	view->destination = bytes;
+	view->source = bytes + MAC_ADDRESS_SIZE;
+	view->vlan_tagged = 0;
+	view->vlan_tci = 0;
+
+	if (bytes[offset] == VLAN_TPID_0 && bytes[offset + 1] == VLAN_TPID_1)
+	{
+		if (len < offset + VLAN_TAG_SIZE + ETHERTYPE_SIZE)
+			return -1;
+
+		view->vlan_tagged = 1;
+		view->vlan_tci = (uint16_t)((bytes[offset + 2] << 8) | bytes[offset + 3]);
+		offset += VLAN_TAG_SIZE;
+	}
+
+	if (bytes[offset] != GOOSE_ETHERTYPE_0 || bytes[offset + 1] != GOOSE_ETHERTYPE_1)
+		return -1;
+	offset += ETHERTYPE_SIZE;
+
+	if (len < offset + APP_ID_SIZE + sizeof(uint16_t) + 2 * RESERVED_SIZE)
+		return -1;
+
+	view->app_id = (uint16_t)((bytes[offset] << 8) | bytes[offset + 1]);
+	view->len = (uint16_t)((bytes[offset + 2] << 8) | bytes[offset + 3]);
+	offset += APP_ID_SIZE + sizeof(uint16_t) + 2 * RESERVED_SIZE;
+
+	uint8_t tag = 0;
+	size_t pdu_length = 0;
+	size_t header_len = ber_decode_header(bytes + offset, len - offset, &tag, &pdu_length);
+	if (header_len == 0 || tag != TAG_PDU)
+		return -1;
+	offset += header_len;
+
+	for (size_t i = 0; i < GOOSE_PDU_FIELD_COUNT; i++)
+	{
+		ber_init(&view->fields[i], 0x0);
+	}
+	view->all_data_list.entry_count = 0;
+
+	size_t end = offset + pdu_length;
+	while (offset < end)
+	{
+		size_t field_length = 0;
+		header_len = ber_decode_header(bytes + offset, end - offset, &tag, &field_length);
+		if (header_len == 0)
+			return -1;
+
+		// gocbRef..numDatSetEntries are context tags 0..10, allData is the last field
+		size_t index = (tag == TAG_ALL_DATA) ? GOOSE_PDU_FIELD_COUNT - 1 : (size_t)(tag - TAG_GOCBREF);
+		if (tag == TAG_ALL_DATA || (tag >= TAG_GOCBREF && tag <= TAG_NUM_DATASET_ENTRIES))
+		{
+			view->fields[index].tag = tag;
+			view->fields[index].length = field_length;
+			view->fields[index].value = bytes + offset + header_len;
+		}
+
+		offset += header_len + field_length;
+	}
+
+	return 0;
+}
+
+// Splits allData of a decoded view into its members, again without copying.
+// Members past MAX_NUM_DATASET_ENTRIES are ignored. Returns the member count or -1.
+int goose_decode_all_data(goose_frame_view* view)
+{
+	ber* all_data = &view->fields[GOOSE_PDU_FIELD_COUNT - 1];
+	size_t offset = 0;
+
+	view->all_data_list.entry_count = 0;
+
+	while (offset < all_data->length)
+	{
+		uint8_t tag = 0;
+		size_t length = 0;
+		size_t header_len = ber_decode_header(all_data->value + offset, all_data->length - offset, &tag, &length);
+		if (header_len == 0)
+			return -1;
+
+		if (view->all_data_list.entry_count < MAX_NUM_DATASET_ENTRIES)
+		{
+			ber* entry = &view->all_data_list.entries[view->all_data_list.entry_count++];
+			entry->tag = tag;
+			entry->length = length;
+			entry->value = all_data->value + offset + header_len;
+		}
+
+		offset += header_len + length;
+	}
+
+	return (int)view->all_data_list.entry_count;
+}
+
+// Reads an unsigned integer field (stNum, sqNum, timeAllowedtoLive...) of up to 4 bytes
+uint32_t goose_field_uint(const ber* field)
+{
+	uint32_t value = 0;
+	size_t length = field->length > sizeof(uint32_t) ? sizeof(uint32_t) : field->length;
+
+	for (size_t i = field->length - length; i < field->length; i++)
+	{
+		value = (value << 8) | field->value[i];
+	}
+
+	return value;
+}
\ No newline at end of file
@@ -2,6 +2,7 @@
 
 #include <stdint.h>
 #include "ber.h"
+#include "iec_time.h"
 
 #define APP_ID_SIZE 2
 #define RESERVED_SIZE 2
@@ -12,6 +13,15 @@
 #define GOOSE_ETHERTYPE_0 0x88
 #define GOOSE_ETHERTYPE_1 0xb8
 
+#define VLAN_TAG_SIZE 4
+#define VLAN_TPID_0 0x81
+#define VLAN_TPID_1 0x00
+#define VLAN_MAX_PRIORITY 7
+#define VLAN_MAX_ID 0x0fff
+
+// Default user priority for GOOSE per IEC 61850-8-1, trip-class traffic uses 6 or 7
+#define GOOSE_DEFAULT_VLAN_PRIORITY 4
+
 #define TAG_PDU 0x61
 #define TAG_GOCBREF 0x80
 #define TAG_TIME_ALLOWED_TO_LIVE 0x81
@@ -28,7 +38,10 @@
 
 #define GOOSE_MULTICAST_ADDRESS(last_byte0, last_byte1) { 0x01, 0x0C, 0xCD, 0x01, last_byte0, last_byte1 }
 
+// Members per dataset, sized at compile time
+#ifndef MAX_NUM_DATASET_ENTRIES
 #define MAX_NUM_DATASET_ENTRIES 16
+#endif
 
 typedef struct
 {
@@ -57,6 +70,8 @@ typedef struct
 {
 	uint8_t destination[MAC_ADDRESS_SIZE];
 	uint8_t source[MAC_ADDRESS_SIZE];
+	uint8_t vlan_tagged;
+	uint8_t vlan_tag[VLAN_TAG_SIZE];	// 802.1Q TPID and TCI, written after source when vlan_tagged
 	uint8_t ethertype[ETHERTYPE_SIZE];
 	uint8_t app_id[APP_ID_SIZE];
 	uint16_t len;
@@ -66,17 +81,62 @@ typedef struct
 	goose_pdu pdu_list;
 } goose_frame;
 
+// Defined in goose_auth.c, see goose_auth.h
+typedef struct goose_auth_keyring goose_auth_keyring;
+
+// Where the last goose_encode put each field, so the next one can rewrite only what changed
+typedef struct
+{
+	size_t pdu_offset;	// goosePdu tag
+	size_t field_length[GOOSE_PDU_FIELD_COUNT];	// Value length of each field at field_offset
+	size_t member_offset[MAX_NUM_DATASET_ENTRIES + 1];	// Each allData member TLV, then the end of the goosePdu
+	size_t member_count;
+	uint8_t vlan_tagged;
+	uint8_t valid;
+} goose_layout;
+
 typedef struct {
 	goose_frame* frame;
 	uint8_t byte_stream[1524];
 	size_t length;
+	size_t field_offset[GOOSE_PDU_FIELD_COUNT];	// Where each PDU field value starts in byte_stream, 0 when absent
+	const goose_auth_keyring* keyring;	// Signs encoded frames when set (goose_auth_enable)
+	goose_layout layout;
+	uint8_t* values;	// Block the borrowed field and member values point into, freed with the handle
 } goose_handle;
 
+// Decoded view of a received frame. Every ber value points into the frame
+// bytes, so the view is only valid as long as the frame buffer is.
+typedef struct
+{
+	uint8_t* destination;
+	uint8_t* source;
+	uint8_t vlan_tagged;
+	uint16_t vlan_tci;
+	uint16_t app_id;
+	uint16_t len;
+	ber fields[GOOSE_PDU_FIELD_COUNT];	// Same order as goose_pdu, tag 0 when absent
+	goose_all_data all_data_list;		// Filled by goose_decode_all_data
+} goose_frame_view;
+
+int goose_decode(uint8_t* bytes, size_t len, goose_frame_view* view);
+int goose_decode_all_data(goose_frame_view* view);
+uint32_t goose_field_uint(const ber* field);
+
 goose_handle* goose_init(uint8_t source[MAC_ADDRESS_SIZE], uint8_t destination[MAC_ADDRESS_SIZE], uint8_t app_id[APP_ID_SIZE]);
+void goose_vlan_set(goose_handle* handle, uint8_t priority, uint16_t vlan_id);
+void goose_vlan_clear(goose_handle* handle);
+uint8_t goose_vlan_priority(const goose_handle* handle);
+void goose_t_set(goose_handle* handle, const uint8_t t[IEC_TIME_UTC_SIZE]);
 void goose_all_data_entry_add(goose_handle* handle, uint8_t type, size_t length, uint8_t* value);
 void goose_all_data_entry_modify(goose_handle* handle, size_t index, uint8_t new_type, size_t new_length, uint8_t* new_value);
 void goose_all_data_entry_remove(goose_handle* handle, size_t index);
 void goose_encode(goose_handle* handle);
+void goose_encode_full(goose_handle* handle);
+int goose_encode_changes(goose_handle* handle);
+void goose_layout_record(goose_handle* handle);
+void goose_encode_batch(goose_handle** handles, size_t count, void (*output)(uint8_t* byte_stream, size_t length), const uint8_t* encoded, uint64_t* encode_ns);
+int goose_retransmit_patch(goose_handle* handle, uint32_t sq_num, uint16_t time_allowed_to_live);
 void goose_free(goose_handle* handle);
 uint16_t goose_htons(uint16_t hostshort);
 uint32_t goose_htonl(uint32_t hostlong);
@@ -0,0 +1,235 @@
+#include "goose_analysis.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define NS_PER_MILLISECOND 1000000ULL
+#define FNV_OFFSET 2166136261u
+#define FNV_PRIME 16777619u
+
+void goose_analysis_init(goose_analysis* analysis)
+{
+    memset(analysis, 0x0, sizeof(*analysis));
+}
+
+void goose_analysis_free(goose_analysis* analysis)
+{
+    free(analysis->streams);
+    free(analysis->index);
+    memset(analysis, 0x0, sizeof(*analysis));
+}
+
+static uint32_t fnv1a(uint32_t hash, const uint8_t* bytes, size_t length)
+{
+    for (size_t i = 0; i < length; i++)
+    {
+        hash = (hash ^ bytes[i]) * FNV_PRIME;
+    }
+    return hash;
+}
+
+// Offset of the EtherType, past an 802.1Q tag if there is one
+static size_t ethertype_offset(const uint8_t* frame, size_t length)
+{
+    size_t offset = MAC_ADDRESS_SIZE * 2;
+
+    if (length >= offset + VLAN_TAG_SIZE + ETHERTYPE_SIZE && frame[offset] == VLAN_TPID_0 && frame[offset + 1] == VLAN_TPID_1)
+    {
+        offset += VLAN_TAG_SIZE;
+    }
+    return offset;
+}
+
+uint32_t goose_analysis_stream_hash(const uint8_t* frame, size_t length)
+{
+    size_t offset = ethertype_offset(frame, length);
+
+    if (length < offset + ETHERTYPE_SIZE + APP_ID_SIZE)
+    {
+        return 0;
+    }
+
+    uint32_t hash = fnv1a(FNV_OFFSET, frame + MAC_ADDRESS_SIZE, MAC_ADDRESS_SIZE);
+    return fnv1a(hash, frame + offset + ETHERTYPE_SIZE, APP_ID_SIZE);
+}
+
+static uint32_t stream_key_hash(const uint8_t* source, uint16_t app_id, const ber* gocbref)
+{
+    uint8_t app_id_bytes[2] = { (uint8_t)(app_id >> 8), (uint8_t)app_id };
+    uint32_t hash = fnv1a(FNV_OFFSET, source, MAC_ADDRESS_SIZE);
+    hash = fnv1a(hash, app_id_bytes, sizeof(app_id_bytes));
+    return fnv1a(hash, gocbref->value, gocbref->length);
+}
+
+static int stream_matches(const goose_stream_stats* stream, const uint8_t* source, uint16_t app_id, const ber* gocbref)
+{
+    return stream->app_id == app_id
+        && memcmp(stream->source, source, MAC_ADDRESS_SIZE) == 0
+        && strlen(stream->gocbref) == gocbref->length
+        && memcmp(stream->gocbref, gocbref->value, gocbref->length) == 0;
+}
+
+// Keeps the index at most half full
+static int index_grow(goose_analysis* analysis)
+{
+    size_t size = analysis->index_size ? analysis->index_size * 2 : 64;
+    uint32_t* index = (uint32_t*)calloc(size, sizeof(uint32_t));
+    if (!index)
+    {
+        return -1;
+    }
+
+    for (size_t i = 0; i < analysis->stream_count; i++)
+    {
+        goose_stream_stats* stream = &analysis->streams[i];
+        ber gocbref = { TAG_GOCBREF, strlen(stream->gocbref), (uint8_t*)stream->gocbref };
+        size_t slot = stream_key_hash(stream->source, stream->app_id, &gocbref) & (size - 1);
+
+        while (index[slot])
+        {
+            slot = (slot + 1) & (size - 1);
+        }
+        index[slot] = (uint32_t)(i + 1);
+    }
+
+    free(analysis->index);
+    analysis->index = index;
+    analysis->index_size = size;
+    return 0;
+}
+
+static goose_stream_stats* stream_find(goose_analysis* analysis, const uint8_t* source, uint16_t app_id, const ber* gocbref, int* created)
+{
+    if ((analysis->stream_count + 1) * 2 > analysis->index_size && index_grow(analysis) != 0)
+    {
+        return NULL;
+    }
+
+    size_t mask = analysis->index_size - 1;
+    size_t slot = stream_key_hash(source, app_id, gocbref) & mask;
+
+    while (analysis->index[slot])
+    {
+        goose_stream_stats* stream = &analysis->streams[analysis->index[slot] - 1];
+        if (stream_matches(stream, source, app_id, gocbref))
+        {
+            *created = 0;
+            return stream;
+        }
+        slot = (slot + 1) & mask;
+    }
+
+    if (analysis->stream_count == analysis->stream_capacity)
+    {
+        size_t capacity = analysis->stream_capacity ? analysis->stream_capacity * 2 : 16;
+        goose_stream_stats* streams = (goose_stream_stats*)realloc(analysis->streams, capacity * sizeof(goose_stream_stats));
+        if (!streams)
+        {
+            return NULL;
+        }
+        analysis->streams = streams;
+        analysis->stream_capacity = capacity;
+    }
+
+    goose_stream_stats* stream = &analysis->streams[analysis->stream_count];
+    memset(stream, 0x0, sizeof(*stream));
+    memcpy(stream->source, source, MAC_ADDRESS_SIZE);
+    stream->app_id = app_id;
+    memcpy(stream->gocbref, gocbref->value, gocbref->length);
+
+    analysis->index[slot] = (uint32_t)(++analysis->stream_count);
+    *created = 1;
+    return stream;
+}
+
+int goose_analysis_add(goose_analysis* analysis, const uint8_t* frame, size_t length, uint64_t timestamp_ns)
+{
+    goose_frame_view view;
+
+    analysis->frames++;
+
+    size_t offset = ethertype_offset(frame, length);
+    if (length < offset + ETHERTYPE_SIZE || frame[offset] != GOOSE_ETHERTYPE_0 || frame[offset + 1] != GOOSE_ETHERTYPE_1)
+    {
+        analysis->non_goose++;
+        return 0;
+    }
+
+    ber* gocbref = &view.fields[TAG_GOCBREF - TAG_GOCBREF];
+    if (goose_decode((uint8_t*)frame, length, &view) != 0 || gocbref->tag == 0 || gocbref->length >= GOOSE_ANALYSIS_GOCBREF_SIZE)
+    {
+        analysis->malformed++;
+        return 0;
+    }
+
+    int created;
+    goose_stream_stats* stream = stream_find(analysis, view.source, view.app_id, gocbref, &created);
+    if (!stream)
+    {
+        return -1;
+    }
+
+    uint32_t st_num = goose_field_uint(&view.fields[TAG_ST_NUM - TAG_GOCBREF]);
+    uint32_t sq_num = goose_field_uint(&view.fields[TAG_SQ_NUM - TAG_GOCBREF]);
+    uint32_t time_allowed_to_live = goose_field_uint(&view.fields[TAG_TIME_ALLOWED_TO_LIVE - TAG_GOCBREF]);
+
+    stream->frames++;
+    stream->bytes += length;
+
+    if (created)
+    {
+        stream->first_ns = timestamp_ns;
+        stream->last_ns = timestamp_ns;
+        stream->st_num = st_num;
+        stream->sq_num = sq_num;
+        stream->time_allowed_to_live = time_allowed_to_live;
+        return 0;
+    }
+
+    if (timestamp_ns >= stream->last_ns)
+    {
+        uint64_t interval = timestamp_ns - stream->last_ns;
+        if (interval > stream->max_interval_ns)
+        {
+            stream->max_interval_ns = interval;
+        }
+        if (stream->time_allowed_to_live && interval > (uint64_t)stream->time_allowed_to_live * NS_PER_MILLISECOND)
+        {
+            stream->tatl_violations++;
+        }
+        stream->last_ns = timestamp_ns;
+    }
+
+    // Serial number arithmetic, so the counters survive stNum and sqNum wrapping
+    int32_t st_step = (int32_t)(st_num - stream->st_num);
+    int32_t sq_step = (int32_t)(sq_num - stream->sq_num);
+
+    if (st_step > 0)
+    {
+        stream->state_changes++;
+        stream->missed_state_changes += (uint32_t)st_step - 1;
+    }
+    else if (st_step < 0 || sq_step <= 0)
+    {
+        stream->out_of_order++;
+        return 0;
+    }
+    else
+    {
+        stream->sq_num_gaps += (uint32_t)sq_step - 1;
+    }
+
+    stream->st_num = st_num;
+    stream->sq_num = sq_num;
+    stream->time_allowed_to_live = time_allowed_to_live;
+    return 0;
+}
+
+double goose_stream_stats_rate(const goose_stream_stats* stream)
+{
+    if (stream->frames < 2 || stream->last_ns <= stream->first_ns)
+    {
+        return 0.0;
+    }
+
+    return (double)(stream->frames - 1) * 1e9 / (double)(stream->last_ns - stream->first_ns);
+}
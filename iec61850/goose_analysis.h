@@ -0,0 +1,61 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include "goose.h"
+
+// Offline per-stream statistics over captured frames (see goose_pcap.h). A stream is one
+// publisher control block: source MAC, APPID and gocbRef. Frames of a stream must be added
+// in capture order; streams are independent, so a capture can be split across several
+// analyses by goose_analysis_stream_hash and their results concatenated.
+
+#define GOOSE_ANALYSIS_GOCBREF_SIZE 130	// VisibleString129 plus the terminator
+
+typedef struct
+{
+	uint8_t source[MAC_ADDRESS_SIZE];
+	uint16_t app_id;
+	char gocbref[GOOSE_ANALYSIS_GOCBREF_SIZE];
+
+	uint64_t frames;
+	uint64_t bytes;
+	uint64_t first_ns;
+	uint64_t last_ns;
+	uint64_t max_interval_ns;
+
+	uint32_t st_num;		// Last seen
+	uint32_t sq_num;
+	uint32_t time_allowed_to_live;	// Milliseconds, as announced by the last frame
+
+	uint64_t state_changes;		// stNum moved on
+	uint64_t missed_state_changes;	// stNum skipped values
+	uint64_t sq_num_gaps;		// Frames missing within a state, by sqNum
+	uint64_t out_of_order;		// Duplicates and frames older than the last one
+	uint64_t tatl_violations;	// Next frame later than the previous timeAllowedtoLive
+} goose_stream_stats;
+
+typedef struct
+{
+	goose_stream_stats* streams;
+	size_t stream_count;
+	size_t stream_capacity;
+	uint32_t* index;	// Open addressing, stream number + 1, 0 when free
+	size_t index_size;
+
+	uint64_t frames;
+	uint64_t non_goose;	// Frames of other EtherTypes
+	uint64_t malformed;	// GOOSE EtherType that does not decode
+} goose_analysis;
+
+void goose_analysis_init(goose_analysis* analysis);
+void goose_analysis_free(goose_analysis* analysis);
+
+// Returns 0, or -1 if the stream table cannot grow
+int goose_analysis_add(goose_analysis* analysis, const uint8_t* frame, size_t length, uint64_t timestamp_ns);
+
+// Hash of source MAC and APPID read straight from the Ethernet header, every frame of a
+// stream gets the same value. Frames too short to carry them hash to 0.
+uint32_t goose_analysis_stream_hash(const uint8_t* frame, size_t length);
+
+// Frames per second between the first and the last frame of the stream
+double goose_stream_stats_rate(const goose_stream_stats* stream);
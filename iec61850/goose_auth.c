@@ -0,0 +1,475 @@
+#include "goose_auth.h"
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+
+// SHA-256
+
+static const uint32_t sha256_k[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+};
+
+static const uint32_t sha256_initial_state[8] = {
+    0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
+};
+
+#define ROTR(x, n) (((x) >> (n)) | ((x) << (32 - (n))))
+
+static void sha256_compress(uint32_t state[8], const uint8_t block[GOOSE_SHA256_BLOCK_SIZE])
+{
+    uint32_t w[64];
+
+    for (size_t i = 0; i < 16; i++)
+    {
+        w[i] = ((uint32_t)block[i * 4] << 24) | ((uint32_t)block[i * 4 + 1] << 16) | ((uint32_t)block[i * 4 + 2] << 8) | block[i * 4 + 3];
+    }
+    for (size_t i = 16; i < 64; i++)
+    {
+        uint32_t s0 = ROTR(w[i - 15], 7) ^ ROTR(w[i - 15], 18) ^ (w[i - 15] >> 3);
+        uint32_t s1 = ROTR(w[i - 2], 17) ^ ROTR(w[i - 2], 19) ^ (w[i - 2] >> 10);
+        w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+    }
+
+    uint32_t a = state[0], b = state[1], c = state[2], d = state[3];
+    uint32_t e = state[4], f = state[5], g = state[6], h = state[7];
+
+    for (size_t i = 0; i < 64; i++)
+    {
+        uint32_t t1 = h + (ROTR(e, 6) ^ ROTR(e, 11) ^ ROTR(e, 25)) + ((e & f) ^ (~e & g)) + sha256_k[i] + w[i];
+        uint32_t t2 = (ROTR(a, 2) ^ ROTR(a, 13) ^ ROTR(a, 22)) + ((a & b) ^ (a & c) ^ (b & c));
+        h = g;
+        g = f;
+        f = e;
+        e = d + t1;
+        d = c;
+        c = b;
+        b = a;
+        a = t1 + t2;
+    }
+
+    state[0] += a; state[1] += b; state[2] += c; state[3] += d;
+    state[4] += e; state[5] += f; state[6] += g; state[7] += h;
+}
+
+void goose_sha256_init(goose_sha256_context* context)
+{
+    memcpy(context->state, sha256_initial_state, sizeof(context->state));
+    context->length = 0;
+    context->buffered = 0;
+}
+
+void goose_sha256_update(goose_sha256_context* context, const uint8_t* data, size_t length)
+{
+    context->length += length;
+
+    if (context->buffered)
+    {
+        size_t take = GOOSE_SHA256_BLOCK_SIZE - context->buffered;
+        if (take > length)
+        {
+            take = length;
+        }
+        memcpy(&context->buffer[context->buffered], data, take);
+        context->buffered += take;
+        data += take;
+        length -= take;
+
+        if (context->buffered < GOOSE_SHA256_BLOCK_SIZE)
+        {
+            return;
+        }
+        sha256_compress(context->state, context->buffer);
+        context->buffered = 0;
+    }
+
+    // Whole blocks are compressed straight from the caller's buffer
+    while (length >= GOOSE_SHA256_BLOCK_SIZE)
+    {
+        sha256_compress(context->state, data);
+        data += GOOSE_SHA256_BLOCK_SIZE;
+        length -= GOOSE_SHA256_BLOCK_SIZE;
+    }
+
+    memcpy(context->buffer, data, length);
+    context->buffered = length;
+}
+
+void goose_sha256_final(goose_sha256_context* context, uint8_t digest[GOOSE_SHA256_SIZE])
+{
+    uint64_t bits = context->length * 8;
+
+    context->buffer[context->buffered++] = 0x80;
+    if (context->buffered > GOOSE_SHA256_BLOCK_SIZE - 8)
+    {
+        memset(&context->buffer[context->buffered], 0x0, GOOSE_SHA256_BLOCK_SIZE - context->buffered);
+        sha256_compress(context->state, context->buffer);
+        context->buffered = 0;
+    }
+    memset(&context->buffer[context->buffered], 0x0, GOOSE_SHA256_BLOCK_SIZE - 8 - context->buffered);
+    for (size_t i = 0; i < 8; i++)
+    {
+        context->buffer[GOOSE_SHA256_BLOCK_SIZE - 1 - i] = (uint8_t)(bits >> (i * 8));
+    }
+    sha256_compress(context->state, context->buffer);
+
+    for (size_t i = 0; i < 8; i++)
+    {
+        digest[i * 4] = (uint8_t)(context->state[i] >> 24);
+        digest[i * 4 + 1] = (uint8_t)(context->state[i] >> 16);
+        digest[i * 4 + 2] = (uint8_t)(context->state[i] >> 8);
+        digest[i * 4 + 3] = (uint8_t)context->state[i];
+    }
+}
+
+void goose_sha256(const uint8_t* data, size_t length, uint8_t digest[GOOSE_SHA256_SIZE])
+{
+    goose_sha256_context context;
+
+    goose_sha256_init(&context);
+    goose_sha256_update(&context, data, length);
+    goose_sha256_final(&context, digest);
+}
+
+// HMAC-SHA256
+
+// States after compressing the key block xor ipad and xor opad
+static void hmac_states(const uint8_t* key, size_t key_length, uint32_t inner[8], uint32_t outer[8])
+{
+    uint8_t block[GOOSE_SHA256_BLOCK_SIZE] = { 0 };
+
+    if (key_length > GOOSE_SHA256_BLOCK_SIZE)
+    {
+        goose_sha256(key, key_length, block);
+    }
+    else if (key_length)
+    {
+        memcpy(block, key, key_length);
+    }
+
+    for (size_t i = 0; i < GOOSE_SHA256_BLOCK_SIZE; i++)
+    {
+        block[i] ^= 0x36;
+    }
+    memcpy(inner, sha256_initial_state, sizeof(sha256_initial_state));
+    sha256_compress(inner, block);
+
+    for (size_t i = 0; i < GOOSE_SHA256_BLOCK_SIZE; i++)
+    {
+        block[i] ^= 0x36 ^ 0x5c;
+    }
+    memcpy(outer, sha256_initial_state, sizeof(sha256_initial_state));
+    sha256_compress(outer, block);
+
+    memset(block, 0x0, sizeof(block));
+}
+
+static void hmac_finish(const uint32_t inner[8], const uint32_t outer[8], const uint8_t* data, size_t length, uint8_t mac[GOOSE_SHA256_SIZE])
+{
+    goose_sha256_context context;
+    uint8_t digest[GOOSE_SHA256_SIZE];
+
+    memcpy(context.state, inner, sizeof(context.state));
+    context.length = GOOSE_SHA256_BLOCK_SIZE;
+    context.buffered = 0;
+    goose_sha256_update(&context, data, length);
+    goose_sha256_final(&context, digest);
+
+    memcpy(context.state, outer, sizeof(context.state));
+    context.length = GOOSE_SHA256_BLOCK_SIZE;
+    context.buffered = 0;
+    goose_sha256_update(&context, digest, sizeof(digest));
+    goose_sha256_final(&context, mac);
+}
+
+void goose_hmac_sha256(const uint8_t* key, size_t key_length, const uint8_t* data, size_t length, uint8_t mac[GOOSE_SHA256_SIZE])
+{
+    uint32_t inner[8];
+    uint32_t outer[8];
+
+    hmac_states(key, key_length, inner, outer);
+    hmac_finish(inner, outer, data, length, mac);
+}
+
+// Keyring
+
+// Each slot is a sequence lock: the writer makes sequence odd while it rewrites the slot,
+// readers copy the slot and retry if the sequence was odd or moved. Every word is a
+// relaxed atomic so the copy is race free, the loads are plain moves on common targets.
+typedef struct
+{
+    _Atomic uint32_t sequence;
+    _Atomic uint32_t present;
+    _Atomic uint32_t key_id;
+    _Atomic uint32_t inner[8];
+    _Atomic uint32_t outer[8];
+} auth_key_slot;
+
+typedef struct
+{
+    uint32_t present;
+    uint32_t key_id;
+    uint32_t inner[8];
+    uint32_t outer[8];
+} auth_key;
+
+struct goose_auth_keyring
+{
+    auth_key_slot slots[2];
+    _Atomic uint32_t current;	// Slot that signs, the other holds the previous key
+};
+
+static void auth_key_read(const auth_key_slot* slot, auth_key* key)
+{
+    auth_key_slot* source = (auth_key_slot*)slot;
+    uint32_t before;
+    uint32_t after;
+
+    do
+    {
+        before = atomic_load_explicit(&source->sequence, memory_order_acquire);
+
+        key->present = atomic_load_explicit(&source->present, memory_order_relaxed);
+        key->key_id = atomic_load_explicit(&source->key_id, memory_order_relaxed);
+        for (size_t i = 0; i < 8; i++)
+        {
+            key->inner[i] = atomic_load_explicit(&source->inner[i], memory_order_relaxed);
+            key->outer[i] = atomic_load_explicit(&source->outer[i], memory_order_relaxed);
+        }
+
+        atomic_thread_fence(memory_order_acquire);
+        after = atomic_load_explicit(&source->sequence, memory_order_relaxed);
+    } while ((before & 1) || before != after);
+}
+
+static void auth_key_write(auth_key_slot* slot, const auth_key* key)
+{
+    uint32_t sequence = atomic_load_explicit(&slot->sequence, memory_order_relaxed);
+
+    atomic_store_explicit(&slot->sequence, sequence + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+
+    atomic_store_explicit(&slot->present, key->present, memory_order_relaxed);
+    atomic_store_explicit(&slot->key_id, key->key_id, memory_order_relaxed);
+    for (size_t i = 0; i < 8; i++)
+    {
+        atomic_store_explicit(&slot->inner[i], key->inner[i], memory_order_relaxed);
+        atomic_store_explicit(&slot->outer[i], key->outer[i], memory_order_relaxed);
+    }
+
+    atomic_store_explicit(&slot->sequence, sequence + 2, memory_order_release);
+}
+
+goose_auth_keyring* goose_auth_keyring_create(void)
+{
+    goose_auth_keyring* keyring = (goose_auth_keyring*)malloc(sizeof(goose_auth_keyring));
+    if (!keyring)
+    {
+        return NULL;
+    }
+
+    auth_key empty;
+    memset(&empty, 0x0, sizeof(empty));
+
+    for (size_t i = 0; i < 2; i++)
+    {
+        atomic_init(&keyring->slots[i].sequence, 0);
+        auth_key_write(&keyring->slots[i], &empty);
+    }
+    atomic_init(&keyring->current, 0);
+
+    return keyring;
+}
+
+void goose_auth_keyring_free(goose_auth_keyring* keyring)
+{
+    free(keyring);
+}
+
+// Makes key_id the signing key, the key it replaces stays valid for verification
+int goose_auth_key_set(goose_auth_keyring* keyring, uint32_t key_id, const uint8_t* key, size_t key_length)
+{
+    if (!keyring || (!key && key_length))
+    {
+        return -1;
+    }
+
+    auth_key next;
+    next.present = 1;
+    next.key_id = key_id;
+    hmac_states(key, key_length, next.inner, next.outer);
+
+    uint32_t current = atomic_load_explicit(&keyring->current, memory_order_relaxed);
+    auth_key_write(&keyring->slots[current ^ 1], &next);
+    atomic_store_explicit(&keyring->current, current ^ 1, memory_order_release);
+
+    memset(&next, 0x0, sizeof(next));
+    return 0;
+}
+
+uint32_t goose_auth_key_id(const goose_auth_keyring* keyring)
+{
+    auth_key key;
+    uint32_t current = atomic_load_explicit(&((goose_auth_keyring*)keyring)->current, memory_order_acquire);
+
+    auth_key_read(&keyring->slots[current], &key);
+    return key.key_id;
+}
+
+int goose_auth_key_present(const goose_auth_keyring* keyring)
+{
+    uint32_t current = atomic_load_explicit(&((goose_auth_keyring*)keyring)->current, memory_order_acquire);
+
+    return atomic_load_explicit(&((goose_auth_keyring*)keyring)->slots[current].present, memory_order_relaxed) != 0;
+}
+
+// Frames
+
+void goose_auth_enable(goose_handle* handle, const goose_auth_keyring* keyring)
+{
+    if (!handle)
+    {
+        return;
+    }
+
+    handle->keyring = keyring;
+}
+
+// Offset of APPID and the end of the goosePdu, as announced by the APPID Length
+static int auth_frame_bounds(const uint8_t* bytes, size_t length, size_t* app_id_offset, size_t* pdu_end)
+{
+    size_t offset = MAC_ADDRESS_SIZE * 2;
+
+    if (length < offset + VLAN_TAG_SIZE + ETHERTYPE_SIZE)
+    {
+        return -1;
+    }
+    if (bytes[offset] == VLAN_TPID_0 && bytes[offset + 1] == VLAN_TPID_1)
+    {
+        offset += VLAN_TAG_SIZE;
+    }
+    if (bytes[offset] != GOOSE_ETHERTYPE_0 || bytes[offset + 1] != GOOSE_ETHERTYPE_1)
+    {
+        return -1;
+    }
+    offset += ETHERTYPE_SIZE;
+
+    if (length < offset + APP_ID_SIZE + sizeof(uint16_t) + 2 * RESERVED_SIZE)
+    {
+        return -1;
+    }
+
+    size_t apdu_length = ((size_t)bytes[offset + 2] << 8) | bytes[offset + 3];
+    if (apdu_length < APP_ID_SIZE + sizeof(uint16_t) + 2 * RESERVED_SIZE || offset + apdu_length > length)
+    {
+        return -1;
+    }
+
+    *app_id_offset = offset;
+    *pdu_end = offset + apdu_length;
+    return 0;
+}
+
+size_t goose_auth_sign(const goose_auth_keyring* keyring, uint8_t* bytes, size_t length, size_t capacity)
+{
+    size_t app_id_offset;
+    size_t pdu_end;
+
+    if (!keyring || !bytes || auth_frame_bounds(bytes, length, &app_id_offset, &pdu_end) != 0)
+    {
+        return 0;
+    }
+    if (pdu_end + GOOSE_AUTH_EXTENSION_SIZE > capacity)
+    {
+        return 0;
+    }
+
+    auth_key key;
+    uint32_t current = atomic_load_explicit(&((goose_auth_keyring*)keyring)->current, memory_order_acquire);
+    auth_key_read(&keyring->slots[current], &key);
+    if (!key.present)
+    {
+        return 0;
+    }
+
+    // Reserved 1 is covered by the MAC, so the extension length goes in first
+    bytes[app_id_offset + APP_ID_SIZE + sizeof(uint16_t) + 1] = GOOSE_AUTH_EXTENSION_SIZE;
+
+    uint8_t* extension = &bytes[pdu_end];
+    extension[0] = GOOSE_AUTH_TAG_EXTENSION;
+    extension[1] = GOOSE_AUTH_EXTENSION_SIZE - 2;
+    extension[2] = GOOSE_AUTH_TAG_KEY_ID;
+    extension[3] = 4;
+    extension[4] = (uint8_t)(key.key_id >> 24);
+    extension[5] = (uint8_t)(key.key_id >> 16);
+    extension[6] = (uint8_t)(key.key_id >> 8);
+    extension[7] = (uint8_t)key.key_id;
+    extension[8] = GOOSE_AUTH_TAG_ALGORITHM;
+    extension[9] = 1;
+    extension[10] = GOOSE_AUTH_HMAC_SHA256;
+    extension[11] = GOOSE_AUTH_TAG_MAC;
+    extension[12] = GOOSE_SHA256_SIZE;
+
+    hmac_finish(key.inner, key.outer, &bytes[app_id_offset], pdu_end - app_id_offset, &extension[13]);
+
+    memset(&key, 0x0, sizeof(key));
+    return pdu_end + GOOSE_AUTH_EXTENSION_SIZE;
+}
+
+int goose_auth_verify(const goose_auth_keyring* keyring, const uint8_t* bytes, size_t length)
+{
+    size_t app_id_offset;
+    size_t pdu_end;
+
+    if (!keyring || !bytes || auth_frame_bounds(bytes, length, &app_id_offset, &pdu_end) != 0)
+    {
+        return -1;
+    }
+    if (bytes[app_id_offset + APP_ID_SIZE + sizeof(uint16_t) + 1] != GOOSE_AUTH_EXTENSION_SIZE || pdu_end + GOOSE_AUTH_EXTENSION_SIZE > length)
+    {
+        return -1;
+    }
+
+    const uint8_t* extension = &bytes[pdu_end];
+    if (extension[0] != GOOSE_AUTH_TAG_EXTENSION || extension[1] != GOOSE_AUTH_EXTENSION_SIZE - 2
+        || extension[2] != GOOSE_AUTH_TAG_KEY_ID || extension[3] != 4
+        || extension[8] != GOOSE_AUTH_TAG_ALGORITHM || extension[9] != 1 || extension[10] != GOOSE_AUTH_HMAC_SHA256
+        || extension[11] != GOOSE_AUTH_TAG_MAC || extension[12] != GOOSE_SHA256_SIZE)
+    {
+        return -1;
+    }
+
+    uint32_t key_id = ((uint32_t)extension[4] << 24) | ((uint32_t)extension[5] << 16) | ((uint32_t)extension[6] << 8) | extension[7];
+
+    // Current key first, then the previous one
+    auth_key key;
+    uint32_t current = atomic_load_explicit(&((goose_auth_keyring*)keyring)->current, memory_order_acquire);
+    auth_key_read(&keyring->slots[current], &key);
+    if (!key.present || key.key_id != key_id)
+    {
+        auth_key_read(&keyring->slots[current ^ 1], &key);
+        if (!key.present || key.key_id != key_id)
+        {
+            return -1;
+        }
+    }
+
+    uint8_t mac[GOOSE_SHA256_SIZE];
+    hmac_finish(key.inner, key.outer, &bytes[app_id_offset], pdu_end - app_id_offset, mac);
+
+    // Constant time compare
+    uint8_t difference = 0;
+    for (size_t i = 0; i < GOOSE_SHA256_SIZE; i++)
+    {
+        difference |= mac[i] ^ extension[13 + i];
+    }
+
+    memset(&key, 0x0, sizeof(key));
+    return difference == 0 ? 0 : -1;
+}
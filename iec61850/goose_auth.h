@@ -0,0 +1,64 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include "goose.h"
+
+// IEC 62351-6 authentication. A signed frame carries a security extension right after
+// the goosePdu; the APPID Length still ends at the goosePdu, so receivers that do not
+// authenticate keep decoding it, and the low byte of Reserved 1 holds the extension length.
+// The MAC is HMAC-SHA256 over the frame from APPID to the end of the goosePdu, which leaves
+// the Ethernet and 802.1Q headers out so bridges may retag the frame.
+//
+//   af 2b                      security extension
+//      80 04 <key id>          big endian
+//      81 01 <algorithm>       GOOSE_AUTH_HMAC_SHA256
+//      82 20 <mac>             32 bytes
+
+#define GOOSE_SHA256_SIZE 32
+#define GOOSE_SHA256_BLOCK_SIZE 64
+
+#define GOOSE_AUTH_TAG_EXTENSION 0xaf
+#define GOOSE_AUTH_TAG_KEY_ID 0x80
+#define GOOSE_AUTH_TAG_ALGORITHM 0x81
+#define GOOSE_AUTH_TAG_MAC 0x82
+#define GOOSE_AUTH_HMAC_SHA256 0x01
+#define GOOSE_AUTH_EXTENSION_SIZE (2 + 6 + 3 + 2 + GOOSE_SHA256_SIZE)
+
+// Self-contained SHA-256 (FIPS 180-4) and HMAC-SHA256 (RFC 2104)
+typedef struct
+{
+	uint32_t state[8];
+	uint64_t length;	// Bytes hashed so far
+	uint8_t buffer[GOOSE_SHA256_BLOCK_SIZE];
+	size_t buffered;
+} goose_sha256_context;
+
+void goose_sha256_init(goose_sha256_context* context);
+void goose_sha256_update(goose_sha256_context* context, const uint8_t* data, size_t length);
+void goose_sha256_final(goose_sha256_context* context, uint8_t digest[GOOSE_SHA256_SIZE]);
+void goose_sha256(const uint8_t* data, size_t length, uint8_t digest[GOOSE_SHA256_SIZE]);
+void goose_hmac_sha256(const uint8_t* key, size_t key_length, const uint8_t* data, size_t length, uint8_t mac[GOOSE_SHA256_SIZE]);
+
+// Keys are held as the SHA-256 states after the ipad and opad blocks, so a MAC costs the
+// compressions over the frame plus one for the outer hash. The keyring keeps the current
+// key, used to sign, and the one before it, still accepted by verify while peers roll over.
+// goose_auth_key_set may run concurrently with sign and verify on other threads (readers
+// never take a lock), but only one thread may set keys at a time.
+goose_auth_keyring* goose_auth_keyring_create(void);
+void goose_auth_keyring_free(goose_auth_keyring* keyring);
+int goose_auth_key_set(goose_auth_keyring* keyring, uint32_t key_id, const uint8_t* key, size_t key_length);
+uint32_t goose_auth_key_id(const goose_auth_keyring* keyring);
+
+// Returns 1 once a key is set, which goose_auth_sign needs; keys are never removed
+int goose_auth_key_present(const goose_auth_keyring* keyring);
+
+// Sign every frame goose_encode produces for this handle from now on, NULL stops signing
+void goose_auth_enable(goose_handle* handle, const goose_auth_keyring* keyring);
+
+// Appends (or replaces) the extension of an encoded frame, using the current key.
+// Returns the new frame length, or 0 if the frame is malformed, has no key, or would exceed capacity.
+size_t goose_auth_sign(const goose_auth_keyring* keyring, uint8_t* bytes, size_t length, size_t capacity);
+
+// Returns 0 if the frame carries a valid MAC under the current or previous key, -1 otherwise
+int goose_auth_verify(const goose_auth_keyring* keyring, const uint8_t* bytes, size_t length);
@@ -0,0 +1,306 @@
+#pragma once
+
+// C++17 typed layer over goose.h. A dataset is declared as a list of member types,
+//
+//	using Trip = iec61850::GooseDataset<iec61850::Bool, iec61850::Int32, iec61850::Float32, iec61850::Quality>;
+//	iec61850::GooseFrame<Trip> frame(source, destination, 0x0001);
+//	frame.set<1>(-42);
+//
+// and every member is encoded at a fixed width, so a setter is one big-endian store into
+// the member's value in the C structures, and the encoded frame changes only in place.
+// The frame bytes are left alone until the next encode: commit() when the bytes are sent
+// directly, or the state change the publisher encodes after goose_publisher_notify. A
+// retransmission in between still repeats the last frame. goose_encode finds the members
+// that changed and rewrites just those, re-signing when a keyring is attached.
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+
+extern "C" {
+#include "goose.h"
+}
+
+namespace iec61850
+{
+
+namespace detail
+{
+
+inline void store_be16(uint8_t* out, uint16_t value)
+{
+	out[0] = static_cast<uint8_t>(value >> 8);
+	out[1] = static_cast<uint8_t>(value);
+}
+
+inline void store_be32(uint8_t* out, uint32_t value)
+{
+	out[0] = static_cast<uint8_t>(value >> 24);
+	out[1] = static_cast<uint8_t>(value >> 16);
+	out[2] = static_cast<uint8_t>(value >> 8);
+	out[3] = static_cast<uint8_t>(value);
+}
+
+inline void store_be64(uint8_t* out, uint64_t value)
+{
+	store_be32(out, static_cast<uint32_t>(value >> 32));
+	store_be32(out + 4, static_cast<uint32_t>(value));
+}
+
+inline uint16_t load_be16(const uint8_t* in)
+{
+	return static_cast<uint16_t>((in[0] << 8) | in[1]);
+}
+
+inline uint32_t load_be32(const uint8_t* in)
+{
+	return (static_cast<uint32_t>(in[0]) << 24) | (static_cast<uint32_t>(in[1]) << 16) | (static_cast<uint32_t>(in[2]) << 8) | in[3];
+}
+
+inline uint64_t load_be64(const uint8_t* in)
+{
+	return (static_cast<uint64_t>(load_be32(in)) << 32) | load_be32(in + 4);
+}
+
+template <typename To, typename From>
+inline To bit_cast(From from)
+{
+	static_assert(sizeof(To) == sizeof(From), "bit_cast needs equal sizes");
+	To to;
+	std::memcpy(&to, &from, sizeof(to));
+	return to;
+}
+
+} // namespace detail
+
+// Member types. length is the BER content length, prefix the content bytes in front of
+// the value that never change (-1 for none).
+
+struct Bool
+{
+	using value_type = bool;
+	static constexpr uint8_t tag = 0x83;
+	static constexpr size_t length = 1;
+	static constexpr int prefix = -1;
+	static void store(uint8_t* out, bool value) { out[0] = value ? 1 : 0; }
+	static bool load(const uint8_t* in) { return in[0] != 0; }
+};
+
+// Always four content bytes, as goose_all_data_entry_add callers write int32 today
+struct Int32
+{
+	using value_type = int32_t;
+	static constexpr uint8_t tag = 0x85;
+	static constexpr size_t length = 4;
+	static constexpr int prefix = -1;
+	static void store(uint8_t* out, int32_t value) { detail::store_be32(out, static_cast<uint32_t>(value)); }
+	static int32_t load(const uint8_t* in) { return static_cast<int32_t>(detail::load_be32(in)); }
+};
+
+// A leading zero keeps values with the top bit set positive
+struct UInt32
+{
+	using value_type = uint32_t;
+	static constexpr uint8_t tag = 0x86;
+	static constexpr size_t length = 5;
+	static constexpr int prefix = 0x00;
+	static void store(uint8_t* out, uint32_t value) { detail::store_be32(out, value); }
+	static uint32_t load(const uint8_t* in) { return detail::load_be32(in); }
+};
+
+// IEC 61850-8-1 FLOAT32: exponent width 8, then the IEEE 754 single
+struct Float32
+{
+	using value_type = float;
+	static constexpr uint8_t tag = 0x87;
+	static constexpr size_t length = 5;
+	static constexpr int prefix = 8;
+	static void store(uint8_t* out, float value) { detail::store_be32(out, detail::bit_cast<uint32_t>(value)); }
+	static float load(const uint8_t* in) { return detail::bit_cast<float>(detail::load_be32(in)); }
+};
+
+struct Float64
+{
+	using value_type = double;
+	static constexpr uint8_t tag = 0x87;
+	static constexpr size_t length = 9;
+	static constexpr int prefix = 11;
+	static void store(uint8_t* out, double value) { detail::store_be64(out, detail::bit_cast<uint64_t>(value)); }
+	static double load(const uint8_t* in) { return detail::bit_cast<double>(detail::load_be64(in)); }
+};
+
+// 13-bit quality bit-string, the first content byte counts the 3 padding bits
+struct Quality
+{
+	using value_type = uint16_t;
+	static constexpr uint8_t tag = 0x84;
+	static constexpr size_t length = 3;
+	static constexpr int prefix = 3;
+	static void store(uint8_t* out, uint16_t value) { detail::store_be16(out, value); }
+	static uint16_t load(const uint8_t* in) { return detail::load_be16(in); }
+};
+
+// UtcTime, stored as the 8 raw bytes read big-endian (see iec_time_encode)
+struct Timestamp
+{
+	using value_type = uint64_t;
+	static constexpr uint8_t tag = 0x91;
+	static constexpr size_t length = IEC_TIME_UTC_SIZE;
+	static constexpr int prefix = -1;
+	static void store(uint8_t* out, uint64_t value) { detail::store_be64(out, value); }
+	static uint64_t load(const uint8_t* in) { return detail::load_be64(in); }
+};
+
+template <typename... Members>
+struct GooseDataset
+{
+	static constexpr size_t count = sizeof...(Members);
+	static_assert(count > 0, "a dataset needs at least one member");
+	static_assert(count <= MAX_NUM_DATASET_ENTRIES, "more members than MAX_NUM_DATASET_ENTRIES");
+	static_assert(((Members::length < 0x80) && ...), "members must use a one byte BER length");
+
+	template <size_t I>
+	using member = std::tuple_element_t<I, std::tuple<Members...>>;
+
+	static constexpr std::array<uint8_t, count> tags = { Members::tag... };
+	static constexpr std::array<size_t, count> lengths = { Members::length... };
+	static constexpr std::array<int, count> prefixes = { Members::prefix... };
+
+	// Encoded allData content: tag, length and content of every member
+	static constexpr size_t size = ((2 + Members::length) + ...);
+
+	// Where member I's content starts within the allData content
+	static constexpr size_t content_offset(size_t index)
+	{
+		size_t position = 0;
+		for (size_t i = 0; i < index; i++)
+		{
+			position += 2 + lengths[i];
+		}
+		return position + 2;
+	}
+
+	// Where member I's value starts within its content, past its fixed prefix
+	template <size_t I>
+	static constexpr size_t value_offset = member<I>::prefix >= 0 ? 1 : 0;
+
+	// Where member I's value starts within the allData content
+	template <size_t I>
+	static constexpr size_t offset = content_offset(I) + value_offset<I>;
+
+	// allData content with every value zero
+	static constexpr std::array<uint8_t, size> image()
+	{
+		std::array<uint8_t, size> bytes{};
+		size_t position = 0;
+		for (size_t i = 0; i < count; i++)
+		{
+			bytes[position] = tags[i];
+			bytes[position + 1] = static_cast<uint8_t>(lengths[i]);
+			if (prefixes[i] >= 0)
+			{
+				bytes[position + 2] = static_cast<uint8_t>(prefixes[i]);
+			}
+			position += 2 + lengths[i];
+		}
+		return bytes;
+	}
+};
+
+// A control block with a typed dataset, over a goose_handle it owns. Configure the header
+// fields and call encode() once, then update members with set<I>() and either call
+// goose_publisher_notify, or commit() before sending bytes() yourself.
+template <typename Dataset>
+class GooseFrame
+{
+public:
+	GooseFrame(const uint8_t (&source)[MAC_ADDRESS_SIZE], const uint8_t (&destination)[MAC_ADDRESS_SIZE], uint16_t app_id)
+	{
+		uint8_t source_bytes[MAC_ADDRESS_SIZE];
+		uint8_t destination_bytes[MAC_ADDRESS_SIZE];
+		uint8_t app_id_bytes[APP_ID_SIZE] = { static_cast<uint8_t>(app_id >> 8), static_cast<uint8_t>(app_id) };
+		std::memcpy(source_bytes, source, sizeof(source_bytes));
+		std::memcpy(destination_bytes, destination, sizeof(destination_bytes));
+
+		handle_ = goose_init(source_bytes, destination_bytes, app_id_bytes);
+
+		// Four byte counters, so they can be updated in place like the members
+		uint8_t zero[4] = {};
+		ber_set(&(handle_->frame->pdu_list.st_num), zero, sizeof(zero));
+		ber_set(&(handle_->frame->pdu_list.sq_num), zero, sizeof(zero));
+
+		static constexpr std::array<uint8_t, Dataset::size> image = Dataset::image();
+		for (size_t i = 0; i < Dataset::count; i++)
+		{
+			goose_all_data_entry_add(handle_, Dataset::tags[i], Dataset::lengths[i], const_cast<uint8_t*>(&image[Dataset::content_offset(i)]));
+		}
+	}
+
+	~GooseFrame() { goose_free(handle_); }
+
+	GooseFrame(const GooseFrame&) = delete;
+	GooseFrame& operator=(const GooseFrame&) = delete;
+
+	GooseFrame& gocbref(std::string_view value) { return set_string(handle_->frame->pdu_list.gocbref, value); }
+	GooseFrame& dataset(std::string_view value) { return set_string(handle_->frame->pdu_list.dataset, value); }
+	GooseFrame& go_id(std::string_view value) { return set_string(handle_->frame->pdu_list.go_id, value); }
+
+	GooseFrame& time_allowed_to_live(uint16_t milliseconds)
+	{
+		uint8_t bytes[2];
+		detail::store_be16(bytes, milliseconds);
+		ber_set(&(handle_->frame->pdu_list.time_allowed_to_live), bytes, sizeof(bytes));
+		return *this;
+	}
+
+	GooseFrame& conf_rev(uint32_t value)
+	{
+		uint8_t bytes[4];
+		detail::store_be32(bytes, value);
+		ber_set(&(handle_->frame->pdu_list.conf_rev), bytes, sizeof(bytes));
+		return *this;
+	}
+
+	// Full encode through goose_encode, needed after the header fields change
+	void encode() { goose_encode(handle_); }
+
+	template <size_t I>
+	void set(typename Dataset::template member<I>::value_type value)
+	{
+		Dataset::template member<I>::store(member_value(I) + Dataset::template value_offset<I>, value);
+	}
+
+	template <size_t I>
+	typename Dataset::template member<I>::value_type get() const
+	{
+		return Dataset::template member<I>::load(member_value(I) + Dataset::template value_offset<I>);
+	}
+
+	void st_num(uint32_t value) { detail::store_be32(handle_->frame->pdu_list.st_num.value, value); }
+	void sq_num(uint32_t value) { detail::store_be32(handle_->frame->pdu_list.sq_num.value, value); }
+
+	// Encodes what was set since into the frame bytes, patching only the members that
+	// changed, and renews the MAC if the handle signs
+	void commit() { goose_encode(handle_); }
+
+	goose_handle* handle() { return handle_; }
+	const uint8_t* bytes() const { return handle_->byte_stream; }
+	size_t size() const { return handle_->length; }
+
+private:
+	GooseFrame& set_string(ber& field, std::string_view value)
+	{
+		ber_set(&field, reinterpret_cast<uint8_t*>(const_cast<char*>(value.data())), value.size());
+		return *this;
+	}
+
+	uint8_t* member_value(size_t index) const { return handle_->frame->pdu_list.all_data_list.entries[index].value; }
+
+	goose_handle* handle_;
+};
+
+} // namespace iec61850
@@ -0,0 +1,808 @@
+#include "goose_event_log.h"
+#include "iec_time.h"
+#include <dirent.h>
+#include <fcntl.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#define CACHE_LINE 64
+#define NS_PER_SECOND 1000000000ULL
+#define SEQUENCE_DIGITS 8
+#define FNV_OFFSET 14695981039346656037ULL
+#define FNV_PRIME 1099511628211ULL
+
+struct goose_event_log
+{
+    // Producer side
+    atomic_size_t head;
+    size_t cached_tail;
+    atomic_uint_least64_t dropped;
+    uint8_t producer_pad[CACHE_LINE];
+
+    // Consumer side
+    atomic_size_t tail;
+    atomic_uint_least64_t unwritten;	// Dropped because no segment could be created
+    uint8_t consumer_pad[CACHE_LINE - sizeof(atomic_size_t) - sizeof(atomic_uint_least64_t)];
+
+    goose_event_log_event* ring;
+    size_t mask;
+
+    char* directory;
+    char* prefix;
+    uint64_t capacity;
+    uint64_t sequence;	// Of the next segment to create
+    uint64_t segments;
+
+    goose_event_log_header* header;	// Current segment, NULL before the first record
+    uint8_t* base;
+    size_t size;
+};
+
+static size_t align_up(size_t value)
+{
+    return (value + CACHE_LINE - 1) & ~(size_t)(CACHE_LINE - 1);
+}
+
+// Bytes per record of a column, 0 for the per-block time range columns
+static size_t column_width(int column)
+{
+    switch (column)
+    {
+    case GOOSE_EVENT_LOG_STREAM_ID:
+    case GOOSE_EVENT_LOG_ST_NUM:
+    case GOOSE_EVENT_LOG_SQ_NUM:
+        return sizeof(uint32_t);
+    case GOOSE_EVENT_LOG_TIME:
+    case GOOSE_EVENT_LOG_CHANGED:
+        return sizeof(uint64_t);
+    case GOOSE_EVENT_LOG_QUALITY:
+    case GOOSE_EVENT_LOG_MEMBER_COUNT:
+        return sizeof(uint8_t);
+    case GOOSE_EVENT_LOG_BLOCK_MIN:
+    case GOOSE_EVENT_LOG_BLOCK_MAX:
+        return 0;
+    default:
+        return column < GOOSE_EVENT_LOG_VALUES ? sizeof(uint8_t) : sizeof(uint64_t);
+    }
+}
+
+// Fills the column offsets for `capacity` records and returns the file size
+static size_t segment_layout(uint64_t capacity, uint64_t offsets[GOOSE_EVENT_LOG_COLUMNS])
+{
+    size_t offset = align_up(sizeof(goose_event_log_header));
+    size_t blocks = (size_t)((capacity + GOOSE_EVENT_LOG_BLOCK - 1) / GOOSE_EVENT_LOG_BLOCK);
+
+    for (int column = 0; column < GOOSE_EVENT_LOG_COLUMNS; column++)
+    {
+        size_t width = column_width(column);
+        offsets[column] = offset;
+        offset = align_up(offset + (width ? width * (size_t)capacity : blocks * sizeof(uint64_t)));
+    }
+    return offset;
+}
+
+static uint64_t segment_capacity(size_t segment_bytes)
+{
+    size_t record_bytes = 0;
+    for (int column = 0; column < GOOSE_EVENT_LOG_COLUMNS; column++)
+    {
+        record_bytes += column_width(column);
+    }
+
+    uint64_t blocks = segment_bytes / record_bytes / GOOSE_EVENT_LOG_BLOCK;
+    return (blocks ? blocks : 1) * GOOSE_EVENT_LOG_BLOCK;
+}
+
+static char* segment_path(const char* directory, const char* prefix, uint64_t sequence)
+{
+    size_t size = strlen(directory) + strlen(prefix) + SEQUENCE_DIGITS + sizeof(GOOSE_EVENT_LOG_SUFFIX) + 16;
+    char* path = (char*)malloc(size);
+    if (path)
+    {
+        snprintf(path, size, "%s/%s-%0*llu%s", directory, prefix, SEQUENCE_DIGITS, (unsigned long long)sequence, GOOSE_EVENT_LOG_SUFFIX);
+    }
+    return path;
+}
+
+// A file in the log directory, by the name it was listed under
+static char* entry_path(const char* directory, const char* name)
+{
+    size_t size = strlen(directory) + strlen(name) + 2;
+    char* path = (char*)malloc(size);
+    if (path)
+    {
+        snprintf(path, size, "%s/%s", directory, name);
+    }
+    return path;
+}
+
+// Sequence number of a segment file name of the log, -1 for other files
+static int64_t segment_sequence(const char* name, const char* prefix)
+{
+    size_t prefix_length = strlen(prefix);
+    size_t suffix_length = strlen(GOOSE_EVENT_LOG_SUFFIX);
+    size_t length = strlen(name);
+
+    if (length <= prefix_length + 1 + suffix_length || strncmp(name, prefix, prefix_length) != 0 || name[prefix_length] != '-'
+        || strcmp(name + length - suffix_length, GOOSE_EVENT_LOG_SUFFIX) != 0)
+    {
+        return -1;
+    }
+
+    int64_t sequence = 0;
+    for (size_t i = prefix_length + 1; i < length - suffix_length; i++)
+    {
+        if (name[i] < '0' || name[i] > '9' || sequence > (INT64_MAX - 9) / 10)
+        {
+            return -1;
+        }
+        sequence = sequence * 10 + (name[i] - '0');
+    }
+    return sequence;
+}
+
+// A segment file of the log as found in its directory. The name is kept as it was
+// read, the sequence number can be written with any number of digits.
+typedef struct
+{
+    int64_t sequence;
+    char* name;
+} segment_entry;
+
+static int compare_sequence(const void* a, const void* b)
+{
+    int64_t x = ((const segment_entry*)a)->sequence;
+    int64_t y = ((const segment_entry*)b)->sequence;
+    return (x > y) - (x < y);
+}
+
+static char* copy_string(const char* string)
+{
+    size_t size = strlen(string) + 1;
+    char* copy = (char*)malloc(size);
+    if (copy)
+    {
+        memcpy(copy, string, size);
+    }
+    return copy;
+}
+
+static void free_segments(segment_entry* segments, size_t count)
+{
+    for (size_t i = 0; i < count; i++)
+    {
+        free(segments[i].name);
+    }
+    free(segments);
+}
+
+// Segments in the directory sorted by sequence number, NULL with count 0 when there are none
+static int list_segments(const char* directory, const char* prefix, segment_entry** segments, size_t* count)
+{
+    DIR* dir = opendir(directory);
+    if (!dir)
+    {
+        return -1;
+    }
+
+    size_t capacity = 0;
+    int failed = 0;
+    *segments = NULL;
+    *count = 0;
+
+    struct dirent* entry;
+    while (!failed && (entry = readdir(dir)) != NULL)
+    {
+        int64_t sequence = segment_sequence(entry->d_name, prefix);
+        if (sequence < 0)
+        {
+            continue;
+        }
+
+        if (*count == capacity)
+        {
+            capacity = capacity ? capacity * 2 : 16;
+            segment_entry* grown = (segment_entry*)realloc(*segments, capacity * sizeof(segment_entry));
+            if (!grown)
+            {
+                failed = 1;
+                continue;
+            }
+            *segments = grown;
+        }
+        (*segments)[*count].sequence = sequence;
+        (*segments)[*count].name = copy_string(entry->d_name);
+        failed = (*segments)[*count].name == NULL;
+        *count += !failed;
+    }
+    closedir(dir);
+
+    if (failed)
+    {
+        free_segments(*segments, *count);
+        *segments = NULL;
+        *count = 0;
+        return -1;
+    }
+
+    if (*count)
+    {
+        qsort(*segments, *count, sizeof(segment_entry), compare_sequence);
+    }
+    return 0;
+}
+
+goose_event_log* goose_event_log_open(const goose_event_log_params* params)
+{
+    if (!params->directory || !params->prefix || params->queue_size < 2 || (params->queue_size & (params->queue_size - 1)) != 0)
+    {
+        return NULL;
+    }
+
+    segment_entry* segments;
+    size_t count;
+    if (list_segments(params->directory, params->prefix, &segments, &count) != 0)
+    {
+        return NULL;
+    }
+    uint64_t sequence = count ? (uint64_t)segments[count - 1].sequence + 1 : 0;
+    free_segments(segments, count);
+
+    goose_event_log* log = (goose_event_log*)calloc(1, sizeof(goose_event_log));
+    if (!log)
+    {
+        return NULL;
+    }
+
+    log->ring = (goose_event_log_event*)malloc(params->queue_size * sizeof(goose_event_log_event));
+    log->directory = copy_string(params->directory);
+    log->prefix = copy_string(params->prefix);
+    if (!log->ring || !log->directory || !log->prefix)
+    {
+        free(log->ring);
+        free(log->directory);
+        free(log->prefix);
+        free(log);
+        return NULL;
+    }
+
+    atomic_init(&log->head, 0);
+    atomic_init(&log->tail, 0);
+    atomic_init(&log->dropped, 0);
+    atomic_init(&log->unwritten, 0);
+    log->mask = params->queue_size - 1;
+    log->capacity = segment_capacity(params->segment_bytes);
+    log->sequence = sequence;
+    return log;
+}
+
+static void segment_finish(goose_event_log* log)
+{
+    if (log->header)
+    {
+        msync(log->base, log->size, MS_SYNC);
+        munmap(log->base, log->size);
+        log->header = NULL;
+        log->base = NULL;
+    }
+}
+
+// Creates the next segment and maps it shared. Its blocks are allocated up front: a store
+// into a sparse mapping that the file system cannot back raises SIGBUS, so a full disk
+// has to fail here instead, where the half-made file can be removed again.
+static int segment_create(goose_event_log* log)
+{
+    goose_event_log_header header;
+    memset(&header, 0x0, sizeof(header));
+    size_t size = segment_layout(log->capacity, header.offsets);
+
+    char* path = segment_path(log->directory, log->prefix, log->sequence);
+    if (!path)
+    {
+        return -1;
+    }
+    int fd = open(path, O_RDWR | O_CREAT | O_EXCL | O_CLOEXEC, 0644);
+    if (fd < 0)
+    {
+        free(path);
+        return -1;
+    }
+
+    void* base = MAP_FAILED;
+    if (posix_fallocate(fd, 0, (off_t)size) == 0)
+    {
+        base = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    }
+    close(fd);
+    if (base == MAP_FAILED)
+    {
+        unlink(path);
+        free(path);
+        return -1;
+    }
+    free(path);
+
+    memcpy(header.magic, GOOSE_EVENT_LOG_MAGIC, sizeof(header.magic));
+    header.version = GOOSE_EVENT_LOG_VERSION;
+    header.byte_order = GOOSE_EVENT_LOG_BYTE_ORDER;
+    header.members = GOOSE_EVENT_LOG_MEMBERS;
+    header.block = GOOSE_EVENT_LOG_BLOCK;
+    header.sequence = log->sequence;
+    header.capacity = log->capacity;
+    header.min_ns = UINT64_MAX;
+    header.max_ns = 0;
+    memcpy(base, &header, sizeof(header));
+
+    log->header = (goose_event_log_header*)base;
+    log->base = (uint8_t*)base;
+    log->size = size;
+    log->sequence++;
+    log->segments++;
+    return 0;
+}
+
+void goose_event_log_close(goose_event_log* log)
+{
+    if (!log)
+    {
+        return;
+    }
+
+    goose_event_log_drain(log);
+    segment_finish(log);
+    free(log->ring);
+    free(log->directory);
+    free(log->prefix);
+    free(log);
+}
+
+int goose_event_log_push(goose_event_log* log, const goose_event_log_event* event)
+{
+    size_t head = atomic_load_explicit(&log->head, memory_order_relaxed);
+
+    if (head - log->cached_tail > log->mask)
+    {
+        log->cached_tail = atomic_load_explicit(&log->tail, memory_order_acquire);
+        if (head - log->cached_tail > log->mask)
+        {
+            atomic_store_explicit(&log->dropped, atomic_load_explicit(&log->dropped, memory_order_relaxed) + 1, memory_order_relaxed);
+            return -1;
+        }
+    }
+
+    log->ring[head & log->mask] = *event;
+    atomic_store_explicit(&log->head, head + 1, memory_order_release);
+    return 0;
+}
+
+#define COLUMN(log, type, column) ((type*)((log)->base + (log)->header->offsets[column]))
+
+static void segment_write(goose_event_log* log, const goose_event_log_event* event, uint64_t record)
+{
+    COLUMN(log, uint32_t, GOOSE_EVENT_LOG_STREAM_ID)[record] = event->stream_id;
+    COLUMN(log, uint32_t, GOOSE_EVENT_LOG_ST_NUM)[record] = event->st_num;
+    COLUMN(log, uint32_t, GOOSE_EVENT_LOG_SQ_NUM)[record] = event->sq_num;
+    COLUMN(log, uint64_t, GOOSE_EVENT_LOG_TIME)[record] = event->time_ns;
+    COLUMN(log, uint8_t, GOOSE_EVENT_LOG_QUALITY)[record] = event->quality;
+    COLUMN(log, uint64_t, GOOSE_EVENT_LOG_CHANGED)[record] = event->changed;
+    COLUMN(log, uint8_t, GOOSE_EVENT_LOG_MEMBER_COUNT)[record] = event->member_count;
+
+    // Unused members stay zero, as the file was created
+    for (int i = 0; i < event->member_count; i++)
+    {
+        COLUMN(log, uint8_t, GOOSE_EVENT_LOG_TAGS + i)[record] = event->tags[i];
+        COLUMN(log, uint64_t, GOOSE_EVENT_LOG_VALUES + i)[record] = event->values[i];
+    }
+
+    uint64_t* block_min = &COLUMN(log, uint64_t, GOOSE_EVENT_LOG_BLOCK_MIN)[record / GOOSE_EVENT_LOG_BLOCK];
+    uint64_t* block_max = &COLUMN(log, uint64_t, GOOSE_EVENT_LOG_BLOCK_MAX)[record / GOOSE_EVENT_LOG_BLOCK];
+    if (record % GOOSE_EVENT_LOG_BLOCK == 0 || event->time_ns < *block_min)
+    {
+        *block_min = event->time_ns;
+    }
+    if (record % GOOSE_EVENT_LOG_BLOCK == 0 || event->time_ns > *block_max)
+    {
+        *block_max = event->time_ns;
+    }
+
+    if (event->time_ns < log->header->min_ns)
+    {
+        log->header->min_ns = event->time_ns;
+    }
+    if (event->time_ns > log->header->max_ns)
+    {
+        log->header->max_ns = event->time_ns;
+    }
+}
+
+// Readers trust count, so it is published after the columns it covers
+static void segment_commit(goose_event_log* log, uint64_t count)
+{
+    atomic_thread_fence(memory_order_release);
+    log->header->count = count;
+}
+
+size_t goose_event_log_drain(goose_event_log* log)
+{
+    size_t tail = atomic_load_explicit(&log->tail, memory_order_relaxed);
+    size_t head = atomic_load_explicit(&log->head, memory_order_acquire);
+    size_t drained = 0;
+    uint64_t count = log->header ? log->header->count : 0;
+
+    while (tail != head)
+    {
+        if (!log->header || count == log->header->capacity)
+        {
+            if (log->header)
+            {
+                segment_commit(log, count);
+                segment_finish(log);
+            }
+            if (segment_create(log) != 0)
+            {
+                // Nothing queued can be written, the next drain tries again
+                uint64_t unwritten = atomic_load_explicit(&log->unwritten, memory_order_relaxed);
+                atomic_store_explicit(&log->unwritten, unwritten + (head - tail), memory_order_relaxed);
+                tail = head;
+                break;
+            }
+            count = 0;
+        }
+
+        segment_write(log, &log->ring[tail & log->mask], count++);
+        tail++;
+        drained++;
+    }
+
+    if (log->header)
+    {
+        segment_commit(log, count);
+    }
+    atomic_store_explicit(&log->tail, tail, memory_order_release);
+    return drained;
+}
+
+uint64_t goose_event_log_dropped(const goose_event_log* log)
+{
+    goose_event_log* shared = (goose_event_log*)log;
+    return atomic_load_explicit(&shared->dropped, memory_order_relaxed) + atomic_load_explicit(&shared->unwritten, memory_order_relaxed);
+}
+
+uint64_t goose_event_log_segments(const goose_event_log* log)
+{
+    return log->segments;
+}
+
+static uint64_t fnv1a(uint64_t hash, const uint8_t* bytes, size_t length)
+{
+    for (size_t i = 0; i < length; i++)
+    {
+        hash = (hash ^ bytes[i]) * FNV_PRIME;
+    }
+    return hash;
+}
+
+// Tags and contents of the members that have no value column, FNV_OFFSET when there are none
+static uint64_t unlogged_hash(const goose_all_data* all_data)
+{
+    uint64_t hash = FNV_OFFSET;
+    for (size_t i = GOOSE_EVENT_LOG_MEMBERS; i < all_data->entry_count; i++)
+    {
+        const ber* entry = &all_data->entries[i];
+        uint8_t header[1 + sizeof(uint32_t)] = { entry->tag, (uint8_t)(entry->length >> 24), (uint8_t)(entry->length >> 16), (uint8_t)(entry->length >> 8), (uint8_t)entry->length };
+        hash = fnv1a(hash, header, sizeof(header));
+        hash = fnv1a(hash, entry->value, entry->length);
+    }
+    return hash;
+}
+
+void goose_event_log_stream_init(goose_event_log_stream* stream, goose_event_log* log, uint32_t stream_id)
+{
+    memset(stream, 0x0, sizeof(*stream));
+    stream->log = log;
+    stream->stream_id = stream_id;
+    stream->unlogged = FNV_OFFSET;
+}
+
+uint64_t goose_event_log_value(const ber* entry)
+{
+    uint64_t value = 0;
+    const uint8_t* bytes = entry->value;
+    size_t length = entry->length;
+
+    switch (entry->tag)
+    {
+    case 0x83:	// boolean
+        return length && bytes[0] ? 1 : 0;
+    case 0x84:	// bit-string, the first byte counts the padding bits
+        if (length)
+        {
+            bytes++;
+            length--;
+        }
+        break;
+    case 0x85:	// integer
+        if (length && (bytes[0] & 0x80))
+        {
+            value = UINT64_MAX;
+        }
+        break;
+    case 0x87:	// floating-point, exponent width then IEEE 754 single or double
+        if (length == 5 && bytes[0] == 8)
+        {
+            uint32_t bits = ((uint32_t)bytes[1] << 24) | ((uint32_t)bytes[2] << 16) | ((uint32_t)bytes[3] << 8) | bytes[4];
+            float single;
+            double converted;
+            memcpy(&single, &bits, sizeof(single));
+            converted = single;
+            memcpy(&value, &converted, sizeof(value));
+            return value;
+        }
+        if (length == 9 && bytes[0] == 11)
+        {
+            bytes++;
+            length--;
+        }
+        break;
+    default:
+        break;
+    }
+
+    // Big-endian: integers keep their low 8 bytes, strings their first 8
+    if (entry->tag == 0x85 || entry->tag == 0x86 || entry->tag == 0x84)
+    {
+        size_t skip = length > sizeof(value) ? length - sizeof(value) : 0;
+        bytes += skip;
+        length -= skip;
+    }
+    else if (length > sizeof(value))
+    {
+        length = sizeof(value);
+    }
+
+    for (size_t i = 0; i < length; i++)
+    {
+        value = (value << 8) | bytes[i];
+    }
+    return value;
+}
+
+double goose_event_log_float(uint64_t value)
+{
+    double result;
+    memcpy(&result, &value, sizeof(result));
+    return result;
+}
+
+int goose_event_log_append(goose_event_log_stream* stream, const goose_frame_view* view, uint64_t receive_ns)
+{
+    goose_event_log_event event;
+    const ber* t = &view->fields[TAG_T - TAG_GOCBREF];
+
+    event.stream_id = stream->stream_id;
+    event.st_num = goose_field_uint(&view->fields[TAG_ST_NUM - TAG_GOCBREF]);
+    event.sq_num = goose_field_uint(&view->fields[TAG_SQ_NUM - TAG_GOCBREF]);
+
+    if (t->tag && t->length == IEC_TIME_UTC_SIZE)
+    {
+        iec_time time;
+        iec_time_decode(t->value, &time, &event.quality);
+        event.time_ns = (uint64_t)time.seconds * NS_PER_SECOND + time.nanoseconds;
+    }
+    else
+    {
+        event.time_ns = receive_ns;
+        event.quality = GOOSE_EVENT_LOG_RECEIVE_TIME;
+    }
+
+    size_t count = view->all_data_list.entry_count;
+    event.member_count = (uint8_t)(count < GOOSE_EVENT_LOG_MEMBERS ? count : GOOSE_EVENT_LOG_MEMBERS);
+    event.changed = 0;
+
+    for (int i = 0; i < event.member_count; i++)
+    {
+        const ber* entry = &view->all_data_list.entries[i];
+        event.tags[i] = entry->tag;
+        event.values[i] = goose_event_log_value(entry);
+
+        if (i >= stream->member_count || event.tags[i] != stream->tags[i] || event.values[i] != stream->values[i])
+        {
+            event.changed |= 1ULL << i;
+        }
+        stream->tags[i] = event.tags[i];
+        stream->values[i] = event.values[i];
+    }
+    stream->member_count = event.member_count;
+
+    // Members past the value columns are compared as a whole, so a change there still shows
+    if (count > GOOSE_EVENT_LOG_MEMBERS || stream->unlogged != FNV_OFFSET)
+    {
+        uint64_t unlogged = unlogged_hash(&view->all_data_list);
+        if (unlogged != stream->unlogged)
+        {
+            event.changed |= GOOSE_EVENT_LOG_UNLOGGED;
+        }
+        stream->unlogged = unlogged;
+    }
+
+    return goose_event_log_push(stream->log, &event);
+}
+
+void goose_event_log_callback(goose_subscription_params* subscription, goose_subscriber_event event, goose_frame_view* view)
+{
+    if (event != GOOSE_SUBSCRIBER_STATE_CHANGE || !subscription->context)
+    {
+        return;
+    }
+
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    goose_event_log_append((goose_event_log_stream*)subscription->context, view, (uint64_t)ts.tv_sec * NS_PER_SECOND + (uint64_t)ts.tv_nsec);
+}
+
+int goose_event_log_segment_open(goose_event_log_segment* segment, const char* path)
+{
+    memset(segment, 0x0, sizeof(*segment));
+
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+    {
+        return -1;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(goose_event_log_header))
+    {
+        close(fd);
+        return -1;
+    }
+
+    void* base = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED)
+    {
+        return -1;
+    }
+
+    const goose_event_log_header* header = (const goose_event_log_header*)base;
+    uint64_t offsets[GOOSE_EVENT_LOG_COLUMNS];
+    uint64_t count = header->count;
+    atomic_thread_fence(memory_order_acquire);
+
+    if (memcmp(header->magic, GOOSE_EVENT_LOG_MAGIC, sizeof(header->magic)) != 0 || header->version != GOOSE_EVENT_LOG_VERSION
+        || header->byte_order != GOOSE_EVENT_LOG_BYTE_ORDER || header->members != GOOSE_EVENT_LOG_MEMBERS
+        || header->block != GOOSE_EVENT_LOG_BLOCK || header->capacity % GOOSE_EVENT_LOG_BLOCK != 0 || count > header->capacity
+        || segment_layout(header->capacity, offsets) > (size_t)st.st_size
+        || memcmp(offsets, header->offsets, sizeof(offsets)) != 0)
+    {
+        munmap(base, (size_t)st.st_size);
+        return -1;
+    }
+
+    segment->header = header;
+    segment->base = (uint8_t*)base;
+    segment->size = (size_t)st.st_size;
+    segment->count = count;
+
+    const uint8_t* bytes = (const uint8_t*)base;
+    segment->stream_id = (const uint32_t*)(bytes + offsets[GOOSE_EVENT_LOG_STREAM_ID]);
+    segment->st_num = (const uint32_t*)(bytes + offsets[GOOSE_EVENT_LOG_ST_NUM]);
+    segment->sq_num = (const uint32_t*)(bytes + offsets[GOOSE_EVENT_LOG_SQ_NUM]);
+    segment->time_ns = (const uint64_t*)(bytes + offsets[GOOSE_EVENT_LOG_TIME]);
+    segment->quality = bytes + offsets[GOOSE_EVENT_LOG_QUALITY];
+    segment->changed = (const uint64_t*)(bytes + offsets[GOOSE_EVENT_LOG_CHANGED]);
+    segment->member_count = bytes + offsets[GOOSE_EVENT_LOG_MEMBER_COUNT];
+    segment->block_min = (const uint64_t*)(bytes + offsets[GOOSE_EVENT_LOG_BLOCK_MIN]);
+    segment->block_max = (const uint64_t*)(bytes + offsets[GOOSE_EVENT_LOG_BLOCK_MAX]);
+    for (int i = 0; i < GOOSE_EVENT_LOG_MEMBERS; i++)
+    {
+        segment->tags[i] = bytes + offsets[GOOSE_EVENT_LOG_TAGS + i];
+        segment->values[i] = (const uint64_t*)(bytes + offsets[GOOSE_EVENT_LOG_VALUES + i]);
+    }
+    return 0;
+}
+
+void goose_event_log_segment_close(goose_event_log_segment* segment)
+{
+    if (segment->base)
+    {
+        munmap(segment->base, segment->size);
+    }
+    memset(segment, 0x0, sizeof(*segment));
+}
+
+static int stream_selected(const goose_event_log_filter* filter, uint32_t stream_id)
+{
+    for (size_t i = 0; i < filter->stream_count; i++)
+    {
+        if (filter->streams[i] == stream_id)
+        {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+// As goose_event_log_scan, and tells whether the visitor asked to stop
+static size_t segment_scan(const goose_event_log_segment* segment, const goose_event_log_filter* filter, goose_event_log_visitor visitor, void* context, int* stopped)
+{
+    size_t visited = 0;
+    *stopped = 0;
+
+    for (uint64_t start = 0; start < segment->count; start += GOOSE_EVENT_LOG_BLOCK)
+    {
+        uint64_t block = start / GOOSE_EVENT_LOG_BLOCK;
+        if (segment->block_max[block] < filter->from_ns || segment->block_min[block] > filter->to_ns)
+        {
+            continue;
+        }
+
+        uint64_t end = start + GOOSE_EVENT_LOG_BLOCK < segment->count ? start + GOOSE_EVENT_LOG_BLOCK : segment->count;
+        int whole_range = segment->block_min[block] >= filter->from_ns && segment->block_max[block] <= filter->to_ns;
+
+        for (uint64_t record = start; record < end; record++)
+        {
+            if (!whole_range && (segment->time_ns[record] < filter->from_ns || segment->time_ns[record] > filter->to_ns))
+            {
+                continue;
+            }
+            if (filter->streams && !stream_selected(filter, segment->stream_id[record]))
+            {
+                continue;
+            }
+
+            visited++;
+            if (visitor && visitor(segment, (size_t)record, context))
+            {
+                *stopped = 1;
+                return visited;
+            }
+        }
+    }
+    return visited;
+}
+
+size_t goose_event_log_scan(const goose_event_log_segment* segment, const goose_event_log_filter* filter, goose_event_log_visitor visitor, void* context)
+{
+    int stopped;
+    return segment_scan(segment, filter, visitor, context, &stopped);
+}
+
+int64_t goose_event_log_query(const char* directory, const char* prefix, const goose_event_log_filter* filter, goose_event_log_visitor visitor, void* context)
+{
+    segment_entry* segments;
+    size_t count;
+    if (list_segments(directory, prefix, &segments, &count) != 0)
+    {
+        return -1;
+    }
+
+    int64_t visited = 0;
+    int stopped = 0;
+    for (size_t i = 0; i < count && !stopped; i++)
+    {
+        goose_event_log_segment segment;
+        char* path = entry_path(directory, segments[i].name);
+        int opened = path ? goose_event_log_segment_open(&segment, path) : -1;
+        free(path);
+        if (opened != 0)
+        {
+            continue;
+        }
+
+        if (segment.count && segment.header->max_ns >= filter->from_ns && segment.header->min_ns <= filter->to_ns)
+        {
+            visited += (int64_t)segment_scan(&segment, filter, visitor, context, &stopped);
+        }
+        goose_event_log_segment_close(&segment);
+    }
+
+    free_segments(segments, count);
+    return visited;
+}
@@ -0,0 +1,184 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include "goose.h"
+#include "goose_subscriber.h"
+
+// Append-only log of decoded state changes, one fixed-width record per stNum change.
+// Records live in segment files of column arrays (stream ID, stNum, sqNum, time, quality,
+// changed-member bitmap, then one tag and one value column per member), so a query only
+// touches the columns it filters on. Segments are mapped shared and rotated when full.
+//
+// The receive thread only copies records into a single-producer ring: goose_event_log_append
+// takes no lock and makes no system call, and drops the record if the ring is full. Another
+// thread moves them into the segments with goose_event_log_drain, which is where files get
+// created, grown into and rotated. Segments use the host byte order.
+
+#ifndef GOOSE_EVENT_LOG_MEMBERS
+#define GOOSE_EVENT_LOG_MEMBERS 16	// Value columns per record, see GOOSE_EVENT_LOG_UNLOGGED for members beyond
+#endif
+
+#if GOOSE_EVENT_LOG_MEMBERS > 63
+#error "GOOSE_EVENT_LOG_MEMBERS must leave the top bit of the changed bitmap free"
+#endif
+
+// Top bit of the changed bitmap: a member past the value columns changed. Their values
+// are not logged, only whether any of them differ from the stream's previous record.
+#define GOOSE_EVENT_LOG_UNLOGGED (1ULL << 63)
+
+#ifndef GOOSE_EVENT_LOG_BLOCK
+#define GOOSE_EVENT_LOG_BLOCK 4096	// Records per time range entry of the segment index
+#endif
+
+#define GOOSE_EVENT_LOG_MAGIC "GOOSELOG"
+#define GOOSE_EVENT_LOG_VERSION 1
+#define GOOSE_EVENT_LOG_BYTE_ORDER 0x01020304u
+#define GOOSE_EVENT_LOG_SUFFIX ".glog"
+
+// Time quality stored for frames without a UtcTime T field; time_ns is then the receive time
+#define GOOSE_EVENT_LOG_RECEIVE_TIME 0xff
+
+typedef enum
+{
+	GOOSE_EVENT_LOG_STREAM_ID,	// uint32_t
+	GOOSE_EVENT_LOG_ST_NUM,		// uint32_t
+	GOOSE_EVENT_LOG_SQ_NUM,		// uint32_t
+	GOOSE_EVENT_LOG_TIME,		// uint64_t, nanoseconds since 1970-01-01 UTC
+	GOOSE_EVENT_LOG_QUALITY,	// uint8_t, UtcTime time quality
+	GOOSE_EVENT_LOG_CHANGED,	// uint64_t, bit i set when member i differs from the stream's previous record, plus GOOSE_EVENT_LOG_UNLOGGED
+	GOOSE_EVENT_LOG_MEMBER_COUNT,	// uint8_t
+	GOOSE_EVENT_LOG_BLOCK_MIN,	// uint64_t per block of GOOSE_EVENT_LOG_BLOCK records
+	GOOSE_EVENT_LOG_BLOCK_MAX,
+	GOOSE_EVENT_LOG_TAGS,		// GOOSE_EVENT_LOG_MEMBERS uint8_t columns of BER tags
+	GOOSE_EVENT_LOG_VALUES = GOOSE_EVENT_LOG_TAGS + GOOSE_EVENT_LOG_MEMBERS,	// and as many uint64_t value columns
+	GOOSE_EVENT_LOG_COLUMNS = GOOSE_EVENT_LOG_VALUES + GOOSE_EVENT_LOG_MEMBERS
+} goose_event_log_column;
+
+// Start of every segment file, columns follow at 64-byte aligned offsets
+typedef struct
+{
+	uint8_t magic[8];
+	uint32_t version;
+	uint32_t byte_order;
+	uint32_t members;
+	uint32_t block;
+	uint64_t sequence;	// Position of the segment in the log
+	uint64_t capacity;	// Records per column
+	volatile uint64_t count;	// Records written, stored after their columns
+	uint64_t min_ns;	// Time range of the records written
+	uint64_t max_ns;
+	uint64_t offsets[GOOSE_EVENT_LOG_COLUMNS];
+} goose_event_log_header;
+
+// One record. Values are decoded to 64 bits by goose_event_log_value.
+typedef struct
+{
+	uint32_t stream_id;
+	uint32_t st_num;
+	uint32_t sq_num;
+	uint8_t quality;
+	uint8_t member_count;
+	uint8_t tags[GOOSE_EVENT_LOG_MEMBERS];
+	uint64_t time_ns;
+	uint64_t changed;
+	uint64_t values[GOOSE_EVENT_LOG_MEMBERS];
+} goose_event_log_event;
+
+// Defined in goose_event_log.c
+typedef struct goose_event_log goose_event_log;
+
+typedef struct
+{
+	const char* directory;
+	const char* prefix;	// Segments are DIRECTORY/PREFIX-00000000.glog onwards
+	size_t segment_bytes;	// Rotation size, rounded down to whole blocks of records
+	size_t queue_size;	// Ring entries between append and drain, a power of two
+} goose_event_log_params;
+
+// Numbering continues after the segments already in the directory. NULL on error.
+goose_event_log* goose_event_log_open(const goose_event_log_params* params);
+
+// Drains what is queued, syncs and unmaps the current segment
+void goose_event_log_close(goose_event_log* log);
+
+// Single producer: returns 0, or -1 and counts a drop when the ring is full
+int goose_event_log_push(goose_event_log* log, const goose_event_log_event* event);
+
+// Single consumer: moves queued records into the segments and returns how many. If the
+// next segment cannot be created, e.g. when the disk is full, the records still queued
+// are dropped.
+size_t goose_event_log_drain(goose_event_log* log);
+
+// Records dropped on a full ring or for want of a segment
+uint64_t goose_event_log_dropped(const goose_event_log* log);
+uint64_t goose_event_log_segments(const goose_event_log* log);	// Created by this writer
+
+// Receive side state of one subscribed stream: the values of its last record, which the
+// changed bitmap of the next one is computed against
+typedef struct
+{
+	goose_event_log* log;
+	uint32_t stream_id;
+	uint8_t member_count;	// 0 until the first record
+	uint8_t tags[GOOSE_EVENT_LOG_MEMBERS];
+	uint64_t values[GOOSE_EVENT_LOG_MEMBERS];
+	uint64_t unlogged;	// Hash of the members past the value columns
+} goose_event_log_stream;
+
+void goose_event_log_stream_init(goose_event_log_stream* stream, goose_event_log* log, uint32_t stream_id);
+
+// Queues a record for a decoded frame whose all_data_list is filled. receive_ns stands in
+// for the T field when the frame has none. Same return as goose_event_log_push.
+int goose_event_log_append(goose_event_log_stream* stream, const goose_frame_view* view, uint64_t receive_ns);
+
+// goose_subscriber_callback logging every state change; context must be a goose_event_log_stream
+void goose_event_log_callback(goose_subscription_params* subscription, goose_subscriber_event event, goose_frame_view* view);
+
+// Booleans, integers and bit-strings as unsigned or sign-extended integers, floats as the
+// bits of a double, UtcTime as its 8 raw bytes, anything else as its first 8 bytes, big-endian
+uint64_t goose_event_log_value(const ber* entry);
+double goose_event_log_float(uint64_t value);
+
+// Read side: a mapped segment with a pointer to each column
+typedef struct
+{
+	const goose_event_log_header* header;
+	uint8_t* base;
+	size_t size;
+	uint64_t count;	// Records committed when the segment was opened
+
+	const uint32_t* stream_id;
+	const uint32_t* st_num;
+	const uint32_t* sq_num;
+	const uint64_t* time_ns;
+	const uint8_t* quality;
+	const uint64_t* changed;
+	const uint8_t* member_count;
+	const uint64_t* block_min;
+	const uint64_t* block_max;
+	const uint8_t* tags[GOOSE_EVENT_LOG_MEMBERS];
+	const uint64_t* values[GOOSE_EVENT_LOG_MEMBERS];
+} goose_event_log_segment;
+
+// Returns 0, or -1 if the file cannot be mapped or is not a segment of this build's layout
+int goose_event_log_segment_open(goose_event_log_segment* segment, const char* path);
+void goose_event_log_segment_close(goose_event_log_segment* segment);
+
+typedef struct
+{
+	uint64_t from_ns;	// Inclusive time range, 0 and UINT64_MAX for all records
+	uint64_t to_ns;
+	const uint32_t* streams;	// Stream IDs to keep, NULL for all
+	size_t stream_count;
+} goose_event_log_filter;
+
+// Called with each matching record, in log order. A nonzero return stops the scan.
+typedef int (*goose_event_log_visitor)(const goose_event_log_segment* segment, size_t record, void* context);
+
+// Returns the number of records visited. Blocks of records outside the time range are skipped.
+size_t goose_event_log_scan(const goose_event_log_segment* segment, const goose_event_log_filter* filter, goose_event_log_visitor visitor, void* context);
+
+// Scans every segment of a log in sequence order, skipping segments outside the time range.
+// Returns the number of records visited, or -1 if the directory cannot be read.
+int64_t goose_event_log_query(const char* directory, const char* prefix, const goose_event_log_filter* filter, goose_event_log_visitor visitor, void* context);
@@ -0,0 +1,434 @@
+#include "goose_gateway.h"
+#include "iec_time.h"
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define CACHE_LINE 64
+#define GOOSE_HEADER_SIZE (APP_ID_SIZE + 3 * sizeof(uint16_t))	// APPID, Length, Reserved 1 and 2
+#define GOOSE_EXTENSION_LENGTH (APP_ID_SIZE + sizeof(uint16_t) + 1)	// Low byte of Reserved 1
+#define GOOSE_GATEWAY_MAC_FIELDS (GOOSE_GATEWAY_SET_APP_ID | GOOSE_GATEWAY_RESTAMP)
+#define MIX_MULTIPLIER 0x9e3779b97f4a7c15ULL
+
+typedef struct
+{
+    goose_gateway_rule rule;
+    atomic_uint_least64_t forwarded;
+} gateway_rule;
+
+typedef enum
+{
+    GATEWAY_FRAMES,
+    GATEWAY_FORWARDED,
+    GATEWAY_UNMATCHED,
+    GATEWAY_MALFORMED,
+    GATEWAY_AUTH_FAILED,
+    GATEWAY_NO_ROOM,
+    GATEWAY_RING_FULL,
+    GATEWAY_COUNTERS
+} gateway_counter;
+
+struct goose_gateway
+{
+    // Receive side
+    atomic_size_t head;
+    size_t cached_tail;
+    atomic_uint_least64_t counters[GATEWAY_COUNTERS];
+    uint8_t producer_pad[CACHE_LINE];
+
+    // Transmit side
+    atomic_size_t tail;
+    uint8_t consumer_pad[CACHE_LINE - sizeof(atomic_size_t)];
+
+    goose_gateway_frame* ring;
+    size_t mask;
+
+    gateway_rule* rules;
+    size_t rule_count;
+    size_t rule_capacity;
+    size_t source_rules;	// Rules with GOOSE_GATEWAY_MATCH_SOURCE, the exact lookup is skipped while 0
+    uint32_t* index;	// Open addressing, rule number + 1, 0 when free
+    size_t index_size;
+};
+
+static void counter_add(goose_gateway* gateway, gateway_counter counter)
+{
+    atomic_uint_least64_t* value = &gateway->counters[counter];
+    atomic_store_explicit(value, atomic_load_explicit(value, memory_order_relaxed) + 1, memory_order_relaxed);
+}
+
+static size_t rule_hash(uint16_t app_id, const uint8_t* source)
+{
+    uint64_t key = app_id;
+    if (source)
+    {
+        for (int i = 0; i < MAC_ADDRESS_SIZE; i++)
+        {
+            key = (key << 8) | source[i];
+        }
+        key ^= 1ULL << 63;
+    }
+    key *= MIX_MULTIPLIER;
+    return (size_t)(key ^ (key >> 32));
+}
+
+static int rule_matches(const goose_gateway_rule* rule, uint16_t app_id, const uint8_t* source)
+{
+    if (rule->app_id != app_id)
+    {
+        return 0;
+    }
+    if (!source)
+    {
+        return !(rule->flags & GOOSE_GATEWAY_MATCH_SOURCE);
+    }
+    return (rule->flags & GOOSE_GATEWAY_MATCH_SOURCE) && memcmp(rule->source, source, MAC_ADDRESS_SIZE) == 0;
+}
+
+// source NULL looks up the APPID-only rule
+static gateway_rule* rule_find(const goose_gateway* gateway, uint16_t app_id, const uint8_t* source)
+{
+    if (!gateway->index_size)
+    {
+        return NULL;
+    }
+
+    size_t mask = gateway->index_size - 1;
+    size_t slot = rule_hash(app_id, source) & mask;
+
+    while (gateway->index[slot])
+    {
+        gateway_rule* rule = &gateway->rules[gateway->index[slot] - 1];
+        if (rule_matches(&rule->rule, app_id, source))
+        {
+            return rule;
+        }
+        slot = (slot + 1) & mask;
+    }
+    return NULL;
+}
+
+static size_t rule_slot(const goose_gateway_rule* rule, size_t mask)
+{
+    return rule_hash(rule->app_id, (rule->flags & GOOSE_GATEWAY_MATCH_SOURCE) ? rule->source : NULL) & mask;
+}
+
+// Keeps the index at most half full
+static int index_grow(goose_gateway* gateway)
+{
+    size_t size = gateway->index_size ? gateway->index_size * 2 : 64;
+    uint32_t* index = (uint32_t*)calloc(size, sizeof(uint32_t));
+    if (!index)
+    {
+        return -1;
+    }
+
+    for (size_t i = 0; i < gateway->rule_count; i++)
+    {
+        size_t slot = rule_slot(&gateway->rules[i].rule, size - 1);
+        while (index[slot])
+        {
+            slot = (slot + 1) & (size - 1);
+        }
+        index[slot] = (uint32_t)(i + 1);
+    }
+
+    free(gateway->index);
+    gateway->index = index;
+    gateway->index_size = size;
+    return 0;
+}
+
+goose_gateway* goose_gateway_create(size_t ring_size)
+{
+    if (ring_size < 2 || (ring_size & (ring_size - 1)) != 0)
+    {
+        return NULL;
+    }
+
+    goose_gateway* gateway = (goose_gateway*)calloc(1, sizeof(goose_gateway));
+    if (!gateway)
+    {
+        return NULL;
+    }
+
+    gateway->ring = (goose_gateway_frame*)malloc(ring_size * sizeof(goose_gateway_frame));
+    if (!gateway->ring)
+    {
+        free(gateway);
+        return NULL;
+    }
+
+    atomic_init(&gateway->head, 0);
+    atomic_init(&gateway->tail, 0);
+    for (int i = 0; i < GATEWAY_COUNTERS; i++)
+    {
+        atomic_init(&gateway->counters[i], 0);
+    }
+    gateway->mask = ring_size - 1;
+    return gateway;
+}
+
+void goose_gateway_free(goose_gateway* gateway)
+{
+    if (!gateway)
+    {
+        return;
+    }
+
+    free(gateway->ring);
+    free(gateway->rules);
+    free(gateway->index);
+    free(gateway);
+}
+
+int goose_gateway_rule_add(goose_gateway* gateway, const goose_gateway_rule* rule)
+{
+    const uint8_t* source = (rule->flags & GOOSE_GATEWAY_MATCH_SOURCE) ? rule->source : NULL;
+    if (rule_find(gateway, rule->app_id, source))
+    {
+        return -1;
+    }
+
+    if ((gateway->rule_count + 1) * 2 > gateway->index_size && index_grow(gateway) != 0)
+    {
+        return -1;
+    }
+
+    if (gateway->rule_count == gateway->rule_capacity)
+    {
+        size_t capacity = gateway->rule_capacity ? gateway->rule_capacity * 2 : 16;
+        gateway_rule* rules = (gateway_rule*)realloc(gateway->rules, capacity * sizeof(gateway_rule));
+        if (!rules)
+        {
+            return -1;
+        }
+        gateway->rules = rules;
+        gateway->rule_capacity = capacity;
+    }
+
+    gateway_rule* added = &gateway->rules[gateway->rule_count];
+    added->rule = *rule;
+    atomic_init(&added->forwarded, 0);
+
+    size_t mask = gateway->index_size - 1;
+    size_t slot = rule_slot(rule, mask);
+    while (gateway->index[slot])
+    {
+        slot = (slot + 1) & mask;
+    }
+    gateway->index[slot] = (uint32_t)(++gateway->rule_count);
+
+    if (source)
+    {
+        gateway->source_rules++;
+    }
+    return (int)(gateway->rule_count - 1);
+}
+
+uint64_t goose_gateway_rule_forwarded(const goose_gateway* gateway, int index)
+{
+    if (index < 0 || (size_t)index >= gateway->rule_count)
+    {
+        return 0;
+    }
+    return atomic_load_explicit(&gateway->rules[index].forwarded, memory_order_relaxed);
+}
+
+// Rewrites the UtcTime of an encoded goosePdu starting at pdu; 0 if it has no T field
+static int restamp(uint8_t* pdu, size_t length)
+{
+    uint8_t tag;
+    size_t field_length;
+    size_t header = ber_decode_header(pdu, length, &tag, &field_length);
+    if (!header || tag != TAG_PDU)
+    {
+        return 0;
+    }
+
+    size_t offset = header;
+    while (offset < length)
+    {
+        header = ber_decode_header(pdu + offset, length - offset, &tag, &field_length);
+        if (!header || offset + header + field_length > length)
+        {
+            return 0;
+        }
+        if (tag == TAG_T)
+        {
+            if (field_length != IEC_TIME_UTC_SIZE)
+            {
+                return 0;
+            }
+            iec_time_stamp(pdu + offset + header);
+            return 1;
+        }
+        if (tag > TAG_T)
+        {
+            return 0;
+        }
+        offset += header + field_length;
+    }
+    return 0;
+}
+
+static int gateway_drop(goose_gateway* gateway, gateway_counter counter)
+{
+    counter_add(gateway, counter);
+    return -1;
+}
+
+int goose_gateway_input(goose_gateway* gateway, goose_gateway_frame* frame)
+{
+    uint8_t* bytes = frame->buffer + frame->offset;
+    size_t length = frame->length;
+
+    counter_add(gateway, GATEWAY_FRAMES);
+
+    size_t offset = MAC_ADDRESS_SIZE * 2;
+    int tagged = length >= offset + VLAN_TAG_SIZE && bytes[offset] == VLAN_TPID_0 && bytes[offset + 1] == VLAN_TPID_1;
+    if (tagged)
+    {
+        offset += VLAN_TAG_SIZE;
+    }
+    if (length < offset + ETHERTYPE_SIZE + GOOSE_HEADER_SIZE || bytes[offset] != GOOSE_ETHERTYPE_0 || bytes[offset + 1] != GOOSE_ETHERTYPE_1)
+    {
+        return gateway_drop(gateway, GATEWAY_MALFORMED);
+    }
+
+    uint8_t* app_id_bytes = bytes + offset + ETHERTYPE_SIZE;
+    uint16_t app_id = (uint16_t)((app_id_bytes[0] << 8) | app_id_bytes[1]);
+
+    gateway_rule* match = gateway->source_rules ? rule_find(gateway, app_id, bytes + MAC_ADDRESS_SIZE) : NULL;
+    if (!match)
+    {
+        match = rule_find(gateway, app_id, NULL);
+    }
+    if (!match)
+    {
+        counter_add(gateway, GATEWAY_UNMATCHED);
+        return 0;
+    }
+    const goose_gateway_rule* rule = &match->rule;
+
+    if (rule->verify && goose_auth_verify(rule->verify, bytes, length) != 0)
+    {
+        return gateway_drop(gateway, GATEWAY_AUTH_FAILED);
+    }
+
+    // Everything that can drop the frame is checked before it is touched, so the caller
+    // gets it back as received. Moving the addresses leaves the end of the frame in place,
+    // and a signature replaces any extension after the goosePdu.
+    int add_tag = (rule->flags & GOOSE_GATEWAY_SET_VLAN) && !tagged;
+    int remove_tag = (rule->flags & GOOSE_GATEWAY_STRIP_VLAN) && tagged;
+    size_t apdu_length = (size_t)((app_id_bytes[2] << 8) | app_id_bytes[3]);
+    size_t pdu_end = offset + ETHERTYPE_SIZE + apdu_length;
+    if (apdu_length < GOOSE_HEADER_SIZE || pdu_end > length)
+    {
+        return gateway_drop(gateway, GATEWAY_MALFORMED);
+    }
+    if (rule->sign && !goose_auth_key_present(rule->sign))
+    {
+        return gateway_drop(gateway, GATEWAY_AUTH_FAILED);
+    }
+    if ((add_tag && frame->offset < VLAN_TAG_SIZE) || (rule->sign && frame->offset + pdu_end + GOOSE_AUTH_EXTENSION_SIZE > frame->capacity))
+    {
+        return gateway_drop(gateway, GATEWAY_NO_ROOM);
+    }
+
+    size_t head = atomic_load_explicit(&gateway->head, memory_order_relaxed);
+    if (head - gateway->cached_tail > gateway->mask)
+    {
+        gateway->cached_tail = atomic_load_explicit(&gateway->tail, memory_order_acquire);
+        if (head - gateway->cached_tail > gateway->mask)
+        {
+            return gateway_drop(gateway, GATEWAY_RING_FULL);
+        }
+    }
+
+    if (rule->flags & GOOSE_GATEWAY_SET_APP_ID)
+    {
+        app_id_bytes[0] = (uint8_t)(rule->new_app_id >> 8);
+        app_id_bytes[1] = (uint8_t)rule->new_app_id;
+    }
+    if (rule->flags & GOOSE_GATEWAY_RESTAMP)
+    {
+        restamp(app_id_bytes + GOOSE_HEADER_SIZE, pdu_end - offset - ETHERTYPE_SIZE - GOOSE_HEADER_SIZE);
+    }
+
+    // The old MAC no longer verifies, forward the frame unsigned instead
+    if (!rule->sign && (rule->flags & GOOSE_GATEWAY_MAC_FIELDS) && app_id_bytes[GOOSE_EXTENSION_LENGTH])
+    {
+        app_id_bytes[GOOSE_EXTENSION_LENGTH] = 0;
+        length = pdu_end;
+    }
+
+    // Only the addresses move, the tag and everything after it stay where they are
+    if (add_tag)
+    {
+        memmove(bytes - VLAN_TAG_SIZE, bytes, MAC_ADDRESS_SIZE * 2);
+        bytes -= VLAN_TAG_SIZE;
+        frame->offset -= VLAN_TAG_SIZE;
+        length += VLAN_TAG_SIZE;
+        bytes[MAC_ADDRESS_SIZE * 2] = VLAN_TPID_0;
+        bytes[MAC_ADDRESS_SIZE * 2 + 1] = VLAN_TPID_1;
+    }
+    else if (remove_tag)
+    {
+        memmove(bytes + VLAN_TAG_SIZE, bytes, MAC_ADDRESS_SIZE * 2);
+        bytes += VLAN_TAG_SIZE;
+        frame->offset += VLAN_TAG_SIZE;
+        length -= VLAN_TAG_SIZE;
+    }
+    if (rule->flags & GOOSE_GATEWAY_SET_VLAN)
+    {
+        uint16_t tci = (uint16_t)(((rule->vlan_priority & VLAN_MAX_PRIORITY) << 13) | (rule->vlan_id & VLAN_MAX_ID));
+        bytes[MAC_ADDRESS_SIZE * 2 + 2] = (uint8_t)(tci >> 8);
+        bytes[MAC_ADDRESS_SIZE * 2 + 3] = (uint8_t)tci;
+    }
+    if (rule->flags & GOOSE_GATEWAY_SET_DESTINATION)
+    {
+        memcpy(bytes, rule->destination, MAC_ADDRESS_SIZE);
+    }
+
+    // The key, the bounds and the tailroom were checked above, so this cannot fail
+    if (rule->sign)
+    {
+        length = goose_auth_sign(rule->sign, bytes, length, frame->capacity - frame->offset);
+    }
+
+    frame->length = length;
+    frame->port = rule->port;
+
+    gateway->ring[head & gateway->mask] = *frame;
+    atomic_store_explicit(&gateway->head, head + 1, memory_order_release);
+
+    atomic_store_explicit(&match->forwarded, atomic_load_explicit(&match->forwarded, memory_order_relaxed) + 1, memory_order_relaxed);
+    counter_add(gateway, GATEWAY_FORWARDED);
+    return 1;
+}
+
+int goose_gateway_pop(goose_gateway* gateway, goose_gateway_frame* out)
+{
+    size_t tail = atomic_load_explicit(&gateway->tail, memory_order_relaxed);
+    if (tail == atomic_load_explicit(&gateway->head, memory_order_acquire))
+    {
+        return 0;
+    }
+
+    *out = gateway->ring[tail & gateway->mask];
+    atomic_store_explicit(&gateway->tail, tail + 1, memory_order_release);
+    return 1;
+}
+
+void goose_gateway_stats_snapshot(const goose_gateway* gateway, goose_gateway_stats* out)
+{
+    goose_gateway* shared = (goose_gateway*)gateway;
+    out->frames = atomic_load_explicit(&shared->counters[GATEWAY_FRAMES], memory_order_relaxed);
+    out->forwarded = atomic_load_explicit(&shared->counters[GATEWAY_FORWARDED], memory_order_relaxed);
+    out->unmatched = atomic_load_explicit(&shared->counters[GATEWAY_UNMATCHED], memory_order_relaxed);
+    out->malformed = atomic_load_explicit(&shared->counters[GATEWAY_MALFORMED], memory_order_relaxed);
+    out->auth_failed = atomic_load_explicit(&shared->counters[GATEWAY_AUTH_FAILED], memory_order_relaxed);
+    out->no_room = atomic_load_explicit(&shared->counters[GATEWAY_NO_ROOM], memory_order_relaxed);
+    out->ring_full = atomic_load_explicit(&shared->counters[GATEWAY_RING_FULL], memory_order_relaxed);
+}
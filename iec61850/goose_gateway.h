@@ -0,0 +1,86 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include "goose.h"
+#include "goose_auth.h"
+
+// Forwarding of GOOSE between segments without decoding or re-encoding. Each received frame
+// is matched by APPID, and optionally source MAC, against a rule table. The header fields
+// the rule names are rewritten in place in the receive buffer, and the buffer itself goes
+// out through a single-producer, single-consumer ring; the goosePdu is never copied.
+//
+// Adding or removing an 802.1Q tag moves only the two MAC addresses, into the headroom in
+// front of the frame or over the old tag. Re-signing appends the IEC 62351-6 extension, so
+// it needs GOOSE_AUTH_EXTENSION_SIZE bytes of tailroom. A rule that sets the APPID or T
+// without re-signing strips the extension a received frame carries, since its MAC covers
+// both and would no longer verify. Rules are added before forwarding
+// starts; goose_gateway_input runs on the receive thread and goose_gateway_pop on the
+// transmit thread.
+
+#define GOOSE_GATEWAY_MATCH_SOURCE 0x01	// Match the source MAC as well as the APPID
+#define GOOSE_GATEWAY_SET_APP_ID 0x02
+#define GOOSE_GATEWAY_SET_DESTINATION 0x04
+#define GOOSE_GATEWAY_SET_VLAN 0x08	// Tag, or retag, with vlan_priority and vlan_id
+#define GOOSE_GATEWAY_STRIP_VLAN 0x10
+#define GOOSE_GATEWAY_RESTAMP 0x20	// Rewrite T with iec_time_stamp
+
+typedef struct
+{
+	uint8_t flags;
+	uint16_t app_id;		// Received APPID
+	uint8_t source[MAC_ADDRESS_SIZE];	// With GOOSE_GATEWAY_MATCH_SOURCE
+
+	uint16_t new_app_id;
+	uint8_t destination[MAC_ADDRESS_SIZE];
+	uint8_t vlan_priority;
+	uint16_t vlan_id;
+
+	const goose_auth_keyring* verify;	// Frames without a valid MAC are dropped, NULL accepts all
+	const goose_auth_keyring* sign;		// Re-signs the rewritten frame, NULL forwards it unsigned (see below)
+	uint16_t port;			// Handed to the transmit side with the frame
+} goose_gateway_rule;
+
+// A receive buffer. The frame occupies [offset, offset + length) of buffer; forwarding
+// may move offset and change length, and fills in port.
+typedef struct
+{
+	uint8_t* buffer;
+	size_t capacity;
+	size_t offset;
+	size_t length;
+	uint16_t port;
+	void* tag;	// Caller's own, e.g. the receive ring slot to give back after transmit
+} goose_gateway_frame;
+
+typedef struct
+{
+	uint64_t frames;
+	uint64_t forwarded;
+	uint64_t unmatched;	// No rule, the buffer stays with the caller
+	uint64_t malformed;	// Not GOOSE, or too short
+	uint64_t auth_failed;
+	uint64_t no_room;	// Not enough headroom or tailroom for the rewrite
+	uint64_t ring_full;
+} goose_gateway_stats;
+
+// Defined in goose_gateway.c
+typedef struct goose_gateway goose_gateway;
+
+// ring_size is a power of two. NULL on error.
+goose_gateway* goose_gateway_create(size_t ring_size);
+void goose_gateway_free(goose_gateway* gateway);
+
+// Returns the rule index, or -1 if an identical match already exists or memory runs out
+int goose_gateway_rule_add(goose_gateway* gateway, const goose_gateway_rule* rule);
+uint64_t goose_gateway_rule_forwarded(const goose_gateway* gateway, int index);
+
+// Returns 1 when the frame was rewritten and queued, the buffer then belongs to the
+// transmit side until popped. 0 when no rule matches and -1 when the frame is dropped;
+// in both cases the caller keeps the buffer.
+int goose_gateway_input(goose_gateway* gateway, goose_gateway_frame* frame);
+
+// Returns 1 and the oldest queued frame, or 0 when the ring is empty
+int goose_gateway_pop(goose_gateway* gateway, goose_gateway_frame* out);
+
+void goose_gateway_stats_snapshot(const goose_gateway* gateway, goose_gateway_stats* out);
@@ -0,0 +1,420 @@
+#include "goose_image.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__unix__) || defined(__APPLE__)
+#define GOOSE_IMAGE_MMAP 1
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// Four interleaved FNV-1a lanes over 64-bit words, folded to 32 bits. One lane of
+// byte-wise FNV-1a costs about a nanosecond per byte, which dominated opening a large image.
+uint32_t goose_image_checksum(const uint8_t* bytes, size_t size)
+{
+    const uint64_t prime = 1099511628211ULL;
+    uint64_t lanes[4] = { 14695981039346656037ULL, 14695981039346656037ULL ^ 1, 14695981039346656037ULL ^ 2, 14695981039346656037ULL ^ 3 };
+    size_t i = 0;
+
+    for (; i + 32 <= size; i += 32)
+    {
+        for (size_t lane = 0; lane < 4; lane++)
+        {
+            uint64_t word;
+            memcpy(&word, bytes + i + lane * 8, sizeof(word));
+            lanes[lane] = (lanes[lane] ^ word) * prime;
+        }
+    }
+
+    uint64_t hash = lanes[0] ^ (lanes[1] * 3) ^ (lanes[2] * 5) ^ (lanes[3] * 7);
+    for (; i < size; i++)
+    {
+        hash = (hash ^ bytes[i]) * prime;
+    }
+
+    return (uint32_t)(hash ^ (hash >> 32));
+}
+
+// Nonzero if [offset, offset + count * item) lies inside [start, start + size)
+static int goose_image_in_range(uint64_t start, uint64_t size, uint64_t offset, uint64_t count, uint64_t item)
+{
+    return offset >= start && offset + count * item <= start + size;
+}
+
+// Ethernet header with its optional 802.1Q tag, then APPID, Length and the two reserved fields
+static size_t goose_image_frame_header_length(const uint8_t* frame)
+{
+    size_t length = MAC_ADDRESS_SIZE * 2 + ETHERTYPE_SIZE + APP_ID_SIZE + sizeof(((goose_frame*)0)->len) + RESERVED_SIZE * 2;
+    if (frame[MAC_ADDRESS_SIZE * 2] == VLAN_TPID_0 && frame[MAC_ADDRESS_SIZE * 2 + 1] == VLAN_TPID_1)
+    {
+        length += VLAN_TAG_SIZE;
+    }
+    return length;
+}
+
+// Everything the accessors rely on is checked once here, so they can index without checks
+static int goose_image_validate(const goose_image* image)
+{
+    const goose_image_header* header = image->header;
+
+    if (image->size < sizeof(goose_image_header)
+        || memcmp(header->magic, GOOSE_IMAGE_MAGIC, GOOSE_IMAGE_MAGIC_SIZE) != 0
+        || header->version != GOOSE_IMAGE_VERSION
+        || header->byte_order != GOOSE_IMAGE_BYTE_ORDER
+        || header->size != image->size)
+    {
+        return -1;
+    }
+
+    if (goose_image_checksum(image->base + sizeof(goose_image_header), image->size - sizeof(goose_image_header)) != header->checksum)
+    {
+        return -1;
+    }
+
+    if (!goose_image_in_range(0, image->size, header->dataset_offset, header->dataset_count, sizeof(goose_image_dataset))
+        || !goose_image_in_range(0, image->size, header->entry_offset, header->entry_count, sizeof(goose_image_entry))
+        || !goose_image_in_range(0, image->size, header->publisher_offset, header->publisher_count, sizeof(goose_image_publisher))
+        || !goose_image_in_range(0, image->size, header->subscription_offset, header->subscription_count, sizeof(goose_image_subscription))
+        || !goose_image_in_range(0, image->size, header->string_offset, header->string_size, 1)
+        || !goose_image_in_range(0, image->size, header->data_offset, header->data_size, 1)
+        || (header->dataset_offset | header->entry_offset | header->publisher_offset | header->subscription_offset) % sizeof(uint32_t) != 0
+        || header->string_size == 0
+        || image->base[header->string_offset + header->string_size - 1] != '\0')
+    {
+        return -1;
+    }
+
+    for (uint32_t i = 0; i < header->dataset_count; i++)
+    {
+        const goose_image_dataset* dataset = goose_image_dataset_get(image, i);
+        if (dataset->name >= header->string_size || !goose_image_in_range(0, header->entry_count, dataset->first_entry, dataset->entry_count, 1))
+        {
+            return -1;
+        }
+    }
+
+    const goose_image_entry* entries = (const goose_image_entry*)(image->base + header->entry_offset);
+    for (uint32_t i = 0; i < header->entry_count; i++)
+    {
+        if (!goose_image_in_range(0, header->data_size, entries[i].value, entries[i].length, 1))
+        {
+            return -1;
+        }
+    }
+
+    for (uint32_t i = 0; i < header->publisher_count; i++)
+    {
+        const goose_image_publisher* publisher = goose_image_publisher_get(image, i);
+        if (publisher->name >= header->string_size
+            || (publisher->dataset != GOOSE_IMAGE_NONE && publisher->dataset >= header->dataset_count)
+            || publisher->frame_length > sizeof(((goose_handle*)0)->byte_stream)
+            || publisher->frame_length < MAC_ADDRESS_SIZE * 2 + ETHERTYPE_SIZE
+            || !goose_image_in_range(0, header->data_size, publisher->frame, publisher->frame_length, 1))
+        {
+            return -1;
+        }
+
+        // goose_image_handle reads the APPID and Length from the header, and the fields must
+        // not overlap it
+        size_t frame_header = goose_image_frame_header_length(image->base + header->data_offset + publisher->frame);
+        if (publisher->frame_length < frame_header)
+        {
+            return -1;
+        }
+
+        for (size_t k = 0; k < GOOSE_PDU_FIELD_COUNT; k++)
+        {
+            if (!goose_image_in_range(0, publisher->frame_length, publisher->field_offset[k], publisher->field_length[k], 1)
+                || (publisher->field_length[k] && publisher->field_offset[k] < frame_header))
+            {
+                return -1;
+            }
+        }
+
+        // Members lie inside allData
+        size_t all_data = publisher->field_offset[GOOSE_PDU_FIELD_COUNT - 1];
+        size_t all_data_length = publisher->field_length[GOOSE_PDU_FIELD_COUNT - 1];
+        if (publisher->member_count > MAX_NUM_DATASET_ENTRIES
+            || !goose_image_in_range(0, header->data_size, publisher->members, publisher->member_count, sizeof(goose_image_member))
+            || publisher->members % sizeof(uint32_t) != 0)
+        {
+            return -1;
+        }
+        const goose_image_member* members = (const goose_image_member*)(image->base + header->data_offset + publisher->members);
+        for (uint32_t m = 0; m < publisher->member_count; m++)
+        {
+            if (!goose_image_in_range(all_data, all_data_length, members[m].offset, members[m].length, 1))
+            {
+                return -1;
+            }
+        }
+    }
+
+    for (uint32_t i = 0; i < header->subscription_count; i++)
+    {
+        const goose_image_subscription* subscription = goose_image_subscription_get(image, i);
+        if (subscription->name >= header->string_size
+            || subscription->gocbref >= header->string_size
+            || (subscription->dataset != GOOSE_IMAGE_NONE && subscription->dataset >= header->dataset_count))
+        {
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+// Use an image already in memory. The bytes are not copied and must outlive the image.
+int goose_image_attach(const uint8_t* bytes, size_t size, goose_image* image)
+{
+    image->base = bytes;
+    image->size = size;
+    image->header = (const goose_image_header*)bytes;
+    image->owned = 0;
+
+    if (!bytes || ((uintptr_t)bytes % sizeof(uint32_t)) != 0 || goose_image_validate(image) != 0)
+    {
+        image->base = NULL;
+        image->header = NULL;
+        return -1;
+    }
+
+    return 0;
+}
+
+// Map the image file read-only. Nothing is copied, but goose_image_attach checksums the
+// whole image and checks every record, so all of its pages are read once here.
+int goose_image_open(const char* path, goose_image* image)
+{
+    memset(image, 0x0, sizeof(*image));
+
+#if GOOSE_IMAGE_MMAP
+    int fd = open(path, O_RDONLY);
+    if (fd < 0)
+    {
+        return -1;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size < (off_t)sizeof(goose_image_header))
+    {
+        close(fd);
+        return -1;
+    }
+
+    void* base = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED)
+    {
+        return -1;
+    }
+
+    if (goose_image_attach((const uint8_t*)base, (size_t)st.st_size, image) != 0)
+    {
+        munmap(base, (size_t)st.st_size);
+        return -1;
+    }
+
+    image->owned = 1;
+    return 0;
+#else
+    FILE* file = fopen(path, "rb");
+    if (!file)
+    {
+        return -1;
+    }
+
+    fseek(file, 0, SEEK_END);
+    long size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+
+    uint8_t* bytes = size > 0 ? (uint8_t*)malloc((size_t)size) : NULL;
+    if (!bytes || fread(bytes, 1, (size_t)size, file) != (size_t)size || goose_image_attach(bytes, (size_t)size, image) != 0)
+    {
+        free(bytes);
+        fclose(file);
+        return -1;
+    }
+
+    fclose(file);
+    image->owned = 1;
+    return 0;
+#endif
+}
+
+void goose_image_close(goose_image* image)
+{
+    if (!image || !image->base)
+    {
+        return;
+    }
+
+    if (image->owned)
+    {
+#if GOOSE_IMAGE_MMAP
+        munmap((void*)image->base, image->size);
+#else
+        free((void*)image->base);
+#endif
+    }
+
+    image->base = NULL;
+    image->header = NULL;
+    image->size = 0;
+}
+
+const char* goose_image_string(const goose_image* image, uint32_t offset)
+{
+    return (const char*)(image->base + image->header->string_offset + offset);
+}
+
+const goose_image_dataset* goose_image_dataset_get(const goose_image* image, uint32_t index)
+{
+    if (index >= image->header->dataset_count)
+    {
+        return NULL;
+    }
+    return (const goose_image_dataset*)(image->base + image->header->dataset_offset) + index;
+}
+
+const goose_image_entry* goose_image_dataset_entries(const goose_image* image, const goose_image_dataset* dataset)
+{
+    return (const goose_image_entry*)(image->base + image->header->entry_offset) + dataset->first_entry;
+}
+
+const goose_image_publisher* goose_image_publisher_get(const goose_image* image, size_t index)
+{
+    if (index >= image->header->publisher_count)
+    {
+        return NULL;
+    }
+    return (const goose_image_publisher*)(image->base + image->header->publisher_offset) + index;
+}
+
+const goose_image_subscription* goose_image_subscription_get(const goose_image* image, size_t index)
+{
+    if (index >= image->header->subscription_count)
+    {
+        return NULL;
+    }
+    return (const goose_image_subscription*)(image->base + image->header->subscription_offset) + index;
+}
+
+// The frame struct is filled from slices of the template and the template itself becomes
+// the encoded byte stream with its layout recorded, so the first goose_encode only
+// rewrites the fields the publisher changed.
+goose_handle* goose_image_handle(const goose_image* image, size_t index)
+{
+    const goose_image_publisher* publisher = goose_image_publisher_get(image, index);
+    if (!publisher)
+    {
+        return NULL;
+    }
+
+    uint8_t* frame = (uint8_t*)(image->base + image->header->data_offset + publisher->frame);
+    size_t offset = MAC_ADDRESS_SIZE * 2;
+    uint8_t vlan_tagged = frame[offset] == VLAN_TPID_0 && frame[offset + 1] == VLAN_TPID_1;
+    uint8_t* vlan_tag = &frame[offset];
+
+    if (vlan_tagged)
+    {
+        offset += VLAN_TAG_SIZE;
+    }
+    offset += ETHERTYPE_SIZE;
+
+    goose_handle* handle = goose_init(&frame[MAC_ADDRESS_SIZE], frame, &frame[offset]);
+    if (!handle)
+    {
+        return NULL;
+    }
+
+    // One copy of the template holds every value, mapped images are read-only
+    handle->values = (uint8_t*)malloc(publisher->frame_length);
+    if (!handle->values)
+    {
+        goose_free(handle);
+        return NULL;
+    }
+    memcpy(handle->values, frame, publisher->frame_length);
+
+    if (vlan_tagged)
+    {
+        uint16_t tci = (uint16_t)((vlan_tag[2] << 8) | vlan_tag[3]);
+        goose_vlan_set(handle, (uint8_t)(tci >> 13), (uint16_t)(tci & VLAN_MAX_ID));
+    }
+
+    // Same field order as goose_pdu; allData is taken member by member below
+    ber* fields = (ber*)&(handle->frame->pdu_list);
+    for (size_t k = 0; k < GOOSE_PDU_FIELD_COUNT - 1; k++)
+    {
+        if (publisher->field_length[k])
+        {
+            fields[k].value = handle->values + publisher->field_offset[k];
+            fields[k].length = publisher->field_length[k];
+            fields[k].borrowed = 1;
+        }
+    }
+
+    const goose_image_member* members = (const goose_image_member*)(image->base + image->header->data_offset + publisher->members);
+    goose_all_data* all_data = &(handle->frame->pdu_list.all_data_list);
+    for (uint32_t m = 0; m < publisher->member_count; m++)
+    {
+        ber* entry = &(all_data->entries[m]);
+        entry->tag = members[m].type;
+        entry->length = members[m].length;
+        entry->value = handle->values + members[m].offset;
+        entry->borrowed = 1;
+    }
+    all_data->entry_count = publisher->member_count;
+
+    memcpy(handle->byte_stream, frame, publisher->frame_length);
+    handle->length = publisher->frame_length;
+    memcpy(&(handle->frame->len), &frame[offset + APP_ID_SIZE], sizeof(handle->frame->len));
+    goose_layout_record(handle);
+
+    return handle;
+}
+
+int goose_image_publisher_params(const goose_image* image, size_t index, goose_message_params* out)
+{
+    const goose_image_publisher* publisher = goose_image_publisher_get(image, index);
+    if (!publisher)
+    {
+        return -1;
+    }
+
+    memset(out, 0x0, sizeof(*out));
+    out->handle = goose_image_handle(image, index);
+    if (!out->handle)
+    {
+        return -1;
+    }
+
+    out->name = goose_image_string(image, publisher->name);
+    out->default_time_allowed_to_live = publisher->default_time_allowed_to_live;
+    out->coalescing_window_us = publisher->coalescing_window_us;
+    out->coalescing_leading_edge = publisher->coalescing_leading_edge;
+    out->time_stamping = publisher->time_stamping;
+    out->updated = 1;
+
+    return 0;
+}
+
+int goose_image_subscription_params(const goose_image* image, size_t index, goose_subscription_params* out)
+{
+    const goose_image_subscription* subscription = goose_image_subscription_get(image, index);
+    if (!subscription)
+    {
+        return -1;
+    }
+
+    memset(out, 0x0, sizeof(*out));
+    out->name = goose_image_string(image, subscription->name);
+    out->gocbref = goose_image_string(image, subscription->gocbref);
+    out->app_id = subscription->app_id;
+
+    return 0;
+}
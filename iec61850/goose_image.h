@@ -0,0 +1,127 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include "goose.h"
+#include "goose_publisher.h"
+#include "goose_subscriber.h"
+
+// Precompiled control block configuration. goose_image_compile (tools/) turns a text
+// description of datasets, publishers and subscriptions into an image holding every
+// publisher's frame already encoded; at boot the image is mapped and used as is.
+//
+// All references inside the image are offsets from its start, so it can be mapped
+// anywhere. Integers are in the byte order of the machine that compiled it, which
+// the loader checks through byte_order.
+
+#define GOOSE_IMAGE_MAGIC "GOOSEIMG"
+#define GOOSE_IMAGE_MAGIC_SIZE 8
+#define GOOSE_IMAGE_VERSION 2
+#define GOOSE_IMAGE_BYTE_ORDER 0x01020304u
+#define GOOSE_IMAGE_NONE 0xffffffffu
+
+typedef struct
+{
+	char magic[GOOSE_IMAGE_MAGIC_SIZE];
+	uint32_t version;
+	uint32_t byte_order;
+	uint32_t size;		// Whole image in bytes
+	uint32_t checksum;	// goose_image_checksum of everything after the header
+	uint32_t dataset_count;
+	uint32_t dataset_offset;
+	uint32_t entry_count;
+	uint32_t entry_offset;
+	uint32_t publisher_count;
+	uint32_t publisher_offset;
+	uint32_t subscription_count;
+	uint32_t subscription_offset;
+	uint32_t string_offset;	// NUL-terminated strings
+	uint32_t string_size;
+	uint32_t data_offset;	// Frame templates, their member records and default member values
+	uint32_t data_size;
+} goose_image_header;
+
+// Dataset schema, its members are entries [first_entry, first_entry + entry_count)
+typedef struct
+{
+	uint32_t name;
+	uint32_t first_entry;
+	uint32_t entry_count;
+} goose_image_dataset;
+
+typedef struct
+{
+	uint8_t type;		// BER tag of the member
+	uint8_t reserved;
+	uint16_t length;	// Encoded value length
+	uint32_t value;		// Default value in the data area
+} goose_image_entry;
+
+// allData member of a publisher's frame template
+typedef struct
+{
+	uint8_t type;		// BER tag of the member
+	uint8_t reserved;
+	uint16_t length;	// Value length
+	uint32_t offset;	// Value offset into the frame
+} goose_image_member;
+
+typedef struct
+{
+	uint32_t name;
+	uint32_t dataset;
+	uint32_t frame;		// Encoded frame in the data area
+	uint32_t frame_length;
+	uint32_t field_offset[GOOSE_PDU_FIELD_COUNT];	// Value offsets into the frame, 0 when absent
+	uint32_t field_length[GOOSE_PDU_FIELD_COUNT];
+	uint32_t members;	// member_count goose_image_member records in the data area
+	uint32_t member_count;
+	uint32_t coalescing_window_us;
+	uint16_t default_time_allowed_to_live;
+	uint8_t coalescing_leading_edge;
+	uint8_t time_stamping;
+} goose_image_publisher;
+
+typedef struct
+{
+	uint32_t name;
+	uint32_t gocbref;
+	uint32_t dataset;	// GOOSE_IMAGE_NONE when the schema is not checked
+	uint16_t app_id;
+	uint16_t reserved;
+} goose_image_subscription;
+
+typedef struct
+{
+	const uint8_t* base;
+	size_t size;
+	const goose_image_header* header;
+	uint8_t owned;		// Opened from a file (mapped, or read where there is no mmap), released by close
+} goose_image;
+
+// Runtime side. Returns 0, or -1 if the file cannot be read or is not a valid image.
+int goose_image_open(const char* path, goose_image* image);
+int goose_image_attach(const uint8_t* bytes, size_t size, goose_image* image);
+void goose_image_close(goose_image* image);
+
+const char* goose_image_string(const goose_image* image, uint32_t offset);
+const goose_image_dataset* goose_image_dataset_get(const goose_image* image, uint32_t index);
+const goose_image_entry* goose_image_dataset_entries(const goose_image* image, const goose_image_dataset* dataset);
+const goose_image_publisher* goose_image_publisher_get(const goose_image* image, size_t index);
+const goose_image_subscription* goose_image_subscription_get(const goose_image* image, size_t index);
+
+// New handle whose byte stream is the publisher's template. Its field and member values
+// point into one copy of the template, allocated with the handle.
+goose_handle* goose_image_handle(const goose_image* image, size_t index);
+
+// Checksum stored in goose_image_header.checksum
+uint32_t goose_image_checksum(const uint8_t* bytes, size_t size);
+
+// Registration parameters; name and gocbref point into the image, which must stay open.
+// Publishers come back with updated set, so their first process call sends stNum 1.
+int goose_image_publisher_params(const goose_image* image, size_t index, goose_message_params* out);
+int goose_image_subscription_params(const goose_image* image, size_t index, goose_subscription_params* out);
+
+// Offline side. Compiles the text description into a malloc'd image. Returns 0, or -1
+// with a message naming the offending line in error.
+int goose_image_compile(const char* text, uint8_t** out, size_t* out_size, char* error, size_t error_size);
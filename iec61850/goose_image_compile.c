@@ -0,0 +1,714 @@
+#include "goose_image.h"
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Text format, one statement per line, '#' starts a comment, strings in double quotes:
+//
+//   dataset Protection
+//     bool false
+//     int32 0
+//     float32 0.0
+//     quality 0000
+//     utctime
+//   end
+//
+//   publisher Trip
+//     source 00:30:a7:03:c1:53
+//     destination 01:0c:cd:01:00:01
+//     app_id 0x0001
+//     vlan 6 0                        # priority, VLAN ID
+//     gocbref "IED1/LLN0$GO$Trip"
+//     datset "IED1/LLN0$Protection"
+//     go_id "Trip"
+//     conf_rev 1
+//     time_allowed_to_live 2000
+//     coalescing_window_us 500 leading
+//     time_stamping
+//     dataset Protection
+//   end
+//
+//   subscription RemoteTrip
+//     gocbref "IED2/LLN0$GO$Trip"
+//     app_id 0x0002
+//     dataset Protection
+//   end
+//
+// Member types: bool, int32, uint32, float32, quality (13-bit string, hex), utctime,
+// octets (hex) and visible (string). Values are encoded at a fixed width per type.
+
+#define MAX_TOKENS 8
+#define MAX_LINE 512
+
+typedef struct
+{
+    uint8_t* bytes;
+    size_t size;
+    size_t capacity;
+} image_buffer;
+
+typedef struct
+{
+    char name[MAX_LINE];
+    uint32_t name_offset;
+    uint32_t first_entry;
+    uint32_t entry_count;
+} compile_dataset;
+
+typedef struct
+{
+    image_buffer datasets;       // goose_image_dataset
+    image_buffer entries;        // goose_image_entry
+    image_buffer publishers;     // goose_image_publisher
+    image_buffer subscriptions;  // goose_image_subscription
+    image_buffer strings;
+    image_buffer data;
+    compile_dataset* dataset_names;
+    size_t dataset_count;
+    char* error;
+    size_t error_size;
+    size_t line;
+    int failed;
+} compile_state;
+
+static void compile_fail(compile_state* state, const char* format, ...)
+{
+    if (state->failed)
+    {
+        return;
+    }
+    state->failed = 1;
+
+    if (state->error && state->error_size)
+    {
+        int written = snprintf(state->error, state->error_size, "line %zu: ", state->line);
+        if (written >= 0 && (size_t)written < state->error_size)
+        {
+            va_list args;
+            va_start(args, format);
+            vsnprintf(state->error + written, state->error_size - (size_t)written, format, args);
+            va_end(args);
+        }
+    }
+}
+
+// Appends and returns the offset of the bytes in the buffer, aligned to `align`
+static uint32_t buffer_append(compile_state* state, image_buffer* buffer, const void* bytes, size_t size, size_t align)
+{
+    size_t offset = (buffer->size + align - 1) / align * align;
+
+    if (offset + size > buffer->capacity)
+    {
+        size_t capacity = buffer->capacity ? buffer->capacity : 256;
+        while (capacity < offset + size)
+        {
+            capacity *= 2;
+        }
+
+        uint8_t* grown = (uint8_t*)realloc(buffer->bytes, capacity);
+        if (!grown)
+        {
+            compile_fail(state, "out of memory");
+            return 0;
+        }
+        buffer->bytes = grown;
+        buffer->capacity = capacity;
+    }
+
+    if (offset > buffer->size)
+    {
+        memset(buffer->bytes + buffer->size, 0x0, offset - buffer->size);
+    }
+    if (size)
+    {
+        memcpy(buffer->bytes + offset, bytes, size);
+    }
+    buffer->size = offset + size;
+
+    return (uint32_t)offset;
+}
+
+static uint32_t string_append(compile_state* state, const char* text)
+{
+    return buffer_append(state, &state->strings, text, strlen(text) + 1, 1);
+}
+
+// Splits a line into whitespace separated tokens, quoted strings keep their spaces
+static size_t tokenize(char* line, char* tokens[MAX_TOKENS])
+{
+    size_t count = 0;
+    char* cursor = line;
+
+    while (*cursor && count < MAX_TOKENS)
+    {
+        while (*cursor == ' ' || *cursor == '\t' || *cursor == '\r')
+        {
+            cursor++;
+        }
+        if (*cursor == '\0' || *cursor == '#')
+        {
+            break;
+        }
+
+        if (*cursor == '"')
+        {
+            tokens[count++] = ++cursor;
+            while (*cursor && *cursor != '"')
+            {
+                cursor++;
+            }
+        }
+        else
+        {
+            tokens[count++] = cursor;
+            while (*cursor && *cursor != ' ' && *cursor != '\t' && *cursor != '\r')
+            {
+                cursor++;
+            }
+        }
+
+        if (*cursor)
+        {
+            *cursor++ = '\0';
+        }
+    }
+
+    return count;
+}
+
+static unsigned long parse_number(compile_state* state, const char* text, unsigned long max)
+{
+    char* end;
+    unsigned long value = strtoul(text, &end, 0);
+    if (*text == '\0' || *end != '\0' || value > max)
+    {
+        compile_fail(state, "bad number '%s'", text);
+        return 0;
+    }
+    return value;
+}
+
+static long parse_signed(compile_state* state, const char* text, long min, long max)
+{
+    char* end;
+    long value = strtol(text, &end, 0);
+    if (*text == '\0' || *end != '\0' || value < min || value > max)
+    {
+        compile_fail(state, "bad number '%s'", text);
+        return 0;
+    }
+    return value;
+}
+
+static size_t parse_hex(compile_state* state, const char* text, uint8_t* out, size_t max)
+{
+    size_t count = 0;
+
+    while (*text)
+    {
+        if (*text == ':')
+        {
+            text++;
+            continue;
+        }
+
+        unsigned int byte;
+        if (count == max || sscanf(text, "%2x", &byte) != 1 || !text[1])
+        {
+            compile_fail(state, "bad hex value");
+            return count;
+        }
+        out[count++] = (uint8_t)byte;
+        text += 2;
+    }
+
+    return count;
+}
+
+static void parse_mac(compile_state* state, const char* text, uint8_t out[MAC_ADDRESS_SIZE])
+{
+    if (parse_hex(state, text, out, MAC_ADDRESS_SIZE) != MAC_ADDRESS_SIZE)
+    {
+        compile_fail(state, "bad MAC address '%s'", text);
+    }
+}
+
+static uint32_t find_dataset(compile_state* state, const char* name)
+{
+    for (size_t i = 0; i < state->dataset_count; i++)
+    {
+        if (strcmp(state->dataset_names[i].name, name) == 0)
+        {
+            return (uint32_t)i;
+        }
+    }
+
+    compile_fail(state, "unknown dataset '%s'", name);
+    return GOOSE_IMAGE_NONE;
+}
+
+// One dataset member line: type and optional default value
+static void compile_member(compile_state* state, compile_dataset* dataset, char* tokens[MAX_TOKENS], size_t count)
+{
+    const char* type = tokens[0];
+    const char* text = count > 1 ? tokens[1] : NULL;
+    uint8_t value[64] = { 0 };
+    goose_image_entry entry = { 0 };
+
+    if (strcmp(type, "bool") == 0)
+    {
+        entry.type = 0x83;
+        entry.length = 1;
+        value[0] = text && (strcmp(text, "true") == 0 || strcmp(text, "1") == 0);
+    }
+    else if (strcmp(type, "int32") == 0)
+    {
+        // Fixed width, so a member keeps its position in the frame whatever its value
+        uint32_t number = text ? (uint32_t)parse_signed(state, text, INT32_MIN, INT32_MAX) : 0;
+        entry.type = 0x85;
+        entry.length = 4;
+        number = goose_htonl(number);
+        memcpy(value, &number, sizeof(number));
+    }
+    else if (strcmp(type, "uint32") == 0)
+    {
+        // A leading zero keeps values with the top bit set positive, as in goose_dataset.hpp
+        uint32_t number = text ? (uint32_t)parse_number(state, text, UINT32_MAX) : 0;
+        entry.type = 0x86;
+        entry.length = 5;
+        number = goose_htonl(number);
+        memcpy(&value[1], &number, sizeof(number));
+    }
+    else if (strcmp(type, "float32") == 0)
+    {
+        float number = text ? strtof(text, NULL) : 0.0f;
+        uint32_t bits;
+        memcpy(&bits, &number, sizeof(bits));
+        bits = goose_htonl(bits);
+        entry.type = 0x87;
+        entry.length = 5;
+        value[0] = 0x08;  // Exponent width of IEEE 754 single precision
+        memcpy(&value[1], &bits, sizeof(bits));
+    }
+    else if (strcmp(type, "quality") == 0)
+    {
+        entry.type = 0x84;
+        entry.length = 3;
+        value[0] = 0x03;  // 13 bits used of 16
+        if (text && parse_hex(state, text, &value[1], 2) != 2)
+        {
+            compile_fail(state, "bad quality '%s', expected 4 hex digits", text);
+            return;
+        }
+    }
+    else if (strcmp(type, "utctime") == 0)
+    {
+        entry.type = 0x91;
+        entry.length = IEC_TIME_UTC_SIZE;
+    }
+    else if (strcmp(type, "octets") == 0)
+    {
+        entry.type = 0x89;
+        entry.length = text ? (uint16_t)parse_hex(state, text, value, sizeof(value)) : 0;
+    }
+    else if (strcmp(type, "visible") == 0)
+    {
+        size_t length = text ? strlen(text) : 0;
+        if (length > sizeof(value))
+        {
+            compile_fail(state, "visible string longer than %zu", sizeof(value));
+            return;
+        }
+        entry.type = 0x8a;
+        entry.length = (uint16_t)length;
+        memcpy(value, text, length);
+    }
+    else
+    {
+        compile_fail(state, "unknown member type '%s'", type);
+        return;
+    }
+
+    entry.value = buffer_append(state, &state->data, value, entry.length, 1);
+    buffer_append(state, &state->entries, &entry, sizeof(entry), sizeof(uint32_t));
+    dataset->entry_count++;
+}
+
+// Next line of the description, NUL-terminated in place; NULL at the end
+static char* next_line(compile_state* state, char** cursor)
+{
+    if (!**cursor)
+    {
+        return NULL;
+    }
+
+    char* line = *cursor;
+    char* end = strchr(line, '\n');
+    if (end)
+    {
+        *end = '\0';
+        *cursor = end + 1;
+    }
+    else
+    {
+        *cursor = line + strlen(line);
+    }
+
+    state->line++;
+    return line;
+}
+
+static void compile_dataset_block(compile_state* state, const char* name, char** cursor)
+{
+    compile_dataset* grown = (compile_dataset*)realloc(state->dataset_names, (state->dataset_count + 1) * sizeof(compile_dataset));
+    if (!grown)
+    {
+        compile_fail(state, "out of memory");
+        return;
+    }
+    state->dataset_names = grown;
+
+    compile_dataset* dataset = &state->dataset_names[state->dataset_count++];
+    snprintf(dataset->name, sizeof(dataset->name), "%s", name);
+    dataset->name_offset = string_append(state, name);
+    dataset->first_entry = (uint32_t)(state->entries.size / sizeof(goose_image_entry));
+    dataset->entry_count = 0;
+
+    char* line;
+    char* tokens[MAX_TOKENS];
+    while (!state->failed && (line = next_line(state, cursor)) != NULL)
+    {
+        size_t count = tokenize(line, tokens);
+        if (count == 0)
+        {
+            continue;
+        }
+        if (strcmp(tokens[0], "end") == 0)
+        {
+            if (dataset->entry_count > MAX_NUM_DATASET_ENTRIES)
+            {
+                compile_fail(state, "dataset '%s' has %u members, at most %d fit", name, dataset->entry_count, MAX_NUM_DATASET_ENTRIES);
+                return;
+            }
+
+            goose_image_dataset record = { dataset->name_offset, dataset->first_entry, dataset->entry_count };
+            buffer_append(state, &state->datasets, &record, sizeof(record), sizeof(uint32_t));
+            return;
+        }
+        compile_member(state, dataset, tokens, count);
+    }
+
+    compile_fail(state, "dataset '%s' has no end", name);
+}
+
+static void compile_publisher_block(compile_state* state, const char* name, char** cursor)
+{
+    uint8_t source[MAC_ADDRESS_SIZE] = { 0 };
+    uint8_t destination[MAC_ADDRESS_SIZE] = GOOSE_MULTICAST_ADDRESS(0x00, 0x00);
+    uint8_t app_id[APP_ID_SIZE] = { 0 };
+    goose_image_publisher record = { 0 };
+    goose_handle* handle = NULL;
+    int vlan = 0;
+    unsigned long vlan_priority = 0;
+    unsigned long vlan_id = 0;
+    uint32_t conf_rev = 1;
+    uint8_t simulation = 0;
+    uint8_t nds_com = 0;
+    const char* strings[3] = { "", "", "" };  // gocbref, datSet, goID
+    char string_storage[3][MAX_LINE];
+
+    int ended = 0;
+
+    record.name = string_append(state, name);
+    record.dataset = GOOSE_IMAGE_NONE;
+    record.default_time_allowed_to_live = 2000;
+
+    char* line;
+    char* tokens[MAX_TOKENS];
+    while (!state->failed && (line = next_line(state, cursor)) != NULL)
+    {
+        size_t count = tokenize(line, tokens);
+        if (count == 0)
+        {
+            continue;
+        }
+
+        const char* key = tokens[0];
+        if (strcmp(key, "end") == 0)
+        {
+            ended = 1;
+            break;
+        }
+        if (count < 2 && strcmp(key, "time_stamping") != 0)
+        {
+            compile_fail(state, "'%s' needs a value", key);
+            break;
+        }
+
+        if (strcmp(key, "source") == 0) parse_mac(state, tokens[1], source);
+        else if (strcmp(key, "destination") == 0) parse_mac(state, tokens[1], destination);
+        else if (strcmp(key, "app_id") == 0)
+        {
+            unsigned long value = parse_number(state, tokens[1], 0xffff);
+            app_id[0] = (uint8_t)(value >> 8);
+            app_id[1] = (uint8_t)value;
+        }
+        else if (strcmp(key, "vlan") == 0)
+        {
+            vlan = 1;
+            vlan_priority = parse_number(state, tokens[1], VLAN_MAX_PRIORITY);
+            vlan_id = count > 2 ? parse_number(state, tokens[2], VLAN_MAX_ID) : 0;
+        }
+        else if (strcmp(key, "gocbref") == 0 || strcmp(key, "datset") == 0 || strcmp(key, "go_id") == 0)
+        {
+            size_t k = strcmp(key, "gocbref") == 0 ? 0 : strcmp(key, "datset") == 0 ? 1 : 2;
+            snprintf(string_storage[k], sizeof(string_storage[k]), "%s", tokens[1]);
+            strings[k] = string_storage[k];
+        }
+        else if (strcmp(key, "conf_rev") == 0) conf_rev = (uint32_t)parse_number(state, tokens[1], 0xffffffffUL);
+        else if (strcmp(key, "simulation") == 0) simulation = (uint8_t)parse_number(state, tokens[1], 1);
+        else if (strcmp(key, "nds_com") == 0) nds_com = (uint8_t)parse_number(state, tokens[1], 1);
+        else if (strcmp(key, "time_allowed_to_live") == 0) record.default_time_allowed_to_live = (uint16_t)parse_number(state, tokens[1], 0xffff);
+        else if (strcmp(key, "coalescing_window_us") == 0)
+        {
+            record.coalescing_window_us = (uint32_t)parse_number(state, tokens[1], 0xffffffffUL);
+            record.coalescing_leading_edge = count > 2 && strcmp(tokens[2], "leading") == 0;
+        }
+        else if (strcmp(key, "time_stamping") == 0) record.time_stamping = 1;
+        else if (strcmp(key, "dataset") == 0) record.dataset = find_dataset(state, tokens[1]);
+        else compile_fail(state, "unknown publisher key '%s'", key);
+    }
+
+    if (!ended)
+    {
+        compile_fail(state, "publisher '%s' has no end", name);
+    }
+    if (state->failed)
+    {
+        return;
+    }
+
+    // The template is made by the runtime encoder itself, so it matches goose_encode byte for byte
+    handle = goose_init(source, destination, app_id);
+    if (!handle)
+    {
+        compile_fail(state, "out of memory");
+        return;
+    }
+
+    if (vlan)
+    {
+        goose_vlan_set(handle, (uint8_t)vlan_priority, (uint16_t)vlan_id);
+    }
+
+    uint16_t time_allowed_to_live = goose_htons(record.default_time_allowed_to_live);
+    uint8_t t[IEC_TIME_UTC_SIZE] = { 0 };
+    uint32_t st_num = 0;
+    uint32_t sq_num = 0;
+    uint32_t conf_rev_net = goose_htonl(conf_rev);
+
+    ber_set(&(handle->frame->pdu_list.gocbref), (uint8_t*)strings[0], strlen(strings[0]));
+    ber_set(&(handle->frame->pdu_list.time_allowed_to_live), (uint8_t*)&time_allowed_to_live, sizeof(time_allowed_to_live));
+    ber_set(&(handle->frame->pdu_list.dataset), (uint8_t*)strings[1], strlen(strings[1]));
+    ber_set(&(handle->frame->pdu_list.go_id), (uint8_t*)strings[2], strlen(strings[2]));
+    ber_set(&(handle->frame->pdu_list.t), t, sizeof(t));
+    ber_set(&(handle->frame->pdu_list.st_num), (uint8_t*)&st_num, sizeof(st_num));
+    ber_set(&(handle->frame->pdu_list.sq_num), (uint8_t*)&sq_num, sizeof(sq_num));
+    ber_set(&(handle->frame->pdu_list.simulation), &simulation, sizeof(simulation));
+    ber_set(&(handle->frame->pdu_list.conf_rev), (uint8_t*)&conf_rev_net, sizeof(conf_rev_net));
+    ber_set(&(handle->frame->pdu_list.nds_com), &nds_com, sizeof(nds_com));
+
+    if (record.dataset != GOOSE_IMAGE_NONE)
+    {
+        const compile_dataset* dataset = &state->dataset_names[record.dataset];
+        const goose_image_entry* entries = (const goose_image_entry*)state->entries.bytes + dataset->first_entry;
+        for (uint32_t i = 0; i < dataset->entry_count; i++)
+        {
+            goose_all_data_entry_add(handle, entries[i].type, entries[i].length, state->data.bytes + entries[i].value);
+        }
+    }
+
+    goose_encode(handle);
+    if (handle->length == 0)
+    {
+        compile_fail(state, "publisher '%s' does not fit in a frame", name);
+        goose_free(handle);
+        return;
+    }
+
+    record.frame = buffer_append(state, &state->data, handle->byte_stream, handle->length, sizeof(uint32_t));
+    record.frame_length = (uint32_t)handle->length;
+
+    ber* fields = (ber*)&(handle->frame->pdu_list);
+    for (size_t k = 0; k < GOOSE_PDU_FIELD_COUNT; k++)
+    {
+        record.field_offset[k] = (uint32_t)handle->field_offset[k];
+        record.field_length[k] = (uint32_t)fields[k].length;
+    }
+
+    // Where each member's value landed, so the loader can point at it without parsing allData
+    const goose_all_data* all_data = &(handle->frame->pdu_list.all_data_list);
+    record.member_count = (uint32_t)all_data->entry_count;
+    for (size_t i = 0; i < all_data->entry_count; i++)
+    {
+        const ber* entry = &(all_data->entries[i]);
+        goose_image_member member = { entry->tag, 0, (uint16_t)entry->length, 0 };
+        member.offset = (uint32_t)(handle->layout.member_offset[i] + ber_encode_header(NULL, entry->tag, entry->length));
+        uint32_t offset = buffer_append(state, &state->data, &member, sizeof(member), sizeof(uint32_t));
+        if (i == 0)
+        {
+            record.members = offset;
+        }
+    }
+
+    buffer_append(state, &state->publishers, &record, sizeof(record), sizeof(uint32_t));
+    goose_free(handle);
+}
+
+static void compile_subscription_block(compile_state* state, const char* name, char** cursor)
+{
+    goose_image_subscription record = { 0 };
+    char gocbref[MAX_LINE] = "";
+    int ended = 0;
+
+    record.name = string_append(state, name);
+    record.dataset = GOOSE_IMAGE_NONE;
+
+    char* line;
+    char* tokens[MAX_TOKENS];
+    while (!state->failed && (line = next_line(state, cursor)) != NULL)
+    {
+        size_t count = tokenize(line, tokens);
+        if (count == 0)
+        {
+            continue;
+        }
+
+        const char* key = tokens[0];
+        if (strcmp(key, "end") == 0)
+        {
+            ended = 1;
+            break;
+        }
+        if (count < 2)
+        {
+            compile_fail(state, "'%s' needs a value", key);
+            break;
+        }
+
+        if (strcmp(key, "gocbref") == 0) snprintf(gocbref, sizeof(gocbref), "%s", tokens[1]);
+        else if (strcmp(key, "app_id") == 0) record.app_id = (uint16_t)parse_number(state, tokens[1], 0xffff);
+        else if (strcmp(key, "dataset") == 0) record.dataset = find_dataset(state, tokens[1]);
+        else compile_fail(state, "unknown subscription key '%s'", key);
+    }
+
+    if (!ended)
+    {
+        compile_fail(state, "subscription '%s' has no end", name);
+    }
+
+    record.gocbref = string_append(state, gocbref);
+    buffer_append(state, &state->subscriptions, &record, sizeof(record), sizeof(uint32_t));
+}
+
+// Lays the sections out after the header and fills in the offsets and checksum
+static int compile_assemble(compile_state* state, uint8_t** out, size_t* out_size)
+{
+    image_buffer image = { 0 };
+    goose_image_header header;
+
+    memset(&header, 0x0, sizeof(header));
+    buffer_append(state, &image, &header, sizeof(header), 1);
+
+    header.dataset_count = (uint32_t)(state->datasets.size / sizeof(goose_image_dataset));
+    header.dataset_offset = buffer_append(state, &image, state->datasets.bytes, state->datasets.size, sizeof(uint32_t));
+    header.entry_count = (uint32_t)(state->entries.size / sizeof(goose_image_entry));
+    header.entry_offset = buffer_append(state, &image, state->entries.bytes, state->entries.size, sizeof(uint32_t));
+    header.publisher_count = (uint32_t)(state->publishers.size / sizeof(goose_image_publisher));
+    header.publisher_offset = buffer_append(state, &image, state->publishers.bytes, state->publishers.size, sizeof(uint32_t));
+    header.subscription_count = (uint32_t)(state->subscriptions.size / sizeof(goose_image_subscription));
+    header.subscription_offset = buffer_append(state, &image, state->subscriptions.bytes, state->subscriptions.size, sizeof(uint32_t));
+    header.string_size = (uint32_t)state->strings.size;
+    header.string_offset = buffer_append(state, &image, state->strings.bytes, state->strings.size, 1);
+    header.data_size = (uint32_t)state->data.size;
+    header.data_offset = buffer_append(state, &image, state->data.bytes, state->data.size, sizeof(uint32_t));
+
+    if (state->failed)
+    {
+        free(image.bytes);
+        return -1;
+    }
+
+    memcpy(header.magic, GOOSE_IMAGE_MAGIC, GOOSE_IMAGE_MAGIC_SIZE);
+    header.version = GOOSE_IMAGE_VERSION;
+    header.byte_order = GOOSE_IMAGE_BYTE_ORDER;
+    header.size = (uint32_t)image.size;
+    header.checksum = goose_image_checksum(image.bytes + sizeof(header), image.size - sizeof(header));
+    memcpy(image.bytes, &header, sizeof(header));
+
+    *out = image.bytes;
+    *out_size = image.size;
+    return 0;
+}
+
+int goose_image_compile(const char* text, uint8_t** out, size_t* out_size, char* error, size_t error_size)
+{
+    compile_state state;
+    memset(&state, 0x0, sizeof(state));
+    state.error = error;
+    state.error_size = error_size;
+
+    *out = NULL;
+    *out_size = 0;
+    if (error && error_size)
+    {
+        error[0] = '\0';
+    }
+
+    char* copy = (char*)malloc(strlen(text) + 1);
+    if (!copy)
+    {
+        return -1;
+    }
+    strcpy(copy, text);
+
+    // Offset 0 of the string area is the empty string
+    string_append(&state, "");
+
+    char* cursor = copy;
+    char* line;
+    char* tokens[MAX_TOKENS];
+    while (!state.failed && (line = next_line(&state, &cursor)) != NULL)
+    {
+        size_t count = tokenize(line, tokens);
+        if (count == 0)
+        {
+            continue;
+        }
+        if (count != 2)
+        {
+            compile_fail(&state, "expected 'dataset NAME', 'publisher NAME' or 'subscription NAME'");
+            break;
+        }
+
+        if (strcmp(tokens[0], "dataset") == 0) compile_dataset_block(&state, tokens[1], &cursor);
+        else if (strcmp(tokens[0], "publisher") == 0) compile_publisher_block(&state, tokens[1], &cursor);
+        else if (strcmp(tokens[0], "subscription") == 0) compile_subscription_block(&state, tokens[1], &cursor);
+        else compile_fail(&state, "unknown block '%s'", tokens[0]);
+    }
+
+    int result = state.failed ? -1 : compile_assemble(&state, out, out_size);
+
+    free(copy);
+    free(state.datasets.bytes);
+    free(state.entries.bytes);
+    free(state.publishers.bytes);
+    free(state.subscriptions.bytes);
+    free(state.strings.bytes);
+    free(state.data.bytes);
+    free(state.dataset_names);
+
+    return result;
+}
@@ -0,0 +1,656 @@
+#include "goose_pcap.h"
+#include "iec_time.h"
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#if defined(__unix__) || defined(__APPLE__)
+#define GOOSE_PCAP_MMAP 1
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#define NS_PER_SECOND 1000000000ULL
+#define NS_PER_MILLISECOND 1000000ULL
+
+// Writer
+
+static void buffer_put_u16(uint8_t* out, uint16_t value)
+{
+    memcpy(out, &value, sizeof(value));
+}
+
+static void buffer_put_u32(uint8_t* out, uint32_t value)
+{
+    memcpy(out, &value, sizeof(value));
+}
+
+static int writer_drain(goose_pcap_writer* writer)
+{
+    if (writer->buffered && !writer->error)
+    {
+        if (fwrite(writer->buffer, 1, writer->buffered, writer->file) != writer->buffered)
+        {
+            writer->error = 1;
+        }
+    }
+    writer->buffered = 0;
+    return writer->error ? -1 : 0;
+}
+
+// Space for `length` contiguous bytes in the buffer, draining it first if needed
+static uint8_t* writer_reserve(goose_pcap_writer* writer, size_t length)
+{
+    if (writer->buffered + length > GOOSE_PCAP_BUFFER_SIZE && writer_drain(writer) != 0)
+    {
+        return NULL;
+    }
+    if (length > GOOSE_PCAP_BUFFER_SIZE)
+    {
+        return NULL;
+    }
+
+    uint8_t* out = &writer->buffer[writer->buffered];
+    writer->buffered += length;
+    return out;
+}
+
+int goose_pcap_writer_open(goose_pcap_writer* writer, const char* path, goose_pcap_format format)
+{
+    memset(writer, 0x0, sizeof(*writer));
+    writer->format = format;
+
+    writer->buffer = (uint8_t*)malloc(GOOSE_PCAP_BUFFER_SIZE);
+    if (!writer->buffer)
+    {
+        return -1;
+    }
+
+    writer->file = fopen(path, "wb");
+    if (!writer->file)
+    {
+        free(writer->buffer);
+        writer->buffer = NULL;
+        return -1;
+    }
+
+    // Whole buffers go straight to the file, stdio would only copy them once more
+    setvbuf(writer->file, NULL, _IONBF, 0);
+
+    if (format == GOOSE_PCAP_CLASSIC)
+    {
+        uint8_t* out = writer_reserve(writer, 24);
+        buffer_put_u32(out, GOOSE_PCAP_MAGIC_NS);
+        buffer_put_u16(out + 4, 2);
+        buffer_put_u16(out + 6, 4);
+        buffer_put_u32(out + 8, 0);	// thiszone
+        buffer_put_u32(out + 12, 0);	// sigfigs
+        buffer_put_u32(out + 16, GOOSE_PCAP_SNAPLEN);
+        buffer_put_u32(out + 20, GOOSE_PCAP_LINKTYPE_ETHERNET);
+    }
+    else
+    {
+        // Section header without options, section length unknown
+        uint8_t* out = writer_reserve(writer, 28);
+        buffer_put_u32(out, GOOSE_PCAPNG_SECTION_HEADER);
+        buffer_put_u32(out + 4, 28);
+        buffer_put_u32(out + 8, GOOSE_PCAPNG_BYTE_ORDER_MAGIC);
+        buffer_put_u16(out + 12, 1);
+        buffer_put_u16(out + 14, 0);
+        buffer_put_u32(out + 16, 0xffffffffu);
+        buffer_put_u32(out + 20, 0xffffffffu);
+        buffer_put_u32(out + 24, 28);
+
+        // Interface description: Ethernet, if_tsresol 9 (nanoseconds), end of options
+        out = writer_reserve(writer, 32);
+        buffer_put_u32(out, GOOSE_PCAPNG_INTERFACE_DESCRIPTION);
+        buffer_put_u32(out + 4, 32);
+        buffer_put_u16(out + 8, GOOSE_PCAP_LINKTYPE_ETHERNET);
+        buffer_put_u16(out + 10, 0);
+        buffer_put_u32(out + 12, GOOSE_PCAP_SNAPLEN);
+        buffer_put_u16(out + 16, GOOSE_PCAPNG_OPTION_TSRESOL);
+        buffer_put_u16(out + 18, 1);
+        buffer_put_u32(out + 20, 9);
+        buffer_put_u32(out + 24, 0);
+        buffer_put_u32(out + 28, 32);
+    }
+
+    return 0;
+}
+
+int goose_pcap_write(goose_pcap_writer* writer, const uint8_t* frame, size_t length, uint64_t timestamp_ns)
+{
+    if (writer->error || !writer->file)
+    {
+        return -1;
+    }
+
+    size_t captured = length > GOOSE_PCAP_SNAPLEN ? GOOSE_PCAP_SNAPLEN : length;
+    uint8_t* out;
+
+    if (writer->format == GOOSE_PCAP_CLASSIC)
+    {
+        out = writer_reserve(writer, 16 + captured);
+        if (!out)
+        {
+            return -1;
+        }
+
+        buffer_put_u32(out, (uint32_t)(timestamp_ns / NS_PER_SECOND));
+        buffer_put_u32(out + 4, (uint32_t)(timestamp_ns % NS_PER_SECOND));
+        buffer_put_u32(out + 8, (uint32_t)captured);
+        buffer_put_u32(out + 12, (uint32_t)length);
+        memcpy(out + 16, frame, captured);
+    }
+    else
+    {
+        size_t padded = (captured + 3) & ~(size_t)3;
+        uint32_t block_length = (uint32_t)(32 + padded);
+
+        out = writer_reserve(writer, block_length);
+        if (!out)
+        {
+            return -1;
+        }
+
+        buffer_put_u32(out, GOOSE_PCAPNG_ENHANCED_PACKET);
+        buffer_put_u32(out + 4, block_length);
+        buffer_put_u32(out + 8, 0);	// Interface
+        buffer_put_u32(out + 12, (uint32_t)(timestamp_ns >> 32));
+        buffer_put_u32(out + 16, (uint32_t)timestamp_ns);
+        buffer_put_u32(out + 20, (uint32_t)captured);
+        buffer_put_u32(out + 24, (uint32_t)length);
+        memcpy(out + 28, frame, captured);
+        memset(out + 28 + captured, 0x0, padded - captured);
+        buffer_put_u32(out + 28 + padded, block_length);
+    }
+
+    writer->frames++;
+    return 0;
+}
+
+int goose_pcap_writer_flush(goose_pcap_writer* writer)
+{
+    if (!writer->file)
+    {
+        return -1;
+    }
+    if (writer_drain(writer) != 0 || fflush(writer->file) != 0)
+    {
+        writer->error = 1;
+        return -1;
+    }
+    return 0;
+}
+
+int goose_pcap_writer_close(goose_pcap_writer* writer)
+{
+    if (!writer->file)
+    {
+        return -1;
+    }
+
+    int result = goose_pcap_writer_flush(writer);
+    if (fclose(writer->file) != 0)
+    {
+        result = -1;
+    }
+
+    free(writer->buffer);
+    writer->buffer = NULL;
+    writer->file = NULL;
+    return result;
+}
+
+static goose_pcap_writer* capture_writer = NULL;
+static void (*capture_forward)(uint8_t* byte_stream, size_t length) = NULL;
+
+void goose_pcap_capture(goose_pcap_writer* writer, void (*forward)(uint8_t* byte_stream, size_t length))
+{
+    capture_writer = writer;
+    capture_forward = forward;
+}
+
+void goose_pcap_linkoutput(uint8_t* byte_stream, size_t length)
+{
+    if (capture_writer)
+    {
+        iec_time now;
+        iec_time_now(&now);
+        goose_pcap_write(capture_writer, byte_stream, length, (uint64_t)now.seconds * NS_PER_SECOND + now.nanoseconds);
+    }
+
+    if (capture_forward)
+    {
+        capture_forward(byte_stream, length);
+    }
+}
+
+// Reader
+
+static uint16_t reader_u16(const goose_pcap_reader* reader, const uint8_t* in)
+{
+    uint16_t value;
+    memcpy(&value, in, sizeof(value));
+    return reader->swapped ? (uint16_t)((value >> 8) | (value << 8)) : value;
+}
+
+static uint32_t reader_u32(const goose_pcap_reader* reader, const uint8_t* in)
+{
+    uint32_t value;
+    memcpy(&value, in, sizeof(value));
+    if (reader->swapped)
+    {
+        value = ((value >> 24) & 0xff) | ((value >> 8) & 0xff00) | ((value << 8) & 0xff0000) | (value << 24);
+    }
+    return value;
+}
+
+// Timestamp units given by if_tsresol: 10^-n seconds, or 2^-n with the top bit set
+static uint64_t ticks_to_ns(uint64_t ticks, uint8_t tsresol)
+{
+    uint8_t exponent = tsresol & 0x7f;
+
+    if (tsresol & 0x80)
+    {
+        if (exponent >= 64)
+        {
+            return 0;
+        }
+        uint64_t mask = exponent ? (((uint64_t)1 << exponent) - 1) : 0;
+        return (ticks >> exponent) * NS_PER_SECOND + (((ticks & mask) * NS_PER_SECOND) >> exponent);
+    }
+
+    uint64_t ns = ticks;
+    for (uint8_t i = exponent; i < 9; i++)
+    {
+        ns *= 10;
+    }
+    for (uint8_t i = 9; i < exponent; i++)
+    {
+        ns /= 10;
+    }
+    return ns;
+}
+
+int goose_pcap_reader_attach(goose_pcap_reader* reader, uint8_t* bytes, size_t size)
+{
+    memset(reader, 0x0, sizeof(*reader));
+
+    if (!bytes || size < 24)
+    {
+        return -1;
+    }
+
+    reader->base = bytes;
+    reader->size = size;
+
+    uint32_t magic;
+    memcpy(&magic, bytes, sizeof(magic));
+
+    if (magic == GOOSE_PCAPNG_SECTION_HEADER)
+    {
+        // Byte order is settled per section as blocks are read
+        reader->format = GOOSE_PCAP_NG;
+        reader->data_offset = 0;
+        reader->offset = 0;
+        return 0;
+    }
+
+    reader->format = GOOSE_PCAP_CLASSIC;
+    if (magic == GOOSE_PCAP_MAGIC_US || magic == GOOSE_PCAP_MAGIC_NS)
+    {
+        reader->swapped = 0;
+    }
+    else
+    {
+        reader->swapped = 1;
+        magic = reader_u32(reader, bytes);
+        if (magic != GOOSE_PCAP_MAGIC_US && magic != GOOSE_PCAP_MAGIC_NS)
+        {
+            memset(reader, 0x0, sizeof(*reader));
+            return -1;
+        }
+    }
+
+    reader->nanosecond = magic == GOOSE_PCAP_MAGIC_NS;
+    reader->link_type = (uint16_t)(reader_u32(reader, bytes + 20) & 0xffff);
+    reader->data_offset = 24;
+    reader->offset = 24;
+    return 0;
+}
+
+int goose_pcap_reader_open(goose_pcap_reader* reader, const char* path)
+{
+    memset(reader, 0x0, sizeof(*reader));
+
+#if GOOSE_PCAP_MMAP
+    int fd = open(path, O_RDONLY);
+    if (fd < 0)
+    {
+        return -1;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size < 24)
+    {
+        close(fd);
+        return -1;
+    }
+
+    void* base = mmap(NULL, (size_t)st.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED)
+    {
+        return -1;
+    }
+#if defined(MADV_SEQUENTIAL)
+    madvise(base, (size_t)st.st_size, MADV_SEQUENTIAL);
+#endif
+
+    if (goose_pcap_reader_attach(reader, (uint8_t*)base, (size_t)st.st_size) != 0)
+    {
+        munmap(base, (size_t)st.st_size);
+        return -1;
+    }
+
+    reader->owned = 1;
+    return 0;
+#else
+    FILE* file = fopen(path, "rb");
+    if (!file)
+    {
+        return -1;
+    }
+
+    fseek(file, 0, SEEK_END);
+    long size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+
+    uint8_t* bytes = size > 0 ? (uint8_t*)malloc((size_t)size) : NULL;
+    if (!bytes || fread(bytes, 1, (size_t)size, file) != (size_t)size || goose_pcap_reader_attach(reader, bytes, (size_t)size) != 0)
+    {
+        free(bytes);
+        fclose(file);
+        return -1;
+    }
+
+    fclose(file);
+    reader->owned = 1;
+    return 0;
+#endif
+}
+
+void goose_pcap_reader_rewind(goose_pcap_reader* reader)
+{
+    reader->offset = reader->data_offset;
+}
+
+void goose_pcap_reader_close(goose_pcap_reader* reader)
+{
+    if (!reader || !reader->base)
+    {
+        return;
+    }
+
+    if (reader->owned)
+    {
+#if GOOSE_PCAP_MMAP
+        munmap(reader->base, reader->size);
+#else
+        free(reader->base);
+#endif
+    }
+
+    memset(reader, 0x0, sizeof(*reader));
+}
+
+static int next_classic(goose_pcap_reader* reader, goose_pcap_record* record)
+{
+    while (reader->offset < reader->size)
+    {
+        if (reader->size - reader->offset < 16)
+        {
+            return -1;
+        }
+
+        const uint8_t* header = &reader->base[reader->offset];
+        uint32_t seconds = reader_u32(reader, header);
+        uint32_t fraction = reader_u32(reader, header + 4);
+        uint32_t captured = reader_u32(reader, header + 8);
+        uint32_t original = reader_u32(reader, header + 12);
+
+        if (captured > reader->size - reader->offset - 16)
+        {
+            return -1;
+        }
+
+        record->frame = &reader->base[reader->offset + 16];
+        record->length = captured;
+        record->original_length = original;
+        record->timestamp_ns = (uint64_t)seconds * NS_PER_SECOND + (reader->nanosecond ? fraction : (uint64_t)fraction * 1000);
+
+        reader->offset += 16 + (size_t)captured;
+
+        if (reader->link_type == GOOSE_PCAP_LINKTYPE_ETHERNET)
+        {
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+static int next_ng(goose_pcap_reader* reader, goose_pcap_record* record)
+{
+    while (reader->offset < reader->size)
+    {
+        if (reader->size - reader->offset < 12)
+        {
+            return -1;
+        }
+
+        uint8_t* block = &reader->base[reader->offset];
+        uint32_t type;
+        memcpy(&type, block, sizeof(type));
+
+        if (type == GOOSE_PCAPNG_SECTION_HEADER)
+        {
+            // A new section may switch byte order and starts without interfaces
+            uint32_t magic;
+            memcpy(&magic, block + 8, sizeof(magic));
+            if (magic == GOOSE_PCAPNG_BYTE_ORDER_MAGIC)
+            {
+                reader->swapped = 0;
+            }
+            else
+            {
+                reader->swapped = 1;
+                if (reader_u32(reader, block + 8) != GOOSE_PCAPNG_BYTE_ORDER_MAGIC)
+                {
+                    return -1;
+                }
+            }
+            reader->interface_count = 0;
+        }
+        else
+        {
+            type = reader_u32(reader, block);
+        }
+
+        uint32_t block_length = reader_u32(reader, block + 4);
+        if (block_length < 12 || (block_length & 3) || block_length > reader->size - reader->offset)
+        {
+            return -1;
+        }
+        reader->offset += block_length;
+
+        if (type == GOOSE_PCAPNG_INTERFACE_DESCRIPTION)
+        {
+            if (block_length < 20)
+            {
+                return -1;
+            }
+            if (reader->interface_count >= GOOSE_PCAPNG_MAX_INTERFACES)
+            {
+                continue;	// Its packets are skipped as unknown interfaces
+            }
+
+            goose_pcap_interface* interface = &reader->interfaces[reader->interface_count++];
+            interface->link_type = reader_u16(reader, block + 8);
+            interface->tsresol = 6;
+
+            size_t option = 16;
+            while (option + 4 <= block_length - 4)
+            {
+                uint16_t code = reader_u16(reader, block + option);
+                uint16_t length = reader_u16(reader, block + option + 2);
+                if (code == 0 || option + 4 + length > block_length - 4)
+                {
+                    break;
+                }
+                if (code == GOOSE_PCAPNG_OPTION_TSRESOL && length >= 1)
+                {
+                    interface->tsresol = block[option + 4];
+                }
+                option += 4 + (((size_t)length + 3) & ~(size_t)3);
+            }
+        }
+        else if (type == GOOSE_PCAPNG_ENHANCED_PACKET)
+        {
+            if (block_length < 32)
+            {
+                return -1;
+            }
+
+            uint32_t interface_id = reader_u32(reader, block + 8);
+            uint64_t ticks = ((uint64_t)reader_u32(reader, block + 12) << 32) | reader_u32(reader, block + 16);
+            uint32_t captured = reader_u32(reader, block + 20);
+            uint32_t original = reader_u32(reader, block + 24);
+
+            if (captured > block_length - 32)
+            {
+                return -1;
+            }
+            if (interface_id >= reader->interface_count || reader->interfaces[interface_id].link_type != GOOSE_PCAP_LINKTYPE_ETHERNET)
+            {
+                continue;
+            }
+
+            record->frame = block + 28;
+            record->length = captured;
+            record->original_length = original;
+            record->timestamp_ns = ticks_to_ns(ticks, reader->interfaces[interface_id].tsresol);
+            return 1;
+        }
+        else if (type == GOOSE_PCAPNG_SIMPLE_PACKET)
+        {
+            if (block_length < 16)
+            {
+                return -1;
+            }
+            if (reader->interface_count == 0 || reader->interfaces[0].link_type != GOOSE_PCAP_LINKTYPE_ETHERNET)
+            {
+                continue;
+            }
+
+            uint32_t original = reader_u32(reader, block + 8);
+            record->frame = block + 12;
+            record->length = original < block_length - 16 ? original : block_length - 16;
+            record->original_length = original;
+            record->timestamp_ns = 0;	// Simple packets carry no timestamp
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+int goose_pcap_next(goose_pcap_reader* reader, goose_pcap_record* record)
+{
+    if (!reader->base)
+    {
+        return -1;
+    }
+
+    return reader->format == GOOSE_PCAP_CLASSIC ? next_classic(reader, record) : next_ng(reader, record);
+}
+
+// Replay
+
+static uint64_t replay_now_ns(void)
+{
+    struct timespec ts;
+#if defined(CLOCK_MONOTONIC)
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+#else
+    timespec_get(&ts, TIME_UTC);
+#endif
+    return (uint64_t)ts.tv_sec * NS_PER_SECOND + (uint64_t)ts.tv_nsec;
+}
+
+static void replay_wait_until(uint64_t deadline_ns)
+{
+    for (;;)
+    {
+        uint64_t now = replay_now_ns();
+        if (now >= deadline_ns)
+        {
+            return;
+        }
+#if defined(__unix__) || defined(__APPLE__)
+        uint64_t remaining = deadline_ns - now;
+        struct timespec ts = { (time_t)(remaining / NS_PER_SECOND), (long)(remaining % NS_PER_SECOND) };
+        nanosleep(&ts, NULL);
+#endif
+    }
+}
+
+long long goose_pcap_replay(goose_pcap_reader* reader, const goose_pcap_replay_params* params)
+{
+    goose_pcap_record record;
+    long long frames = 0;
+    uint64_t first_ns = 0;
+    uint64_t next_tick_ns = 0;
+    uint64_t start_ns = 0;
+    int result;
+
+    while ((result = goose_pcap_next(reader, &record)) == 1)
+    {
+        if (frames == 0)
+        {
+            first_ns = record.timestamp_ns;
+            next_tick_ns = first_ns + NS_PER_MILLISECOND;
+            start_ns = replay_now_ns();
+        }
+
+        // Captures are not always in order, a frame stamped before its predecessor goes out at once
+        if (params->tick)
+        {
+            while (next_tick_ns <= record.timestamp_ns)
+            {
+                if (params->timing == GOOSE_PCAP_REPLAY_ORIGINAL)
+                {
+                    replay_wait_until(start_ns + (next_tick_ns - first_ns));
+                }
+                params->tick();
+                next_tick_ns += NS_PER_MILLISECOND;
+            }
+        }
+
+        if (params->timing == GOOSE_PCAP_REPLAY_ORIGINAL && record.timestamp_ns > first_ns)
+        {
+            replay_wait_until(start_ns + (record.timestamp_ns - first_ns));
+        }
+
+        if (params->output)
+        {
+            params->output(record.frame, record.length);
+        }
+        frames++;
+    }
+
+    return result < 0 ? -1 : frames;
+}
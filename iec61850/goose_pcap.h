@@ -0,0 +1,113 @@
+#pragma once
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stddef.h>
+
+// Capture files for commissioning and incident analysis: a pcap/pcapng writer that
+// can sit on the publisher's linkoutput, a reader over a mapped capture and a replay
+// loop that feeds the frames back into a subscriber.
+
+#define GOOSE_PCAP_MAGIC_US 0xa1b2c3d4u
+#define GOOSE_PCAP_MAGIC_NS 0xa1b23c4du
+#define GOOSE_PCAP_LINKTYPE_ETHERNET 1
+#define GOOSE_PCAP_SNAPLEN 65535
+
+#define GOOSE_PCAPNG_SECTION_HEADER 0x0a0d0d0au
+#define GOOSE_PCAPNG_INTERFACE_DESCRIPTION 0x00000001u
+#define GOOSE_PCAPNG_SIMPLE_PACKET 0x00000003u
+#define GOOSE_PCAPNG_ENHANCED_PACKET 0x00000006u
+#define GOOSE_PCAPNG_BYTE_ORDER_MAGIC 0x1a2b3c4du
+#define GOOSE_PCAPNG_OPTION_TSRESOL 9
+#define GOOSE_PCAPNG_MAX_INTERFACES 16
+
+// Records are gathered here and written with one fwrite per buffer
+#ifndef GOOSE_PCAP_BUFFER_SIZE
+#define GOOSE_PCAP_BUFFER_SIZE (256 * 1024)
+#endif
+
+typedef enum
+{
+	GOOSE_PCAP_CLASSIC,	// libpcap format with nanosecond timestamps
+	GOOSE_PCAP_NG		// pcapng, one Ethernet interface with if_tsresol 9
+} goose_pcap_format;
+
+typedef struct
+{
+	FILE* file;
+	goose_pcap_format format;
+	uint8_t* buffer;
+	size_t buffered;
+	uint64_t frames;
+	int error;		// Sticky, set by the first failed write
+} goose_pcap_writer;
+
+// Writer, used from one thread at a time. Returns 0, or -1 on I/O errors.
+int goose_pcap_writer_open(goose_pcap_writer* writer, const char* path, goose_pcap_format format);
+int goose_pcap_write(goose_pcap_writer* writer, const uint8_t* frame, size_t length, uint64_t timestamp_ns);
+int goose_pcap_writer_flush(goose_pcap_writer* writer);
+int goose_pcap_writer_close(goose_pcap_writer* writer);
+
+// Capture sink with the linkoutput signature: records every frame with the iec_time_now
+// clock into the writer set by goose_pcap_capture, then hands it on to forward if given.
+void goose_pcap_capture(goose_pcap_writer* writer, void (*forward)(uint8_t* byte_stream, size_t length));
+void goose_pcap_linkoutput(uint8_t* byte_stream, size_t length);
+
+typedef struct
+{
+	uint16_t link_type;
+	uint8_t tsresol;	// if_tsresol option, 6 (microseconds) when absent
+} goose_pcap_interface;
+
+typedef struct
+{
+	uint8_t* base;
+	size_t size;
+	size_t offset;		// Next record or block
+	size_t data_offset;	// First record or block, for rewind
+	uint8_t owned;		// Opened from a file, released by close
+	goose_pcap_format format;
+	uint8_t swapped;	// File byte order differs from the host
+	uint8_t nanosecond;	// Classic files only
+	uint16_t link_type;	// Classic files only
+	size_t interface_count;
+	goose_pcap_interface interfaces[GOOSE_PCAPNG_MAX_INTERFACES];
+} goose_pcap_reader;
+
+// A captured Ethernet frame, pointing into the mapped capture
+typedef struct
+{
+	uint8_t* frame;
+	size_t length;			// Captured bytes
+	size_t original_length;		// Bytes on the wire
+	uint64_t timestamp_ns;
+} goose_pcap_record;
+
+// Maps the capture copy-on-write, so consumers may modify frames without touching the file.
+// Either format and byte order is accepted, with any timestamp resolution.
+int goose_pcap_reader_open(goose_pcap_reader* reader, const char* path);
+int goose_pcap_reader_attach(goose_pcap_reader* reader, uint8_t* bytes, size_t size);
+void goose_pcap_reader_rewind(goose_pcap_reader* reader);
+void goose_pcap_reader_close(goose_pcap_reader* reader);
+
+// Next Ethernet frame, other link types are skipped. Returns 1 with a record, 0 at the
+// end of the capture, -1 if the rest of the capture is malformed.
+int goose_pcap_next(goose_pcap_reader* reader, goose_pcap_record* record);
+
+typedef enum
+{
+	GOOSE_PCAP_REPLAY_ORIGINAL,	// Frames and ticks are spaced as in the capture
+	GOOSE_PCAP_REPLAY_FAST		// No waiting, capture time only drives the ticks
+} goose_pcap_replay_timing;
+
+typedef struct
+{
+	goose_pcap_replay_timing timing;
+	void (*output)(uint8_t* byte_stream, size_t length);	// goose_subscriber_input, a publisher output...
+	void (*tick)(void);	// Optional, once per millisecond of capture time, e.g. goose_subscriber_process
+} goose_pcap_replay_params;
+
+// Replays the reader from its current position to the end. Ticks run on capture time from
+// the first frame on, so TATL supervision sees the same gaps in either timing mode.
+// Returns the number of frames replayed, or -1 if the capture is malformed.
+long long goose_pcap_replay(goose_pcap_reader* reader, const goose_pcap_replay_params* params);
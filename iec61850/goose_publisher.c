@@ -1,4 +1,5 @@
 #include "goose_publisher.h"
+#include "goose_stats.h"
 #include "semaphore_interface.h"
 #include <string.h>
 
@@ -8,10 +9,53 @@ static goose_publisher publisher;
 // Static semaphore to guard access to the publisher
 static semaphore_t* publisher_semaphore;
 
-void goose_message_housekeeping(goose_message_params* params);
-
-uint64_t time_elapsed_ns = 0;
-uint32_t time_elapsed_ms = 0;
+static void goose_message_housekeeping(size_t index, uint64_t now);
+static void goose_message_enqueue(size_t index, int state_change, int encoded);
+static void goose_message_transmit_batch(void);
+static void goose_message_reschedule(size_t index, uint64_t interval, uint64_t now);
+static int goose_message_find(const char* name);
+static void goose_message_block_update(size_t block);
+
+// Frames due in one process call, one FIFO per VLAN user priority, drained from
+// the highest priority down so trip-class frames leave before status-class ones
+#define TRANSMIT_QUEUE_END SIZE_MAX
+static size_t transmit_head[VLAN_MAX_PRIORITY + 1];
+static size_t transmit_tail[VLAN_MAX_PRIORITY + 1];
+static size_t transmit_next[MAX_GOOSE_MESSAGES];
+static uint8_t transmit_state_change[MAX_GOOSE_MESSAGES];
+static uint8_t transmit_encoded[MAX_GOOSE_MESSAGES];	// Retransmission patched into the last frame
+
+// The drained queues in transmit order, handed to goose_encode_batch
+static goose_handle* transmit_batch[MAX_GOOSE_MESSAGES];
+static size_t transmit_batch_index[MAX_GOOSE_MESSAGES];
+static uint8_t transmit_batch_encoded[MAX_GOOSE_MESSAGES];
+
+#if GOOSE_STATS
+// Time of the pending notify per slot, for the notify-to-output latency
+static uint64_t notify_time_ns[MAX_GOOSE_MESSAGES];
+static uint64_t tick_sequence = 0;
+// Time goose_retransmit_patch took per slot, the encode time of a retransmission
+static uint64_t transmit_patch_ns[MAX_GOOSE_MESSAGES];
+static uint64_t transmit_batch_encode_ns[MAX_GOOSE_MESSAGES];
+#define TRANSMIT_BATCH_ENCODE_NS transmit_batch_encode_ns
+#else
+#define TRANSMIT_BATCH_ENCODE_NS NULL
+#endif
+
+// Put a slot back in the state the scan skips
+static void goose_message_clear(size_t index)
+{
+    publisher.hot.next_transmission[index] = GOOSE_PUBLISHER_NO_DEADLINE;
+    publisher.hot.updated[index] = 0;
+    publisher.hot.coalescing_held[index] = 0;
+    publisher.hot.coalescing_window_end[index] = 0;
+    publisher.hot.st_num[index] = 0;
+    publisher.hot.sq_num[index] = 0;
+    publisher.hot.current_time_allowed_to_live[index] = 0;
+    publisher.hot.step[index] = 0;
+    memset(&publisher.cold[index], 0x0, sizeof(publisher.cold[index]));
+    goose_message_block_update(index / GOOSE_PUBLISHER_SCAN_BLOCK);
+}
 
 // Initialize the GOOSE publisher
 void goose_publisher_init(linkoutput output)
@@ -21,31 +65,73 @@ void goose_publisher_init(linkoutput output)
 
     // Set the linkoutput function
     publisher.output = output;
+    publisher.wakeup = NULL;
+    publisher.tick_time = 0;
 
     for (size_t i = 0; i < MAX_GOOSE_MESSAGES; i++)
     {
-        publisher.message_list[i].name = NULL;
-        publisher.message_list[i].handle = NULL;
-        publisher.message_list[i].default_time_allowed_to_live = 0;
-        publisher.message_list[i].burst_count = 0;
+        goose_message_clear(i);
     }
 }
 
 // Register a new GOOSE message
-void goose_publisher_register(goose_message_params params)
+int goose_publisher_register(goose_message_params params)
 {
+    const goose_retransmission_profile* profile = params.profile ? params.profile : &goose_retransmission_profile_default;
+    uint32_t factor = profile->time_allowed_to_live_factor ? profile->time_allowed_to_live_factor : 1;
+    uint32_t heartbeat_time_allowed_to_live = (uint32_t)params.default_time_allowed_to_live * factor;
+    int result = -1;
+
+    if (params.default_time_allowed_to_live == 0 || heartbeat_time_allowed_to_live > UINT16_MAX)
+    {
+        return -1;
+    }
+
     semaphore_take(publisher_semaphore);
 
     for (size_t i = 0; i < MAX_GOOSE_MESSAGES; i++)
     {
-        if (publisher.message_list[i].name == NULL)
+        if (publisher.cold[i].name == NULL)
         {
-            publisher.message_list[i] = params;
+            goose_message_cold* cold = &publisher.cold[i];
+
+            cold->name = params.name;
+            cold->handle = params.handle;
+            cold->default_time_allowed_to_live = params.default_time_allowed_to_live;
+            cold->heartbeat_time_allowed_to_live = (uint16_t)heartbeat_time_allowed_to_live;
+            cold->profile = profile;
+            cold->coalescing_window_us = params.coalescing_window_us;
+            cold->coalescing_leading_edge = params.coalescing_leading_edge;
+            cold->time_stamping = params.time_stamping;
+            cold->coalesced_updates = params.coalesced_updates;
+            if (cold->time_stamping)
+            {
+                iec_time_stamp(cold->notify_time);
+            }
+
+            publisher.hot.next_transmission[i] = params.next_transmission;
+            publisher.hot.updated[i] = params.updated;
+            publisher.hot.coalescing_held[i] = params.coalescing_held;
+            publisher.hot.coalescing_window_end[i] = params.coalescing_window_end;
+            publisher.hot.st_num[i] = params.st_num;
+            publisher.hot.sq_num[i] = params.sq_num;
+            publisher.hot.current_time_allowed_to_live[i] = params.current_time_allowed_to_live;
+            publisher.hot.step[i] = (uint8_t)params.step;
+
+            // A message that never had a state change has no curve to run: like the
+            // fixed-tick publisher, it starts on heartbeats at next_transmission
+            if (!params.updated && params.st_num == 0)
+            {
+                publisher.hot.step[i] = (uint8_t)profile->step_count;
+            }
+            goose_message_block_update(i / GOOSE_PUBLISHER_SCAN_BLOCK);
+            result = 0;
             break;
         }
     }
 
     semaphore_release(publisher_semaphore);
+    return result;
 }
 
 // Deregister a GOOSE message by name
@@ -53,16 +139,10 @@ void goose_publisher_deregister(const char* name)
 {
     semaphore_take(publisher_semaphore);
 
-    for (int i = 0; i < MAX_GOOSE_MESSAGES; i++)
+    int i = goose_message_find(name);
+    if (i >= 0)
     {
-        if (publisher.message_list[i].name && strcmp(publisher.message_list[i].name, name) == 0)
-        {
-            publisher.message_list[i].name = NULL;
-            publisher.message_list[i].handle = NULL;
-            publisher.message_list[i].default_time_allowed_to_live = 0;
-            publisher.message_list[i].burst_count = 0;
-            break;
-        }
+        goose_message_clear((size_t)i);
     }
 
     semaphore_release(publisher_semaphore);
@@ -73,122 +153,394 @@ void goose_publisher_notify(const char* name)
 {
     semaphore_take(publisher_semaphore);
 
-    for (int i = 0; i < MAX_GOOSE_MESSAGES; i++)
+    int i = goose_message_find(name);
+    if (i >= 0)
     {
-        if (publisher.message_list[i].name && strcmp(publisher.message_list[i].name, name) == 0)
+        // A state is already waiting to go out, this update rides along with it
+        if (publisher.hot.updated[i])
+        {
+            publisher.cold[i].coalesced_updates++;
+            GOOSE_STATS_CB_COALESCED(i);
+        }
+
+        // The data changed now, not when the state goes out
+        if (publisher.cold[i].time_stamping)
         {
+            iec_time_stamp(publisher.cold[i].notify_time);
+        }
 
+        // The next process call starts a new state and its retransmission burst
+        publisher.hot.updated[i] = 1;
+        publisher.hot.block_deadline[i / GOOSE_PUBLISHER_SCAN_BLOCK] = 0;
+#if GOOSE_STATS
+        if (notify_time_ns[i] == 0)
+        {
+            notify_time_ns[i] = goose_stats_now_ns();
         }
+#endif
     }
 
+    goose_publisher_wakeup wakeup = publisher.wakeup;
+
     semaphore_release(publisher_semaphore);
+
+    if (wakeup)
+    {
+        wakeup();
+    }
 }
 
-// Process function (can be called periodically)
+// Copy the current state of a message (counters, stNum, deadlines). Returns 0, or -1 if not registered.
+int goose_publisher_get(const char* name, goose_message_params* out)
+{
+    semaphore_take(publisher_semaphore);
+
+    int i = goose_message_find(name);
+    if (i >= 0)
+    {
+        const goose_message_cold* cold = &publisher.cold[i];
+
+        memset(out, 0x0, sizeof(*out));
+        out->name = cold->name;
+        out->handle = cold->handle;
+        out->default_time_allowed_to_live = cold->default_time_allowed_to_live;
+        out->current_time_allowed_to_live = publisher.hot.current_time_allowed_to_live[i];
+        out->next_transmission = publisher.hot.next_transmission[i];
+        out->st_num = publisher.hot.st_num[i];
+        out->sq_num = publisher.hot.sq_num[i];
+        out->profile = cold->profile;
+        out->step = publisher.hot.step[i];
+        out->coalescing_window_us = cold->coalescing_window_us;
+        out->coalescing_leading_edge = cold->coalescing_leading_edge;
+        out->coalescing_window_end = publisher.hot.coalescing_window_end[i];
+        out->coalescing_held = publisher.hot.coalescing_held[i];
+        out->coalesced_updates = cold->coalesced_updates;
+        out->time_stamping = cold->time_stamping;
+        memcpy(out->notify_time, cold->notify_time, IEC_TIME_UTC_SIZE);
+        out->updated = publisher.hot.updated[i];
+    }
+
+    semaphore_release(publisher_semaphore);
+
+    return i >= 0 ? 0 : -1;
+}
+
+// Install the wakeup hook of an event loop driving goose_publisher_process_at
+void goose_publisher_set_wakeup(goose_publisher_wakeup wakeup)
+{
+    semaphore_take(publisher_semaphore);
+    publisher.wakeup = wakeup;
+    semaphore_release(publisher_semaphore);
+}
+
+// Process function (can be called periodically), each call advances the publisher clock by one tick
 void goose_publisher_process(void)
 {
     semaphore_take(publisher_semaphore);
+    publisher.tick_time += GOOSE_PUBLISHER_TICK_NS;
+    uint64_t now = publisher.tick_time;
+    semaphore_release(publisher_semaphore);
 
-    for (size_t i = 0; i < MAX_GOOSE_MESSAGES; i++)
+    goose_publisher_process_at(now);
+}
+
+// Transmit everything due at `now` (ns, any monotonic time base as long as it is used consistently)
+void goose_publisher_process_at(uint64_t now)
+{
+    semaphore_take(publisher_semaphore);
+
+#if GOOSE_STATS
+    uint64_t tick_start_ns = GOOSE_STATS_PUBLISHER_TICK_BEGIN(tick_sequence);
+#endif
+
+    for (size_t priority = 0; priority <= VLAN_MAX_PRIORITY; priority++)
+    {
+        transmit_head[priority] = TRANSMIT_QUEUE_END;
+    }
+
+    // Only blocks holding something due are looked into. Free slots never match:
+    // their deadline is GOOSE_PUBLISHER_NO_DEADLINE and they are never updated.
+    for (size_t block = 0; block < GOOSE_PUBLISHER_SCAN_BLOCKS; block++)
     {
-        if (publisher.message_list[i].name)
+        if (publisher.hot.block_deadline[block] > now)
         {
-            goose_message_housekeeping(&(publisher.message_list[i]));
+            continue;
         }
+
+        size_t end = (block + 1) * GOOSE_PUBLISHER_SCAN_BLOCK;
+        for (size_t i = block * GOOSE_PUBLISHER_SCAN_BLOCK; i < end && i < MAX_GOOSE_MESSAGES; i++)
+        {
+            if (publisher.hot.updated[i] | (publisher.hot.next_transmission[i] <= now))
+            {
+                goose_message_housekeeping(i, now);
+            }
+        }
+
+        goose_message_block_update(block);
     }
 
-    time_elapsed_ns += 1000000000ULL;
-    time_elapsed_ms += 1ULL;
+    goose_message_transmit_batch();
+
+#if GOOSE_STATS
+    GOOSE_STATS_PUBLISHER_TICK(tick_sequence, tick_start_ns);
+    tick_sequence++;
+#endif
 
     semaphore_release(publisher_semaphore);
 }
 
+// Earliest deadline over all messages, 0 when a notified state is waiting and
+// GOOSE_PUBLISHER_NO_DEADLINE when nothing is registered
+uint64_t goose_publisher_next_deadline(void)
+{
+    uint64_t next = GOOSE_PUBLISHER_NO_DEADLINE;
+
+    semaphore_take(publisher_semaphore);
+
+    // A block's deadline is never later than those of its slots (an updated slot
+    // counts as 0 there), so only blocks earlier than the best so far are looked into
+    for (size_t block = 0; block < GOOSE_PUBLISHER_SCAN_BLOCKS; block++)
+    {
+        if (publisher.hot.block_deadline[block] >= next)
+        {
+            continue;
+        }
+
+        size_t end = (block + 1) * GOOSE_PUBLISHER_SCAN_BLOCK;
+        for (size_t i = block * GOOSE_PUBLISHER_SCAN_BLOCK; i < end && i < MAX_GOOSE_MESSAGES; i++)
+        {
+            // A pending state is due at once, or when its coalescing window closes
+            uint64_t due = publisher.hot.next_transmission[i];
+            if (publisher.hot.updated[i])
+            {
+                due = publisher.cold[i].coalescing_window_us ? publisher.hot.coalescing_window_end[i] : 0;
+                if (publisher.hot.next_transmission[i] < due)
+                {
+                    due = publisher.hot.next_transmission[i];
+                }
+            }
+
+            if (due < next)
+            {
+                next = due;
+            }
+        }
+    }
+
+    semaphore_release(publisher_semaphore);
+
+    return next;
+}
 
-void goose_message_housekeeping(goose_message_params* params)
+static int goose_message_find(const char* name)
 {
-    // Case 1: If message was updated, reset and transmit
-    if (params->updated)
+    for (int i = 0; i < MAX_GOOSE_MESSAGES; i++)
     {
-        params->burst_count = 6;  // Reset burst count to 6
-        params->current_time_allowed_to_live = 3;  // Set current TATL to 3
-        params->time_since_last_transmission = 0;  // Reset the time since last transmission
-        params->updated = 0;  // Clear the updated flag
+        if (publisher.cold[i].name && strcmp(publisher.cold[i].name, name) == 0)
+        {
+            return i;
+        }
+    }
 
-        // Increment st_num and reset sq_num to 0
-        params->st_num++;  // Use the st_num from the params struct
-        params->sq_num = 0;  // Reset sq_num to 0
+    return -1;
+}
 
-        // Set the time allowed to live in network byte order
-        uint16_t time_allowed_to_live_net = goose_htons(params->current_time_allowed_to_live);
+// Recompute the earliest deadline of a block after its slots changed
+static void goose_message_block_update(size_t block)
+{
+    uint64_t deadline = GOOSE_PUBLISHER_NO_DEADLINE;
+    size_t end = (block + 1) * GOOSE_PUBLISHER_SCAN_BLOCK;
 
-        // Convert st_num and sq_num to network byte order
-        uint32_t st_num_net = goose_htonl(params->st_num);
-        uint32_t sq_num_net = goose_htonl(params->sq_num);
+    for (size_t i = block * GOOSE_PUBLISHER_SCAN_BLOCK; i < end && i < MAX_GOOSE_MESSAGES; i++)
+    {
+        uint64_t due = publisher.hot.updated[i] ? 0 : publisher.hot.next_transmission[i];
+        deadline = due < deadline ? due : deadline;
+    }
 
-        // Update the PDU with new values
-        ber_set(&(params->handle->frame->pdu_list.time_allowed_to_live), (uint8_t*)&time_allowed_to_live_net, sizeof(time_allowed_to_live_net));
-        ber_set(&(params->handle->frame->pdu_list.st_num), (uint8_t*)&st_num_net, sizeof(st_num_net));
-        ber_set(&(params->handle->frame->pdu_list.sq_num), (uint8_t*)&sq_num_net, sizeof(sq_num_net));
+    publisher.hot.block_deadline[block] = deadline;
+}
 
-        // Re-encode the GOOSE message and transmit it
-        goose_encode(params->handle);
-        publisher.output(params->handle->byte_stream, params->handle->length);
+// Queue a message for this process call behind others of the same priority
+static void goose_message_enqueue(size_t index, int state_change, int encoded)
+{
+    uint8_t priority = goose_vlan_priority(publisher.cold[index].handle);
 
-        return;  // Return after transmission
+    transmit_next[index] = TRANSMIT_QUEUE_END;
+    transmit_state_change[index] = (uint8_t)state_change;
+    transmit_encoded[index] = (uint8_t)encoded;
+
+    if (transmit_head[priority] == TRANSMIT_QUEUE_END)
+    {
+        transmit_head[priority] = index;
+    }
+    else
+    {
+        transmit_next[transmit_tail[priority]] = index;
+    }
+    transmit_tail[priority] = index;
+}
+
+// Re-encode everything queued and hand it to the link in priority order
+static void goose_message_transmit_batch(void)
+{
+    size_t count = 0;
+
+    for (size_t priority = VLAN_MAX_PRIORITY + 1; priority-- > 0;)
+    {
+        for (size_t i = transmit_head[priority]; i != TRANSMIT_QUEUE_END; i = transmit_next[i])
+        {
+            transmit_batch_index[count] = i;
+            transmit_batch_encoded[count] = transmit_encoded[i];
+            transmit_batch[count++] = publisher.cold[i].handle;
+        }
     }
 
-    // Case 2: If time since last transmission is less than TATL, increment and return
-    if (params->time_since_last_transmission < params->current_time_allowed_to_live)
+    if (count == 0)
     {
-        params->time_since_last_transmission++;
         return;
     }
 
-    // Case 3: If burst_count > 0, decrement burst count, double the TATL, increment sq_num, and transmit
-    if (params->burst_count > 0)
+    goose_encode_batch(transmit_batch, count, publisher.output, transmit_batch_encoded, TRANSMIT_BATCH_ENCODE_NS);
+
+#if GOOSE_STATS
+    // Each frame's own encode, or retransmit patch, leaving out the output calls
+    uint64_t output_ns = GOOSE_STATS_NOW();
+    for (size_t n = 0; n < count; n++)
+    {
+        size_t i = transmit_batch_index[n];
+        uint64_t encode_ns = transmit_batch_encoded[n] ? transmit_patch_ns[i] : transmit_batch_encode_ns[n];
+        GOOSE_STATS_CB_FRAME(i, transmit_batch[n]->length, transmit_state_change[i], encode_ns);
+        if (transmit_state_change[i] && notify_time_ns[i] != 0)
+        {
+            GOOSE_STATS_CB_LATENCY(i, output_ns - notify_time_ns[i]);
+            notify_time_ns[i] = 0;
+        }
+    }
+#endif
+}
+
+
+// Next deadline one interval after the one just served, so late processing does not
+// stretch the curve. If that is already past, the schedule restarts from now.
+static void goose_message_reschedule(size_t index, uint64_t interval, uint64_t now)
+{
+    uint64_t next = publisher.hot.next_transmission[index] + interval;
+    publisher.hot.next_transmission[index] = next <= now ? now + interval : next;
+}
+
+static void goose_message_housekeeping(size_t index, uint64_t now)
+{
+    goose_publisher_hot* hot = &publisher.hot;
+    goose_message_cold* cold = &publisher.cold[index];
+    const goose_retransmission_profile* profile = cold->profile;
+
+    // Case 1: If message was updated, restart the curve and transmit, unless the update
+    // has to wait for its coalescing window. Every state change opens a window; updates
+    // inside it are held and go out as one state with the final values when it closes.
+    if (hot->updated[index] && cold->coalescing_window_us)
     {
-        params->burst_count--;  // Decrement burst count
-        params->current_time_allowed_to_live *= 2;  // Double the current TATL
+        if (now < hot->coalescing_window_end[index])
+        {
+            hot->coalescing_held[index] = 1;
+        }
+        else if (!hot->coalescing_held[index] && !cold->coalescing_leading_edge)
+        {
+            // Trailing edge only: a fresh update opens the window and waits for it
+            hot->coalescing_window_end[index] = now + (uint64_t)cold->coalescing_window_us * 1000ULL;
+            hot->coalescing_held[index] = 1;
+        }
+        else
+        {
+            hot->coalescing_window_end[index] = now + (uint64_t)cold->coalescing_window_us * 1000ULL;
+            hot->coalescing_held[index] = 0;
+        }
+    }
 
-        // Increment sq_num
-        params->sq_num++;
+    if (hot->updated[index] && !hot->coalescing_held[index])
+    {
+        hot->step[index] = 1;  // The state change frame is step 0 of the curve
+        hot->current_time_allowed_to_live[index] = profile->time_allowed_to_live[0];
+        hot->next_transmission[index] = now + profile->interval_ns[0];  // First retransmission one interval later
+        hot->updated[index] = 0;  // Clear the updated flag
 
-        // Convert sq_num to network byte order
-        uint32_t sq_num_net = goose_htonl(params->sq_num);
-        uint16_t time_allowed_to_live_net = goose_htons(params->current_time_allowed_to_live);
+        // Increment st_num and reset sq_num to 0
+        hot->st_num[index]++;
+        hot->sq_num[index] = 0;
 
-        // Update the PDU with the new sq_num and time allowed to live
-        ber_set(&(params->handle->frame->pdu_list.sq_num), (uint8_t*)&sq_num_net, sizeof(sq_num_net));
-        ber_set(&(params->handle->frame->pdu_list.time_allowed_to_live), (uint8_t*)&time_allowed_to_live_net, sizeof(time_allowed_to_live_net));
+        // Set the time allowed to live in network byte order
+        uint16_t time_allowed_to_live_net = goose_htons(hot->current_time_allowed_to_live[index]);
 
-        // Re-encode the GOOSE message and transmit it
-        goose_encode(params->handle);
-        publisher.output(params->handle->byte_stream, params->handle->length);
+        // Convert st_num and sq_num to network byte order
+        uint32_t st_num_net = goose_htonl(hot->st_num[index]);
+        uint32_t sq_num_net = goose_htonl(hot->sq_num[index]);
 
-        params->time_since_last_transmission = 0;  // Reset time since last transmission
+        // Update the PDU with new values
+        ber_set(&(cold->handle->frame->pdu_list.time_allowed_to_live), (uint8_t*)&time_allowed_to_live_net, sizeof(time_allowed_to_live_net));
+        ber_set(&(cold->handle->frame->pdu_list.st_num), (uint8_t*)&st_num_net, sizeof(st_num_net));
+        ber_set(&(cold->handle->frame->pdu_list.sq_num), (uint8_t*)&sq_num_net, sizeof(sq_num_net));
+
+        if (cold->time_stamping)
+        {
+            goose_t_set(cold->handle, cold->notify_time);
+        }
+
+        // Re-encode and transmit the GOOSE message once everything due is known
+        goose_message_enqueue(index, 1, 0);
+
+        return;  // Return after transmission
+    }
 
+    // Case 2: If the current interval has not run out yet, nothing is due
+    if (hot->next_transmission[index] > now)
+    {
         return;
     }
 
-    // Case 4: Normal case, increment sq_num and transmit
-    params->sq_num++;  // Increment sq_num in the params struct
+    // Case 3: Still on the curve, the step table gives this frame's TATL and the next interval.
+    // Case 4: Past its end, heartbeat at the default TATL.
+    uint16_t time_allowed_to_live;
+    uint64_t interval;
+
+    if (hot->step[index] < profile->step_count)
+    {
+        time_allowed_to_live = profile->time_allowed_to_live[hot->step[index]];
+        interval = profile->interval_ns[hot->step[index]];
+        hot->step[index]++;
+    }
+    else
+    {
+        time_allowed_to_live = cold->heartbeat_time_allowed_to_live;
+        interval = (uint64_t)cold->default_time_allowed_to_live * GOOSE_PUBLISHER_TICK_NS;
+    }
+
+    // Increment sq_num
+    hot->sq_num[index]++;
 
     // Convert sq_num to network byte order
-    uint32_t sq_num_net = goose_htonl(params->sq_num);
+    uint32_t sq_num_net = goose_htonl(hot->sq_num[index]);
 
     // Update the PDU with the incremented sq_num
-    ber_set(&(params->handle->frame->pdu_list.sq_num), (uint8_t*)&sq_num_net, sizeof(sq_num_net));
+    ber_set(&(cold->handle->frame->pdu_list.sq_num), (uint8_t*)&sq_num_net, sizeof(sq_num_net));
 
-    if (params->current_time_allowed_to_live != params->default_time_allowed_to_live)
+    if (hot->current_time_allowed_to_live[index] != time_allowed_to_live)
     {
-        params->current_time_allowed_to_live = params->default_time_allowed_to_live;
-        uint16_t time_allowed_to_live_net = goose_htons(params->current_time_allowed_to_live);
-        ber_set(&(params->handle->frame->pdu_list.time_allowed_to_live), (uint8_t*)&time_allowed_to_live_net, sizeof(time_allowed_to_live_net));
+        hot->current_time_allowed_to_live[index] = time_allowed_to_live;
+        uint16_t time_allowed_to_live_net = goose_htons(time_allowed_to_live);
+        ber_set(&(cold->handle->frame->pdu_list.time_allowed_to_live), (uint8_t*)&time_allowed_to_live_net, sizeof(time_allowed_to_live_net));
     }
 
-    // Re-encode the GOOSE message and transmit it
-    goose_encode(params->handle);
-    publisher.output(params->handle->byte_stream, params->handle->length);
-
-    params->time_since_last_transmission = 0;  // Reset time since last transmission
+    // A retransmission repeats the last state. The application may already have changed the
+    // dataset for the next one, held in a coalescing window or not yet notified, so only
+    // sqNum and TATL are patched into the frame last sent; the handle is re-encoded only
+    // when it has no encoded frame yet.
+#if GOOSE_STATS
+    uint64_t patch_start_ns = goose_stats_now_ns();
+#endif
+    int encoded = goose_retransmit_patch(cold->handle, hot->sq_num[index], time_allowed_to_live) == 0;
+#if GOOSE_STATS
+    transmit_patch_ns[index] = goose_stats_now_ns() - patch_start_ns;
+#endif
+    goose_message_enqueue(index, 0, encoded);
+
+    goose_message_reschedule(index, interval, now);
 }
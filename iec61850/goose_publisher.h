@@ -1,31 +1,94 @@
+﻿#pragma once
+
 #include <stdint.h>
 #include "goose.h"
+#include "goose_retransmission.h"
 
+#ifndef MAX_GOOSE_MESSAGES
 #define MAX_GOOSE_MESSAGES 16
+#endif
+
+// Length of one goose_publisher_process() tick on the publisher clock
+#define GOOSE_PUBLISHER_TICK_NS 1000000ULL
+#define GOOSE_PUBLISHER_NO_DEADLINE UINT64_MAX
 
 typedef void (*linkoutput)(uint8_t* byte_stream, size_t length);
 
+// Called after a notify so an event loop can run the publisher before its next deadline
+typedef void (*goose_publisher_wakeup)(void);
+
 typedef struct
 {
 	const char* name;
 	goose_handle* handle;
 	uint16_t default_time_allowed_to_live;
 	uint16_t current_time_allowed_to_live;
-	uint16_t time_since_last_transmission;
+	uint64_t next_transmission;	// Deadline in ns on the publisher clock
 	uint32_t st_num;
 	uint32_t sq_num;
-	size_t burst_count;
+	const goose_retransmission_profile* profile;	// NULL for goose_retransmission_profile_default
+	size_t step;	// Index into profile of the next retransmission; past the curve when registered idle with stNum 0
+	uint32_t coalescing_window_us;	// 0 sends every notify as its own state
+	uint8_t coalescing_leading_edge;	// Send the first update of a quiet period without waiting for the window
+	uint64_t coalescing_window_end;	// Updates before this deadline are held and merged
+	uint8_t coalescing_held;
+	uint32_t coalesced_updates;	// Notifies merged into a state already pending
+	uint8_t time_stamping;	// Stamp T with the UtcTime of the latest notify on each state change
+	uint8_t notify_time[IEC_TIME_UTC_SIZE];	// UtcTime of the latest notify, when time_stamping
 	uint8_t updated;
 } goose_message_params;
 
+// Slots are scanned in blocks, each with the earliest deadline of its slots
+#define GOOSE_PUBLISHER_SCAN_BLOCK 16
+#define GOOSE_PUBLISHER_SCAN_BLOCKS ((MAX_GOOSE_MESSAGES + GOOSE_PUBLISHER_SCAN_BLOCK - 1) / GOOSE_PUBLISHER_SCAN_BLOCK)
+
+// Publisher state is split by access pattern. Every process call scans the hot arrays,
+// one array per field so the scan only pulls in the bytes it compares; the cold
+// registration data of a message is read once it is actually due.
+typedef struct
+{
+	uint64_t block_deadline[GOOSE_PUBLISHER_SCAN_BLOCKS];	// 0 while a slot in the block is updated
+	uint64_t next_transmission[MAX_GOOSE_MESSAGES];	// GOOSE_PUBLISHER_NO_DEADLINE for free slots
+	uint8_t updated[MAX_GOOSE_MESSAGES];
+	uint8_t coalescing_held[MAX_GOOSE_MESSAGES];
+	uint64_t coalescing_window_end[MAX_GOOSE_MESSAGES];
+	uint32_t st_num[MAX_GOOSE_MESSAGES];
+	uint32_t sq_num[MAX_GOOSE_MESSAGES];
+	uint16_t current_time_allowed_to_live[MAX_GOOSE_MESSAGES];
+	uint8_t step[MAX_GOOSE_MESSAGES];
+} goose_publisher_hot;
+
+typedef struct
+{
+	const char* name;
+	goose_handle* handle;
+	uint16_t default_time_allowed_to_live;
+	uint16_t heartbeat_time_allowed_to_live;	// Advertised past the curve, default times the profile's factor
+	const goose_retransmission_profile* profile;
+	uint32_t coalescing_window_us;
+	uint8_t coalescing_leading_edge;
+	uint8_t time_stamping;
+	uint8_t notify_time[IEC_TIME_UTC_SIZE];
+	uint32_t coalesced_updates;
+} goose_message_cold;
+
 typedef struct
 {
-	goose_message_params message_list[MAX_GOOSE_MESSAGES];
+	goose_publisher_hot hot;
+	goose_message_cold cold[MAX_GOOSE_MESSAGES];
 	linkoutput output;
+	goose_publisher_wakeup wakeup;
+	uint64_t tick_time;
 } goose_publisher;
 
 void goose_publisher_init(linkoutput output);
-void goose_publisher_register(goose_message_params params);
+// Returns 0, or -1 if the default TATL is 0 (a heartbeat interval of 0 would never end),
+// its product with the profile's factor does not fit the 16-bit TATL, or no slot is free
+int goose_publisher_register(goose_message_params params);
 void goose_publisher_deregister(const char* name);
 void goose_publisher_notify(const char* name);
-void goose_publisher_process(void);
\ No newline at end of file
+int goose_publisher_get(const char* name, goose_message_params* out);
+void goose_publisher_process(void);
+void goose_publisher_process_at(uint64_t now);
+uint64_t goose_publisher_next_deadline(void);
+void goose_publisher_set_wakeup(goose_publisher_wakeup wakeup);
\ No newline at end of file
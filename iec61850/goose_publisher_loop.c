@@ -0,0 +1,163 @@
+#include "goose_publisher_loop.h"
+#include <errno.h>
+#include <stdint.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/timerfd.h>
+#include <time.h>
+#include <unistd.h>
+
+static int timer_fd = -1;
+static int event_fd = -1;
+
+static void goose_publisher_loop_wakeup(void);
+static void goose_publisher_loop_arm(uint64_t deadline);
+
+// Current time on the clock the loop feeds to goose_publisher_process_at
+uint64_t goose_publisher_loop_now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+// Create the descriptors and take over the publisher wakeup hook. Call after goose_publisher_init.
+int goose_publisher_loop_init(void)
+{
+    timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    if (timer_fd < 0)
+    {
+        return -1;
+    }
+
+    event_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (event_fd < 0)
+    {
+        close(timer_fd);
+        timer_fd = -1;
+        return -1;
+    }
+
+    goose_publisher_set_wakeup(goose_publisher_loop_wakeup);
+
+    // Messages registered before the loop existed are due right away
+    goose_publisher_loop_arm(goose_publisher_next_deadline());
+
+    return 0;
+}
+
+// Add both descriptors to an existing epoll set. Either one becoming readable
+// carries `tag` in epoll_event.data.ptr and means: call goose_publisher_loop_handle.
+int goose_publisher_loop_attach(int epoll_fd, void* tag)
+{
+    struct epoll_event event;
+    event.events = EPOLLIN;
+    event.data.ptr = tag;
+
+    if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, timer_fd, &event) != 0)
+    {
+        return -1;
+    }
+
+    event.data.ptr = tag;
+    if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, event_fd, &event) != 0)
+    {
+        epoll_ctl(epoll_fd, EPOLL_CTL_DEL, timer_fd, NULL);
+        return -1;
+    }
+
+    return 0;
+}
+
+// Drain both descriptors, transmit what is due and re-arm for the next deadline
+void goose_publisher_loop_handle(void)
+{
+    uint64_t count;
+
+    // Both are non-blocking, EAGAIN just means that one did not fire
+    while (read(timer_fd, &count, sizeof(count)) < 0 && errno == EINTR)
+    {
+    }
+    while (read(event_fd, &count, sizeof(count)) < 0 && errno == EINTR)
+    {
+    }
+
+    goose_publisher_process_at(goose_publisher_loop_now());
+    goose_publisher_loop_arm(goose_publisher_next_deadline());
+}
+
+// Standalone loop on a private epoll set, returns when *stop becomes nonzero
+// (set it from another thread and call goose_publisher_notify or wait for a deadline)
+int goose_publisher_loop_run(volatile int* stop)
+{
+    int epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    if (epoll_fd < 0)
+    {
+        return -1;
+    }
+
+    if (goose_publisher_loop_attach(epoll_fd, NULL) != 0)
+    {
+        close(epoll_fd);
+        return -1;
+    }
+
+    while (!*stop)
+    {
+        struct epoll_event events[2];
+        int ready = epoll_wait(epoll_fd, events, 2, -1);
+
+        if (ready < 0 && errno != EINTR)
+        {
+            close(epoll_fd);
+            return -1;
+        }
+
+        if (ready > 0)
+        {
+            goose_publisher_loop_handle();
+        }
+    }
+
+    close(epoll_fd);
+    return 0;
+}
+
+void goose_publisher_loop_free(void)
+{
+    goose_publisher_set_wakeup(NULL);
+
+    if (timer_fd >= 0) close(timer_fd);
+    if (event_fd >= 0) close(event_fd);
+
+    timer_fd = -1;
+    event_fd = -1;
+}
+
+static void goose_publisher_loop_wakeup(void)
+{
+    uint64_t one = 1;
+
+    while (write(event_fd, &one, sizeof(one)) < 0 && errno == EINTR)
+    {
+    }
+}
+
+static void goose_publisher_loop_arm(uint64_t deadline)
+{
+    struct itimerspec spec = { 0 };
+
+    if (deadline != GOOSE_PUBLISHER_NO_DEADLINE)
+    {
+        // An all-zero it_value disarms the timer, a past deadline fires immediately
+        if (deadline == 0)
+        {
+            deadline = 1;
+        }
+
+        spec.it_value.tv_sec = (time_t)(deadline / 1000000000ULL);
+        spec.it_value.tv_nsec = (long)(deadline % 1000000000ULL);
+    }
+
+    timerfd_settime(timer_fd, TFD_TIMER_ABSTIME, &spec, NULL);
+}
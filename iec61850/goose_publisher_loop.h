@@ -0,0 +1,16 @@
+#pragma once
+
+#include <stdint.h>
+#include "goose_publisher.h"
+
+// Linux event loop for the publisher: one timerfd armed for the earliest
+// deadline and an eventfd poked by goose_publisher_notify. Nothing wakes up
+// until a frame is due, and deadlines are absolute CLOCK_MONOTONIC times so
+// retransmission intervals do not stretch when processing runs late.
+
+int goose_publisher_loop_init(void);
+int goose_publisher_loop_attach(int epoll_fd, void* tag);
+void goose_publisher_loop_handle(void);
+int goose_publisher_loop_run(volatile int* stop);
+void goose_publisher_loop_free(void);
+uint64_t goose_publisher_loop_now(void);
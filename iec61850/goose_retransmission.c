@@ -0,0 +1,73 @@
+#include "goose_retransmission.h"
+
+#define MS_NS 1000000ULL
+
+const goose_retransmission_profile goose_retransmission_profile_default =
+{
+    7,
+    { 3 * MS_NS, 6 * MS_NS, 12 * MS_NS, 24 * MS_NS, 48 * MS_NS, 96 * MS_NS, 192 * MS_NS },
+    { 3, 6, 12, 24, 48, 96, 192 },
+    1
+};
+
+static int profile_add_step(goose_retransmission_profile* profile, uint64_t interval_us)
+{
+    if (profile->step_count >= GOOSE_RETRANSMISSION_MAX_STEPS || interval_us == 0)
+    {
+        return -1;
+    }
+
+    // TATL is carried in whole milliseconds, round up so it never undercuts the interval
+    uint64_t time_allowed_to_live = (interval_us * profile->time_allowed_to_live_factor + 999) / 1000;
+    if (time_allowed_to_live > UINT16_MAX)
+    {
+        return -1;
+    }
+
+    profile->interval_ns[profile->step_count] = interval_us * 1000ULL;
+    profile->time_allowed_to_live[profile->step_count] = (uint16_t)time_allowed_to_live;
+    profile->step_count++;
+
+    return 0;
+}
+
+// Precompute the step table of a curve. Returns 0, or -1 if the curve is empty,
+// has a zero interval, exceeds GOOSE_RETRANSMISSION_MAX_STEPS or a TATL overflows.
+int goose_retransmission_profile_compile(goose_retransmission_profile* profile, const goose_retransmission_curve* curve)
+{
+    if (!profile || !curve)
+    {
+        return -1;
+    }
+
+    profile->step_count = 0;
+    profile->time_allowed_to_live_factor = curve->time_allowed_to_live_factor ? curve->time_allowed_to_live_factor : 1;
+
+    if (curve->intervals_us)
+    {
+        for (size_t i = 0; i < curve->interval_count; i++)
+        {
+            if (profile_add_step(profile, curve->intervals_us[i]) != 0)
+            {
+                return -1;
+            }
+        }
+    }
+    else
+    {
+        if (curve->multiplier < 2)
+        {
+            return -1;  // Would never reach the maximum
+        }
+
+        for (uint64_t interval = curve->first_interval_us; interval <= curve->max_interval_us; interval *= curve->multiplier)
+        {
+            if (profile_add_step(profile, interval) != 0)
+            {
+                return -1;
+            }
+        }
+    }
+
+    return profile->step_count > 0 ? 0 : -1;
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Retransmission curves. A curve is compiled once into a table of burst steps;
+// the publisher indexes it with the message's step counter, so the next deadline
+// and the advertised TATL of every frame are plain lookups. Past the last step
+// the message falls back to its heartbeat (default_time_allowed_to_live).
+
+#define GOOSE_RETRANSMISSION_MAX_STEPS 32
+
+typedef struct
+{
+	// Explicit curve in microseconds, e.g. { 2000, 4000, 8000, 16000 }; NULL for geometric
+	const uint32_t* intervals_us;
+	size_t interval_count;
+
+	// Geometric curve: first, first * multiplier, ... up to and including max_interval_us
+	uint32_t first_interval_us;
+	uint32_t multiplier;
+	uint32_t max_interval_us;
+
+	// Advertised TATL as a multiple of the interval to the next frame, 0 is taken as 1
+	uint16_t time_allowed_to_live_factor;
+} goose_retransmission_curve;
+
+typedef struct
+{
+	size_t step_count;
+	uint64_t interval_ns[GOOSE_RETRANSMISSION_MAX_STEPS];		// Delay after the frame sent at step i
+	uint16_t time_allowed_to_live[GOOSE_RETRANSMISSION_MAX_STEPS];	// TATL in ms carried by that frame
+	uint16_t time_allowed_to_live_factor;
+} goose_retransmission_profile;
+
+// 3, 6, 12 ... 192 ms with TATL equal to the interval, the publisher's historical curve
+extern const goose_retransmission_profile goose_retransmission_profile_default;
+
+int goose_retransmission_profile_compile(goose_retransmission_profile* profile, const goose_retransmission_curve* curve);
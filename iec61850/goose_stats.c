@@ -0,0 +1,353 @@
+#include "goose_stats.h"
+#include <string.h>
+#include <time.h>
+
+static uint64_t bucket_lower_bound(size_t bucket)
+{
+    const size_t sub_count = (size_t)1 << GOOSE_STATS_HISTOGRAM_SUB_BITS;
+
+    if (bucket < sub_count)
+    {
+        return bucket;
+    }
+
+    size_t shift = (bucket >> GOOSE_STATS_HISTOGRAM_SUB_BITS) - 1;
+    return (uint64_t)(sub_count + (bucket & (sub_count - 1))) << shift;
+}
+
+uint64_t goose_stats_histogram_percentile(const goose_stats_histogram* histogram, double percentile)
+{
+    if (histogram->count == 0) return 0;
+
+    uint64_t rank = (uint64_t)((percentile / 100.0) * (double)histogram->count);
+    if (rank >= histogram->count) rank = histogram->count - 1;
+
+    uint64_t seen = 0;
+    for (size_t i = 0; i < GOOSE_STATS_HISTOGRAM_BUCKETS; i++)
+    {
+        seen += histogram->buckets[i];
+        if (seen > rank)
+        {
+            uint64_t value = bucket_lower_bound(i);
+            return value > histogram->max ? histogram->max : value;
+        }
+    }
+
+    return histogram->max;
+}
+
+#if GOOSE_STATS
+
+#include <stdatomic.h>
+#include <stdlib.h>
+
+#if defined(_MSC_VER)
+#define GOOSE_THREAD_LOCAL __declspec(thread)
+#else
+#define GOOSE_THREAD_LOCAL _Thread_local
+#endif
+
+// Shard-side mirrors of the public structs. Only the owning thread writes a shard,
+// so updates are a relaxed load and store (plain moves on common targets) and the
+// atomics only keep snapshot readers free of torn values.
+typedef struct
+{
+    _Atomic uint64_t count;
+    _Atomic uint64_t sum;
+    _Atomic uint64_t min;
+    _Atomic uint64_t max;
+    _Atomic uint64_t buckets[GOOSE_STATS_HISTOGRAM_BUCKETS];
+} shard_histogram;
+
+typedef struct
+{
+    _Atomic uint64_t frames_sent;
+    _Atomic uint64_t state_changes;
+    _Atomic uint64_t retransmissions;
+    _Atomic uint64_t bytes_sent;
+    _Atomic uint64_t coalesced_updates;
+    shard_histogram encode_ns;
+    shard_histogram notify_to_output_ns;
+} shard_control_block;
+
+typedef struct
+{
+    _Atomic uint64_t ticks;
+    uint64_t last_start_ns;
+    uint64_t last_interval_ns;
+    shard_histogram tick_ns;
+    shard_histogram jitter_ns;
+} shard_publisher;
+
+typedef struct goose_stats_shard
+{
+    struct goose_stats_shard* next;
+    shard_control_block control_blocks[MAX_GOOSE_MESSAGES];
+    shard_publisher publisher;
+    _Atomic uint64_t subscriptions[MAX_GOOSE_SUBSCRIPTIONS][GOOSE_STATS_SUB_COUNTERS];
+} goose_stats_shard;
+
+// Shards are pushed once per thread and never unlinked, so counts survive thread exit
+static _Atomic(goose_stats_shard*) shard_list = NULL;
+static GOOSE_THREAD_LOCAL goose_stats_shard* local_shard = NULL;
+
+static goose_stats_shard* shard_get(void)
+{
+    goose_stats_shard* shard = local_shard;
+    if (shard)
+    {
+        return shard;
+    }
+
+    shard = (goose_stats_shard*)calloc(1, sizeof(goose_stats_shard));
+    if (!shard)
+    {
+        return NULL;
+    }
+
+    for (size_t i = 0; i < MAX_GOOSE_MESSAGES; i++)
+    {
+        atomic_init(&shard->control_blocks[i].encode_ns.min, UINT64_MAX);
+        atomic_init(&shard->control_blocks[i].notify_to_output_ns.min, UINT64_MAX);
+    }
+    atomic_init(&shard->publisher.tick_ns.min, UINT64_MAX);
+    atomic_init(&shard->publisher.jitter_ns.min, UINT64_MAX);
+
+    goose_stats_shard* head = atomic_load_explicit(&shard_list, memory_order_relaxed);
+    do
+    {
+        shard->next = head;
+    } while (!atomic_compare_exchange_weak_explicit(&shard_list, &head, shard, memory_order_release, memory_order_relaxed));
+
+    local_shard = shard;
+    return shard;
+}
+
+static inline void counter_add(_Atomic uint64_t* counter, uint64_t value)
+{
+    atomic_store_explicit(counter, atomic_load_explicit(counter, memory_order_relaxed) + value, memory_order_relaxed);
+}
+
+static inline size_t bucket_index(uint64_t value)
+{
+    const size_t sub_count = (size_t)1 << GOOSE_STATS_HISTOGRAM_SUB_BITS;
+
+    if (value < sub_count)
+    {
+        return (size_t)value;
+    }
+
+    if (value >> GOOSE_STATS_HISTOGRAM_MAX_BITS)
+    {
+        return GOOSE_STATS_HISTOGRAM_BUCKETS - 1;
+    }
+
+    size_t msb = 63 - (size_t)__builtin_clzll(value);
+    size_t shift = msb - GOOSE_STATS_HISTOGRAM_SUB_BITS;
+    return ((shift + 1) << GOOSE_STATS_HISTOGRAM_SUB_BITS) + (size_t)((value >> shift) & (sub_count - 1));
+}
+
+static void histogram_record(shard_histogram* histogram, uint64_t value)
+{
+    counter_add(&histogram->count, 1);
+    counter_add(&histogram->sum, value);
+    counter_add(&histogram->buckets[bucket_index(value)], 1);
+
+    if (value < atomic_load_explicit(&histogram->min, memory_order_relaxed))
+    {
+        atomic_store_explicit(&histogram->min, value, memory_order_relaxed);
+    }
+    if (value > atomic_load_explicit(&histogram->max, memory_order_relaxed))
+    {
+        atomic_store_explicit(&histogram->max, value, memory_order_relaxed);
+    }
+}
+
+static void histogram_merge(goose_stats_histogram* out, shard_histogram* histogram)
+{
+    uint64_t min = atomic_load_explicit(&histogram->min, memory_order_relaxed);
+    uint64_t max = atomic_load_explicit(&histogram->max, memory_order_relaxed);
+    uint64_t count = atomic_load_explicit(&histogram->count, memory_order_relaxed);
+
+    if (count == 0) return;
+
+    if (out->count == 0 || min < out->min) out->min = min;
+    if (max > out->max) out->max = max;
+    out->count += count;
+    out->sum += atomic_load_explicit(&histogram->sum, memory_order_relaxed);
+
+    for (size_t i = 0; i < GOOSE_STATS_HISTOGRAM_BUCKETS; i++)
+    {
+        out->buckets[i] += atomic_load_explicit(&histogram->buckets[i], memory_order_relaxed);
+    }
+}
+
+uint64_t goose_stats_now_ns(void)
+{
+    struct timespec ts;
+#if defined(CLOCK_MONOTONIC)
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+#else
+    timespec_get(&ts, TIME_UTC);
+#endif
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+void goose_stats_control_block_frame(size_t index, size_t bytes, int state_change, uint64_t encode_ns)
+{
+    goose_stats_shard* shard = shard_get();
+    if (!shard || index >= MAX_GOOSE_MESSAGES) return;
+
+    shard_control_block* control_block = &shard->control_blocks[index];
+    counter_add(&control_block->frames_sent, 1);
+    counter_add(state_change ? &control_block->state_changes : &control_block->retransmissions, 1);
+    counter_add(&control_block->bytes_sent, bytes);
+    histogram_record(&control_block->encode_ns, encode_ns);
+}
+
+void goose_stats_control_block_latency(size_t index, uint64_t latency_ns)
+{
+    goose_stats_shard* shard = shard_get();
+    if (!shard || index >= MAX_GOOSE_MESSAGES) return;
+
+    histogram_record(&shard->control_blocks[index].notify_to_output_ns, latency_ns);
+}
+
+void goose_stats_control_block_coalesced(size_t index)
+{
+    goose_stats_shard* shard = shard_get();
+    if (!shard || index >= MAX_GOOSE_MESSAGES) return;
+
+    counter_add(&shard->control_blocks[index].coalesced_updates, 1);
+}
+
+// Called for the sampled ticks only, sequence is the publisher's tick counter
+void goose_stats_publisher_tick(uint64_t sequence, uint64_t start_ns)
+{
+    goose_stats_shard* shard = shard_get();
+    if (!shard) return;
+
+    shard_publisher* publisher = &shard->publisher;
+    atomic_store_explicit(&publisher->ticks, sequence + 1, memory_order_relaxed);
+    histogram_record(&publisher->tick_ns, goose_stats_now_ns() - start_ns);
+
+    // The second tick of a sampled pair gives one tick interval
+    if (sequence % GOOSE_STATS_TICK_SAMPLE == 1 && publisher->last_start_ns != 0)
+    {
+        uint64_t interval = start_ns - publisher->last_start_ns;
+        if (publisher->last_interval_ns != 0)
+        {
+            uint64_t jitter = interval > publisher->last_interval_ns ? interval - publisher->last_interval_ns : publisher->last_interval_ns - interval;
+            histogram_record(&publisher->jitter_ns, jitter);
+        }
+        publisher->last_interval_ns = interval;
+    }
+    publisher->last_start_ns = start_ns;
+}
+
+void goose_stats_subscription_count(size_t index, size_t counter)
+{
+    goose_stats_shard* shard = shard_get();
+    if (!shard || index >= MAX_GOOSE_SUBSCRIPTIONS) return;
+
+    counter_add(&shard->subscriptions[index][counter], 1);
+}
+
+void goose_stats_control_block_snapshot(size_t index, goose_stats_control_block* out)
+{
+    memset(out, 0, sizeof(*out));
+    if (index >= MAX_GOOSE_MESSAGES) return;
+
+    for (goose_stats_shard* shard = atomic_load_explicit(&shard_list, memory_order_acquire); shard; shard = shard->next)
+    {
+        shard_control_block* control_block = &shard->control_blocks[index];
+        out->frames_sent += atomic_load_explicit(&control_block->frames_sent, memory_order_relaxed);
+        out->state_changes += atomic_load_explicit(&control_block->state_changes, memory_order_relaxed);
+        out->retransmissions += atomic_load_explicit(&control_block->retransmissions, memory_order_relaxed);
+        out->bytes_sent += atomic_load_explicit(&control_block->bytes_sent, memory_order_relaxed);
+        out->coalesced_updates += atomic_load_explicit(&control_block->coalesced_updates, memory_order_relaxed);
+        histogram_merge(&out->encode_ns, &control_block->encode_ns);
+        histogram_merge(&out->notify_to_output_ns, &control_block->notify_to_output_ns);
+    }
+}
+
+void goose_stats_publisher_snapshot(goose_stats_publisher* out)
+{
+    memset(out, 0, sizeof(*out));
+
+    for (goose_stats_shard* shard = atomic_load_explicit(&shard_list, memory_order_acquire); shard; shard = shard->next)
+    {
+        uint64_t ticks = atomic_load_explicit(&shard->publisher.ticks, memory_order_relaxed);
+        if (ticks > out->ticks) out->ticks = ticks;
+        histogram_merge(&out->tick_ns, &shard->publisher.tick_ns);
+        histogram_merge(&out->jitter_ns, &shard->publisher.jitter_ns);
+    }
+}
+
+void goose_stats_subscription_snapshot(size_t index, goose_stats_subscription* out)
+{
+    memset(out, 0, sizeof(*out));
+    if (index >= MAX_GOOSE_SUBSCRIPTIONS) return;
+
+    for (goose_stats_shard* shard = atomic_load_explicit(&shard_list, memory_order_acquire); shard; shard = shard->next)
+    {
+        out->received += atomic_load_explicit(&shard->subscriptions[index][GOOSE_STATS_SUB_RECEIVED_COUNTER], memory_order_relaxed);
+        out->dropped += atomic_load_explicit(&shard->subscriptions[index][GOOSE_STATS_SUB_DROPPED_COUNTER], memory_order_relaxed);
+        out->fast_pathed += atomic_load_explicit(&shard->subscriptions[index][GOOSE_STATS_SUB_FAST_PATHED_COUNTER], memory_order_relaxed);
+        out->tatl_expired += atomic_load_explicit(&shard->subscriptions[index][GOOSE_STATS_SUB_TATL_EXPIRED_COUNTER], memory_order_relaxed);
+        out->auth_failed += atomic_load_explicit(&shard->subscriptions[index][GOOSE_STATS_SUB_AUTH_FAILED_COUNTER], memory_order_relaxed);
+    }
+}
+
+#else
+
+// Stats compiled out: recorders are never called through the macros and snapshots read as zero
+
+uint64_t goose_stats_now_ns(void)
+{
+    return 0;
+}
+
+void goose_stats_control_block_frame(size_t index, size_t bytes, int state_change, uint64_t encode_ns)
+{
+    (void)index; (void)bytes; (void)state_change; (void)encode_ns;
+}
+
+void goose_stats_control_block_latency(size_t index, uint64_t latency_ns)
+{
+    (void)index; (void)latency_ns;
+}
+
+void goose_stats_control_block_coalesced(size_t index)
+{
+    (void)index;
+}
+
+void goose_stats_publisher_tick(uint64_t sequence, uint64_t start_ns)
+{
+    (void)sequence; (void)start_ns;
+}
+
+void goose_stats_subscription_count(size_t index, size_t counter)
+{
+    (void)index; (void)counter;
+}
+
+void goose_stats_control_block_snapshot(size_t index, goose_stats_control_block* out)
+{
+    (void)index;
+    memset(out, 0, sizeof(*out));
+}
+
+void goose_stats_publisher_snapshot(goose_stats_publisher* out)
+{
+    memset(out, 0, sizeof(*out));
+}
+
+void goose_stats_subscription_snapshot(size_t index, goose_stats_subscription* out)
+{
+    (void)index;
+    memset(out, 0, sizeof(*out));
+}
+
+#endif
@@ -0,0 +1,109 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include "goose_publisher.h"
+#include "goose_subscriber.h"
+
+// Hot path statistics, compiled in with -DGOOSE_STATS=1 (IEC61850_STATS in CMake).
+// Every thread records into its own shard without locks or atomic read-modify-writes;
+// the snapshot functions sum all shards, so they can run from any thread at any time.
+
+#ifndef GOOSE_STATS
+#define GOOSE_STATS 0
+#endif
+
+// Log-bucket histogram of nanosecond values: exact below 8, then 8 buckets per
+// power of two (12.5% resolution) up to 2^40 ns, larger values land in the last bucket
+#define GOOSE_STATS_HISTOGRAM_SUB_BITS 3
+#define GOOSE_STATS_HISTOGRAM_MAX_BITS 40
+#define GOOSE_STATS_HISTOGRAM_BUCKETS (((GOOSE_STATS_HISTOGRAM_MAX_BITS - GOOSE_STATS_HISTOGRAM_SUB_BITS + 1) << GOOSE_STATS_HISTOGRAM_SUB_BITS))
+
+typedef struct
+{
+	uint64_t count;
+	uint64_t sum;
+	uint64_t min;
+	uint64_t max;
+	uint64_t buckets[GOOSE_STATS_HISTOGRAM_BUCKETS];
+} goose_stats_histogram;
+
+// Per publisher slot (control block)
+typedef struct
+{
+	uint64_t frames_sent;
+	uint64_t state_changes;
+	uint64_t retransmissions;
+	uint64_t bytes_sent;
+	uint64_t coalesced_updates;
+	goose_stats_histogram encode_ns;
+	goose_stats_histogram notify_to_output_ns;
+} goose_stats_control_block;
+
+// Tick timing is sampled on a pair of consecutive ticks every GOOSE_STATS_TICK_SAMPLE
+// ticks, reading the clock on every idle tick would cost more than the tick itself
+#ifndef GOOSE_STATS_TICK_SAMPLE
+#define GOOSE_STATS_TICK_SAMPLE 16
+#endif
+
+typedef struct
+{
+	uint64_t ticks;		// As of the last sampled tick
+	goose_stats_histogram tick_ns;
+	goose_stats_histogram jitter_ns;	// Change of the interval between consecutive ticks
+} goose_stats_publisher;
+
+// Per subscriber slot
+typedef struct
+{
+	uint64_t received;
+	uint64_t dropped;
+	uint64_t fast_pathed;
+	uint64_t tatl_expired;
+	uint64_t auth_failed;
+} goose_stats_subscription;
+
+void goose_stats_control_block_snapshot(size_t index, goose_stats_control_block* out);
+void goose_stats_publisher_snapshot(goose_stats_publisher* out);
+void goose_stats_subscription_snapshot(size_t index, goose_stats_subscription* out);
+uint64_t goose_stats_histogram_percentile(const goose_stats_histogram* histogram, double percentile);
+
+uint64_t goose_stats_now_ns(void);
+void goose_stats_control_block_frame(size_t index, size_t bytes, int state_change, uint64_t encode_ns);
+void goose_stats_control_block_latency(size_t index, uint64_t latency_ns);
+void goose_stats_control_block_coalesced(size_t index);
+void goose_stats_publisher_tick(uint64_t sequence, uint64_t start_ns);
+void goose_stats_subscription_count(size_t index, size_t counter);
+
+#define GOOSE_STATS_SUB_RECEIVED_COUNTER 0
+#define GOOSE_STATS_SUB_DROPPED_COUNTER 1
+#define GOOSE_STATS_SUB_FAST_PATHED_COUNTER 2
+#define GOOSE_STATS_SUB_TATL_EXPIRED_COUNTER 3
+#define GOOSE_STATS_SUB_AUTH_FAILED_COUNTER 4
+#define GOOSE_STATS_SUB_COUNTERS 5
+
+#if GOOSE_STATS
+#define GOOSE_STATS_NOW() goose_stats_now_ns()
+#define GOOSE_STATS_CB_FRAME(index, bytes, state_change, encode_ns) goose_stats_control_block_frame((index), (bytes), (state_change), (encode_ns))
+#define GOOSE_STATS_CB_LATENCY(index, latency_ns) goose_stats_control_block_latency((index), (latency_ns))
+#define GOOSE_STATS_CB_COALESCED(index) goose_stats_control_block_coalesced((index))
+#define GOOSE_STATS_PUBLISHER_TICK_BEGIN(sequence) (((sequence) % GOOSE_STATS_TICK_SAMPLE) <= 1 ? goose_stats_now_ns() : 0)
+#define GOOSE_STATS_PUBLISHER_TICK(sequence, start_ns) do { if (start_ns) goose_stats_publisher_tick((sequence), (start_ns)); } while (0)
+#define GOOSE_STATS_SUB_RECEIVED(index) goose_stats_subscription_count((index), GOOSE_STATS_SUB_RECEIVED_COUNTER)
+#define GOOSE_STATS_SUB_DROPPED(index) goose_stats_subscription_count((index), GOOSE_STATS_SUB_DROPPED_COUNTER)
+#define GOOSE_STATS_SUB_FAST_PATHED(index) goose_stats_subscription_count((index), GOOSE_STATS_SUB_FAST_PATHED_COUNTER)
+#define GOOSE_STATS_SUB_TATL_EXPIRED(index) goose_stats_subscription_count((index), GOOSE_STATS_SUB_TATL_EXPIRED_COUNTER)
+#define GOOSE_STATS_SUB_AUTH_FAILED(index) goose_stats_subscription_count((index), GOOSE_STATS_SUB_AUTH_FAILED_COUNTER)
+#else
+#define GOOSE_STATS_NOW() ((uint64_t)0)
+#define GOOSE_STATS_CB_FRAME(index, bytes, state_change, encode_ns) ((void)0)
+#define GOOSE_STATS_CB_LATENCY(index, latency_ns) ((void)0)
+#define GOOSE_STATS_CB_COALESCED(index) ((void)0)
+#define GOOSE_STATS_PUBLISHER_TICK_BEGIN(sequence) ((uint64_t)0)
+#define GOOSE_STATS_PUBLISHER_TICK(sequence, start_ns) ((void)0)
+#define GOOSE_STATS_SUB_RECEIVED(index) ((void)0)
+#define GOOSE_STATS_SUB_DROPPED(index) ((void)0)
+#define GOOSE_STATS_SUB_FAST_PATHED(index) ((void)0)
+#define GOOSE_STATS_SUB_TATL_EXPIRED(index) ((void)0)
+#define GOOSE_STATS_SUB_AUTH_FAILED(index) ((void)0)
+#endif
@@ -0,0 +1,200 @@
+#include "goose_subscriber.h"
+#include "goose_auth.h"
+#include "goose_stats.h"
+#include "semaphore_interface.h"
+#include <string.h>
+
+// Static goose_subscriber instance
+static goose_subscriber subscriber;
+
+// Static semaphore to guard access to the subscriber
+static semaphore_t* subscriber_semaphore;
+
+static int goose_subscription_receive(size_t index, goose_frame_view* view);
+
+// Initialize the GOOSE subscriber
+void goose_subscriber_init(void)
+{
+    subscriber_semaphore = semaphore_create();
+
+    for (size_t i = 0; i < MAX_GOOSE_SUBSCRIPTIONS; i++)
+    {
+        subscriber.subscription_list[i].name = NULL;
+        subscriber.subscription_list[i].valid = 0;
+    }
+}
+
+// Register a new subscription
+void goose_subscriber_register(goose_subscription_params params)
+{
+    semaphore_take(subscriber_semaphore);
+
+    for (size_t i = 0; i < MAX_GOOSE_SUBSCRIPTIONS; i++)
+    {
+        if (subscriber.subscription_list[i].name == NULL)
+        {
+            subscriber.subscription_list[i] = params;
+            subscriber.subscription_list[i].gocbref_length = params.gocbref ? strlen(params.gocbref) : 0;
+            subscriber.subscription_list[i].valid = 0;
+            break;
+        }
+    }
+
+    semaphore_release(subscriber_semaphore);
+}
+
+// Deregister a subscription by name
+void goose_subscriber_deregister(const char* name)
+{
+    semaphore_take(subscriber_semaphore);
+
+    for (size_t i = 0; i < MAX_GOOSE_SUBSCRIPTIONS; i++)
+    {
+        if (subscriber.subscription_list[i].name && strcmp(subscriber.subscription_list[i].name, name) == 0)
+        {
+            subscriber.subscription_list[i].name = NULL;
+            subscriber.subscription_list[i].valid = 0;
+            break;
+        }
+    }
+
+    semaphore_release(subscriber_semaphore);
+}
+
+// Feed one received Ethernet frame, has the linkoutput signature so it can sit behind a capture or a loopback
+void goose_subscriber_input(uint8_t* byte_stream, size_t length)
+{
+    goose_frame_view view;
+    goose_subscription_params notified;
+    int state_change = 0;
+
+    if (goose_decode(byte_stream, length, &view) != 0)
+    {
+        return;  // Not GOOSE or malformed, nothing to account it to
+    }
+
+    ber* gocbref = &view.fields[TAG_GOCBREF - TAG_GOCBREF];
+
+    semaphore_take(subscriber_semaphore);
+
+    for (size_t i = 0; i < MAX_GOOSE_SUBSCRIPTIONS; i++)
+    {
+        goose_subscription_params* subscription = &subscriber.subscription_list[i];
+
+        if (subscription->name == NULL || subscription->app_id != view.app_id)
+        {
+            continue;
+        }
+
+        if (subscription->gocbref && (subscription->gocbref_length != gocbref->length || memcmp(subscription->gocbref, gocbref->value, gocbref->length) != 0))
+        {
+            continue;
+        }
+
+        // Retransmissions are verified too, or a forged sqNum could keep a dead stream alive
+        if (subscription->keyring && goose_auth_verify(subscription->keyring, byte_stream, length) != 0)
+        {
+            GOOSE_STATS_SUB_AUTH_FAILED(i);
+            break;
+        }
+
+        // The callback gets a copy and runs after the lock is released, so it may
+        // call back into the subscriber
+        state_change = goose_subscription_receive(i, &view);
+        if (state_change)
+        {
+            notified = *subscription;
+        }
+        break;
+    }
+
+    semaphore_release(subscriber_semaphore);
+
+    if (state_change)
+    {
+        notified.callback(&notified, GOOSE_SUBSCRIBER_STATE_CHANGE, &view);
+    }
+}
+
+// Process function (called once per millisecond, like goose_publisher_process)
+void goose_subscriber_process(void)
+{
+    goose_subscription_params expired[MAX_GOOSE_SUBSCRIPTIONS];
+    size_t expired_count = 0;
+
+    semaphore_take(subscriber_semaphore);
+
+    for (size_t i = 0; i < MAX_GOOSE_SUBSCRIPTIONS; i++)
+    {
+        goose_subscription_params* subscription = &subscriber.subscription_list[i];
+
+        if (subscription->name == NULL || !subscription->valid)
+        {
+            continue;
+        }
+
+        subscription->time_since_last_reception++;
+
+        if (subscription->time_since_last_reception > subscription->time_allowed_to_live)
+        {
+            subscription->valid = 0;
+            GOOSE_STATS_SUB_TATL_EXPIRED(i);
+
+            if (subscription->callback)
+            {
+                expired[expired_count++] = *subscription;
+            }
+        }
+    }
+
+    semaphore_release(subscriber_semaphore);
+
+    for (size_t i = 0; i < expired_count; i++)
+    {
+        expired[i].callback(&expired[i], GOOSE_SUBSCRIBER_TATL_EXPIRED, NULL);
+    }
+}
+
+// Returns 1 when the frame is a new state the callback has to hear about
+static int goose_subscription_receive(size_t index, goose_frame_view* view)
+{
+    goose_subscription_params* subscription = &subscriber.subscription_list[index];
+
+    GOOSE_STATS_SUB_RECEIVED(index);
+
+    uint32_t st_num = goose_field_uint(&view->fields[TAG_ST_NUM - TAG_GOCBREF]);
+    uint32_t sq_num = goose_field_uint(&view->fields[TAG_SQ_NUM - TAG_GOCBREF]);
+    uint32_t time_allowed_to_live = goose_field_uint(&view->fields[TAG_TIME_ALLOWED_TO_LIVE - TAG_GOCBREF]);
+
+    if (subscription->valid && st_num == subscription->st_num)
+    {
+        // Duplicates and reordered retransmissions carry nothing new. sqNum is compared
+        // as a serial number so the stream keeps flowing when it wraps past UINT32_MAX.
+        if ((int32_t)(sq_num - subscription->sq_num) <= 0)
+        {
+            GOOSE_STATS_SUB_DROPPED(index);
+            return 0;
+        }
+
+        // Fast path: a retransmission only refreshes the supervision, allData is not decoded
+        subscription->sq_num = sq_num;
+        subscription->time_allowed_to_live = time_allowed_to_live;
+        subscription->time_since_last_reception = 0;
+        GOOSE_STATS_SUB_FAST_PATHED(index);
+        return 0;
+    }
+
+    if (goose_decode_all_data(view) < 0)
+    {
+        GOOSE_STATS_SUB_DROPPED(index);
+        return 0;
+    }
+
+    subscription->st_num = st_num;
+    subscription->sq_num = sq_num;
+    subscription->time_allowed_to_live = time_allowed_to_live;
+    subscription->time_since_last_reception = 0;
+    subscription->valid = 1;
+
+    return subscription->callback != NULL;
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <stdint.h>
+#include "goose.h"
+
+#ifndef MAX_GOOSE_SUBSCRIPTIONS
+#define MAX_GOOSE_SUBSCRIPTIONS 16
+#endif
+
+typedef enum
+{
+	GOOSE_SUBSCRIBER_STATE_CHANGE,	// New stNum, view->all_data_list holds the new values
+	GOOSE_SUBSCRIBER_TATL_EXPIRED	// No frame within timeAllowedtoLive, view is NULL
+} goose_subscriber_event;
+
+struct goose_subscription_params;
+
+// The view and its values point into the received frame and are only valid during the call.
+// subscription is a copy of the entry taken under the subscriber lock; the callback runs
+// after the lock is released, so it may register, deregister or feed frames itself.
+typedef void (*goose_subscriber_callback)(struct goose_subscription_params* subscription, goose_subscriber_event event, goose_frame_view* view);
+
+typedef struct goose_subscription_params
+{
+	const char* name;
+	const char* gocbref;	// NULL accepts every control block on app_id
+	size_t gocbref_length;	// Set by goose_subscriber_register
+	uint16_t app_id;
+	goose_subscriber_callback callback;
+	void* context;
+	const goose_auth_keyring* keyring;	// When set, frames without a valid IEC 62351-6 MAC are dropped
+	uint32_t st_num;
+	uint32_t sq_num;
+	uint32_t time_allowed_to_live;
+	uint32_t time_since_last_reception;
+	uint8_t valid;
+} goose_subscription_params;
+
+typedef struct
+{
+	goose_subscription_params subscription_list[MAX_GOOSE_SUBSCRIPTIONS];
+} goose_subscriber;
+
+void goose_subscriber_init(void);
+void goose_subscriber_register(goose_subscription_params params);
+void goose_subscriber_deregister(const char* name);
+void goose_subscriber_input(uint8_t* byte_stream, size_t length);
+void goose_subscriber_process(void);
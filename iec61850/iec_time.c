@@ -0,0 +1,83 @@
+#include "iec_time.h"
+#include <time.h>
+
+#define NS_PER_SECOND 1000000000ULL
+#define FRACTION_BITS 24
+
+static iec_time_clock time_clock = IEC_TIME_CLOCK_REALTIME;
+static int32_t time_tai_utc_offset = 0;
+static uint8_t time_quality = 0x0a;
+
+void iec_time_configure(iec_time_clock clock, int32_t tai_utc_offset, uint8_t quality)
+{
+    time_clock = clock;
+    time_tai_utc_offset = tai_utc_offset;
+    time_quality = quality;
+}
+
+uint8_t iec_time_quality(void)
+{
+    return time_quality;
+}
+
+// clock_gettime is served from the vDSO on Linux, so this is a few tens of ns
+void iec_time_now(iec_time* out)
+{
+    struct timespec ts;
+    int32_t offset = 0;
+
+#if defined(CLOCK_TAI)
+    if (time_clock == IEC_TIME_CLOCK_TAI)
+    {
+        clock_gettime(CLOCK_TAI, &ts);
+        offset = time_tai_utc_offset;
+    }
+    else
+    {
+        clock_gettime(CLOCK_REALTIME, &ts);
+    }
+#elif defined(CLOCK_REALTIME)
+    clock_gettime(CLOCK_REALTIME, &ts);
+#else
+    timespec_get(&ts, TIME_UTC);
+#endif
+
+    out->seconds = (uint32_t)((int64_t)ts.tv_sec - offset);
+    out->nanoseconds = (uint32_t)ts.tv_nsec;
+}
+
+// The fraction is floor(ns * 2^24 / 10^9). Dividing by a constant compiles to a
+// multiply and shift, so the conversion needs no division or floating point.
+void iec_time_encode(const iec_time* time, uint8_t quality, uint8_t out[IEC_TIME_UTC_SIZE])
+{
+    uint32_t fraction = (uint32_t)(((uint64_t)time->nanoseconds << FRACTION_BITS) / NS_PER_SECOND);
+
+    out[0] = (uint8_t)(time->seconds >> 24);
+    out[1] = (uint8_t)(time->seconds >> 16);
+    out[2] = (uint8_t)(time->seconds >> 8);
+    out[3] = (uint8_t)time->seconds;
+    out[4] = (uint8_t)(fraction >> 16);
+    out[5] = (uint8_t)(fraction >> 8);
+    out[6] = (uint8_t)fraction;
+    out[7] = quality;
+}
+
+// Encoding truncates, so decode(encode(t)) is up to one fraction step (~60 ns) before t
+void iec_time_decode(const uint8_t in[IEC_TIME_UTC_SIZE], iec_time* out, uint8_t* quality)
+{
+    uint32_t fraction = ((uint32_t)in[4] << 16) | ((uint32_t)in[5] << 8) | in[6];
+
+    out->seconds = ((uint32_t)in[0] << 24) | ((uint32_t)in[1] << 16) | ((uint32_t)in[2] << 8) | in[3];
+    out->nanoseconds = (uint32_t)(((uint64_t)fraction * NS_PER_SECOND + (1ULL << (FRACTION_BITS - 1))) >> FRACTION_BITS);
+    if (quality)
+    {
+        *quality = in[7];
+    }
+}
+
+void iec_time_stamp(uint8_t out[IEC_TIME_UTC_SIZE])
+{
+    iec_time now;
+    iec_time_now(&now);
+    iec_time_encode(&now, time_quality, out);
+}
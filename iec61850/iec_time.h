@@ -5,4 +5,32 @@
 typedef struct {
 	uint32_t seconds;
 	uint32_t nanoseconds;
-} iec_time;
\ No newline at end of file
+} iec_time;
+
+// IEC 61850-8-1 UtcTime: 4 bytes of seconds since 1970-01-01 00:00 UTC, a 24-bit
+// binary fraction of a second and a time quality byte, all big-endian
+#define IEC_TIME_UTC_SIZE 8
+
+// Time quality byte
+#define IEC_TIME_QUALITY_LEAP_SECONDS_KNOWN 0x80
+#define IEC_TIME_QUALITY_CLOCK_FAILURE 0x40
+#define IEC_TIME_QUALITY_CLOCK_NOT_SYNCHRONIZED 0x20
+#define IEC_TIME_QUALITY_ACCURACY_MASK 0x1f	// Number of significant fraction bits
+#define IEC_TIME_ACCURACY_UNSPECIFIED 0x1f
+
+typedef enum {
+	IEC_TIME_CLOCK_REALTIME,
+	IEC_TIME_CLOCK_TAI		// Converted to UTC with the configured TAI-UTC offset
+} iec_time_clock;
+
+// Clock source and quality used by iec_time_now and iec_time_stamp. The default is
+// CLOCK_REALTIME with quality 0x0a: leap seconds not known, 10 bit (~1 ms) accuracy.
+void iec_time_configure(iec_time_clock clock, int32_t tai_utc_offset, uint8_t quality);
+uint8_t iec_time_quality(void);
+
+void iec_time_now(iec_time* out);
+void iec_time_encode(const iec_time* time, uint8_t quality, uint8_t out[IEC_TIME_UTC_SIZE]);
+void iec_time_decode(const uint8_t in[IEC_TIME_UTC_SIZE], iec_time* out, uint8_t* quality);
+
+// Reads the clock and writes the UtcTime with the configured quality in one go
+void iec_time_stamp(uint8_t out[IEC_TIME_UTC_SIZE]);
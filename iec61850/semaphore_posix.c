@@ -0,0 +1,44 @@
+#include "semaphore_interface.h"
+#include <pthread.h>
+#include <stdlib.h>
+
+// pthread port of semaphore_interface.h, the publisher only uses it as a mutex
+struct semaphore_t
+{
+    pthread_mutex_t mutex;
+};
+
+semaphore_t* semaphore_create(void)
+{
+    semaphore_t* sem = (semaphore_t*)malloc(sizeof(semaphore_t));
+    if (!sem)
+    {
+        return NULL;
+    }
+
+    if (pthread_mutex_init(&sem->mutex, NULL) != 0)
+    {
+        free(sem);
+        return NULL;
+    }
+
+    return sem;
+}
+
+void semaphore_take(semaphore_t* sem)
+{
+    pthread_mutex_lock(&sem->mutex);
+}
+
+void semaphore_release(semaphore_t* sem)
+{
+    pthread_mutex_unlock(&sem->mutex);
+}
+
+void semaphore_destroy(semaphore_t* sem)
+{
+    if (!sem) return;
+
+    pthread_mutex_destroy(&sem->mutex);
+    free(sem);
+}
@@ -1,9 +1,16 @@
 #include <stdio.h>
 #include <stdint.h>
 #include <string.h>
-#include <crtdbg.h>
 #include "goose.h"
 
+#ifdef _MSC_VER
+#include <crtdbg.h>
+#else
+// Leak checking is only available through the MSVC debug CRT
+#define _CrtSetDbgFlag(flags) ((void)0)
+#define _CrtDumpMemoryLeaks() ((void)0)
+#endif
+
 // Sample data from the provided GOOSE frame
 void test_goose_encode() {
     _CrtSetDbgFlag(_CRTDBG_ALLOC_MEM_DF | _CRTDBG_LEAK_CHECK_DF);
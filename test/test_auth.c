@@ -0,0 +1,376 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include "goose.h"
+#include "goose_auth.h"
+#include "goose_publisher.h"
+#include "goose_subscriber.h"
+#include "goose_stats.h"
+#include "test_util.h"
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <pthread.h>
+#define TEST_THREADS 1
+#endif
+
+// IEC 62351-6 signing: SHA-256 and HMAC vectors, the frame extension, key rotation
+// (also raced against signing from another thread) and verification in the subscriber
+
+#define CHECK(cond) do { if (!(cond)) { printf("FAILED %s:%d: %s\n", __FILE__, __LINE__, #cond); failures++; } } while (0)
+
+static int failures = 0;
+static size_t state_changes = 0;
+
+static const char* gocbref = "CPC UNIFEI/LLN0$GO$TestDataSet";
+
+static int hex_equal(const uint8_t* bytes, const char* hex)
+{
+    for (size_t i = 0; hex[i * 2]; i++)
+    {
+        unsigned value;
+        if (sscanf(&hex[i * 2], "%2x", &value) != 1 || bytes[i] != value)
+        {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+static goose_handle* make_handle(uint8_t vlan)
+{
+    const char* dataset = "CPC UNIFEI/LLN0$TestDataSet";
+    const char* go_id = "CPC UNIFEI GOID";
+    uint8_t t[IEC_TIME_UTC_SIZE] = { 0x65, 0x0a, 0x1b, 0x2c, 0x10, 0x00, 0x00, 0x0a };
+    uint8_t zero = 0;
+    uint8_t conf_rev = 1;
+
+    goose_handle* handle = test_make_handle(0x05, 0x53, gocbref, 0);
+    if (vlan)
+    {
+        goose_vlan_set(handle, 6, 0x123);
+    }
+
+    ber_set(&(handle->frame->pdu_list.dataset), (uint8_t*)dataset, strlen(dataset));
+    ber_set(&(handle->frame->pdu_list.go_id), (uint8_t*)go_id, strlen(go_id));
+    ber_set(&(handle->frame->pdu_list.t), t, sizeof(t));
+    ber_set(&(handle->frame->pdu_list.simulation), &zero, sizeof(zero));
+    ber_set(&(handle->frame->pdu_list.conf_rev), &conf_rev, sizeof(conf_rev));
+    ber_set(&(handle->frame->pdu_list.nds_com), &zero, sizeof(zero));
+
+    for (int i = 0; i < 4; i++)
+    {
+        goose_all_data_entry_add(handle, 0x83, sizeof(zero), &zero);
+    }
+
+    return handle;
+}
+
+static void test_sha256(void)
+{
+    uint8_t digest[GOOSE_SHA256_SIZE];
+    const char* two_blocks = "abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq";
+
+    goose_sha256((const uint8_t*)"", 0, digest);
+    CHECK(hex_equal(digest, "e3b0c44298fc1c149afbf4c8996fb92427ae41e4649b934ca495991b7852b855"));
+
+    goose_sha256((const uint8_t*)"abc", 3, digest);
+    CHECK(hex_equal(digest, "ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad"));
+
+    goose_sha256((const uint8_t*)two_blocks, strlen(two_blocks), digest);
+    CHECK(hex_equal(digest, "248d6a61d20638b8e5c026930c3e6039a33ce45964ff2167f6ecedd419db06c1"));
+
+    // Fed in uneven pieces across block boundaries
+    uint8_t million[1000];
+    memset(million, 'a', sizeof(million));
+    goose_sha256_context context;
+    goose_sha256_init(&context);
+    for (size_t i = 0; i < 1000; i++)
+    {
+        goose_sha256_update(&context, million, 7);
+        goose_sha256_update(&context, million, 993);
+    }
+    goose_sha256_final(&context, digest);
+    CHECK(hex_equal(digest, "cdc76e5c9914fb9281a1c7e284d73e67f1809a48a497200e046d39ccc7112cd0"));
+}
+
+// RFC 4231 test cases 1, 2 and 6 (key longer than a block)
+static void test_hmac(void)
+{
+    uint8_t mac[GOOSE_SHA256_SIZE];
+    uint8_t key[131];
+
+    memset(key, 0x0b, 20);
+    goose_hmac_sha256(key, 20, (const uint8_t*)"Hi There", 8, mac);
+    CHECK(hex_equal(mac, "b0344c61d8db38535ca8afceaf0bf12b881dc200c9833da726e9376c2e32cff7"));
+
+    goose_hmac_sha256((const uint8_t*)"Jefe", 4, (const uint8_t*)"what do ya want for nothing?", 28, mac);
+    CHECK(hex_equal(mac, "5bdcc146bf60754e6a042426089575c75a003f089d2739839dec58b964ec3843"));
+
+    const char* message = "Test Using Larger Than Block-Size Key - Hash Key First";
+    memset(key, 0xaa, sizeof(key));
+    goose_hmac_sha256(key, sizeof(key), (const uint8_t*)message, strlen(message), mac);
+    CHECK(hex_equal(mac, "60e431591ee0b67f0d8a26aacbf5b77f8e0bc6213728c5140546040f0ee37f54"));
+}
+
+static void test_frame(void)
+{
+    const uint8_t key[] = "substation key 1";
+    goose_auth_keyring* keyring = goose_auth_keyring_create();
+    goose_handle* handle = make_handle(1);
+
+    goose_encode(handle);
+    size_t plain_length = handle->length;
+    uint8_t plain[sizeof(handle->byte_stream)];
+    memcpy(plain, handle->byte_stream, plain_length);
+
+    // No key yet: nothing is signed, the frame is not sent
+    goose_auth_enable(handle, keyring);
+    goose_encode(handle);
+    CHECK(handle->length == 0);
+    CHECK(goose_auth_key_id(keyring) == 0);
+
+    CHECK(goose_auth_key_set(keyring, 7, key, sizeof(key) - 1) == 0);
+    CHECK(goose_auth_key_id(keyring) == 7);
+    goose_encode(handle);
+    CHECK(handle->length == plain_length + GOOSE_AUTH_EXTENSION_SIZE);
+
+    // Same frame up to the goosePdu except Reserved 1, whose low byte is the extension length
+    size_t app_id_offset = MAC_ADDRESS_SIZE * 2 + VLAN_TAG_SIZE + ETHERTYPE_SIZE;
+    size_t reserved_1 = app_id_offset + APP_ID_SIZE + sizeof(uint16_t);
+    CHECK(memcmp(handle->byte_stream, plain, reserved_1 + 1) == 0);
+    CHECK(handle->byte_stream[reserved_1 + 1] == GOOSE_AUTH_EXTENSION_SIZE);
+    CHECK(memcmp(&handle->byte_stream[reserved_1 + 2], &plain[reserved_1 + 2], plain_length - reserved_1 - 2) == 0);
+
+    uint8_t* extension = &handle->byte_stream[plain_length];
+    CHECK(extension[0] == GOOSE_AUTH_TAG_EXTENSION && extension[1] == GOOSE_AUTH_EXTENSION_SIZE - 2);
+    CHECK(hex_equal(&extension[2], "8004000000078101018220"));
+
+    // The MAC is plain HMAC-SHA256 from APPID to the end of the goosePdu
+    uint8_t mac[GOOSE_SHA256_SIZE];
+    goose_hmac_sha256(key, sizeof(key) - 1, &handle->byte_stream[app_id_offset], plain_length - app_id_offset, mac);
+    CHECK(memcmp(&extension[13], mac, sizeof(mac)) == 0);
+
+    // Still a valid frame for receivers that ignore the extension
+    goose_frame_view view;
+    CHECK(goose_decode(handle->byte_stream, handle->length, &view) == 0);
+    CHECK(goose_decode_all_data(&view) == 4);
+
+    CHECK(goose_auth_verify(keyring, handle->byte_stream, handle->length) == 0);
+
+    // Retagging by a bridge keeps the MAC valid
+    handle->byte_stream[MAC_ADDRESS_SIZE * 2 + 3] ^= 0x01;
+    CHECK(goose_auth_verify(keyring, handle->byte_stream, handle->length) == 0);
+
+    // Any change from APPID on, or in the MAC, is rejected
+    uint8_t copy[sizeof(handle->byte_stream)];
+    for (size_t i = app_id_offset; i < handle->length; i++)
+    {
+        memcpy(copy, handle->byte_stream, handle->length);
+        copy[i] ^= 0x20;
+        if (goose_auth_verify(keyring, copy, handle->length) == 0)
+        {
+            CHECK(!"tampered byte accepted");
+            break;
+        }
+    }
+    CHECK(goose_auth_verify(keyring, handle->byte_stream, handle->length - 1) == -1);
+    CHECK(goose_auth_verify(keyring, plain, plain_length) == -1);
+
+    // Other keys, and a key that is neither current nor previous
+    goose_auth_keyring* other = goose_auth_keyring_create();
+    goose_auth_key_set(other, 7, (const uint8_t*)"another key", 11);
+    CHECK(goose_auth_verify(other, handle->byte_stream, handle->length) == -1);
+    goose_auth_keyring_free(other);
+
+    uint8_t signed_by_7[sizeof(handle->byte_stream)];
+    size_t signed_length = handle->length;
+    memcpy(signed_by_7, handle->byte_stream, signed_length);
+
+    goose_auth_key_set(keyring, 8, (const uint8_t*)"substation key 2", 16);
+    CHECK(goose_auth_verify(keyring, signed_by_7, signed_length) == 0);
+    goose_auth_key_set(keyring, 9, (const uint8_t*)"substation key 3", 16);
+    CHECK(goose_auth_verify(keyring, signed_by_7, signed_length) == -1);
+
+    // Re-signing replaces the extension instead of appending a second one
+    goose_encode(handle);
+    CHECK(handle->length == plain_length + GOOSE_AUTH_EXTENSION_SIZE);
+    CHECK(handle->byte_stream[plain_length + 7] == 9);
+    CHECK(goose_auth_sign(keyring, handle->byte_stream, handle->length, sizeof(handle->byte_stream)) == handle->length);
+    CHECK(goose_auth_sign(keyring, handle->byte_stream, handle->length, handle->length - 1) == 0);
+
+    // In-place T updates are signed again
+    uint8_t t[IEC_TIME_UTC_SIZE] = { 0x65, 0x0a, 0x1b, 0x2d, 0x00, 0x00, 0x00, 0x0a };
+    goose_t_set(handle, t);
+    CHECK(handle->length == plain_length + GOOSE_AUTH_EXTENSION_SIZE);
+    CHECK(goose_auth_verify(keyring, handle->byte_stream, handle->length) == 0);
+
+    goose_auth_enable(handle, NULL);
+    goose_encode(handle);
+    CHECK(handle->length == plain_length);
+
+    goose_free(handle);
+    goose_auth_keyring_free(keyring);
+}
+
+#if TEST_THREADS
+// Key n is n repeated, so a reader can recompute the MAC of whichever key signed
+#define ROTATIONS 2000
+
+static goose_auth_keyring* race_keyring;
+
+static void race_key(uint32_t key_id, uint8_t key[16])
+{
+    memset(key, (uint8_t)key_id, 16);
+    key[0] = (uint8_t)(key_id >> 8);
+}
+
+static void* race_rotate(void* argument)
+{
+    (void)argument;
+    uint8_t key[16];
+
+    for (uint32_t key_id = 2; key_id <= ROTATIONS; key_id++)
+    {
+        race_key(key_id, key);
+        goose_auth_key_set(race_keyring, key_id, key, sizeof(key));
+    }
+    return NULL;
+}
+
+static void test_rotation_race(void)
+{
+    uint8_t key[16];
+    race_keyring = goose_auth_keyring_create();
+    race_key(1, key);
+    goose_auth_key_set(race_keyring, 1, key, sizeof(key));
+
+    goose_handle* handle = make_handle(0);
+    goose_auth_enable(handle, race_keyring);
+    goose_encode(handle);
+
+    size_t app_id_offset = MAC_ADDRESS_SIZE * 2 + ETHERTYPE_SIZE;
+    size_t pdu_end = handle->length - GOOSE_AUTH_EXTENSION_SIZE;
+    size_t mismatches = 0;
+    uint32_t last_key_id = 0;
+
+    pthread_t thread;
+    pthread_create(&thread, NULL, race_rotate, NULL);
+
+    while (last_key_id < ROTATIONS)
+    {
+        size_t length = goose_auth_sign(race_keyring, handle->byte_stream, handle->length, sizeof(handle->byte_stream));
+        const uint8_t* extension = &handle->byte_stream[pdu_end];
+        uint32_t key_id = ((uint32_t)extension[4] << 24) | ((uint32_t)extension[5] << 16) | ((uint32_t)extension[6] << 8) | extension[7];
+
+        uint8_t mac[GOOSE_SHA256_SIZE];
+        race_key(key_id, key);
+        goose_hmac_sha256(key, sizeof(key), &handle->byte_stream[app_id_offset], pdu_end - app_id_offset, mac);
+
+        if (length != handle->length || key_id < last_key_id || memcmp(mac, &extension[13], sizeof(mac)) != 0)
+        {
+            mismatches++;
+        }
+        last_key_id = key_id;
+    }
+
+    pthread_join(thread, NULL);
+    CHECK(mismatches == 0);
+
+    goose_free(handle);
+    goose_auth_keyring_free(race_keyring);
+}
+#endif
+
+static void on_event(goose_subscription_params* subscription, goose_subscriber_event event, goose_frame_view* view)
+{
+    (void)subscription;
+    (void)view;
+
+    if (event == GOOSE_SUBSCRIBER_STATE_CHANGE)
+    {
+        state_changes++;
+    }
+}
+
+static void test_subscriber(void)
+{
+    goose_auth_keyring* keyring = goose_auth_keyring_create();
+    goose_auth_key_set(keyring, 1, (const uint8_t*)"bay key", 7);
+
+    goose_handle* handle = make_handle(1);
+    goose_auth_enable(handle, keyring);
+
+    goose_publisher_init(goose_subscriber_input);
+    goose_subscriber_init();
+
+    goose_subscription_params subscription = { 0 };
+    subscription.name = "sub";
+    subscription.gocbref = gocbref;
+    subscription.app_id = 0x0005;
+    subscription.callback = on_event;
+    subscription.keyring = keyring;
+    goose_subscriber_register(subscription);
+
+    goose_message_params message = { 0 };
+    message.name = "pub";
+    message.handle = handle;
+    message.default_time_allowed_to_live = 100;
+    message.updated = 1;
+    goose_publisher_register(message);
+
+    for (size_t i = 0; i < 50; i++)
+    {
+        goose_publisher_process();
+        goose_subscriber_process();
+    }
+    CHECK(state_changes == 1);
+
+    // A forged state change and an unsigned one are both dropped
+    uint8_t one = 1;
+    goose_all_data_entry_modify(handle, 0, 0x83, sizeof(one), &one);
+    uint32_t st_num = goose_htonl(2);
+    ber_set(&(handle->frame->pdu_list.st_num), (uint8_t*)&st_num, sizeof(st_num));
+    goose_encode(handle);
+    handle->byte_stream[handle->length - 1] ^= 0xff;
+    goose_subscriber_input(handle->byte_stream, handle->length);
+
+    goose_auth_enable(handle, NULL);
+    goose_encode(handle);
+    goose_subscriber_input(handle->byte_stream, handle->length);
+    CHECK(state_changes == 1);
+
+    // The next genuine one goes through, also across a key rotation
+    goose_auth_enable(handle, keyring);
+    goose_publisher_notify("pub");
+    goose_auth_key_set(keyring, 2, (const uint8_t*)"bay key 2", 9);
+    goose_publisher_process();
+    CHECK(state_changes == 2);
+
+#if GOOSE_STATS
+    goose_stats_subscription sub_stats;
+    goose_stats_subscription_snapshot(0, &sub_stats);
+    CHECK(sub_stats.auth_failed == 2);
+#endif
+
+    goose_publisher_deregister("pub");
+    goose_subscriber_deregister("sub");
+    goose_free(handle);
+    goose_auth_keyring_free(keyring);
+}
+
+int main(void)
+{
+    test_sha256();
+    test_hmac();
+    test_frame();
+#if TEST_THREADS
+    test_rotation_race();
+#endif
+    test_subscriber();
+
+    if (failures == 0)
+    {
+        printf("test_auth passed\n");
+    }
+    return failures == 0 ? 0 : 1;
+}
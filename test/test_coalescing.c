@@ -0,0 +1,192 @@
+#include <stdio.h>
+#include <stdint.h>
+#include "goose.h"
+#include "goose_publisher.h"
+#include "goose_stats.h"
+#include "test_util.h"
+
+// Update coalescing: bursts of notifies inside a window become one state change
+
+#define CHECK(cond) do { if (!(cond)) { printf("FAILED %s:%d: %s\n", __FILE__, __LINE__, #cond); failures++; } } while (0)
+#define US 1000ULL
+#define MS 1000000ULL
+
+static int failures = 0;
+
+static goose_handle* make_handle(void)
+{
+    uint8_t zero = 0;
+    goose_handle* handle = test_make_handle(0x05, 0x53, "IED1/LLN0$GO$Bounce", 0);
+    goose_all_data_entry_add(handle, 0x86, sizeof(zero), &zero);
+    return handle;
+}
+
+// Contact bounce: the value changes and is notified at each step
+static void bounce(goose_handle* handle, const char* name, uint8_t value, uint64_t now)
+{
+    goose_all_data_entry_modify(handle, 0, 0x86, sizeof(value), &value);
+    goose_publisher_notify(name);
+    goose_publisher_process_at(now);
+}
+
+static void register_message(const char* name, goose_handle* handle, uint32_t window_us, uint8_t leading_edge)
+{
+    goose_message_params message = { 0 };
+    message.name = name;
+    message.handle = handle;
+    message.default_time_allowed_to_live = 1000;
+    message.coalescing_window_us = window_us;
+    message.coalescing_leading_edge = leading_edge;
+    goose_publisher_register(message);
+}
+
+static void test_immediate(void)
+{
+    goose_handle* handle = make_handle();
+    goose_message_params state;
+    uint64_t now = 1000 * MS;
+
+    register_message("immediate", handle, 0, 0);
+
+    // Each notify processed on its own is its own state
+    bounce(handle, "immediate", 1, now);
+    bounce(handle, "immediate", 2, now + 10 * US);
+    CHECK(test_frame_field(&test_last_frame, TAG_ST_NUM) == 2);
+    CHECK(test_frame_member(&test_last_frame, 0) == 2);
+
+    // Two notifies before one process call have always merged, now they are counted
+    goose_publisher_notify("immediate");
+    bounce(handle, "immediate", 3, now + 20 * US);
+    CHECK(test_frame_field(&test_last_frame, TAG_ST_NUM) == 3);
+    CHECK(goose_publisher_get("immediate", &state) == 0);
+    CHECK(state.coalesced_updates == 1);
+
+    goose_publisher_deregister("immediate");
+    goose_free(handle);
+}
+
+static void test_leading_edge_window(void)
+{
+    goose_handle* handle = make_handle();
+    goose_message_params state;
+    uint64_t now = 2000 * MS;
+
+    register_message("leading", handle, 500, 1);
+
+    // First update of a quiet period is not delayed
+    test_frame_count = 0;
+    bounce(handle, "leading", 1, now);
+    CHECK(test_frame_count == 1);
+    CHECK(test_frame_field(&test_last_frame, TAG_ST_NUM) == 1);
+
+    // Bounces inside the window produce no frames and no new stNum
+    bounce(handle, "leading", 0, now + 100 * US);
+    bounce(handle, "leading", 1, now + 200 * US);
+    bounce(handle, "leading", 0, now + 300 * US);
+    CHECK(test_frame_count == 1);
+    CHECK(goose_publisher_next_deadline() == now + 500 * US);
+
+    // Window closes: one state change carrying the final value
+    goose_publisher_process_at(now + 500 * US);
+    CHECK(test_frame_count == 2);
+    CHECK(test_frame_field(&test_last_frame, TAG_ST_NUM) == 2);
+    CHECK(test_frame_member(&test_last_frame, 0) == 0);
+    CHECK(goose_publisher_get("leading", &state) == 0);
+    CHECK(state.coalesced_updates == 2);
+
+    // Quiet for longer than the window, the next update goes out at once again
+    bounce(handle, "leading", 1, now + 5 * MS);
+    CHECK(test_frame_field(&test_last_frame, TAG_ST_NUM) == 3);
+    CHECK(test_frame_member(&test_last_frame, 0) == 1);
+
+    goose_publisher_deregister("leading");
+    goose_free(handle);
+}
+
+// A window longer than the first retransmission interval: the frames sent while an
+// update is held repeat the state already published, not the held values
+static void test_held_update_retransmission(void)
+{
+    goose_handle* handle = make_handle();
+    uint64_t now = 4000 * MS;
+    size_t held_frames = 0;
+
+    register_message("held", handle, 10000, 1);
+
+    test_frame_count = 0;
+    bounce(handle, "held", 1, now);
+    CHECK(test_frame_count == 1);
+    CHECK(test_frame_field(&test_last_frame, TAG_ST_NUM) == 1);
+
+    bounce(handle, "held", 0, now + MS);
+    for (uint64_t t = 2; t < 10; t++)
+    {
+        size_t before = test_frame_count;
+        goose_publisher_process_at(now + t * MS);
+        if (test_frame_count != before)
+        {
+            held_frames += test_frame_count - before;
+            CHECK(test_frame_field(&test_last_frame, TAG_ST_NUM) == 1);
+            CHECK(test_frame_member(&test_last_frame, 0) == 1);
+        }
+    }
+    CHECK(held_frames > 0);
+
+    goose_publisher_process_at(now + 10 * MS);
+    CHECK(test_frame_field(&test_last_frame, TAG_ST_NUM) == 2);
+    CHECK(test_frame_member(&test_last_frame, 0) == 0);
+
+    goose_publisher_deregister("held");
+    goose_free(handle);
+}
+
+static void test_trailing_edge_window(void)
+{
+    goose_handle* handle = make_handle();
+    uint64_t now = 3000 * MS;
+
+#if GOOSE_STATS
+    goose_stats_control_block before;
+    goose_stats_control_block_snapshot(0, &before);
+#endif
+
+    register_message("trailing", handle, 250, 0);
+    goose_publisher_process_at(now - MS);  // Initial heartbeat, no state change yet
+
+    test_frame_count = 0;
+    bounce(handle, "trailing", 1, now);
+    bounce(handle, "trailing", 0, now + 100 * US);
+    bounce(handle, "trailing", 1, now + 200 * US);
+    CHECK(test_frame_count == 0);
+    CHECK(goose_publisher_next_deadline() == now + 250 * US);
+
+    goose_publisher_process_at(now + 250 * US);
+    CHECK(test_frame_count == 1);
+    CHECK(test_frame_field(&test_last_frame, TAG_ST_NUM) == 1);
+    CHECK(test_frame_member(&test_last_frame, 0) == 1);
+
+#if GOOSE_STATS
+    goose_stats_control_block after;
+    goose_stats_control_block_snapshot(0, &after);
+    CHECK(after.coalesced_updates - before.coalesced_updates == 2);
+#endif
+
+    goose_publisher_deregister("trailing");
+    goose_free(handle);
+}
+
+int main(void)
+{
+    goose_publisher_init(test_capture_output);
+
+    test_immediate();
+    test_leading_edge_window();
+    test_held_update_retransmission();
+    test_trailing_edge_window();
+
+    if (failures == 0)
+    {
+        printf("test_coalescing passed\n");
+    }
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,231 @@
+#include <cstdio>
+#include <cstring>
+#include "goose_dataset.hpp"
+
+extern "C" {
+#include "goose_auth.h"
+#include "goose_publisher.h"
+}
+
+// Typed C++ frames: compile-time layout, setters against the C encoder byte for byte,
+// the publisher re-encode after commit, signing and retransmissions between updates
+
+#define CHECK(cond) do { if (!(cond)) { printf("FAILED %s:%d: %s\n", __FILE__, __LINE__, #cond); failures++; } } while (0)
+
+static int failures = 0;
+
+using namespace iec61850;
+using Trip = GooseDataset<Bool, Int32, Float32, Quality>;
+using Wide = GooseDataset<UInt32, Float64, Timestamp, Bool>;
+
+static_assert(Trip::size == 3 + 6 + 7 + 5, "encoded allData size");
+static_assert(Trip::offset<0> == 2 && Trip::offset<1> == 5 && Trip::offset<2> == 12 && Trip::offset<3> == 19, "member offsets");
+static_assert(Wide::offset<0> == 3 && Wide::offset<1> == 10 && Wide::offset<2> == 20 && Wide::offset<3> == 30, "member offsets");
+static_assert(Trip::image()[16] == 0x84 && Trip::image()[18] == 3, "quality header and padding count");
+
+static const uint8_t source[MAC_ADDRESS_SIZE] = { 0x00, 0x30, 0xa7, 0x03, 0xc1, 0x53 };
+static const uint8_t destination[MAC_ADDRESS_SIZE] = GOOSE_MULTICAST_ADDRESS(0x00, 0x01);
+static const char* gocbref = "IED1/LLN0$GO$Trip";
+static const char* dataset = "IED1/LLN0$Trip";
+static const char* go_id = "Trip";
+
+template <typename Dataset>
+static void configure(GooseFrame<Dataset>& frame)
+{
+    frame.gocbref(gocbref).dataset(dataset).go_id(go_id).time_allowed_to_live(2000).conf_rev(1);
+    frame.encode();
+}
+
+// The same control block through the C API, members given as BER content
+static goose_handle* c_handle(const uint8_t* const* contents, const uint8_t* tags, const size_t* lengths, size_t count, uint32_t st_num, uint32_t sq_num)
+{
+    uint8_t source_bytes[MAC_ADDRESS_SIZE];
+    uint8_t destination_bytes[MAC_ADDRESS_SIZE];
+    uint8_t app_id[APP_ID_SIZE] = { 0x00, 0x01 };
+    memcpy(source_bytes, source, sizeof(source_bytes));
+    memcpy(destination_bytes, destination, sizeof(destination_bytes));
+
+    goose_handle* handle = goose_init(source_bytes, destination_bytes, app_id);
+    uint8_t time_allowed_to_live[2] = { 0x07, 0xd0 };
+    uint8_t conf_rev[4] = { 0, 0, 0, 1 };
+    uint32_t st_num_net = goose_htonl(st_num);
+    uint32_t sq_num_net = goose_htonl(sq_num);
+
+    ber_set(&(handle->frame->pdu_list.st_num), (uint8_t*)&st_num_net, sizeof(st_num_net));
+    ber_set(&(handle->frame->pdu_list.sq_num), (uint8_t*)&sq_num_net, sizeof(sq_num_net));
+    ber_set(&(handle->frame->pdu_list.gocbref), (uint8_t*)gocbref, strlen(gocbref));
+    ber_set(&(handle->frame->pdu_list.dataset), (uint8_t*)dataset, strlen(dataset));
+    ber_set(&(handle->frame->pdu_list.go_id), (uint8_t*)go_id, strlen(go_id));
+    ber_set(&(handle->frame->pdu_list.time_allowed_to_live), time_allowed_to_live, sizeof(time_allowed_to_live));
+    ber_set(&(handle->frame->pdu_list.conf_rev), conf_rev, sizeof(conf_rev));
+
+    for (size_t i = 0; i < count; i++)
+    {
+        goose_all_data_entry_add(handle, tags[i], lengths[i], (uint8_t*)contents[i]);
+    }
+    goose_encode(handle);
+    return handle;
+}
+
+static void test_trip(void)
+{
+    GooseFrame<Trip> frame(source, destination, 0x0001);
+    configure(frame);
+
+    frame.set<0>(true);
+    frame.set<1>(-42);
+    frame.set<2>(1.5f);
+    frame.set<3>(0x0040);
+    frame.st_num(7);
+    frame.sq_num(3);
+
+    CHECK(frame.get<0>() == true);
+    CHECK(frame.get<1>() == -42);
+    CHECK(frame.get<2>() == 1.5f);
+    CHECK(frame.get<3>() == 0x0040);
+    frame.commit();
+
+    uint8_t boolean[1] = { 1 };
+    uint8_t int32[4] = { 0xff, 0xff, 0xff, 0xd6 };
+    uint8_t float32[5] = { 0x08, 0x3f, 0xc0, 0x00, 0x00 };
+    uint8_t quality[3] = { 0x03, 0x00, 0x40 };
+    const uint8_t* contents[4] = { boolean, int32, float32, quality };
+    uint8_t tags[4] = { 0x83, 0x85, 0x87, 0x84 };
+    size_t lengths[4] = { 1, 4, 5, 3 };
+
+    goose_handle* expected = c_handle(contents, tags, lengths, 4, 7, 3);
+    CHECK(frame.size() == expected->length);
+    CHECK(memcmp(frame.bytes(), expected->byte_stream, expected->length) == 0);
+
+    // The patched frame is what a full encode of the same structures gives
+    goose_encode_full(frame.handle());
+    CHECK(memcmp(frame.bytes(), expected->byte_stream, expected->length) == 0);
+
+    goose_frame_view view;
+    CHECK(goose_decode(const_cast<uint8_t*>(frame.bytes()), frame.size(), &view) == 0);
+    CHECK(goose_decode_all_data(&view) == 4);
+    CHECK(goose_field_uint(&view.fields[TAG_ST_NUM - TAG_GOCBREF]) == 7);
+    CHECK(goose_field_uint(&view.fields[TAG_SQ_NUM - TAG_GOCBREF]) == 3);
+
+    goose_free(expected);
+}
+
+static void test_wide(void)
+{
+    GooseFrame<Wide> frame(source, destination, 0x0001);
+    configure(frame);
+
+    frame.set<0>(0x80000001u);
+    frame.set<1>(-0.25);
+    frame.set<2>(0x6553f1008000000aULL);
+    frame.set<3>(false);
+    frame.commit();
+
+    uint8_t uint32[5] = { 0x00, 0x80, 0x00, 0x00, 0x01 };
+    uint8_t float64[9] = { 0x0b, 0xbf, 0xd0, 0, 0, 0, 0, 0, 0 };
+    uint8_t utc[8] = { 0x65, 0x53, 0xf1, 0x00, 0x80, 0x00, 0x00, 0x0a };
+    uint8_t boolean[1] = { 0 };
+    const uint8_t* contents[4] = { uint32, float64, utc, boolean };
+    uint8_t tags[4] = { 0x86, 0x87, 0x91, 0x83 };
+    size_t lengths[4] = { 5, 9, 8, 1 };
+
+    goose_handle* expected = c_handle(contents, tags, lengths, 4, 0, 0);
+    CHECK(frame.size() == expected->length);
+    CHECK(memcmp(frame.bytes(), expected->byte_stream, expected->length) == 0);
+    CHECK(frame.get<0>() == 0x80000001u);
+    CHECK(frame.get<1>() == -0.25);
+    goose_free(expected);
+}
+
+static void test_signed(void)
+{
+    const uint8_t key[32] = { 1, 2, 3, 4, 5, 6, 7, 8 };
+    goose_auth_keyring* keyring = goose_auth_keyring_create();
+    goose_auth_key_set(keyring, 1, key, sizeof(key));
+
+    GooseFrame<Trip> frame(source, destination, 0x0001);
+    goose_auth_enable(frame.handle(), keyring);
+    configure(frame);
+    CHECK(goose_auth_verify(keyring, frame.bytes(), frame.size()) == 0);
+
+    // The frame bytes and their MAC only change on commit
+    frame.set<1>(1000);
+    CHECK(goose_auth_verify(keyring, frame.bytes(), frame.size()) == 0);
+    CHECK(memcmp(frame.bytes() + frame.handle()->field_offset[GOOSE_PDU_FIELD_COUNT - 1] + Trip::offset<1>, "\0\0\0\0", 4) == 0);
+    frame.commit();
+    CHECK(goose_auth_verify(keyring, frame.bytes(), frame.size()) == 0);
+    CHECK(memcmp(frame.bytes() + frame.handle()->field_offset[GOOSE_PDU_FIELD_COUNT - 1] + Trip::offset<1>, "\0\0\x03\xe8", 4) == 0);
+
+    goose_auth_keyring_free(keyring);
+}
+
+static uint32_t sent_st_num = 0;
+static int32_t sent_value = 0;
+static size_t sent_frames = 0;
+
+static void capture_output(uint8_t* byte_stream, size_t length)
+{
+    goose_frame_view view;
+    if (goose_decode(byte_stream, length, &view) == 0 && goose_decode_all_data(&view) == 4)
+    {
+        sent_st_num = goose_field_uint(&view.fields[TAG_ST_NUM - TAG_GOCBREF]);
+        sent_value = Int32::load(view.all_data_list.entries[1].value);
+    }
+    sent_frames++;
+}
+
+// A member set between two state changes is neither sent by the retransmissions in
+// between nor undone by them
+static void test_publisher_retransmission(void)
+{
+    const uint64_t ms = 1000000ULL;
+    uint64_t now = 1000 * ms;
+
+    GooseFrame<Trip> frame(source, destination, 0x0001);
+    configure(frame);
+
+    goose_publisher_init(capture_output);
+    goose_message_params message = {};
+    message.name = "trip";
+    message.handle = frame.handle();
+    message.default_time_allowed_to_live = 1000;
+    goose_publisher_register(message);
+
+    frame.set<1>(1);
+    goose_publisher_notify("trip");
+    goose_publisher_process_at(now);
+    CHECK(sent_st_num == 1);
+    CHECK(sent_value == 1);
+
+    frame.set<1>(2);
+    size_t before = sent_frames;
+    for (uint64_t t = 1; t <= 20; t++)
+    {
+        goose_publisher_process_at(now + t * ms);
+        CHECK(sent_st_num == 1);
+        CHECK(sent_value == 1);
+        CHECK(frame.get<1>() == 2);
+    }
+    CHECK(sent_frames > before);
+
+    goose_publisher_notify("trip");
+    goose_publisher_process_at(now + 21 * ms);
+    CHECK(sent_st_num == 2);
+    CHECK(sent_value == 2);
+
+    goose_publisher_deregister("trip");
+}
+
+int main(void)
+{
+    test_trip();
+    test_wide();
+    test_signed();
+    test_publisher_retransmission();
+
+    if (failures == 0)
+    {
+        printf("test_dataset passed\n");
+    }
+    return failures == 0 ? 0 : 1;
+}
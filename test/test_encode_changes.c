@@ -0,0 +1,341 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include "goose.h"
+#include "goose_auth.h"
+#include "ber.h"
+
+// Differential encode: two handles take the same random edits, one is encoded with
+// goose_encode, which rewrites only what changed, the other with goose_encode_full.
+// Their frames and field offsets must stay byte for byte the same. The test target links
+// iec61850_large so the datasets grow past 100 members.
+
+#define CHECK(cond) do { if (!(cond)) { printf("FAILED %s:%d: %s\n", __FILE__, __LINE__, #cond); failures++; } } while (0)
+
+#define ROUNDS 20000
+
+// Most a round's edits can grow the frame by: three edits, each at most a 199 byte
+// member with its 3 byte header
+#define MAX_ROUND_GROWTH (3 * 202)
+
+static int failures = 0;
+static uint64_t state = 0x2545f4914f6cdd1dULL;
+
+static uint32_t next_random(void)
+{
+    state ^= state << 13;
+    state ^= state >> 7;
+    state ^= state << 17;
+    return (uint32_t)(state >> 16);
+}
+
+static uint32_t random_below(uint32_t n)
+{
+    return next_random() % n;
+}
+
+static void random_bytes(uint8_t* bytes, size_t length)
+{
+    for (size_t i = 0; i < length; i++)
+    {
+        bytes[i] = (uint8_t)next_random();
+    }
+}
+
+// A member of a random type, variable width ones up to a size that needs a long form length
+static size_t random_member(uint8_t* tag, uint8_t* value)
+{
+    static const uint8_t tags[] = { 0x83, 0x84, 0x85, 0x87, 0x8a, 0x91, 0xa2 };
+    size_t length;
+
+    *tag = tags[random_below(sizeof(tags))];
+    switch (*tag)
+    {
+    case 0x83: length = 1; break;
+    case 0x85: length = 1 + random_below(4); break;
+    case 0x87: length = 5; break;
+    case 0x91: length = 8; break;
+    case 0x84: length = 2 + random_below(4); break;
+    default: length = random_below(32) == 0 ? 100 + random_below(100) : random_below(12); break;
+    }
+    random_bytes(value, length);
+    return length;
+}
+
+static goose_handle* handles[2];
+
+static void both_member_add(void)
+{
+    uint8_t tag;
+    uint8_t value[256];
+    size_t length = random_member(&tag, value);
+    for (int h = 0; h < 2; h++)
+    {
+        goose_all_data_entry_add(handles[h], tag, length, value);
+    }
+}
+
+static void both_member_modify(size_t index)
+{
+    uint8_t tag;
+    uint8_t value[256];
+    size_t length = random_member(&tag, value);
+    for (int h = 0; h < 2; h++)
+    {
+        goose_all_data_entry_modify(handles[h], index, tag, length, value);
+    }
+}
+
+// Same tag and length, as the C++ layer writes values back into the entries
+static void both_member_overwrite(size_t index)
+{
+    ber* entry = &handles[0]->frame->pdu_list.all_data_list.entries[index];
+    uint8_t value[256];
+    random_bytes(value, entry->length);
+    for (int h = 0; h < 2; h++)
+    {
+        if (entry->length)
+        {
+            memcpy(handles[h]->frame->pdu_list.all_data_list.entries[index].value, value, entry->length);
+        }
+    }
+}
+
+static void both_field_set(size_t field, size_t length)
+{
+    uint8_t value[256];
+    random_bytes(value, length);
+    for (int h = 0; h < 2; h++)
+    {
+        ber* fields = (ber*)&(handles[h]->frame->pdu_list);
+        ber_set(&fields[field], value, length);
+    }
+}
+
+static void mutate(const goose_auth_keyring* keyring)
+{
+    size_t count = handles[0]->frame->pdu_list.all_data_list.entry_count;
+    uint32_t choice = random_below(100);
+
+    if (choice < 30 && count)
+    {
+        both_member_overwrite(random_below((uint32_t)count));
+    }
+    else if (choice < 55 && count)
+    {
+        both_member_modify(random_below((uint32_t)count));
+    }
+    else if (choice < 70)
+    {
+        // stNum or sqNum, growing and shrinking as counters wrap
+        both_field_set(TAG_ST_NUM - TAG_GOCBREF + random_below(2), 1 + random_below(4));
+    }
+    else if (choice < 75)
+    {
+        both_field_set(TAG_T - TAG_GOCBREF, IEC_TIME_UTC_SIZE);
+    }
+    else if (choice < 80)
+    {
+        static const size_t strings[] = { TAG_GOCBREF - TAG_GOCBREF, TAG_DATASET - TAG_GOCBREF, TAG_GO_ID - TAG_GOCBREF };
+        both_field_set(strings[random_below(3)], random_below(8) == 0 ? 100 + random_below(60) : random_below(40));
+    }
+    else if (choice < 84)
+    {
+        uint8_t app_id = (uint8_t)next_random();
+        for (int h = 0; h < 2; h++)
+        {
+            handles[h]->frame->app_id[1] = app_id;
+            handles[h]->frame->destination[5] = app_id;
+        }
+    }
+    else if (choice < 88 && count < MAX_NUM_DATASET_ENTRIES)
+    {
+        both_member_add();
+    }
+    else if (choice < 91 && count > 1)
+    {
+        size_t index = random_below((uint32_t)count);
+        for (int h = 0; h < 2; h++)
+        {
+            goose_all_data_entry_remove(handles[h], index);
+        }
+    }
+    else if (choice < 95)
+    {
+        uint8_t priority = (uint8_t)random_below(8);
+        uint16_t vlan_id = (uint16_t)random_below(VLAN_MAX_ID + 1);
+        int clear = random_below(3) == 0;
+        for (int h = 0; h < 2; h++)
+        {
+            if (clear)
+            {
+                goose_vlan_clear(handles[h]);
+            }
+            else
+            {
+                goose_vlan_set(handles[h], priority, vlan_id);
+            }
+        }
+    }
+    else if (choice < 97)
+    {
+        const goose_auth_keyring* signing = handles[0]->keyring ? NULL : keyring;
+        for (int h = 0; h < 2; h++)
+        {
+            goose_auth_enable(handles[h], signing);
+        }
+    }
+    else
+    {
+        uint8_t t[IEC_TIME_UTC_SIZE];
+        random_bytes(t, sizeof(t));
+        for (int h = 0; h < 2; h++)
+        {
+            goose_t_set(handles[h], t);
+        }
+    }
+}
+
+// Header sizes of the goosePdu and allData TLVs in the last encoded frame
+static void enclosing_headers(const goose_handle* handle, size_t sizes[2])
+{
+    const goose_layout* layout = &(handle->layout);
+    size_t all_data = GOOSE_PDU_FIELD_COUNT - 1;
+    uint8_t tag;
+    size_t length;
+
+    sizes[0] = ber_decode_header((uint8_t*)&handle->byte_stream[layout->pdu_offset], handle->length - layout->pdu_offset, &tag, &length);
+    sizes[1] = ber_encode_header(NULL, TAG_ALL_DATA, layout->field_length[all_data]);
+}
+
+// Whether goose_encode_changes can take this frame as encoded last time
+static int same_shape(const goose_handle* handle)
+{
+    const goose_layout* layout = &(handle->layout);
+    return layout->valid && handle->length && layout->vlan_tagged == handle->frame->vlan_tagged
+        && layout->member_count == handle->frame->pdu_list.all_data_list.entry_count;
+}
+
+static void test_fuzz(void)
+{
+    uint8_t source[MAC_ADDRESS_SIZE] = { 0x00, 0x30, 0xa7, 0x03, 0xc1, 0x53 };
+    uint8_t destination[MAC_ADDRESS_SIZE] = GOOSE_MULTICAST_ADDRESS(0x00, 0x01);
+    uint8_t app_id[APP_ID_SIZE] = { 0x00, 0x01 };
+    const uint8_t key[32] = { 7, 6, 5, 4, 3, 2, 1 };
+    goose_auth_keyring* keyring = goose_auth_keyring_create();
+    goose_auth_key_set(keyring, 1, key, sizeof(key));
+
+    for (int h = 0; h < 2; h++)
+    {
+        handles[h] = goose_init(source, destination, app_id);
+    }
+    both_field_set(TAG_GOCBREF - TAG_GOCBREF, 20);
+    both_field_set(TAG_TIME_ALLOWED_TO_LIVE - TAG_GOCBREF, 2);
+    both_field_set(TAG_ST_NUM - TAG_GOCBREF, 4);
+    both_field_set(TAG_SQ_NUM - TAG_GOCBREF, 4);
+    both_field_set(TAG_CONF_REV - TAG_GOCBREF, 1);
+    for (size_t i = 0; i < MAX_NUM_DATASET_ENTRIES / 2; i++)
+    {
+        both_member_add();
+    }
+
+    size_t sent = 0;
+    size_t patched = 0;
+    size_t largest = 0;
+    for (int round = 0; round < ROUNDS; round++)
+    {
+        for (uint32_t edits = 1 + random_below(3); edits > 0; edits--)
+        {
+            mutate(keyring);
+        }
+
+        // goose_encode, with the patch path told apart from the full encode it falls back to
+        int patchable = same_shape(handles[0]);
+        size_t before[2];
+        size_t before_length = handles[0]->length;
+        if (patchable)
+        {
+            enclosing_headers(handles[0], before);
+        }
+        int patch = goose_encode_changes(handles[0]) == 0;
+        if (!patch)
+        {
+            goose_encode_full(handles[0]);
+        }
+        goose_encode_full(handles[1]);
+
+        // A frame of the same shape only falls back when the goosePdu or allData length
+        // changed form, or when the edits may have run past the end of byte_stream
+        if (patchable && !patch && handles[0]->length && handles[0]->layout.valid)
+        {
+            size_t after[2];
+            enclosing_headers(handles[0], after);
+            CHECK(before[0] != after[0] || before[1] != after[1] || before_length + MAX_ROUND_GROWTH > sizeof(handles[0]->byte_stream));
+        }
+        patched += patch;
+        if (handles[0]->frame->pdu_list.all_data_list.entry_count > largest)
+        {
+            largest = handles[0]->frame->pdu_list.all_data_list.entry_count;
+        }
+
+        CHECK(handles[0]->length == handles[1]->length);
+        CHECK(memcmp(handles[0]->byte_stream, handles[1]->byte_stream, handles[1]->length) == 0);
+        CHECK(!handles[1]->length || memcmp(handles[0]->field_offset, handles[1]->field_offset, sizeof(handles[1]->field_offset)) == 0);
+        if (failures)
+        {
+            printf("round %d\n", round);
+            break;
+        }
+        sent += handles[0]->length != 0;
+    }
+    CHECK(sent > ROUNDS / 2);
+    CHECK(patched > ROUNDS / 2);
+    CHECK(MAX_NUM_DATASET_ENTRIES < 128 || largest > 100);
+
+    goose_free(handles[0]);
+    goose_free(handles[1]);
+    goose_auth_keyring_free(keyring);
+}
+
+// A change of member size moves the tail and fixes the enclosing lengths
+static void test_resize(void)
+{
+    uint8_t source[MAC_ADDRESS_SIZE] = { 0x00, 0x30, 0xa7, 0x03, 0xc1, 0x53 };
+    uint8_t destination[MAC_ADDRESS_SIZE] = GOOSE_MULTICAST_ADDRESS(0x00, 0x01);
+    uint8_t app_id[APP_ID_SIZE] = { 0x00, 0x01 };
+    uint8_t short_string[3] = { 'o', 'f', 'f' };
+    uint8_t long_string[9] = { 'o', 'p', 'e', 'n', 'i', 'n', 'g', ' ', '1' };
+    uint8_t boolean = 1;
+
+    goose_handle* handle = goose_init(source, destination, app_id);
+    goose_all_data_entry_add(handle, 0x8a, sizeof(short_string), short_string);
+    goose_all_data_entry_add(handle, 0x83, sizeof(boolean), &boolean);
+    goose_encode(handle);
+    size_t length = handle->length;
+
+    goose_all_data_entry_modify(handle, 0, 0x8a, sizeof(long_string), long_string);
+    goose_encode(handle);
+    CHECK(handle->length == length + sizeof(long_string) - sizeof(short_string));
+
+    goose_frame_view view;
+    CHECK(goose_decode(handle->byte_stream, handle->length, &view) == 0);
+    CHECK(goose_decode_all_data(&view) == 2);
+    CHECK(view.len == handle->length - MAC_ADDRESS_SIZE * 2 - ETHERTYPE_SIZE);
+    CHECK(view.all_data_list.entries[0].length == sizeof(long_string));
+    CHECK(memcmp(view.all_data_list.entries[0].value, long_string, sizeof(long_string)) == 0);
+    CHECK(view.all_data_list.entries[1].tag == 0x83 && view.all_data_list.entries[1].value[0] == 1);
+
+    goose_free(handle);
+}
+
+int main(void)
+{
+    test_resize();
+    test_fuzz();
+
+    if (failures == 0)
+    {
+        printf("test_encode_changes passed\n");
+    }
+    return failures == 0 ? 0 : 1;
+}
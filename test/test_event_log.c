@@ -0,0 +1,583 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <dirent.h>
+#include <pthread.h>
+#include <sched.h>
+#include <signal.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "goose.h"
+#include "goose_event_log.h"
+#include "goose_publisher.h"
+#include "goose_subscriber.h"
+#include "iec_time.h"
+#include "test_util.h"
+
+// Event log: value decoding, changed bitmaps including unlogged members, rotation, time
+// and stream filtered queries, ring overflow, segments that do not fit, numbering across
+// writers, the subscriber callback and a producer thread racing the drain. Segments are
+// written under the directory given on the command line.
+
+#define CHECK(cond) do { if (!(cond)) { printf("FAILED %s:%d: %s\n", __FILE__, __LINE__, #cond); failures++; } } while (0)
+
+#define MS 1000000ULL
+#define BASE_NS 1700000000000000000ULL
+#define EVENTS 10000
+#define STREAM_A 7
+#define STREAM_B 9
+
+static int failures = 0;
+static const char* directory = "event_log";
+
+static goose_event_log* open_log(const char* prefix, size_t queue_size)
+{
+    goose_event_log_params params = { directory, prefix, 2 * 1024 * 1024, queue_size };
+    return goose_event_log_open(&params);
+}
+
+static void remove_segments(void)
+{
+    DIR* dir = opendir(directory);
+    struct dirent* entry;
+    char path[1024];
+
+    while (dir && (entry = readdir(dir)) != NULL)
+    {
+        if (strstr(entry->d_name, GOOSE_EVENT_LOG_SUFFIX))
+        {
+            snprintf(path, sizeof(path), "%s/%s", directory, entry->d_name);
+            unlink(path);
+        }
+    }
+    if (dir)
+    {
+        closedir(dir);
+    }
+}
+
+static void test_values(void)
+{
+    uint8_t boolean = 1;
+    uint8_t negative = 0xfb;
+    uint8_t unsigned_value[5] = { 0x00, 0x80, 0x00, 0x00, 0x01 };
+    uint8_t single[5] = { 0x08, 0x3f, 0xc0, 0x00, 0x00 };	// 1.5
+    uint8_t quality[3] = { 0x03, 0x00, 0x40 };
+    uint8_t utc[8] = { 0x65, 0x53, 0xf1, 0x00, 0x80, 0x00, 0x00, 0x0a };
+
+    ber entry = { 0x83, sizeof(boolean), &boolean };
+    CHECK(goose_event_log_value(&entry) == 1);
+    entry = (ber){ 0x85, sizeof(negative), &negative };
+    CHECK((int64_t)goose_event_log_value(&entry) == -5);
+    entry = (ber){ 0x86, sizeof(unsigned_value), unsigned_value };
+    CHECK(goose_event_log_value(&entry) == 0x80000001ULL);
+    entry = (ber){ 0x87, sizeof(single), single };
+    CHECK(goose_event_log_float(goose_event_log_value(&entry)) == 1.5);
+    entry = (ber){ 0x84, sizeof(quality), quality };
+    CHECK(goose_event_log_value(&entry) == 0x0040);
+    entry = (ber){ 0x91, sizeof(utc), utc };
+    CHECK(goose_event_log_value(&entry) == 0x6553f1008000000aULL);
+}
+
+static goose_handle* make_handle(uint8_t app_id_low, size_t members)
+{
+    uint8_t zero[5] = { 0 };
+
+    goose_handle* handle = test_make_handle(app_id_low, app_id_low, "IED1/LLN0$GO$Events", 0);
+    ber_set(&(handle->frame->pdu_list.conf_rev), zero, 1);
+
+    goose_all_data_entry_add(handle, 0x85, 4, zero);
+    if (members > 1)
+    {
+        goose_all_data_entry_add(handle, 0x83, 1, zero);
+        goose_all_data_entry_add(handle, 0x87, 5, zero);
+    }
+    return handle;
+}
+
+// Stream A event k: member 0 is k, member 1 flips every 2nd event, member 2 steps every 4th
+static uint64_t expected_changed(uint32_t k)
+{
+    if (k == 0)
+    {
+        return 0x7;
+    }
+    return 0x1 | ((uint64_t)((k / 2) % 2 != ((k - 1) / 2) % 2) << 1) | ((uint64_t)(k / 4 != (k - 1) / 4) << 2);
+}
+
+static void set_event(goose_handle* handle, uint32_t k, int with_members, uint64_t t_ns)
+{
+    uint32_t st_num = goose_htonl(k + 1);
+    uint32_t value = goose_htonl(k);
+
+    ber_set(&(handle->frame->pdu_list.st_num), (uint8_t*)&st_num, sizeof(st_num));
+    goose_all_data_entry_modify(handle, 0, 0x85, sizeof(value), (uint8_t*)&value);
+
+    if (with_members)
+    {
+        uint8_t boolean = (uint8_t)((k / 2) % 2);
+        float step = (float)(k / 4);
+        uint32_t bits;
+        uint8_t single[5] = { 0x08 };
+        memcpy(&bits, &step, sizeof(bits));
+        bits = goose_htonl(bits);
+        memcpy(single + 1, &bits, sizeof(bits));
+        goose_all_data_entry_modify(handle, 1, 0x83, 1, &boolean);
+        goose_all_data_entry_modify(handle, 2, 0x87, sizeof(single), single);
+
+        iec_time time = { (uint32_t)(t_ns / 1000000000ULL), (uint32_t)(t_ns % 1000000000ULL) };
+        uint8_t t[IEC_TIME_UTC_SIZE];
+        iec_time_encode(&time, 0x0a, t);
+        ber_set(&(handle->frame->pdu_list.t), t, sizeof(t));
+    }
+    goose_encode(handle);
+}
+
+typedef struct
+{
+    size_t visited;
+    size_t stop_after;
+    uint32_t last_st_num[2];
+    int ordered;
+} visit_state;
+
+static int check_record(const goose_event_log_segment* segment, size_t record, void* context)
+{
+    visit_state* state = (visit_state*)context;
+    uint32_t stream_id = segment->stream_id[record];
+    uint32_t k = segment->st_num[record] - 1;
+    uint64_t expected_ns = BASE_NS + (uint64_t)(2 * k + (stream_id == STREAM_B)) * MS;
+
+    int index = stream_id == STREAM_B;
+    if (segment->st_num[record] <= state->last_st_num[index])
+    {
+        state->ordered = 0;
+    }
+    state->last_st_num[index] = segment->st_num[record];
+
+    CHECK((int64_t)segment->values[0][record] == (int64_t)k);
+    CHECK(segment->tags[0][record] == 0x85);
+
+    if (stream_id == STREAM_A)
+    {
+        // UtcTime keeps 24 bits of fraction
+        uint64_t time_ns = segment->time_ns[record];
+        CHECK(time_ns + 100 > expected_ns && time_ns < expected_ns + 100);
+        CHECK(segment->quality[record] == 0x0a);
+        CHECK(segment->member_count[record] == 3);
+        CHECK(segment->changed[record] == expected_changed(k));
+        CHECK(segment->values[1][record] == (k / 2) % 2);
+        CHECK(goose_event_log_float(segment->values[2][record]) == (double)(k / 4));
+    }
+    else
+    {
+        CHECK(stream_id == STREAM_B);
+        CHECK(segment->time_ns[record] == expected_ns);
+        CHECK(segment->quality[record] == GOOSE_EVENT_LOG_RECEIVE_TIME);
+        CHECK(segment->member_count[record] == 1);
+        CHECK(segment->changed[record] == 0x1);
+        CHECK(segment->values[1][record] == 0);
+    }
+
+    state->visited++;
+    return state->stop_after && state->visited == state->stop_after;
+}
+
+static int64_t query(uint64_t from_ns, uint64_t to_ns, const uint32_t* streams, size_t stream_count, visit_state* state)
+{
+    goose_event_log_filter filter = { from_ns, to_ns, streams, stream_count };
+    memset(state, 0x0, sizeof(*state));
+    state->ordered = 1;
+    return goose_event_log_query(directory, "log", &filter, check_record, state);
+}
+
+static void test_log(void)
+{
+    goose_handle* a = make_handle(0x01, 3);
+    goose_handle* b = make_handle(0x02, 1);
+    goose_frame_view view;
+    goose_event_log_stream stream_a;
+    goose_event_log_stream stream_b;
+
+    goose_event_log* log = open_log("log", 1 << 14);
+    CHECK(log != NULL);
+    if (!log)
+    {
+        return;
+    }
+    goose_event_log_stream_init(&stream_a, log, STREAM_A);
+    goose_event_log_stream_init(&stream_b, log, STREAM_B);
+
+    // Events alternate between the streams, 1 ms apart
+    int appended = 0;
+    for (uint32_t i = 0; i < EVENTS; i++)
+    {
+        int is_b = i % 2;
+        goose_handle* handle = is_b ? b : a;
+        uint64_t time_ns = BASE_NS + i * MS;
+
+        set_event(handle, i / 2, !is_b, time_ns);
+        if (goose_decode(handle->byte_stream, handle->length, &view) != 0 || goose_decode_all_data(&view) < 0)
+        {
+            CHECK(0);
+            continue;
+        }
+        appended += goose_event_log_append(is_b ? &stream_b : &stream_a, &view, time_ns) == 0;
+    }
+    CHECK(appended == EVENTS);
+
+    CHECK(goose_event_log_drain(log) == EVENTS);
+    CHECK(goose_event_log_drain(log) == 0);
+    CHECK(goose_event_log_dropped(log) == 0);
+    CHECK(goose_event_log_segments(log) == 2);	// 8,192 records to a segment
+
+    // The open segment is readable before the writer is done
+    goose_event_log_segment segment;
+    char path[1024];
+    snprintf(path, sizeof(path), "%s/log-00000001%s", directory, GOOSE_EVENT_LOG_SUFFIX);
+    CHECK(goose_event_log_segment_open(&segment, path) == 0);
+    CHECK(segment.count == EVENTS - segment.header->capacity);
+    CHECK(segment.header->sequence == 1);
+    goose_event_log_segment_close(&segment);
+
+    goose_event_log_close(log);
+
+    visit_state state;
+    CHECK(query(0, UINT64_MAX, NULL, 0, &state) == EVENTS);
+    CHECK(state.visited == EVENTS && state.ordered);
+
+    // Second 1 with UtcTime rounding slack at both ends
+    uint64_t from_ns = BASE_NS + 1000 * MS - 100000;
+    uint64_t to_ns = BASE_NS + 2000 * MS - 100000;
+    CHECK(query(from_ns, to_ns, NULL, 0, &state) == 1000);
+
+    uint32_t only_b = STREAM_B;
+    CHECK(query(from_ns, to_ns, &only_b, 1, &state) == 500);
+    CHECK(state.last_st_num[1] == 1000 && state.last_st_num[0] == 0);
+
+    uint32_t unknown = 3;
+    CHECK(query(0, UINT64_MAX, &unknown, 1, &state) == 0);
+    CHECK(query(BASE_NS + EVENTS * MS, UINT64_MAX, NULL, 0, &state) == 0);
+
+    // Spans the segment boundary, stops early
+    memset(&state, 0x0, sizeof(state));
+    state.stop_after = 10;
+    goose_event_log_filter filter = { BASE_NS + 8190 * MS, UINT64_MAX, NULL, 0 };
+    CHECK(goose_event_log_query(directory, "log", &filter, check_record, &state) == 10);
+
+    // A second writer carries on with the numbering
+    log = open_log("log", 16);
+    CHECK(log != NULL);
+    if (log)
+    {
+        goose_event_log_stream_init(&stream_b, log, STREAM_B);
+        set_event(b, EVENTS / 2, 0, 0);
+        goose_decode(b->byte_stream, b->length, &view);
+        goose_decode_all_data(&view);
+        goose_event_log_append(&stream_b, &view, BASE_NS + (EVENTS + 1) * MS);
+        goose_event_log_close(log);
+    }
+    snprintf(path, sizeof(path), "%s/log-00000002%s", directory, GOOSE_EVENT_LOG_SUFFIX);
+    CHECK(goose_event_log_segment_open(&segment, path) == 0);
+    CHECK(segment.count == 1 && segment.stream_id[0] == STREAM_B);
+    goose_event_log_segment_close(&segment);
+    CHECK(query(0, UINT64_MAX, NULL, 0, &state) == EVENTS + 1);
+
+    // Segments are read under the name they were listed by, whatever the padding
+    char renamed[1024];
+    snprintf(renamed, sizeof(renamed), "%s/log-2%s", directory, GOOSE_EVENT_LOG_SUFFIX);
+    CHECK(rename(path, renamed) == 0);
+    CHECK(query(0, UINT64_MAX, NULL, 0, &state) == EVENTS + 1);
+
+    goose_free(a);
+    goose_free(b);
+}
+
+static void test_overflow(void)
+{
+    goose_event_log_event event;
+    memset(&event, 0x0, sizeof(event));
+
+    goose_event_log* log = open_log("overflow", 4);
+    CHECK(log != NULL);
+    if (!log)
+    {
+        return;
+    }
+
+    int accepted = 0;
+    for (int i = 0; i < 6; i++)
+    {
+        accepted += goose_event_log_push(log, &event) == 0;
+    }
+    CHECK(accepted == 4);
+    CHECK(goose_event_log_dropped(log) == 2);
+    CHECK(goose_event_log_drain(log) == 4);
+    CHECK(goose_event_log_push(log, &event) == 0);
+    goose_event_log_close(log);
+
+    goose_event_log_params bad = { directory, "bad", 4096, 6 };
+    CHECK(goose_event_log_open(&bad) == NULL);
+
+    // Not a segment
+    char path[1024];
+    goose_event_log_segment segment;
+    snprintf(path, sizeof(path), "%s/junk-00000000%s", directory, GOOSE_EVENT_LOG_SUFFIX);
+    FILE* file = fopen(path, "wb");
+    if (file)
+    {
+        fputs("not a segment", file);
+        fclose(file);
+    }
+    CHECK(goose_event_log_segment_open(&segment, path) == -1);
+}
+
+// A segment the file system cannot hold, here for a file size limit, is not created and
+// what was queued is counted as dropped; once there is room again logging resumes
+static void test_no_space(void)
+{
+    goose_event_log_event event;
+    memset(&event, 0x0, sizeof(event));
+
+    goose_event_log* log = open_log("full", 8);
+    CHECK(log != NULL);
+    if (!log)
+    {
+        return;
+    }
+
+    struct rlimit limit;
+    getrlimit(RLIMIT_FSIZE, &limit);
+    struct rlimit small = { 64 * 1024, limit.rlim_max };
+    signal(SIGXFSZ, SIG_IGN);
+    CHECK(setrlimit(RLIMIT_FSIZE, &small) == 0);
+
+    for (int i = 0; i < 3; i++)
+    {
+        CHECK(goose_event_log_push(log, &event) == 0);
+    }
+    CHECK(goose_event_log_drain(log) == 0);
+    CHECK(goose_event_log_dropped(log) == 3);
+    CHECK(goose_event_log_segments(log) == 0);
+
+    char path[1024];
+    struct stat st;
+    snprintf(path, sizeof(path), "%s/full-00000000%s", directory, GOOSE_EVENT_LOG_SUFFIX);
+    CHECK(stat(path, &st) != 0);
+
+    setrlimit(RLIMIT_FSIZE, &limit);
+    signal(SIGXFSZ, SIG_DFL);
+    CHECK(goose_event_log_push(log, &event) == 0);
+    CHECK(goose_event_log_drain(log) == 1);
+    CHECK(goose_event_log_segments(log) == 1);
+    CHECK(goose_event_log_dropped(log) == 3);
+    goose_event_log_close(log);
+}
+
+// Members past the value columns, only possible when a dataset may have more of them
+static void test_unlogged(void)
+{
+#if MAX_NUM_DATASET_ENTRIES > GOOSE_EVENT_LOG_MEMBERS
+    goose_event_log* log = open_log("unlogged", 8);
+    goose_handle* handle = make_handle(0x0b, 1);
+    uint32_t zero = 0;
+    CHECK(log != NULL);
+    if (!log)
+    {
+        goose_free(handle);
+        return;
+    }
+
+    for (size_t i = 1; i < GOOSE_EVENT_LOG_MEMBERS + 2; i++)
+    {
+        goose_all_data_entry_add(handle, 0x85, sizeof(zero), (uint8_t*)&zero);
+    }
+
+    goose_event_log_stream stream;
+    goose_event_log_stream_init(&stream, log, 1);
+    static const size_t changes[] = { 0, GOOSE_EVENT_LOG_MEMBERS + 1, 1 };
+    for (size_t i = 0; i < sizeof(changes) / sizeof(changes[0]); i++)
+    {
+        uint32_t value = goose_htonl((uint32_t)i + 1);
+        goose_frame_view view;
+        if (i > 0)
+        {
+            goose_all_data_entry_modify(handle, changes[i], 0x85, sizeof(value), (uint8_t*)&value);
+        }
+        goose_encode(handle);
+        CHECK(goose_decode(handle->byte_stream, handle->length, &view) == 0);
+        CHECK(goose_decode_all_data(&view) == GOOSE_EVENT_LOG_MEMBERS + 2);
+        CHECK(goose_event_log_append(&stream, &view, BASE_NS) == 0);
+    }
+    CHECK(goose_event_log_drain(log) == 3);
+    goose_event_log_close(log);
+
+    goose_event_log_segment segment;
+    char path[1024];
+    snprintf(path, sizeof(path), "%s/unlogged-00000000%s", directory, GOOSE_EVENT_LOG_SUFFIX);
+    CHECK(goose_event_log_segment_open(&segment, path) == 0);
+    CHECK(segment.count == 3);
+    if (segment.count == 3)
+    {
+        CHECK(segment.changed[0] == (((1ULL << GOOSE_EVENT_LOG_MEMBERS) - 1) | GOOSE_EVENT_LOG_UNLOGGED));
+        CHECK(segment.changed[1] == GOOSE_EVENT_LOG_UNLOGGED);
+        CHECK(segment.changed[2] == 0x2);
+        CHECK(segment.member_count[2] == GOOSE_EVENT_LOG_MEMBERS);
+    }
+    goose_event_log_segment_close(&segment);
+    goose_free(handle);
+#endif
+}
+
+static void tick(size_t count)
+{
+    for (size_t i = 0; i < count; i++)
+    {
+        goose_publisher_process();
+        goose_subscriber_process();
+    }
+}
+
+static void test_subscriber(void)
+{
+    goose_handle* handle = make_handle(0x03, 3);
+    goose_event_log_stream stream;
+
+    goose_event_log* log = open_log("subscriber", 64);
+    CHECK(log != NULL);
+    if (!log)
+    {
+        goose_free(handle);
+        return;
+    }
+    goose_event_log_stream_init(&stream, log, 1);
+
+    goose_publisher_init(goose_subscriber_input);
+    goose_subscriber_init();
+
+    goose_subscription_params subscription = { 0 };
+    subscription.name = "sub";
+    subscription.gocbref = "IED1/LLN0$GO$Events";
+    subscription.app_id = 0x0003;
+    subscription.callback = goose_event_log_callback;
+    subscription.context = &stream;
+    goose_subscriber_register(subscription);
+
+    goose_message_params message = { 0 };
+    message.name = "pub";
+    message.handle = handle;
+    message.default_time_allowed_to_live = 100;
+    message.updated = 1;
+    goose_publisher_register(message);
+
+    tick(200);
+    uint8_t one = 1;
+    goose_all_data_entry_modify(handle, 1, 0x83, sizeof(one), &one);
+    goose_publisher_notify("pub");
+    tick(200);
+    goose_publisher_deregister("pub");
+    goose_subscriber_deregister("sub");
+
+    CHECK(goose_event_log_drain(log) == 2);
+    goose_event_log_close(log);
+
+    char path[1024];
+    goose_event_log_segment segment;
+    snprintf(path, sizeof(path), "%s/subscriber-00000000%s", directory, GOOSE_EVENT_LOG_SUFFIX);
+    CHECK(goose_event_log_segment_open(&segment, path) == 0);
+    CHECK(segment.count == 2);
+    if (segment.count == 2)
+    {
+        CHECK(segment.st_num[1] == segment.st_num[0] + 1);
+        CHECK(segment.changed[0] == 0x7 && segment.changed[1] == 0x2);
+        CHECK(segment.values[1][0] == 0 && segment.values[1][1] == 1);
+    }
+    goose_event_log_segment_close(&segment);
+
+    goose_free(handle);
+}
+
+#define RACE_EVENTS 20000
+
+static void* race_producer(void* arg)
+{
+    goose_event_log* log = (goose_event_log*)arg;
+    goose_event_log_event event;
+    memset(&event, 0x0, sizeof(event));
+
+    for (uint32_t i = 0; i < RACE_EVENTS; i++)
+    {
+        event.st_num = i;
+        event.time_ns = BASE_NS + i;
+        if (goose_event_log_push(log, &event) != 0)
+        {
+            sched_yield();
+        }
+    }
+    return NULL;
+}
+
+static int check_race(const goose_event_log_segment* segment, size_t record, void* context)
+{
+    int64_t* last = (int64_t*)context;
+    if ((int64_t)segment->st_num[record] <= *last)
+    {
+        failures++;
+    }
+    *last = segment->st_num[record];
+    return 0;
+}
+
+// Receive thread against drain thread: whatever was not dropped lands once, in order
+static void test_race(void)
+{
+    goose_event_log* log = open_log("race", 256);
+    CHECK(log != NULL);
+    if (!log)
+    {
+        return;
+    }
+
+    pthread_t producer;
+    pthread_create(&producer, NULL, race_producer, log);
+
+    size_t drained = 0;
+    while (drained + goose_event_log_dropped(log) < RACE_EVENTS)
+    {
+        drained += goose_event_log_drain(log);
+    }
+    pthread_join(producer, NULL);
+    drained += goose_event_log_drain(log);
+    CHECK(drained + goose_event_log_dropped(log) == RACE_EVENTS);
+    goose_event_log_close(log);
+
+    int64_t last = -1;
+    goose_event_log_filter filter = { 0, UINT64_MAX, NULL, 0 };
+    CHECK(goose_event_log_query(directory, "race", &filter, check_race, &last) == (int64_t)drained);
+}
+
+int main(int argc, char** argv)
+{
+    if (argc > 1)
+    {
+        directory = argv[1];
+    }
+    mkdir(directory, 0755);
+    remove_segments();
+
+    test_values();
+    test_log();
+    test_overflow();
+    test_no_space();
+    test_unlogged();
+    test_subscriber();
+    test_race();
+
+    if (failures == 0)
+    {
+        printf("test_event_log passed\n");
+    }
+    return failures == 0 ? 0 : 1;
+}
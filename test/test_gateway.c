@@ -0,0 +1,365 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include "goose.h"
+#include "goose_auth.h"
+#include "goose_gateway.h"
+#include "goose_pcap.h"
+#include "goose_subscriber.h"
+#include "test_util.h"
+
+// Gateway: header rewrites in place, tagging and untagging through the headroom, source
+// and APPID-only rules, verify, re-stamp and re-sign, stale extensions stripped, drops that
+// leave the frame as it was, and a capture forwarded in place into the subscriber.
+
+#define CHECK(cond) do { if (!(cond)) { printf("FAILED %s:%d: %s\n", __FILE__, __LINE__, #cond); failures++; } } while (0)
+
+#define HEADROOM 64
+#define SLOT_SIZE 1600
+
+static int failures = 0;
+static uint8_t slots[8][SLOT_SIZE];
+static const uint8_t old_t[IEC_TIME_UTC_SIZE] = { 0x50, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x0a };
+static const uint8_t key[32] = { 0x0b, 0x0b, 0x0b, 0x0b };
+
+static goose_handle* make_handle(uint8_t app_id_low, uint8_t source_low, int vlan)
+{
+    uint8_t zero[4] = { 0 };
+
+    goose_handle* handle = test_make_handle(app_id_low, source_low, "IED1/LLN0$GO$Gateway", vlan);
+    ber_set(&(handle->frame->pdu_list.t), (uint8_t*)old_t, sizeof(old_t));
+    ber_set(&(handle->frame->pdu_list.st_num), zero, sizeof(zero));
+    ber_set(&(handle->frame->pdu_list.sq_num), zero, sizeof(zero));
+    ber_set(&(handle->frame->pdu_list.conf_rev), zero, 1);
+    goose_all_data_entry_add(handle, 0x83, 1, zero);
+    goose_all_data_entry_add(handle, 0x85, 4, zero);
+    goose_encode(handle);
+    return handle;
+}
+
+// Copies the frame into a slot, as a NIC would, leaving `headroom` in front of it
+static goose_gateway_frame receive(int slot, const goose_handle* handle, size_t headroom)
+{
+    goose_gateway_frame frame = { slots[slot], SLOT_SIZE, headroom, handle->length, 0, NULL };
+    memcpy(slots[slot] + headroom, handle->byte_stream, handle->length);
+    return frame;
+}
+
+static const uint8_t* pdu_of(const uint8_t* frame)
+{
+    size_t offset = MAC_ADDRESS_SIZE * 2;
+    if (frame[offset] == VLAN_TPID_0 && frame[offset + 1] == VLAN_TPID_1)
+    {
+        offset += VLAN_TAG_SIZE;
+    }
+    return frame + offset + ETHERTYPE_SIZE + APP_ID_SIZE + 3 * sizeof(uint16_t);
+}
+
+static void test_rewrite(void)
+{
+    goose_gateway* gateway = goose_gateway_create(16);
+    goose_handle* untagged = make_handle(0x01, 0x01, 0);
+    goose_handle* tagged = make_handle(0x02, 0x02, 1);
+    goose_handle* other = make_handle(0x02, 0x09, 1);
+    goose_gateway_frame out;
+    goose_frame_view view;
+
+    // Retag onto VLAN 0x123 with a new APPID and destination
+    goose_gateway_rule retag = { 0 };
+    retag.flags = GOOSE_GATEWAY_SET_APP_ID | GOOSE_GATEWAY_SET_DESTINATION | GOOSE_GATEWAY_SET_VLAN;
+    retag.app_id = 0x0001;
+    retag.new_app_id = 0x1001;
+    memcpy(retag.destination, (uint8_t[])GOOSE_MULTICAST_ADDRESS(0x01, 0xff), MAC_ADDRESS_SIZE);
+    retag.vlan_priority = 6;
+    retag.vlan_id = 0x123;
+    retag.port = 2;
+    CHECK(goose_gateway_rule_add(gateway, &retag) == 0);
+    CHECK(goose_gateway_rule_add(gateway, &retag) == -1);
+
+    // Untag one publisher of APPID 2, pass the others through on port 3
+    goose_gateway_rule untag = { 0 };
+    untag.flags = GOOSE_GATEWAY_MATCH_SOURCE | GOOSE_GATEWAY_STRIP_VLAN;
+    untag.app_id = 0x0002;
+    memcpy(untag.source, tagged->frame->source, MAC_ADDRESS_SIZE);
+    untag.port = 1;
+    CHECK(goose_gateway_rule_add(gateway, &untag) == 1);
+
+    goose_gateway_frame frame = receive(0, untagged, HEADROOM);
+    const uint8_t* pdu = pdu_of(slots[0] + HEADROOM);
+    CHECK(goose_gateway_input(gateway, &frame) == 1);
+    CHECK(goose_gateway_pop(gateway, &out) == 1);
+    CHECK(out.buffer == slots[0] && out.offset == HEADROOM - VLAN_TAG_SIZE && out.port == 2);
+    CHECK(out.length == untagged->length + VLAN_TAG_SIZE);
+    CHECK(pdu_of(out.buffer + out.offset) == pdu);	// The PDU did not move
+    CHECK(memcmp(pdu, pdu_of(untagged->byte_stream), untagged->length - (pdu_of(untagged->byte_stream) - untagged->byte_stream)) == 0);
+    CHECK(goose_decode(out.buffer + out.offset, out.length, &view) == 0);
+    CHECK(view.app_id == 0x1001 && view.vlan_tagged && view.vlan_tci == ((6 << 13) | 0x123));
+    CHECK(view.destination[4] == 0x01 && view.destination[5] == 0xff);
+    CHECK(memcmp(view.source, untagged->frame->source, MAC_ADDRESS_SIZE) == 0);
+
+    frame = receive(1, tagged, 0);
+    CHECK(goose_gateway_input(gateway, &frame) == 1);
+    CHECK(goose_gateway_pop(gateway, &out) == 1);
+    CHECK(out.offset == VLAN_TAG_SIZE && out.length == tagged->length - VLAN_TAG_SIZE && out.port == 1);
+    CHECK(goose_decode(out.buffer + out.offset, out.length, &view) == 0);
+    CHECK(view.app_id == 0x0002 && !view.vlan_tagged);
+    CHECK(memcmp(view.source, tagged->frame->source, MAC_ADDRESS_SIZE) == 0);
+
+    frame = receive(2, other, 0);
+    CHECK(goose_gateway_input(gateway, &frame) == 0);
+    goose_gateway_rule pass = { 0 };
+    pass.app_id = 0x0002;
+    pass.port = 3;
+    CHECK(goose_gateway_rule_add(gateway, &pass) == 2);
+    CHECK(goose_gateway_input(gateway, &frame) == 1);
+    CHECK(goose_gateway_pop(gateway, &out) == 1);
+    CHECK(out.port == 3 && out.length == other->length && memcmp(out.buffer + out.offset, other->byte_stream, other->length) == 0);
+    CHECK(goose_gateway_pop(gateway, &out) == 0);
+
+    // Tagging without headroom drops the frame untouched
+    frame = receive(3, untagged, 0);
+    CHECK(goose_gateway_input(gateway, &frame) == -1);
+    CHECK(frame.offset == 0 && memcmp(slots[3], untagged->byte_stream, untagged->length) == 0);
+
+    uint8_t runt[20] = { 0 };
+    goose_gateway_frame short_frame = { runt, sizeof(runt), 0, sizeof(runt), 0, NULL };
+    CHECK(goose_gateway_input(gateway, &short_frame) == -1);
+
+    goose_gateway_stats stats;
+    goose_gateway_stats_snapshot(gateway, &stats);
+    CHECK(stats.frames == 6 && stats.forwarded == 3 && stats.unmatched == 1 && stats.no_room == 1 && stats.malformed == 1);
+    CHECK(goose_gateway_rule_forwarded(gateway, 0) == 1 && goose_gateway_rule_forwarded(gateway, 2) == 1);
+
+    goose_gateway_free(gateway);
+    goose_free(untagged);
+    goose_free(tagged);
+    goose_free(other);
+}
+
+static void test_auth(void)
+{
+    goose_gateway* gateway = goose_gateway_create(4);
+    goose_auth_keyring* upstream = goose_auth_keyring_create();
+    goose_auth_keyring* downstream = goose_auth_keyring_create();
+    goose_auth_key_set(upstream, 1, key, sizeof(key));
+    goose_auth_key_set(downstream, 2, key + 1, sizeof(key) - 1);
+
+    goose_handle* plain = make_handle(0x03, 0x03, 0);
+    goose_handle* signed_frame = make_handle(0x03, 0x03, 0);
+    goose_auth_enable(signed_frame, upstream);
+    goose_encode(signed_frame);
+    goose_gateway_frame out;
+
+    // Accept only upstream-signed frames, stamp and sign them for downstream
+    goose_gateway_rule rule = { 0 };
+    rule.flags = GOOSE_GATEWAY_SET_APP_ID | GOOSE_GATEWAY_SET_VLAN | GOOSE_GATEWAY_RESTAMP;
+    rule.app_id = 0x0003;
+    rule.new_app_id = 0x2003;
+    rule.vlan_priority = 7;
+    rule.verify = upstream;
+    rule.sign = downstream;
+    CHECK(goose_gateway_rule_add(gateway, &rule) == 0);
+
+    goose_gateway_frame frame = receive(0, plain, HEADROOM);
+    CHECK(goose_gateway_input(gateway, &frame) == -1);
+
+    frame = receive(1, signed_frame, HEADROOM);
+    CHECK(goose_gateway_input(gateway, &frame) == 1);
+    CHECK(goose_gateway_pop(gateway, &out) == 1);
+    CHECK(out.length == signed_frame->length + VLAN_TAG_SIZE);
+    CHECK(goose_auth_verify(downstream, out.buffer + out.offset, out.length) == 0);
+    CHECK(goose_auth_verify(upstream, out.buffer + out.offset, out.length) != 0);
+
+    goose_frame_view view;
+    CHECK(goose_decode(out.buffer + out.offset, out.length, &view) == 0);
+    const ber* t = &view.fields[TAG_T - TAG_GOCBREF];
+    CHECK(view.app_id == 0x2003);
+    CHECK(t->length == IEC_TIME_UTC_SIZE && memcmp(t->value, old_t, 4) != 0);
+
+    // Signing needs tailroom for the extension once the frame has none
+    rule.verify = NULL;
+    rule.app_id = 0x0004;
+    CHECK(goose_gateway_rule_add(gateway, &rule) == 1);
+    plain->frame->app_id[1] = 0x04;
+    goose_encode(plain);
+    frame = receive(2, plain, HEADROOM);
+    frame.capacity = HEADROOM + plain->length;
+    CHECK(goose_gateway_input(gateway, &frame) == -1);
+
+    // Ring full
+    for (int i = 0; i < 4; i++)
+    {
+        frame = receive(3 + i % 4, plain, HEADROOM);
+        CHECK(goose_gateway_input(gateway, &frame) == 1);
+    }
+    frame = receive(7, plain, HEADROOM);
+    CHECK(goose_gateway_input(gateway, &frame) == -1);
+    CHECK(memcmp(slots[7] + HEADROOM, plain->byte_stream, plain->length) == 0);
+
+    goose_gateway_stats stats;
+    goose_gateway_stats_snapshot(gateway, &stats);
+    CHECK(stats.auth_failed == 1 && stats.no_room == 1 && stats.ring_full == 1 && stats.forwarded == 5);
+
+    goose_gateway_free(gateway);
+    goose_auth_keyring_free(upstream);
+    goose_auth_keyring_free(downstream);
+    goose_free(plain);
+    goose_free(signed_frame);
+}
+
+// Without re-signing, a rewrite the MAC covers strips the extension and one it leaves out
+// keeps it. A signing keyring with no key drops the frame before anything is written.
+static void test_unsigned_rewrite(void)
+{
+    goose_gateway* gateway = goose_gateway_create(4);
+    goose_auth_keyring* upstream = goose_auth_keyring_create();
+    goose_auth_keyring* empty = goose_auth_keyring_create();
+    goose_auth_key_set(upstream, 1, key, sizeof(key));
+
+    goose_handle* restamped = make_handle(0x06, 0x06, 0);
+    goose_handle* retagged = make_handle(0x07, 0x07, 1);
+    goose_handle* unsigned_frame = make_handle(0x08, 0x08, 0);
+    goose_auth_enable(restamped, upstream);
+    goose_auth_enable(retagged, upstream);
+    goose_encode(restamped);
+    goose_encode(retagged);
+    goose_gateway_frame out;
+    goose_frame_view view;
+
+    goose_gateway_rule rule = { 0 };
+    rule.flags = GOOSE_GATEWAY_RESTAMP;
+    rule.app_id = 0x0006;
+    CHECK(goose_gateway_rule_add(gateway, &rule) == 0);
+    rule.flags = GOOSE_GATEWAY_SET_VLAN;
+    rule.app_id = 0x0007;
+    rule.vlan_id = 0x055;
+    CHECK(goose_gateway_rule_add(gateway, &rule) == 1);
+    rule.flags = GOOSE_GATEWAY_SET_APP_ID;
+    rule.app_id = 0x0008;
+    rule.new_app_id = 0x0009;
+    rule.sign = empty;
+    CHECK(goose_gateway_rule_add(gateway, &rule) == 2);
+
+    goose_gateway_frame frame = receive(0, restamped, HEADROOM);
+    CHECK(goose_gateway_input(gateway, &frame) == 1);
+    CHECK(goose_gateway_pop(gateway, &out) == 1);
+    CHECK(out.length == restamped->length - GOOSE_AUTH_EXTENSION_SIZE);
+    CHECK(goose_auth_verify(upstream, out.buffer + out.offset, out.length) != 0);
+    CHECK(goose_decode(out.buffer + out.offset, out.length, &view) == 0);
+    CHECK(memcmp(view.fields[TAG_T - TAG_GOCBREF].value, old_t, 4) != 0);
+    CHECK(out.buffer[out.offset + MAC_ADDRESS_SIZE * 2 + ETHERTYPE_SIZE + APP_ID_SIZE + sizeof(uint16_t) + 1] == 0);
+
+    frame = receive(1, retagged, HEADROOM);
+    CHECK(goose_gateway_input(gateway, &frame) == 1);
+    CHECK(goose_gateway_pop(gateway, &out) == 1);
+    CHECK(out.length == retagged->length);
+    CHECK(goose_auth_verify(upstream, out.buffer + out.offset, out.length) == 0);
+
+    frame = receive(2, unsigned_frame, HEADROOM);
+    CHECK(goose_gateway_input(gateway, &frame) == -1);
+    CHECK(frame.offset == HEADROOM && frame.length == unsigned_frame->length);
+    CHECK(memcmp(slots[2] + HEADROOM, unsigned_frame->byte_stream, unsigned_frame->length) == 0);
+
+    goose_gateway_stats stats;
+    goose_gateway_stats_snapshot(gateway, &stats);
+    CHECK(stats.forwarded == 2 && stats.auth_failed == 1);
+
+    goose_gateway_free(gateway);
+    goose_auth_keyring_free(upstream);
+    goose_auth_keyring_free(empty);
+    goose_free(restamped);
+    goose_free(retagged);
+    goose_free(unsigned_frame);
+}
+
+static size_t state_changes = 0;
+
+static void on_event(goose_subscription_params* subscription, goose_subscriber_event event, goose_frame_view* view)
+{
+    (void)subscription;
+    if (event == GOOSE_SUBSCRIBER_STATE_CHANGE && view->vlan_tagged && view->app_id == 0x3001)
+    {
+        state_changes++;
+    }
+}
+
+// A capture read through its copy-on-write mapping: each record header is the headroom
+static void test_capture(const char* path)
+{
+    goose_handle* handle = make_handle(0x05, 0x05, 0);
+    goose_pcap_writer writer;
+    CHECK(goose_pcap_writer_open(&writer, path, GOOSE_PCAP_CLASSIC) == 0);
+
+    for (uint32_t st_num = 1; st_num <= 5; st_num++)
+    {
+        for (uint32_t sq_num = 0; sq_num < 3; sq_num++)
+        {
+            uint32_t st_num_net = goose_htonl(st_num);
+            uint32_t sq_num_net = goose_htonl(sq_num);
+            ber_set(&(handle->frame->pdu_list.st_num), (uint8_t*)&st_num_net, sizeof(st_num_net));
+            ber_set(&(handle->frame->pdu_list.sq_num), (uint8_t*)&sq_num_net, sizeof(sq_num_net));
+            goose_encode(handle);
+            goose_pcap_write(&writer, handle->byte_stream, handle->length, (st_num * 3 + sq_num) * 1000000ULL);
+        }
+    }
+    goose_pcap_writer_close(&writer);
+
+    goose_gateway* gateway = goose_gateway_create(64);
+    goose_gateway_rule rule = { 0 };
+    rule.flags = GOOSE_GATEWAY_SET_APP_ID | GOOSE_GATEWAY_SET_VLAN;
+    rule.app_id = 0x0005;
+    rule.new_app_id = 0x3001;
+    rule.vlan_priority = 5;
+    rule.vlan_id = 0x042;
+    goose_gateway_rule_add(gateway, &rule);
+
+    goose_subscriber_init();
+    goose_subscription_params subscription = { 0 };
+    subscription.name = "gateway";
+    subscription.gocbref = "IED1/LLN0$GO$Gateway";
+    subscription.app_id = 0x3001;
+    subscription.callback = on_event;
+    goose_subscriber_register(subscription);
+
+    goose_pcap_reader reader;
+    goose_pcap_record record;
+    goose_gateway_frame frame;
+    goose_gateway_frame out;
+    size_t forwarded = 0;
+
+    CHECK(goose_pcap_reader_open(&reader, path) == 0);
+    while (goose_pcap_next(&reader, &record) == 1)
+    {
+        frame = (goose_gateway_frame){ record.frame - 16, 16 + record.length, 16, record.length, 0, NULL };
+        CHECK(goose_gateway_input(gateway, &frame) == 1);
+        while (goose_gateway_pop(gateway, &out) == 1)
+        {
+            goose_subscriber_input(out.buffer + out.offset, out.length);
+            forwarded++;
+        }
+    }
+    goose_pcap_reader_close(&reader);
+
+    CHECK(forwarded == 15);
+    CHECK(state_changes == 5);
+
+    goose_subscriber_deregister("gateway");
+    goose_gateway_free(gateway);
+    goose_free(handle);
+}
+
+int main(int argc, char** argv)
+{
+    const char* path = argc > 1 ? argv[1] : "gateway.pcap";
+
+    test_rewrite();
+    test_auth();
+    test_unsigned_rewrite();
+    test_capture(path);
+
+    if (failures == 0)
+    {
+        printf("test_gateway passed\n");
+    }
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,301 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "goose.h"
+#include "goose_image.h"
+#include "goose_publisher.h"
+#include "goose_subscriber.h"
+
+// Configuration images: the compiled templates match a hand-built control block,
+// handles made from them publish straight away, and damaged images are refused
+
+#define CHECK(cond) do { if (!(cond)) { printf("FAILED %s:%d: %s\n", __FILE__, __LINE__, #cond); failures++; } } while (0)
+
+static int failures = 0;
+static uint8_t last_frame[1524];
+static size_t last_length = 0;
+static size_t frame_count = 0;
+
+static void capture_output(uint8_t* byte_stream, size_t length)
+{
+    memcpy(last_frame, byte_stream, length);
+    last_length = length;
+    frame_count++;
+}
+
+// The Trip publisher of image_sample.txt, built the usual way
+static goose_handle* make_trip_handle(void)
+{
+    uint8_t source[MAC_ADDRESS_SIZE] = { 0x00, 0x30, 0xa7, 0x03, 0xc1, 0x53 };
+    uint8_t destination[MAC_ADDRESS_SIZE] = GOOSE_MULTICAST_ADDRESS(0x00, 0x01);
+    uint8_t app_id[APP_ID_SIZE] = { 0x30, 0x01 };
+    const char* gocbref = "IED1/LLN0$GO$Trip";
+    const char* dataset = "IED1/LLN0$Protection";
+    const char* go_id = "IED1 Trip";
+    uint16_t time_allowed_to_live = goose_htons(1500);
+    uint8_t t[IEC_TIME_UTC_SIZE] = { 0 };
+    uint32_t zero = 0;
+    uint32_t conf_rev = goose_htonl(3);
+    uint8_t flag = 0;
+    uint8_t boolean = 1;
+    uint8_t int32[4] = { 0xff, 0xff, 0xff, 0xfb };
+    uint8_t float32[5] = { 0x08, 0x3f, 0xc0, 0x00, 0x00 };
+    uint8_t quality[3] = { 0x03, 0x00, 0x00 };
+
+    goose_handle* handle = goose_init(source, destination, app_id);
+    goose_vlan_set(handle, 6, 0x123);
+    ber_set(&(handle->frame->pdu_list.gocbref), (uint8_t*)gocbref, strlen(gocbref));
+    ber_set(&(handle->frame->pdu_list.time_allowed_to_live), (uint8_t*)&time_allowed_to_live, sizeof(time_allowed_to_live));
+    ber_set(&(handle->frame->pdu_list.dataset), (uint8_t*)dataset, strlen(dataset));
+    ber_set(&(handle->frame->pdu_list.go_id), (uint8_t*)go_id, strlen(go_id));
+    ber_set(&(handle->frame->pdu_list.t), t, sizeof(t));
+    ber_set(&(handle->frame->pdu_list.st_num), (uint8_t*)&zero, sizeof(zero));
+    ber_set(&(handle->frame->pdu_list.sq_num), (uint8_t*)&zero, sizeof(zero));
+    ber_set(&(handle->frame->pdu_list.simulation), &flag, sizeof(flag));
+    ber_set(&(handle->frame->pdu_list.conf_rev), (uint8_t*)&conf_rev, sizeof(conf_rev));
+    ber_set(&(handle->frame->pdu_list.nds_com), &flag, sizeof(flag));
+    goose_all_data_entry_add(handle, 0x83, sizeof(boolean), &boolean);
+    goose_all_data_entry_add(handle, 0x85, sizeof(int32), int32);
+    goose_all_data_entry_add(handle, 0x87, sizeof(float32), float32);
+    goose_all_data_entry_add(handle, 0x84, sizeof(quality), quality);
+    goose_encode(handle);
+
+    return handle;
+}
+
+static void test_image(const goose_image* image)
+{
+    CHECK(image->header->dataset_count == 1);
+    CHECK(image->header->publisher_count == 2);
+    CHECK(image->header->subscription_count == 1);
+
+    // Dataset schema
+    const goose_image_dataset* dataset = goose_image_dataset_get(image, 0);
+    CHECK(dataset != NULL);
+    CHECK(strcmp(goose_image_string(image, dataset->name), "Protection") == 0);
+    CHECK(dataset->entry_count == 4);
+    const goose_image_entry* entries = goose_image_dataset_entries(image, dataset);
+    CHECK(entries[0].type == 0x83 && entries[0].length == 1);
+    CHECK(entries[1].type == 0x85 && entries[1].length == 4);
+    CHECK(entries[2].type == 0x87 && entries[2].length == 5);
+    CHECK(entries[3].type == 0x84 && entries[3].length == 3);
+
+    // The template is byte for byte what goose_encode makes of the same control block
+    goose_frame_view view;
+    goose_handle* expected = make_trip_handle();
+    goose_handle* handle = goose_image_handle(image, 0);
+    CHECK(handle != NULL);
+    CHECK(handle->length == expected->length);
+    CHECK(memcmp(handle->byte_stream, expected->byte_stream, expected->length) == 0);
+    CHECK(memcmp(handle->field_offset, expected->field_offset, sizeof(expected->field_offset)) == 0);
+    CHECK(goose_vlan_priority(handle) == 6);
+
+    // Field and member values point into one copy of the template
+    CHECK(handle->values != NULL);
+    CHECK(handle->frame->pdu_list.gocbref.value == handle->values + handle->field_offset[TAG_GOCBREF - TAG_GOCBREF]);
+    CHECK(handle->frame->pdu_list.all_data_list.entry_count == 4);
+    CHECK(handle->frame->pdu_list.all_data_list.entries[2].tag == 0x87);
+    CHECK(handle->frame->pdu_list.all_data_list.entries[2].length == 5);
+    CHECK(memcmp(handle->frame->pdu_list.all_data_list.entries[2].value, (uint8_t[]){ 0x08, 0x3f, 0xc0, 0x00, 0x00 }, 5) == 0);
+
+    // ... and its frame struct encodes back to the template, without a full encode
+    CHECK(handle->layout.valid);
+    CHECK(goose_encode_changes(handle) == 0);
+    CHECK(handle->length == expected->length);
+    CHECK(memcmp(handle->byte_stream, expected->byte_stream, expected->length) == 0);
+
+    // A state change rewrites stNum, T and sqNum in place and nothing else
+    uint32_t st_num = goose_htonl(1);
+    uint32_t sq_num = goose_htonl(0);
+    uint8_t t[IEC_TIME_UTC_SIZE] = { 0x65, 0x53, 0xf1, 0x00, 0x80, 0x00, 0x00, 0x0a };
+    ber_set(&(handle->frame->pdu_list.st_num), (uint8_t*)&st_num, sizeof(st_num));
+    ber_set(&(handle->frame->pdu_list.sq_num), (uint8_t*)&sq_num, sizeof(sq_num));
+    goose_t_set(handle, t);
+    CHECK(goose_encode_changes(handle) == 0);
+    CHECK(handle->length == expected->length);
+    for (size_t i = 0; i < expected->length; i++)
+    {
+        if (handle->byte_stream[i] != expected->byte_stream[i])
+        {
+            size_t st = handle->field_offset[TAG_ST_NUM - TAG_GOCBREF];
+            size_t sq = handle->field_offset[TAG_SQ_NUM - TAG_GOCBREF];
+            size_t time = handle->field_offset[TAG_T - TAG_GOCBREF];
+            CHECK((i >= st && i < st + sizeof(st_num)) || (i >= sq && i < sq + sizeof(sq_num)) || (i >= time && i < time + sizeof(t)));
+        }
+    }
+    CHECK(memcmp(&handle->byte_stream[handle->field_offset[TAG_ST_NUM - TAG_GOCBREF]], &st_num, sizeof(st_num)) == 0);
+    CHECK(memcmp(&handle->byte_stream[handle->field_offset[TAG_T - TAG_GOCBREF]], t, sizeof(t)) == 0);
+    CHECK(goose_retransmit_patch(handle, 1, 3000) == 0);
+
+    // A borrowed member can still be replaced like any other
+    uint8_t boolean = 0;
+    goose_all_data_entry_modify(handle, 0, 0x83, sizeof(boolean), &boolean);
+    goose_all_data_entry_remove(handle, 1);
+    goose_encode(handle);
+    CHECK(goose_decode(handle->byte_stream, handle->length, &view) == 0);
+    CHECK(goose_decode_all_data(&view) == 3);
+    CHECK(view.all_data_list.entries[0].value[0] == 0);
+    goose_free(handle);
+    goose_free(expected);
+
+    // Publish from the image: the first process call sends stNum 1
+    goose_message_params message;
+    CHECK(goose_image_publisher_params(image, 1, &message) == 0);
+    CHECK(strcmp(message.name, "Status") == 0);
+    CHECK(message.default_time_allowed_to_live == 2000);
+    CHECK(message.coalescing_window_us == 500);
+    CHECK(message.coalescing_leading_edge == 1);
+    CHECK(message.time_stamping == 1);
+
+    goose_publisher_register(message);
+    frame_count = 0;
+    goose_publisher_process_at(1000000000ULL);
+    CHECK(frame_count == 1);
+    CHECK(goose_decode(last_frame, last_length, &view) == 0);
+    CHECK(view.app_id == 0x3002);
+    CHECK(goose_field_uint(&view.fields[TAG_ST_NUM - TAG_GOCBREF]) == 1);
+    CHECK(view.fields[TAG_GOCBREF - TAG_GOCBREF].length == strlen("IED1/LLN0$GO$Status"));
+    CHECK(goose_decode_all_data(&view) == 4);
+    goose_publisher_deregister("Status");
+    goose_free(message.handle);
+
+    // Subscription strings point into the image
+    goose_subscription_params subscription;
+    CHECK(goose_image_subscription_params(image, 0, &subscription) == 0);
+    CHECK(strcmp(subscription.name, "RemoteTrip") == 0);
+    CHECK(strcmp(subscription.gocbref, "IED2/LLN0$GO$Trip") == 0);
+    CHECK(subscription.app_id == 0x3101);
+    CHECK((const uint8_t*)subscription.gocbref > image->base && (const uint8_t*)subscription.gocbref < image->base + image->size);
+    CHECK(goose_image_subscription_get(image, 0)->dataset == 0);
+
+    CHECK(goose_image_publisher_get(image, 2) == NULL);
+    CHECK(goose_image_subscription_params(image, 1, &subscription) == -1);
+}
+
+static char* read_text(const char* path)
+{
+    FILE* file = fopen(path, "rb");
+    if (!file) return NULL;
+    fseek(file, 0, SEEK_END);
+    long size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    char* text = (char*)malloc((size_t)size + 1);
+    size_t read = fread(text, 1, (size_t)size, file);
+    text[read] = '\0';
+    fclose(file);
+    return text;
+}
+
+static void test_rejected(const char* description)
+{
+    uint8_t* bytes;
+    size_t size;
+    uint32_t* words;
+    goose_image image;
+    char error[128];
+
+    CHECK(goose_image_compile(description, &bytes, &size, error, sizeof(error)) == 0);
+
+    // Any flipped byte fails the checksum
+    bytes[size / 2] ^= 0x01;
+    CHECK(goose_image_attach(bytes, size, &image) == -1);
+    bytes[size / 2] ^= 0x01;
+    CHECK(goose_image_attach(bytes, size, &image) == 0);
+
+    // Other versions and truncated images are refused
+    words = (uint32_t*)bytes;
+    words[GOOSE_IMAGE_MAGIC_SIZE / sizeof(uint32_t)] = GOOSE_IMAGE_VERSION + 1;
+    CHECK(goose_image_attach(bytes, size, &image) == -1);
+    words[GOOSE_IMAGE_MAGIC_SIZE / sizeof(uint32_t)] = GOOSE_IMAGE_VERSION;
+    CHECK(goose_image_attach(bytes, size - 4, &image) == -1);
+
+    // A field inside the Ethernet and GOOSE header is refused even with a valid checksum
+    goose_image_header* header = (goose_image_header*)bytes;
+    goose_image_publisher* publisher = (goose_image_publisher*)(bytes + header->publisher_offset);
+    CHECK(header->publisher_count > 0 && publisher->field_length[0] > 0);
+    uint32_t field_offset = publisher->field_offset[0];
+    publisher->field_offset[0] = MAC_ADDRESS_SIZE * 2 + ETHERTYPE_SIZE;
+    header->checksum = goose_image_checksum(bytes + sizeof(goose_image_header), size - sizeof(goose_image_header));
+    CHECK(goose_image_attach(bytes, size, &image) == -1);
+    publisher->field_offset[0] = field_offset;
+    header->checksum = goose_image_checksum(bytes + sizeof(goose_image_header), size - sizeof(goose_image_header));
+    CHECK(goose_image_attach(bytes, size, &image) == 0);
+    free(bytes);
+
+    // Compile errors name the line
+    CHECK(goose_image_compile("dataset A\n    bool\nend\npublisher P\n    dataset B\nend\n", &bytes, &size, error, sizeof(error)) == -1);
+    CHECK(strcmp(error, "line 5: unknown dataset 'B'") == 0);
+    CHECK(bytes == NULL);
+    CHECK(goose_image_compile("dataset A\n    double 1\nend\n", &bytes, &size, error, sizeof(error)) == -1);
+    CHECK(strcmp(error, "line 2: unknown member type 'double'") == 0);
+    CHECK(goose_image_compile("publisher P\n    app_id 0x10000\nend\n", &bytes, &size, error, sizeof(error)) == -1);
+    CHECK(goose_image_compile("publisher P\n", &bytes, &size, error, sizeof(error)) == -1);
+
+    // Numbers are checked, uint32 keeps its top bit with a leading zero
+    CHECK(goose_image_compile("dataset A\n    int32 12abc\nend\n", &bytes, &size, error, sizeof(error)) == -1);
+    CHECK(strcmp(error, "line 2: bad number '12abc'") == 0);
+    CHECK(goose_image_compile("dataset A\n    int32 2147483648\nend\n", &bytes, &size, error, sizeof(error)) == -1);
+    CHECK(goose_image_compile("dataset A\n    uint32 4294967296\nend\n", &bytes, &size, error, sizeof(error)) == -1);
+    CHECK(goose_image_compile("dataset A\n    quality 00\nend\n", &bytes, &size, error, sizeof(error)) == -1);
+    CHECK(goose_image_compile("dataset A\n    int32 -2147483648\n    uint32 0x80000001\nend\n", &bytes, &size, error, sizeof(error)) == 0);
+    if (bytes)
+    {
+        CHECK(goose_image_attach(bytes, size, &image) == 0);
+        const goose_image_entry* members = goose_image_dataset_entries(&image, goose_image_dataset_get(&image, 0));
+        const uint8_t* data = image.base + image.header->data_offset;
+        CHECK(members[0].type == 0x85 && members[0].length == 4 && memcmp(data + members[0].value, "\x80\x00\x00\x00", 4) == 0);
+        CHECK(members[1].type == 0x86 && members[1].length == 5 && memcmp(data + members[1].value, "\x00\x80\x00\x00\x01", 5) == 0);
+        free(bytes);
+    }
+}
+
+int main(int argc, char** argv)
+{
+    goose_image image;
+
+    if (argc != 3)
+    {
+        printf("usage: %s image_sample.txt image_sample.gimg\n", argv[0]);
+        return 2;
+    }
+
+    goose_publisher_init(capture_output);
+
+    // The image written by the goose_image_compile tool, mapped from disk
+    CHECK(goose_image_open(argv[2], &image) == 0);
+    if (image.base)
+    {
+        CHECK(image.owned == 1);
+        test_image(&image);
+        goose_image_close(&image);
+    }
+
+    // The same description compiled in memory
+    char* description = read_text(argv[1]);
+    uint8_t* bytes = NULL;
+    size_t size = 0;
+    char error[128];
+    CHECK(description != NULL);
+    if (description)
+    {
+        CHECK(goose_image_compile(description, &bytes, &size, error, sizeof(error)) == 0);
+        CHECK(goose_image_attach(bytes, size, &image) == 0);
+        if (image.base)
+        {
+            test_image(&image);
+        }
+        free(bytes);
+
+        test_rejected(description);
+        free(description);
+    }
+
+    CHECK(goose_image_open("does-not-exist.gimg", &image) == -1);
+
+    if (failures == 0)
+    {
+        printf("test_image passed\n");
+    }
+    return failures == 0 ? 0 : 1;
+}
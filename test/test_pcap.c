@@ -0,0 +1,437 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include "goose.h"
+#include "goose_pcap.h"
+#include "goose_analysis.h"
+#include "goose_publisher.h"
+#include "goose_subscriber.h"
+#include "test_util.h"
+
+// Capture files: both formats written and read back, foreign byte order and timestamp
+// resolutions, per-stream analysis and replay into the subscriber. Writes
+// PREFIX.pcap, which the goose_analyze test picks up, and PREFIX.pcapng.
+
+#define CHECK(cond) do { if (!(cond)) { printf("FAILED %s:%d: %s\n", __FILE__, __LINE__, #cond); failures++; } } while (0)
+
+#define MS 1000000ULL
+#define BASE_NS 1700000000000000000ULL
+
+static int failures = 0;
+
+typedef struct
+{
+    uint8_t bytes[256];
+    size_t length;
+    uint64_t timestamp_ns;
+} scenario_frame;
+
+static scenario_frame scenario[16];
+static size_t scenario_count = 0;
+
+static goose_handle* make_handle(uint8_t app_id_low, const char* gocbref, uint8_t vlan)
+{
+    uint8_t zero = 0;
+
+    goose_handle* handle = test_make_handle(app_id_low, app_id_low, gocbref, vlan);
+    ber_set(&(handle->frame->pdu_list.conf_rev), &zero, sizeof(zero));
+    goose_all_data_entry_add(handle, 0x83, sizeof(zero), &zero);
+    return handle;
+}
+
+static void add_frame(goose_handle* handle, uint32_t st_num, uint32_t sq_num, uint16_t time_allowed_to_live, uint64_t offset_ns)
+{
+    uint32_t st_num_net = goose_htonl(st_num);
+    uint32_t sq_num_net = goose_htonl(sq_num);
+    uint16_t time_allowed_to_live_net = goose_htons(time_allowed_to_live);
+
+    ber_set(&(handle->frame->pdu_list.st_num), (uint8_t*)&st_num_net, sizeof(st_num_net));
+    ber_set(&(handle->frame->pdu_list.sq_num), (uint8_t*)&sq_num_net, sizeof(sq_num_net));
+    ber_set(&(handle->frame->pdu_list.time_allowed_to_live), (uint8_t*)&time_allowed_to_live_net, sizeof(time_allowed_to_live_net));
+    goose_encode(handle);
+
+    scenario_frame* frame = &scenario[scenario_count++];
+    memcpy(frame->bytes, handle->byte_stream, handle->length);
+    frame->length = handle->length;
+    frame->timestamp_ns = BASE_NS + offset_ns;
+}
+
+// Stream A: a sqNum gap, a skipped stNum, a duplicate and a TATL violation.
+// Stream B: tagged and clean. Plus one IPv4 frame and one broken GOOSE frame.
+static void build_scenario(void)
+{
+    goose_handle* a = make_handle(0x01, "IED1/LLN0$GO$Trip", 0);
+    goose_handle* b = make_handle(0x02, "IED2/LLN0$GO$Status", 1);
+
+    add_frame(a, 1, 0, 2000, 0);
+    add_frame(b, 1, 0, 2000, 500000);
+    add_frame(a, 1, 1, 2000, 1 * MS);
+    add_frame(a, 1, 2, 2000, 3 * MS);
+    add_frame(a, 1, 4, 2000, 7 * MS);
+    add_frame(b, 1, 1, 2000, 7 * MS + 500000);
+    add_frame(a, 2, 0, 2000, 8 * MS);
+    add_frame(a, 4, 0, 2000, 10 * MS);
+    add_frame(a, 4, 0, 2000, 10 * MS + 500000);
+
+    scenario_frame* ipv4 = &scenario[scenario_count++];
+    memset(ipv4->bytes, 0x11, 60);
+    ipv4->bytes[12] = 0x08;
+    ipv4->bytes[13] = 0x00;
+    ipv4->length = 60;
+    ipv4->timestamp_ns = BASE_NS + 11 * MS;
+
+    scenario_frame* broken = &scenario[scenario_count++];
+    *broken = scenario[1];
+    broken->length = 30;
+    broken->timestamp_ns = BASE_NS + 12 * MS;
+
+    add_frame(a, 4, 1, 2000, 2510 * MS);
+
+    goose_free(a);
+    goose_free(b);
+}
+
+static void write_capture(const char* path, goose_pcap_format format)
+{
+    goose_pcap_writer writer;
+    CHECK(goose_pcap_writer_open(&writer, path, format) == 0);
+    for (size_t i = 0; i < scenario_count; i++)
+    {
+        CHECK(goose_pcap_write(&writer, scenario[i].bytes, scenario[i].length, scenario[i].timestamp_ns) == 0);
+    }
+    CHECK(writer.frames == scenario_count);
+    CHECK(goose_pcap_writer_close(&writer) == 0);
+}
+
+static void test_round_trip(const char* path, goose_pcap_format format)
+{
+    goose_pcap_reader reader;
+    goose_pcap_record record;
+
+    write_capture(path, format);
+    CHECK(goose_pcap_reader_open(&reader, path) == 0);
+    CHECK(reader.format == format);
+
+    size_t count = 0;
+    int result;
+    while ((result = goose_pcap_next(&reader, &record)) == 1)
+    {
+        if (count < scenario_count)
+        {
+            CHECK(record.length == scenario[count].length);
+            CHECK(record.original_length == scenario[count].length);
+            CHECK(record.timestamp_ns == scenario[count].timestamp_ns);
+            CHECK(memcmp(record.frame, scenario[count].bytes, record.length) == 0);
+        }
+        count++;
+    }
+    CHECK(result == 0);
+    CHECK(count == scenario_count);
+
+    goose_pcap_reader_rewind(&reader);
+    CHECK(goose_pcap_next(&reader, &record) == 1 && record.timestamp_ns == BASE_NS);
+
+    goose_pcap_reader_close(&reader);
+}
+
+static void put_be32(uint8_t* out, uint32_t value)
+{
+    out[0] = (uint8_t)(value >> 24);
+    out[1] = (uint8_t)(value >> 16);
+    out[2] = (uint8_t)(value >> 8);
+    out[3] = (uint8_t)value;
+}
+
+// Big-endian files from another host: classic with microseconds, pcapng with a
+// binary timestamp resolution and a second, non-Ethernet interface
+static void test_foreign_files(void)
+{
+    uint8_t classic[24 + 16 + 64];
+    goose_pcap_reader reader;
+    goose_pcap_record record;
+
+    memset(classic, 0x0, sizeof(classic));
+    put_be32(classic, GOOSE_PCAP_MAGIC_US);
+    classic[5] = 2;
+    classic[7] = 4;
+    put_be32(classic + 16, GOOSE_PCAP_SNAPLEN);
+    put_be32(classic + 20, GOOSE_PCAP_LINKTYPE_ETHERNET);
+    put_be32(classic + 24, 100);
+    put_be32(classic + 28, 250000);
+    put_be32(classic + 32, 64);
+    put_be32(classic + 36, 80);
+
+    CHECK(goose_pcap_reader_attach(&reader, classic, sizeof(classic)) == 0);
+    CHECK(reader.swapped == 1 && reader.nanosecond == 0);
+    CHECK(goose_pcap_next(&reader, &record) == 1);
+    CHECK(record.timestamp_ns == 100250000000ULL);
+    CHECK(record.length == 64 && record.original_length == 80);
+    CHECK(record.frame == classic + 40);
+    CHECK(goose_pcap_next(&reader, &record) == 0);
+
+    // Captured length past the end of the file
+    put_be32(classic + 32, 65);
+    goose_pcap_reader_rewind(&reader);
+    CHECK(goose_pcap_next(&reader, &record) == -1);
+
+    uint8_t ng[28 + 32 + 20 + 2 * 48];
+    uint8_t* block = ng;
+    memset(ng, 0x0, sizeof(ng));
+
+    put_be32(block, GOOSE_PCAPNG_SECTION_HEADER);
+    put_be32(block + 4, 28);
+    put_be32(block + 8, GOOSE_PCAPNG_BYTE_ORDER_MAGIC);
+    block[13] = 1;
+    memset(block + 16, 0xff, 8);
+    put_be32(block + 24, 28);
+    block += 28;
+
+    put_be32(block, GOOSE_PCAPNG_INTERFACE_DESCRIPTION);
+    put_be32(block + 4, 32);
+    block[9] = GOOSE_PCAP_LINKTYPE_ETHERNET;
+    block[17] = GOOSE_PCAPNG_OPTION_TSRESOL;
+    block[19] = 1;
+    block[20] = 0x83;	// 1/8 s
+    put_be32(block + 28, 32);
+    block += 32;
+
+    put_be32(block, GOOSE_PCAPNG_INTERFACE_DESCRIPTION);
+    put_be32(block + 4, 20);
+    block[9] = 105;	// IEEE 802.11
+    put_be32(block + 16, 20);
+    block += 20;
+
+    for (uint32_t interface = 1; interface <= 2; interface++)
+    {
+        put_be32(block, GOOSE_PCAPNG_ENHANCED_PACKET);
+        put_be32(block + 4, 48);
+        put_be32(block + 8, 2 - interface);	// Wi-Fi first, then Ethernet
+        put_be32(block + 16, 8 * 3 + 4);
+        put_be32(block + 20, 14);
+        put_be32(block + 24, 14);
+        block[28] = (uint8_t)interface;
+        put_be32(block + 44, 48);
+        block += 48;
+    }
+
+    CHECK(goose_pcap_reader_attach(&reader, ng, sizeof(ng)) == 0);
+    CHECK(reader.format == GOOSE_PCAP_NG);
+    CHECK(goose_pcap_next(&reader, &record) == 1);
+    CHECK(reader.swapped == 1 && reader.interface_count == 2);
+    CHECK(record.frame[0] == 2 && record.length == 14);
+    CHECK(record.timestamp_ns == 3500000000ULL);
+    CHECK(goose_pcap_next(&reader, &record) == 0);
+
+    CHECK(goose_pcap_reader_attach(&reader, ng, 20) == -1);
+    CHECK(goose_pcap_reader_attach(&reader, ng, sizeof(ng) - 4) == 0);
+    CHECK(goose_pcap_next(&reader, &record) == -1);
+}
+
+static void test_analysis(const char* path)
+{
+    goose_pcap_reader reader;
+    goose_pcap_record record;
+    goose_analysis analysis;
+
+    CHECK(goose_pcap_reader_open(&reader, path) == 0);
+    goose_analysis_init(&analysis);
+    while (goose_pcap_next(&reader, &record) == 1)
+    {
+        CHECK(goose_analysis_add(&analysis, record.frame, record.length, record.timestamp_ns) == 0);
+    }
+
+    CHECK(analysis.frames == scenario_count);
+    CHECK(analysis.non_goose == 1);
+    CHECK(analysis.malformed == 1);
+    CHECK(analysis.stream_count == 2);
+
+    const goose_stream_stats* a = &analysis.streams[0];
+    const goose_stream_stats* b = &analysis.streams[1];
+    CHECK(a->app_id == 0x0001 && strcmp(a->gocbref, "IED1/LLN0$GO$Trip") == 0);
+    CHECK(a->frames == 8);
+    CHECK(a->state_changes == 2);
+    CHECK(a->missed_state_changes == 1);
+    CHECK(a->sq_num_gaps == 1);
+    CHECK(a->out_of_order == 1);
+    CHECK(a->tatl_violations == 1);
+    CHECK(a->max_interval_ns == 2500 * MS - 500000);
+    CHECK(a->st_num == 4 && a->sq_num == 1);
+
+    CHECK(b->app_id == 0x0002 && b->frames == 2);
+    CHECK(b->state_changes == 0 && b->sq_num_gaps == 0 && b->out_of_order == 0 && b->tatl_violations == 0);
+    CHECK(goose_stream_stats_rate(b) > 142.8 && goose_stream_stats_rate(b) < 142.9);
+
+    // The split key keeps every frame of a stream together
+    CHECK(goose_analysis_stream_hash(scenario[0].bytes, scenario[0].length) == goose_analysis_stream_hash(scenario[2].bytes, scenario[2].length));
+    CHECK(goose_analysis_stream_hash(scenario[0].bytes, scenario[0].length) != goose_analysis_stream_hash(scenario[1].bytes, scenario[1].length));
+
+    goose_analysis_free(&analysis);
+    goose_pcap_reader_close(&reader);
+}
+
+static size_t state_changes = 0;
+static size_t expirations = 0;
+static size_t ticks = 0;
+
+static void on_event(goose_subscription_params* subscription, goose_subscriber_event event, goose_frame_view* view)
+{
+    (void)subscription;
+    (void)view;
+
+    if (event == GOOSE_SUBSCRIBER_STATE_CHANGE)
+    {
+        state_changes++;
+    }
+    else
+    {
+        expirations++;
+    }
+}
+
+static void count_tick(void)
+{
+    ticks++;
+    goose_subscriber_process();
+}
+
+static double seconds_now(void)
+{
+    struct timespec ts;
+    timespec_get(&ts, TIME_UTC);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+static void test_replay(const char* path)
+{
+    goose_pcap_reader reader;
+
+    goose_subscription_params subscription = { 0 };
+    subscription.name = "trip";
+    subscription.gocbref = "IED1/LLN0$GO$Trip";
+    subscription.app_id = 0x0001;
+    subscription.callback = on_event;
+    goose_subscriber_register(subscription);
+
+    // Capture time drives supervision: the 2.5 s silence expires the 2 s TATL once,
+    // and the frame after it is a new state for the subscriber
+    goose_pcap_replay_params params = { GOOSE_PCAP_REPLAY_FAST, goose_subscriber_input, count_tick };
+    CHECK(goose_pcap_reader_open(&reader, path) == 0);
+    double start = seconds_now();
+    CHECK(goose_pcap_replay(&reader, &params) == (long long)scenario_count);
+    CHECK(seconds_now() - start < 1.0);
+    CHECK(ticks == 2510);
+    CHECK(state_changes == 4);
+    CHECK(expirations == 1);
+    goose_pcap_reader_close(&reader);
+
+    goose_subscriber_deregister("trip");
+
+    // Original timing over the first 12 ms of the scenario
+    goose_pcap_writer writer;
+    char short_path[512];
+    snprintf(short_path, sizeof(short_path), "%s.short", path);
+    CHECK(goose_pcap_writer_open(&writer, short_path, GOOSE_PCAP_CLASSIC) == 0);
+    for (size_t i = 0; i + 1 < scenario_count; i++)
+    {
+        goose_pcap_write(&writer, scenario[i].bytes, scenario[i].length, scenario[i].timestamp_ns);
+    }
+    goose_pcap_writer_close(&writer);
+
+    params.timing = GOOSE_PCAP_REPLAY_ORIGINAL;
+    params.output = NULL;
+    ticks = 0;
+    CHECK(goose_pcap_reader_open(&reader, short_path) == 0);
+    start = seconds_now();
+    CHECK(goose_pcap_replay(&reader, &params) == (long long)scenario_count - 1);
+    CHECK(seconds_now() - start >= 0.012);
+    CHECK(ticks == 12);
+    goose_pcap_reader_close(&reader);
+    remove(short_path);
+}
+
+static size_t forwarded = 0;
+
+static void count_forward(uint8_t* byte_stream, size_t length)
+{
+    (void)byte_stream;
+    (void)length;
+    forwarded++;
+}
+
+// The writer as the publisher's linkoutput, passing frames on to the real output
+static void test_capture_sink(const char* path)
+{
+    goose_pcap_writer writer;
+    goose_pcap_reader reader;
+    goose_pcap_record record;
+
+    goose_handle* handle = make_handle(0x03, "IED3/LLN0$GO$Live", 0);
+
+    CHECK(goose_pcap_writer_open(&writer, path, GOOSE_PCAP_NG) == 0);
+    goose_pcap_capture(&writer, count_forward);
+
+    goose_message_params message = { 0 };
+    message.name = "live";
+    message.handle = handle;
+    message.default_time_allowed_to_live = 100;
+    message.updated = 1;
+    goose_publisher_register(message);
+    for (size_t i = 0; i < 300; i++)
+    {
+        goose_publisher_process();
+    }
+    goose_publisher_deregister("live");
+    goose_pcap_capture(NULL, NULL);
+    CHECK(goose_pcap_writer_close(&writer) == 0);
+    CHECK(forwarded > 1);
+    CHECK(writer.frames == forwarded);
+
+    CHECK(goose_pcap_reader_open(&reader, path) == 0);
+    size_t count = 0;
+    uint64_t last_ns = 0;
+    goose_frame_view view;
+    while (goose_pcap_next(&reader, &record) == 1)
+    {
+        CHECK(goose_decode(record.frame, record.length, &view) == 0);
+        CHECK(goose_field_uint(&view.fields[TAG_SQ_NUM - TAG_GOCBREF]) == count);
+        CHECK(record.timestamp_ns >= last_ns);
+        last_ns = record.timestamp_ns;
+        count++;
+    }
+    CHECK(count == forwarded);
+    goose_pcap_reader_close(&reader);
+
+    goose_free(handle);
+}
+
+int main(int argc, char** argv)
+{
+    char classic_path[512];
+    char ng_path[512];
+    char sink_path[512];
+    const char* prefix = argc > 1 ? argv[1] : "capture";
+
+    snprintf(classic_path, sizeof(classic_path), "%s.pcap", prefix);
+    snprintf(ng_path, sizeof(ng_path), "%s.pcapng", prefix);
+    snprintf(sink_path, sizeof(sink_path), "%s.sink.pcapng", prefix);
+
+    goose_publisher_init(goose_pcap_linkoutput);
+    goose_subscriber_init();
+
+    build_scenario();
+    test_round_trip(ng_path, GOOSE_PCAP_NG);
+    test_round_trip(classic_path, GOOSE_PCAP_CLASSIC);
+    test_foreign_files();
+    test_analysis(classic_path);
+    test_analysis(ng_path);
+    test_replay(classic_path);
+    test_capture_sink(sink_path);
+    remove(sink_path);
+
+    if (failures == 0)
+    {
+        printf("test_pcap passed\n");
+    }
+    return failures == 0 ? 0 : 1;
+}
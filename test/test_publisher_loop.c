@@ -0,0 +1,136 @@
+#include <pthread.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <time.h>
+#include "goose.h"
+#include "goose_publisher.h"
+#include "goose_publisher_loop.h"
+#include "test_util.h"
+
+// Deadline scheduling of the publisher, on a virtual clock and through the timerfd loop
+
+#define CHECK(cond) do { if (!(cond)) { printf("FAILED %s:%d: %s\n", __FILE__, __LINE__, #cond); failures++; } } while (0)
+#define MS 1000000ULL
+#define SLACK (MS / 2)
+
+static int failures = 0;
+static volatile int stop = 0;
+
+static void* loop_thread(void* arg)
+{
+    (void)arg;
+    goose_publisher_loop_run(&stop);
+    return NULL;
+}
+
+static goose_handle* make_handle(void)
+{
+    uint8_t zero = 0;
+    goose_handle* handle = test_make_handle(0x05, 0x53, "IED1/LLN0$GO$Loop", 0);
+    goose_all_data_entry_add(handle, 0x83, sizeof(zero), &zero);
+    return handle;
+}
+
+static void test_virtual_clock(void)
+{
+    goose_handle* handle = make_handle();
+    const uint64_t t0 = 1000 * MS;
+
+    goose_message_params message = { 0 };
+    message.name = "virtual";
+    message.handle = handle;
+    message.default_time_allowed_to_live = 1000;
+    message.updated = 1;
+    goose_publisher_register(message);
+
+    CHECK(goose_publisher_next_deadline() == 0);
+
+    test_frame_count = 0;
+    goose_publisher_process_at(t0);
+    CHECK(test_frame_count == 1);
+    CHECK(goose_publisher_next_deadline() == t0 + 3 * MS);
+
+    // Nothing is sent early
+    goose_publisher_process_at(t0 + 3 * MS - 1);
+    CHECK(test_frame_count == 1);
+
+    // Served half a millisecond late, the next deadline still follows the curve
+    goose_publisher_process_at(t0 + 3 * MS + MS / 2);
+    CHECK(test_frame_count == 2);
+    CHECK(goose_publisher_next_deadline() == t0 + 9 * MS);
+
+    // Far behind schedule, the curve restarts from now instead of bursting to catch up
+    goose_publisher_process_at(t0 + 100 * MS);
+    CHECK(test_frame_count == 3);
+    CHECK(goose_publisher_next_deadline() == t0 + 112 * MS);
+
+    goose_publisher_deregister("virtual");
+    CHECK(goose_publisher_next_deadline() == GOOSE_PUBLISHER_NO_DEADLINE);
+    goose_free(handle);
+}
+
+static void test_timerfd_loop(void)
+{
+    goose_handle* handle = make_handle();
+    pthread_t thread;
+
+    // Registered without a pending state and with a long heartbeat, so the
+    // loop has nothing to do until the notify below
+    goose_message_params message = { 0 };
+    message.name = "loop";
+    message.handle = handle;
+    message.default_time_allowed_to_live = 60000;
+    message.current_time_allowed_to_live = 60000;
+    message.next_transmission = goose_publisher_loop_now() + 60000 * MS;
+    goose_publisher_register(message);
+
+    test_frame_count = 0;
+    CHECK(goose_publisher_loop_init() == 0);
+    pthread_create(&thread, NULL, loop_thread, NULL);
+
+    struct timespec idle = { 0, 20 * MS };
+    nanosleep(&idle, NULL);
+    CHECK(test_frame_count == 0);
+
+    uint64_t notified = goose_publisher_loop_now();
+    goose_publisher_notify("loop");
+
+    struct timespec burst = { 0, 100 * MS };
+    nanosleep(&burst, NULL);
+
+    stop = 1;
+    goose_publisher_notify("loop");
+    pthread_join(thread, NULL);
+    goose_publisher_loop_free();
+
+    // State change, then retransmissions 3, 6, 12, 24 and 48 ms apart. Timers
+    // never fire early and the curve is anchored at the state change, so each
+    // frame is at least its offset on the curve after the first one, give or
+    // take the time the first frame spent in encode and output.
+    static const uint64_t curve[] = { 3, 6, 12, 24, 48 };
+    CHECK(test_frame_count >= 3);
+    CHECK(test_frames[0].time_ns >= notified);
+    for (size_t i = 1; i < test_frame_count && i <= 5; i++)
+    {
+        uint64_t expected = 0;
+        for (size_t j = 0; j < i; j++) expected += curve[j] * MS;
+        CHECK(test_frames[i].time_ns - test_frames[0].time_ns + SLACK >= expected);
+    }
+
+    goose_publisher_deregister("loop");
+    goose_free(handle);
+}
+
+int main(void)
+{
+    goose_publisher_init(test_capture_output);
+
+    test_virtual_clock();
+    test_timerfd_loop();
+
+    if (failures == 0)
+    {
+        printf("test_publisher_loop passed\n");
+    }
+    return failures == 0 ? 0 : 1;
+}
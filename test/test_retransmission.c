@@ -0,0 +1,252 @@
+#include <stdio.h>
+#include <stdint.h>
+#include "goose.h"
+#include "goose_publisher.h"
+#include "goose_retransmission.h"
+#include "goose_stats.h"
+#include "test_util.h"
+
+// Retransmission curves compiled to step tables and followed by the publisher
+
+#define CHECK(cond) do { if (!(cond)) { printf("FAILED %s:%d: %s\n", __FILE__, __LINE__, #cond); failures++; } } while (0)
+#define US 1000ULL
+#define MS 1000000ULL
+
+static int failures = 0;
+
+static goose_handle* make_handle(void)
+{
+    uint8_t zero = 0;
+    goose_handle* handle = test_make_handle(0x05, 0x53, "IED1/LLN0$GO$Curve", 0);
+    goose_all_data_entry_add(handle, 0x83, sizeof(zero), &zero);
+    return handle;
+}
+
+// Runs one state change through the publisher and checks every deadline and advertised TATL
+static void follow_curve(const goose_retransmission_profile* profile, const uint64_t* intervals, const uint32_t* tatl, size_t steps, uint16_t heartbeat)
+{
+    goose_handle* handle = make_handle();
+    uint64_t now = 5000 * MS;
+
+    goose_message_params message = { 0 };
+    message.name = "curve";
+    message.handle = handle;
+    message.default_time_allowed_to_live = heartbeat;
+    message.profile = profile;
+    message.updated = 1;
+    goose_publisher_register(message);
+
+    test_frame_count = 0;
+    goose_publisher_process_at(now);
+
+    for (size_t i = 0; i < steps; i++)
+    {
+        CHECK(test_frame_field(&test_frames[i], TAG_TIME_ALLOWED_TO_LIVE) == tatl[i]);
+        CHECK(goose_publisher_next_deadline() == now + intervals[i]);
+        now += intervals[i];
+        goose_publisher_process_at(now);
+        CHECK(test_frame_count == i + 2);
+        CHECK(test_frame_field(&test_frames[i + 1], TAG_SQ_NUM) == i + 1);
+    }
+
+    // Off the curve, heartbeats at the default TATL
+    CHECK(test_frame_field(&test_frames[steps], TAG_TIME_ALLOWED_TO_LIVE) == (uint32_t)heartbeat * profile->time_allowed_to_live_factor);
+    CHECK(goose_publisher_next_deadline() == now + heartbeat * MS);
+
+    goose_publisher_deregister("curve");
+    goose_free(handle);
+}
+
+static void test_default_profile(void)
+{
+    static const uint64_t intervals[] = { 3 * MS, 6 * MS, 12 * MS, 24 * MS, 48 * MS, 96 * MS, 192 * MS };
+    static const uint32_t tatl[] = { 3, 6, 12, 24, 48, 96, 192 };
+
+    follow_curve(&goose_retransmission_profile_default, intervals, tatl, 7, 1000);
+}
+
+static void test_explicit_profile(void)
+{
+    static const uint32_t curve_us[] = { 1000, 1000, 2000, 4000, 8000 };
+    static const uint64_t intervals[] = { 1 * MS, 1 * MS, 2 * MS, 4 * MS, 8 * MS };
+    static const uint32_t tatl[] = { 2, 2, 4, 8, 16 };
+    goose_retransmission_profile profile;
+
+    goose_retransmission_curve curve = { 0 };
+    curve.intervals_us = curve_us;
+    curve.interval_count = 5;
+    curve.time_allowed_to_live_factor = 2;
+
+    CHECK(goose_retransmission_profile_compile(&profile, &curve) == 0);
+    CHECK(profile.step_count == 5);
+    follow_curve(&profile, intervals, tatl, 5, 500);
+}
+
+static void test_geometric_profile(void)
+{
+    static const uint64_t intervals[] = { 2 * MS, 4 * MS, 8 * MS, 16 * MS };
+    static const uint32_t tatl[] = { 2, 4, 8, 16 };
+    goose_retransmission_profile profile;
+
+    goose_retransmission_curve curve = { 0 };
+    curve.first_interval_us = 2000;
+    curve.multiplier = 2;
+    curve.max_interval_us = 16000;
+
+    CHECK(goose_retransmission_profile_compile(&profile, &curve) == 0);
+    CHECK(profile.step_count == 4);
+    follow_curve(&profile, intervals, tatl, 4, 2000);
+}
+
+static void test_sub_millisecond_profile(void)
+{
+    static const uint32_t curve_us[] = { 250, 500 };
+    goose_retransmission_profile profile;
+
+    goose_retransmission_curve curve = { 0 };
+    curve.intervals_us = curve_us;
+    curve.interval_count = 2;
+
+    // Intervals keep microsecond resolution, TATL rounds up to whole milliseconds
+    CHECK(goose_retransmission_profile_compile(&profile, &curve) == 0);
+    CHECK(profile.interval_ns[0] == 250 * US);
+    CHECK(profile.time_allowed_to_live[0] == 1);
+}
+
+static void test_invalid_curves(void)
+{
+    static const uint32_t zero_us[] = { 1000, 0 };
+    goose_retransmission_profile profile;
+    goose_retransmission_curve curve = { 0 };
+
+    CHECK(goose_retransmission_profile_compile(&profile, &curve) != 0);
+
+    curve.intervals_us = zero_us;
+    curve.interval_count = 2;
+    CHECK(goose_retransmission_profile_compile(&profile, &curve) != 0);
+
+    curve.intervals_us = NULL;
+    curve.first_interval_us = 1000;
+    curve.multiplier = 1;
+    curve.max_interval_us = 8000;
+    CHECK(goose_retransmission_profile_compile(&profile, &curve) != 0);
+}
+
+// A zero heartbeat would never leave the timer loop and a heartbeat TATL past 16 bits
+// would wrap, both are refused at registration
+static void test_invalid_heartbeats(void)
+{
+    goose_handle* handle = make_handle();
+    goose_retransmission_profile profile = goose_retransmission_profile_default;
+    profile.time_allowed_to_live_factor = 2;
+
+    goose_message_params message = { 0 };
+    message.name = "heartbeat";
+    message.handle = handle;
+    CHECK(goose_publisher_register(message) == -1);
+
+    message.default_time_allowed_to_live = 40000;
+    message.profile = &profile;
+    CHECK(goose_publisher_register(message) == -1);
+
+    message.default_time_allowed_to_live = 32767;
+    CHECK(goose_publisher_register(message) == 0);
+    goose_publisher_deregister("heartbeat");
+
+    for (size_t i = 0; i < MAX_GOOSE_MESSAGES; i++)
+    {
+        CHECK(goose_publisher_register(message) == 0);
+    }
+    CHECK(goose_publisher_register(message) == -1);
+    for (size_t i = 0; i < MAX_GOOSE_MESSAGES; i++)
+    {
+        goose_publisher_deregister("heartbeat");
+    }
+
+    goose_free(handle);
+}
+
+// A message registered without a state change goes straight to heartbeats with stNum 0,
+// as the fixed-tick publisher did, instead of running the fast curve
+static void test_idle_register(void)
+{
+    goose_handle* handle = make_handle();
+    uint64_t now = 6000 * MS;
+
+    goose_message_params message = { 0 };
+    message.name = "idle";
+    message.handle = handle;
+    message.default_time_allowed_to_live = 1000;
+    message.next_transmission = now;
+    CHECK(goose_publisher_register(message) == 0);
+
+    test_frame_count = 0;
+    goose_publisher_process_at(now);
+    CHECK(test_frame_count == 1);
+    CHECK(test_frame_field(&test_frames[0], TAG_ST_NUM) == 0);
+    CHECK(test_frame_field(&test_frames[0], TAG_SQ_NUM) == 1);
+    CHECK(test_frame_field(&test_frames[0], TAG_TIME_ALLOWED_TO_LIVE) == 1000);
+    CHECK(goose_publisher_next_deadline() == now + 1000 * MS);
+
+    // The first notify starts the curve as usual
+    goose_publisher_notify("idle");
+    goose_publisher_process_at(now + 1 * MS);
+    CHECK(test_frame_count == 2);
+    CHECK(test_frame_field(&test_frames[1], TAG_ST_NUM) == 1);
+    CHECK(test_frame_field(&test_frames[1], TAG_TIME_ALLOWED_TO_LIVE) == 3);
+    CHECK(goose_publisher_next_deadline() == now + 4 * MS);
+
+    goose_publisher_deregister("idle");
+    goose_free(handle);
+}
+
+// Encode time is each frame's own encode, the output call is not part of it
+static void test_encode_time(void)
+{
+#if GOOSE_STATS
+    goose_handle* handle = make_handle();
+    uint64_t now = 7000 * MS;
+    goose_stats_control_block before;
+    goose_stats_control_block after;
+
+    test_output_delay_ns = 2 * MS;
+    goose_stats_control_block_snapshot(0, &before);
+
+    goose_message_params message = { 0 };
+    message.name = "slow";
+    message.handle = handle;
+    message.default_time_allowed_to_live = 1000;
+    message.updated = 1;
+    CHECK(goose_publisher_register(message) == 0);
+    goose_publisher_process_at(now);
+    goose_publisher_process_at(now + 3 * MS);
+
+    goose_stats_control_block_snapshot(0, &after);
+    CHECK(after.encode_ns.count - before.encode_ns.count == 2);
+    CHECK(after.encode_ns.max < test_output_delay_ns / 2);
+
+    test_output_delay_ns = 0;
+    goose_publisher_deregister("slow");
+    goose_free(handle);
+#endif
+}
+
+int main(void)
+{
+    goose_publisher_init(test_capture_output);
+
+    test_default_profile();
+    test_explicit_profile();
+    test_geometric_profile();
+    test_sub_millisecond_profile();
+    test_invalid_curves();
+    test_invalid_heartbeats();
+    test_idle_register();
+    test_encode_time();
+
+    if (failures == 0)
+    {
+        printf("test_retransmission passed\n");
+    }
+    return failures == 0 ? 0 : 1;
+}
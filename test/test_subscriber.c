@@ -0,0 +1,274 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include "goose.h"
+#include "goose_publisher.h"
+#include "goose_subscriber.h"
+#include "goose_stats.h"
+
+// Publisher and subscriber wired back to back through the linkoutput hook
+
+#define CHECK(cond) do { if (!(cond)) { printf("FAILED %s:%d: %s\n", __FILE__, __LINE__, #cond); failures++; } } while (0)
+
+static int failures = 0;
+static size_t state_changes = 0;
+static size_t expirations = 0;
+static uint8_t last_value = 0xff;
+
+static const char* gocbref = "CPC UNIFEI/LLN0$GO$TestDataSet";
+
+static void on_event(goose_subscription_params* subscription, goose_subscriber_event event, goose_frame_view* view)
+{
+    (void)subscription;
+
+    if (event == GOOSE_SUBSCRIBER_STATE_CHANGE)
+    {
+        state_changes++;
+        if (view->all_data_list.entry_count == 4 && view->all_data_list.entries[0].length == 1)
+        {
+            last_value = view->all_data_list.entries[0].value[0];
+        }
+    }
+    else
+    {
+        expirations++;
+    }
+}
+
+static goose_handle* make_handle(void)
+{
+    uint8_t source[MAC_ADDRESS_SIZE] = { 0x00, 0x30, 0xa7, 0x03, 0xc1, 0x53 };
+    uint8_t destination[MAC_ADDRESS_SIZE] = GOOSE_MULTICAST_ADDRESS(0x00, 0x01);
+    uint8_t app_id[APP_ID_SIZE] = { 0x00, 0x00 };
+    const char* dataset = "CPC UNIFEI/LLN0$TestDataSet";
+    const char* go_id = "CPC UNIFEI GOID";
+    uint64_t t = goose_htonll(1695149275408396764ULL);
+    uint8_t zero = 0;
+    uint8_t conf_rev = 1;
+
+    goose_handle* handle = goose_init(source, destination, app_id);
+
+    ber_set(&(handle->frame->pdu_list.gocbref), (uint8_t*)gocbref, strlen(gocbref));
+    ber_set(&(handle->frame->pdu_list.dataset), (uint8_t*)dataset, strlen(dataset));
+    ber_set(&(handle->frame->pdu_list.go_id), (uint8_t*)go_id, strlen(go_id));
+    ber_set(&(handle->frame->pdu_list.t), (uint8_t*)&t, sizeof(t));
+    ber_set(&(handle->frame->pdu_list.simulation), &zero, sizeof(zero));
+    ber_set(&(handle->frame->pdu_list.conf_rev), &conf_rev, sizeof(conf_rev));
+    ber_set(&(handle->frame->pdu_list.nds_com), &zero, sizeof(zero));
+
+    for (int i = 0; i < 4; i++)
+    {
+        goose_all_data_entry_add(handle, 0x83, sizeof(zero), &zero);
+    }
+
+    return handle;
+}
+
+static void tick(size_t count)
+{
+    for (size_t i = 0; i < count; i++)
+    {
+        goose_publisher_process();
+        goose_subscriber_process();
+    }
+}
+
+static const char* matched = NULL;
+
+static void on_match(goose_subscription_params* subscription, goose_subscriber_event event, goose_frame_view* view)
+{
+    (void)view;
+    if (event == GOOSE_SUBSCRIBER_STATE_CHANGE)
+    {
+        matched = subscription->name;
+    }
+}
+
+// gocbref is compared over its full length, and a NULL gocbref takes any control block
+static void test_gocbref_match(goose_handle* handle)
+{
+    uint32_t st_num = goose_htonl(9);
+    ber_set(&(handle->frame->pdu_list.st_num), (uint8_t*)&st_num, sizeof(st_num));
+    goose_encode(handle);
+
+    goose_subscriber_deregister("sub");
+    goose_subscription_params subscription = { 0 };
+    subscription.name = "prefix";
+    subscription.gocbref = "CPC UNIFEI/LLN0";
+    subscription.callback = on_match;
+    goose_subscriber_register(subscription);
+
+    goose_subscriber_input(handle->byte_stream, handle->length);
+    CHECK(matched == NULL);
+
+    subscription.name = "any";
+    subscription.gocbref = NULL;
+    goose_subscriber_register(subscription);
+
+    goose_subscriber_input(handle->byte_stream, handle->length);
+    CHECK(matched != NULL && strcmp(matched, "any") == 0);
+
+    goose_subscriber_deregister("prefix");
+    goose_subscriber_deregister("any");
+}
+
+// Sends the handle's frame with the given counters, as a publisher would
+static void receive(goose_handle* handle, uint32_t st_num, uint32_t sq_num, uint16_t time_allowed_to_live)
+{
+    uint32_t st_num_net = goose_htonl(st_num);
+    uint32_t sq_num_net = goose_htonl(sq_num);
+    uint16_t time_allowed_to_live_net = goose_htons(time_allowed_to_live);
+
+    ber_set(&(handle->frame->pdu_list.st_num), (uint8_t*)&st_num_net, sizeof(st_num_net));
+    ber_set(&(handle->frame->pdu_list.sq_num), (uint8_t*)&sq_num_net, sizeof(sq_num_net));
+    ber_set(&(handle->frame->pdu_list.time_allowed_to_live), (uint8_t*)&time_allowed_to_live_net, sizeof(time_allowed_to_live_net));
+    goose_encode(handle);
+    goose_subscriber_input(handle->byte_stream, handle->length);
+}
+
+static void subscriber_ticks(size_t count)
+{
+    for (size_t i = 0; i < count; i++)
+    {
+        goose_subscriber_process();
+    }
+}
+
+// sqNum wraps from UINT32_MAX to 0 within a state; the retransmission after the wrap
+// still refreshes the supervision, a repeated one does not
+static void test_sq_num_wrap(goose_handle* handle)
+{
+    goose_subscription_params subscription = { 0 };
+    subscription.name = "wrap";
+    subscription.gocbref = gocbref;
+    subscription.callback = on_event;
+    goose_subscriber_register(subscription);
+
+    size_t changes = state_changes;
+    size_t expired = expirations;
+
+    receive(handle, 30, UINT32_MAX - 1, 5);
+    CHECK(state_changes == changes + 1);
+    subscriber_ticks(4);
+    receive(handle, 30, UINT32_MAX, 5);
+    subscriber_ticks(4);
+    receive(handle, 30, 0, 5);
+    subscriber_ticks(4);
+    CHECK(expirations == expired);
+
+    receive(handle, 30, UINT32_MAX, 5);
+    subscriber_ticks(4);
+    CHECK(expirations == expired + 1);
+    CHECK(state_changes == changes + 1);
+
+    goose_subscriber_deregister("wrap");
+}
+
+static size_t reentries = 0;
+static goose_subscriber_event deregister_on;
+
+static void on_event_deregister(goose_subscription_params* subscription, goose_subscriber_event event, goose_frame_view* view)
+{
+    (void)view;
+    reentries++;
+    if (event == deregister_on)
+    {
+        goose_subscriber_deregister(subscription->name);
+    }
+}
+
+// Callbacks run outside the subscriber lock, so one can deregister its own subscription
+static void test_callback_reentry(goose_handle* handle)
+{
+    goose_subscription_params subscription = { 0 };
+    subscription.name = "once";
+    subscription.gocbref = gocbref;
+    subscription.callback = on_event_deregister;
+
+    deregister_on = GOOSE_SUBSCRIBER_STATE_CHANGE;
+    goose_subscriber_register(subscription);
+    receive(handle, 40, 0, 100);
+    receive(handle, 41, 0, 100);
+    CHECK(reentries == 1);
+
+    // And from a TATL expiry
+    deregister_on = GOOSE_SUBSCRIBER_TATL_EXPIRED;
+    goose_subscriber_register(subscription);
+    receive(handle, 42, 0, 1);
+    CHECK(reentries == 2);
+    subscriber_ticks(2);
+    CHECK(reentries == 3);
+    receive(handle, 43, 0, 1);
+    CHECK(reentries == 3);
+}
+
+int main(void)
+{
+    goose_handle* handle = make_handle();
+
+    goose_publisher_init(goose_subscriber_input);
+    goose_subscriber_init();
+
+    goose_subscription_params subscription = { 0 };
+    subscription.name = "sub";
+    subscription.gocbref = gocbref;
+    subscription.app_id = 0x0000;
+    subscription.callback = on_event;
+    goose_subscriber_register(subscription);
+
+    goose_message_params message = { 0 };
+    message.name = "pub";
+    message.handle = handle;
+    message.default_time_allowed_to_live = 100;
+    message.updated = 1;
+    goose_publisher_register(message);
+
+    // Initial state plus the whole retransmission burst and a few heartbeats
+    tick(1000);
+    CHECK(state_changes == 1);
+    CHECK(expirations == 0);
+    CHECK(last_value == 0);
+
+    uint8_t one = 1;
+    goose_all_data_entry_modify(handle, 0, 0x83, sizeof(one), &one);
+    goose_publisher_notify("pub");
+    tick(10);
+    CHECK(state_changes == 2);
+    CHECK(last_value == 1);
+
+    // Publisher goes silent, the subscription must time out exactly once
+    goose_publisher_deregister("pub");
+    for (size_t i = 0; i < 500; i++)
+    {
+        goose_subscriber_process();
+    }
+    CHECK(expirations == 1);
+
+#if GOOSE_STATS
+    goose_stats_control_block control_block;
+    goose_stats_subscription sub_stats;
+    goose_stats_control_block_snapshot(0, &control_block);
+    goose_stats_subscription_snapshot(0, &sub_stats);
+
+    CHECK(control_block.state_changes == 2);
+    CHECK(control_block.frames_sent == control_block.state_changes + control_block.retransmissions);
+    CHECK(control_block.encode_ns.count == control_block.frames_sent);
+    CHECK(control_block.notify_to_output_ns.count == 1);
+    CHECK(sub_stats.received == control_block.frames_sent);
+    CHECK(sub_stats.fast_pathed == control_block.retransmissions);
+    CHECK(sub_stats.dropped == 0);
+    CHECK(sub_stats.tatl_expired == 1);
+#endif
+
+    test_gocbref_match(handle);
+    test_sq_num_wrap(handle);
+    test_callback_reentry(handle);
+
+    goose_free(handle);
+
+    if (failures == 0)
+    {
+        printf("test_subscriber passed\n");
+    }
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,217 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include "goose.h"
+#include "goose_publisher.h"
+#include "iec_time.h"
+
+// UtcTime encoding, accuracy of iec_time_stamp against the system clock and T stamping by the publisher
+
+#define CHECK(cond) do { if (!(cond)) { printf("FAILED %s:%d: %s\n", __FILE__, __LINE__, #cond); failures++; } } while (0)
+#define NS 1000000000LL
+#define FRACTION_NS 60	// One step of the 24-bit fraction, rounded up
+
+static int failures = 0;
+static uint8_t last_frame[1524];
+static size_t last_length = 0;
+
+static int64_t timespec_ns(const struct timespec* ts)
+{
+    return (int64_t)ts->tv_sec * NS + ts->tv_nsec;
+}
+
+static int64_t iec_time_ns(const iec_time* time)
+{
+    return (int64_t)time->seconds * NS + time->nanoseconds;
+}
+
+static int64_t realtime_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return timespec_ns(&ts);
+}
+
+static void capture_output(uint8_t* byte_stream, size_t length)
+{
+    memcpy(last_frame, byte_stream, length);
+    last_length = length;
+}
+
+static void test_encoding(void)
+{
+    iec_time time = { 0x5f5e1000, 0 };
+    iec_time decoded;
+    uint8_t quality = 0;
+    uint8_t out[IEC_TIME_UTC_SIZE];
+    uint32_t state = 12345;
+
+    iec_time_encode(&time, 0x8a, out);
+    CHECK(out[0] == 0x5f && out[1] == 0x5e && out[2] == 0x10 && out[3] == 0x00);
+    CHECK(out[4] == 0 && out[5] == 0 && out[6] == 0);
+    CHECK(out[7] == 0x8a);
+
+    // Half a second is fraction 0x800000
+    time.nanoseconds = 500000000;
+    iec_time_encode(&time, 0, out);
+    CHECK(out[4] == 0x80 && out[5] == 0x00 && out[6] == 0x00);
+
+    time.nanoseconds = 999999999;
+    iec_time_encode(&time, 0, out);
+    CHECK(out[4] == 0xff && out[5] == 0xff && out[6] == 0xff);
+
+    // Fraction is exactly floor(ns * 2^24 / 10^9), and decoding comes back at most one step early
+    for (size_t i = 0; i < 100000; i++)
+    {
+        state = state * 1103515245u + 12345u;
+        time.nanoseconds = state % (uint32_t)NS;
+        iec_time_encode(&time, 0x0a, out);
+
+        uint32_t fraction = ((uint32_t)out[4] << 16) | ((uint32_t)out[5] << 8) | out[6];
+        uint32_t expected = (uint32_t)(((uint64_t)time.nanoseconds * 16777216ULL) / (uint64_t)NS);
+        CHECK(fraction == expected);
+
+        iec_time_decode(out, &decoded, &quality);
+        int64_t error = iec_time_ns(&decoded) - iec_time_ns(&time);
+        CHECK(error >= -FRACTION_NS && error <= 0);
+        CHECK(quality == 0x0a);
+        if (failures) break;
+    }
+}
+
+static void test_accuracy(void)
+{
+    uint8_t out[IEC_TIME_UTC_SIZE];
+    iec_time stamped;
+    uint8_t quality;
+
+    iec_time_configure(IEC_TIME_CLOCK_REALTIME, 0, IEC_TIME_QUALITY_LEAP_SECONDS_KNOWN | 20);
+
+    // Every stamp lies between two reads of the system clock taken around it
+    for (size_t i = 0; i < 10000; i++)
+    {
+        int64_t before = realtime_ns();
+        iec_time_stamp(out);
+        int64_t after = realtime_ns();
+
+        iec_time_decode(out, &stamped, &quality);
+        CHECK(iec_time_ns(&stamped) >= before - FRACTION_NS);
+        CHECK(iec_time_ns(&stamped) <= after + FRACTION_NS);
+        CHECK(quality == (IEC_TIME_QUALITY_LEAP_SECONDS_KNOWN | 20));
+        if (failures) break;
+    }
+
+#if defined(CLOCK_TAI)
+    // TAI is brought back to UTC with the configured offset
+    struct timespec ts;
+    iec_time_configure(IEC_TIME_CLOCK_TAI, 37, IEC_TIME_QUALITY_LEAP_SECONDS_KNOWN | 20);
+    clock_gettime(CLOCK_TAI, &ts);
+    int64_t before = timespec_ns(&ts);
+    iec_time_stamp(out);
+    clock_gettime(CLOCK_TAI, &ts);
+    int64_t after = timespec_ns(&ts);
+
+    iec_time_decode(out, &stamped, NULL);
+    CHECK(iec_time_ns(&stamped) + 37 * NS >= before - FRACTION_NS);
+    CHECK(iec_time_ns(&stamped) + 37 * NS <= after + FRACTION_NS);
+#endif
+
+    iec_time_configure(IEC_TIME_CLOCK_REALTIME, 0, 0x0a);
+}
+
+static void test_in_place(void)
+{
+    uint8_t source[MAC_ADDRESS_SIZE] = { 0x00, 0x30, 0xa7, 0x03, 0xc1, 0x53 };
+    uint8_t destination[MAC_ADDRESS_SIZE] = GOOSE_MULTICAST_ADDRESS(0x00, 0x01);
+    uint8_t app_id[APP_ID_SIZE] = { 0x00, 0x05 };
+    const char* gocbref = "IED1/LLN0$GO$Time";
+    uint8_t first[IEC_TIME_UTC_SIZE] = { 0x65, 0x0a, 0x2b, 0x1c, 0x12, 0x34, 0x56, 0x0a };
+    uint8_t second[IEC_TIME_UTC_SIZE] = { 0x65, 0x0a, 0x2b, 0x1d, 0xab, 0xcd, 0xef, 0x8a };
+    uint8_t patched[1524];
+    uint8_t value = 1;
+
+    goose_handle* handle = goose_init(source, destination, app_id);
+    ber_set(&(handle->frame->pdu_list.gocbref), (uint8_t*)gocbref, strlen(gocbref));
+    goose_all_data_entry_add(handle, 0x83, sizeof(value), &value);
+
+    goose_t_set(handle, first);
+    goose_encode(handle);
+    size_t offset = handle->field_offset[TAG_T - TAG_GOCBREF];
+    CHECK(offset != 0);
+    CHECK(handle->byte_stream[offset - 2] == TAG_T);
+    CHECK(memcmp(&handle->byte_stream[offset], first, IEC_TIME_UTC_SIZE) == 0);
+
+    // Patching the encoded frame gives the same bytes as encoding again
+    goose_t_set(handle, second);
+    memcpy(patched, handle->byte_stream, handle->length);
+    goose_encode(handle);
+    CHECK(memcmp(patched, handle->byte_stream, handle->length) == 0);
+    CHECK(memcmp(&handle->byte_stream[offset], second, IEC_TIME_UTC_SIZE) == 0);
+
+    goose_free(handle);
+}
+
+static void test_publisher_stamping(void)
+{
+    uint8_t source[MAC_ADDRESS_SIZE] = { 0x00, 0x30, 0xa7, 0x03, 0xc1, 0x53 };
+    uint8_t destination[MAC_ADDRESS_SIZE] = GOOSE_MULTICAST_ADDRESS(0x00, 0x01);
+    uint8_t app_id[APP_ID_SIZE] = { 0x00, 0x05 };
+    const char* gocbref = "IED1/LLN0$GO$Stamped";
+    uint8_t value = 1;
+    uint64_t now = 1000 * 1000000ULL;
+    goose_frame_view view;
+    iec_time stamped;
+    uint8_t quality;
+    uint8_t t[IEC_TIME_UTC_SIZE];
+
+    goose_handle* handle = goose_init(source, destination, app_id);
+    ber_set(&(handle->frame->pdu_list.gocbref), (uint8_t*)gocbref, strlen(gocbref));
+    goose_all_data_entry_add(handle, 0x83, sizeof(value), &value);
+
+    goose_publisher_init(capture_output);
+    goose_message_params message = { 0 };
+    message.name = "stamped";
+    message.handle = handle;
+    message.default_time_allowed_to_live = 1000;
+    message.time_stamping = 1;
+    goose_publisher_register(message);
+    goose_publisher_process_at(now);
+
+    // T is the time of the notify, not of the transmission
+    int64_t before = realtime_ns();
+    goose_publisher_notify("stamped");
+    int64_t after = realtime_ns();
+    goose_publisher_process_at(now + 5000000ULL);
+
+    CHECK(goose_decode(last_frame, last_length, &view) == 0);
+    CHECK(view.fields[TAG_T - TAG_GOCBREF].length == IEC_TIME_UTC_SIZE);
+    iec_time_decode(view.fields[TAG_T - TAG_GOCBREF].value, &stamped, &quality);
+    CHECK(iec_time_ns(&stamped) >= before - FRACTION_NS);
+    CHECK(iec_time_ns(&stamped) <= after + FRACTION_NS);
+    CHECK(quality == iec_time_quality());
+    memcpy(t, view.fields[TAG_T - TAG_GOCBREF].value, IEC_TIME_UTC_SIZE);
+
+    // Retransmissions carry the T of their state change
+    goose_publisher_process_at(now + 8000000ULL);
+    CHECK(goose_decode(last_frame, last_length, &view) == 0);
+    CHECK(goose_field_uint(&view.fields[TAG_SQ_NUM - TAG_GOCBREF]) == 1);
+    CHECK(memcmp(view.fields[TAG_T - TAG_GOCBREF].value, t, IEC_TIME_UTC_SIZE) == 0);
+
+    goose_publisher_deregister("stamped");
+    goose_free(handle);
+}
+
+int main(void)
+{
+    test_encoding();
+    test_accuracy();
+    test_in_place();
+    test_publisher_stamping();
+
+    if (failures == 0)
+    {
+        printf("test_time passed\n");
+    }
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,76 @@
+#include "test_util.h"
+#include <string.h>
+#include <time.h>
+
+test_captured_frame test_frames[TEST_FRAMES];
+test_captured_frame test_last_frame;
+size_t test_frame_count = 0;
+uint64_t test_output_delay_ns = 0;
+
+static uint64_t test_now_ns(void)
+{
+    struct timespec ts;
+#if defined(CLOCK_MONOTONIC)
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+#else
+    timespec_get(&ts, TIME_UTC);
+#endif
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+void test_capture_output(uint8_t* byte_stream, size_t length)
+{
+    uint64_t start = test_now_ns();
+    while (test_output_delay_ns && test_now_ns() - start < test_output_delay_ns)
+    {
+    }
+
+    if (length > sizeof(test_last_frame.bytes))
+    {
+        length = sizeof(test_last_frame.bytes);
+    }
+    memcpy(test_last_frame.bytes, byte_stream, length);
+    test_last_frame.length = length;
+    test_last_frame.time_ns = start;
+
+    if (test_frame_count < TEST_FRAMES)
+    {
+        test_frames[test_frame_count] = test_last_frame;
+    }
+    test_frame_count++;
+}
+
+uint32_t test_frame_field(test_captured_frame* frame, uint8_t tag)
+{
+    goose_frame_view view;
+    if (tag < TAG_GOCBREF || tag > TAG_NUM_DATASET_ENTRIES || goose_decode(frame->bytes, frame->length, &view) != 0)
+    {
+        return 0;
+    }
+    return goose_field_uint(&view.fields[tag - TAG_GOCBREF]);
+}
+
+uint32_t test_frame_member(test_captured_frame* frame, size_t member)
+{
+    goose_frame_view view;
+    if (goose_decode(frame->bytes, frame->length, &view) != 0 || goose_decode_all_data(&view) <= (int)member)
+    {
+        return 0;
+    }
+    return goose_field_uint(&view.all_data_list.entries[member]);
+}
+
+goose_handle* test_make_handle(uint8_t app_id_low, uint8_t source_low, const char* gocbref, int vlan)
+{
+    uint8_t source[MAC_ADDRESS_SIZE] = { 0x00, 0x30, 0xa7, 0x03, 0xc1, source_low };
+    uint8_t destination[MAC_ADDRESS_SIZE] = GOOSE_MULTICAST_ADDRESS(0x00, 0x01);
+    uint8_t app_id[APP_ID_SIZE] = { 0x00, app_id_low };
+
+    goose_handle* handle = goose_init(source, destination, app_id);
+    if (vlan)
+    {
+        goose_vlan_set(handle, 4, 0x010);
+    }
+    ber_set(&(handle->frame->pdu_list.gocbref), (uint8_t*)gocbref, strlen(gocbref));
+    return handle;
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include "goose.h"
+
+// Helpers shared by the test executables
+
+#define TEST_FRAMES 64
+
+typedef struct
+{
+    uint8_t bytes[sizeof(((goose_handle*)0)->byte_stream)];
+    size_t length;
+    uint64_t time_ns;	// CLOCK_MONOTONIC when the frame was output
+} test_captured_frame;
+
+// test_capture_output keeps the first TEST_FRAMES frames since test_frame_count was last
+// zeroed, and always the latest one. test_frame_count counts every frame.
+extern test_captured_frame test_frames[TEST_FRAMES];
+extern test_captured_frame test_last_frame;
+extern size_t test_frame_count;
+
+// Each output call is held this long, a link slower than any encode
+extern uint64_t test_output_delay_ns;
+
+void test_capture_output(uint8_t* byte_stream, size_t length);
+
+// Unsigned value of a PDU field (TAG_GOCBREF to TAG_NUM_DATASET_ENTRIES) or of an allData
+// member of a captured frame, 0 when it does not decode
+uint32_t test_frame_field(test_captured_frame* frame, uint8_t tag);
+uint32_t test_frame_member(test_captured_frame* frame, size_t member);
+
+// Control block on APPID 0x00<app_id_low> from 00:30:a7:03:c1:<source_low>, tagged with
+// priority 4 on VLAN 0x010 when vlan is set. Other fields and members are the caller's.
+goose_handle* test_make_handle(uint8_t app_id_low, uint8_t source_low, const char* gocbref, int vlan);
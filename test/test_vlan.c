@@ -0,0 +1,145 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include "goose.h"
+#include "goose_publisher.h"
+
+// 802.1Q tagging of encoded frames and priority-ordered publisher transmit
+
+#define CHECK(cond) do { if (!(cond)) { printf("FAILED %s:%d: %s\n", __FILE__, __LINE__, #cond); failures++; } } while (0)
+#define MS 1000000ULL
+
+static int failures = 0;
+static uint16_t sent_app_ids[16];
+static size_t sent_count = 0;
+
+static void capture_output(uint8_t* byte_stream, size_t length)
+{
+    goose_frame_view view;
+
+    if (goose_decode(byte_stream, length, &view) == 0 && sent_count < sizeof(sent_app_ids) / sizeof(sent_app_ids[0]))
+    {
+        sent_app_ids[sent_count++] = view.app_id;
+    }
+}
+
+static goose_handle* make_handle(uint16_t app_id_value)
+{
+    uint8_t source[MAC_ADDRESS_SIZE] = { 0x00, 0x30, 0xa7, 0x03, 0xc1, 0x53 };
+    uint8_t destination[MAC_ADDRESS_SIZE] = GOOSE_MULTICAST_ADDRESS(0x00, 0x01);
+    uint8_t app_id[APP_ID_SIZE] = { (uint8_t)(app_id_value >> 8), (uint8_t)app_id_value };
+    const char* gocbref = "IED1/LLN0$GO$Vlan";
+    uint8_t value = 1;
+
+    goose_handle* handle = goose_init(source, destination, app_id);
+    ber_set(&(handle->frame->pdu_list.gocbref), (uint8_t*)gocbref, strlen(gocbref));
+    goose_all_data_entry_add(handle, 0x83, sizeof(value), &value);
+
+    return handle;
+}
+
+static void test_tag_bytes(void)
+{
+    goose_handle* handle = make_handle(0x3001);
+    goose_frame_view view;
+
+    goose_encode(handle);
+    size_t untagged_length = handle->length;
+    CHECK(handle->byte_stream[12] == GOOSE_ETHERTYPE_0);
+    CHECK(handle->byte_stream[13] == GOOSE_ETHERTYPE_1);
+    CHECK(handle->byte_stream[14] == 0x30 && handle->byte_stream[15] == 0x01);
+    CHECK(goose_vlan_priority(handle) == GOOSE_DEFAULT_VLAN_PRIORITY);
+
+    // Priority 6, VLAN 0x123: TCI is 0xc123
+    goose_vlan_set(handle, 6, 0x123);
+    goose_encode(handle);
+    CHECK(handle->length == untagged_length + VLAN_TAG_SIZE);
+    CHECK(handle->byte_stream[12] == 0x81);
+    CHECK(handle->byte_stream[13] == 0x00);
+    CHECK(handle->byte_stream[14] == 0xc1);
+    CHECK(handle->byte_stream[15] == 0x23);
+    CHECK(handle->byte_stream[16] == GOOSE_ETHERTYPE_0);
+    CHECK(handle->byte_stream[17] == GOOSE_ETHERTYPE_1);
+    CHECK(handle->byte_stream[18] == 0x30 && handle->byte_stream[19] == 0x01);
+    CHECK(goose_vlan_priority(handle) == 6);
+
+    // The length field counts from APPID on and does not include the tag
+    size_t len = ((size_t)handle->byte_stream[20] << 8) | handle->byte_stream[21];
+    CHECK(len == handle->length - (MAC_ADDRESS_SIZE * 2 + VLAN_TAG_SIZE + ETHERTYPE_SIZE));
+
+    CHECK(goose_decode(handle->byte_stream, handle->length, &view) == 0);
+    CHECK(view.vlan_tagged == 1);
+    CHECK(view.vlan_tci == 0xc123);
+    CHECK(view.app_id == 0x3001);
+    CHECK(view.len == len);
+
+    // Out of range values leave the tag alone
+    goose_vlan_set(handle, 8, 0x123);
+    goose_vlan_set(handle, 1, 0x1000);
+    CHECK(goose_vlan_priority(handle) == 6);
+
+    goose_vlan_clear(handle);
+    goose_encode(handle);
+    CHECK(handle->length == untagged_length);
+    CHECK(handle->byte_stream[12] == GOOSE_ETHERTYPE_0);
+
+    goose_free(handle);
+}
+
+static void test_priority_order(void)
+{
+    static const char* names[] = { "p1", "p6", "p4", "p7" };
+    static const uint8_t priorities[] = { 1, 6, 4, 7 };
+    static const uint16_t expected[] = { 0x0007, 0x0006, 0x0004, 0x0001 };
+    goose_handle* handles[4];
+    uint64_t now = 1000 * MS;
+
+    goose_publisher_init(capture_output);
+
+    // Registration order is not priority order
+    for (size_t i = 0; i < 4; i++)
+    {
+        goose_message_params message = { 0 };
+        handles[i] = make_handle(priorities[i]);
+        goose_vlan_set(handles[i], priorities[i], 0);
+        message.name = names[i];
+        message.handle = handles[i];
+        message.default_time_allowed_to_live = 1000;
+        goose_publisher_register(message);
+    }
+    goose_publisher_process_at(now);
+
+    // Simultaneous state changes leave highest priority first
+    for (size_t i = 0; i < 4; i++)
+    {
+        goose_publisher_notify(names[i]);
+    }
+    sent_count = 0;
+    goose_publisher_process_at(now + MS);
+    CHECK(sent_count == 4);
+    CHECK(memcmp(sent_app_ids, expected, sizeof(expected)) == 0);
+
+    // The first retransmissions fall due together and keep the same order
+    sent_count = 0;
+    goose_publisher_process_at(now + 4 * MS);
+    CHECK(sent_count == 4);
+    CHECK(memcmp(sent_app_ids, expected, sizeof(expected)) == 0);
+
+    for (size_t i = 0; i < 4; i++)
+    {
+        goose_publisher_deregister(names[i]);
+        goose_free(handles[i]);
+    }
+}
+
+int main(void)
+{
+    test_tag_bytes();
+    test_priority_order();
+
+    if (failures == 0)
+    {
+        printf("test_vlan passed\n");
+    }
+    return failures == 0 ? 0 : 1;
+}
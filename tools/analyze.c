@@ -0,0 +1,254 @@
+#include "goose_pcap.h"
+#include "goose_analysis.h"
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+// goose_analyze [--threads N] CAPTURE
+// Per-stream statistics of a pcap or pcapng capture. One sequential pass over the mapped
+// file splits the frames by stream (source MAC and APPID) into per-worker lists, then the
+// workers decode and analyse their streams in parallel, each in capture order.
+
+#define MAX_WORKERS 256
+
+typedef struct
+{
+    const uint8_t* frame;
+    uint32_t length;
+    uint64_t timestamp_ns;
+} analyze_record;
+
+typedef struct
+{
+    analyze_record* records;
+    size_t count;
+    size_t capacity;
+    goose_analysis analysis;
+    int failed;
+} analyze_worker;
+
+static double seconds_now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+static int worker_push(analyze_worker* worker, const goose_pcap_record* record)
+{
+    if (worker->count == worker->capacity)
+    {
+        size_t capacity = worker->capacity ? worker->capacity * 2 : 4096;
+        analyze_record* records = (analyze_record*)realloc(worker->records, capacity * sizeof(analyze_record));
+        if (!records)
+        {
+            return -1;
+        }
+        worker->records = records;
+        worker->capacity = capacity;
+    }
+
+    analyze_record* out = &worker->records[worker->count++];
+    out->frame = record->frame;
+    out->length = (uint32_t)record->length;
+    out->timestamp_ns = record->timestamp_ns;
+    return 0;
+}
+
+static void* worker_run(void* argument)
+{
+    analyze_worker* worker = (analyze_worker*)argument;
+
+    for (size_t i = 0; i < worker->count; i++)
+    {
+        const analyze_record* record = &worker->records[i];
+        if (goose_analysis_add(&worker->analysis, record->frame, record->length, record->timestamp_ns) != 0)
+        {
+            worker->failed = 1;
+            break;
+        }
+    }
+
+    return NULL;
+}
+
+static int compare_streams(const void* a, const void* b)
+{
+    const goose_stream_stats* x = *(const goose_stream_stats* const*)a;
+    const goose_stream_stats* y = *(const goose_stream_stats* const*)b;
+
+    if (x->app_id != y->app_id)
+    {
+        return x->app_id < y->app_id ? -1 : 1;
+    }
+
+    int source = memcmp(x->source, y->source, MAC_ADDRESS_SIZE);
+    return source ? source : strcmp(x->gocbref, y->gocbref);
+}
+
+static void usage(const char* program)
+{
+    fprintf(stderr, "usage: %s [--threads N] CAPTURE\n", program);
+}
+
+int main(int argc, char** argv)
+{
+    const char* path = NULL;
+    long thread_count = sysconf(_SC_NPROCESSORS_ONLN);
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc)
+        {
+            thread_count = strtol(argv[++i], NULL, 10);
+        }
+        else if (!path && argv[i][0] != '-')
+        {
+            path = argv[i];
+        }
+        else
+        {
+            usage(argv[0]);
+            return 2;
+        }
+    }
+
+    if (!path)
+    {
+        usage(argv[0]);
+        return 2;
+    }
+    if (thread_count < 1)
+    {
+        thread_count = 1;
+    }
+    if (thread_count > MAX_WORKERS)
+    {
+        thread_count = MAX_WORKERS;
+    }
+
+    goose_pcap_reader reader;
+    if (goose_pcap_reader_open(&reader, path) != 0)
+    {
+        fprintf(stderr, "%s: cannot open capture\n", path);
+        return 1;
+    }
+
+    size_t workers_count = (size_t)thread_count;
+    analyze_worker* workers = (analyze_worker*)calloc(workers_count, sizeof(analyze_worker));
+    if (!workers)
+    {
+        goose_pcap_reader_close(&reader);
+        return 1;
+    }
+
+    double start = seconds_now();
+
+    // Split pass: only the record and Ethernet headers are read here
+    goose_pcap_record record;
+    int result;
+    while ((result = goose_pcap_next(&reader, &record)) == 1)
+    {
+        analyze_worker* worker = &workers[goose_analysis_stream_hash(record.frame, record.length) % workers_count];
+        if (worker_push(worker, &record) != 0)
+        {
+            fprintf(stderr, "%s: out of memory\n", path);
+            return 1;
+        }
+    }
+    if (result < 0)
+    {
+        fprintf(stderr, "%s: malformed record at offset %zu, analysing the frames before it\n", path, reader.offset);
+    }
+
+    double split = seconds_now();
+
+    pthread_t threads[MAX_WORKERS];
+    for (size_t i = 0; i < workers_count; i++)
+    {
+        goose_analysis_init(&workers[i].analysis);
+        if (pthread_create(&threads[i], NULL, worker_run, &workers[i]) != 0)
+        {
+            worker_run(&workers[i]);
+            threads[i] = pthread_self();
+        }
+    }
+    for (size_t i = 0; i < workers_count; i++)
+    {
+        if (!pthread_equal(threads[i], pthread_self()))
+        {
+            pthread_join(threads[i], NULL);
+        }
+    }
+
+    double end = seconds_now();
+
+    // Streams never span workers, so the results are simply gathered and sorted
+    size_t stream_count = 0;
+    uint64_t frames = 0;
+    uint64_t non_goose = 0;
+    uint64_t malformed = 0;
+    int failed = 0;
+    for (size_t i = 0; i < workers_count; i++)
+    {
+        stream_count += workers[i].analysis.stream_count;
+        frames += workers[i].analysis.frames;
+        non_goose += workers[i].analysis.non_goose;
+        malformed += workers[i].analysis.malformed;
+        failed |= workers[i].failed;
+    }
+
+    goose_stream_stats** streams = (goose_stream_stats**)malloc((stream_count ? stream_count : 1) * sizeof(goose_stream_stats*));
+    if (!streams)
+    {
+        return 1;
+    }
+    size_t n = 0;
+    for (size_t i = 0; i < workers_count; i++)
+    {
+        for (size_t s = 0; s < workers[i].analysis.stream_count; s++)
+        {
+            streams[n++] = &workers[i].analysis.streams[s];
+        }
+    }
+    qsort(streams, stream_count, sizeof(goose_stream_stats*), compare_streams);
+
+    printf("%-6s %-17s %10s %10s %8s %8s %8s %8s %8s %10s  %s\n",
+        "appid", "source", "frames", "rate/s", "states", "missed", "sq_gaps", "order", "tatl", "max_gap_ms", "gocbref");
+    for (size_t i = 0; i < stream_count; i++)
+    {
+        const goose_stream_stats* stream = streams[i];
+        printf("0x%04x %02x:%02x:%02x:%02x:%02x:%02x %10llu %10.1f %8llu %8llu %8llu %8llu %8llu %10.3f  %s\n",
+            stream->app_id,
+            stream->source[0], stream->source[1], stream->source[2], stream->source[3], stream->source[4], stream->source[5],
+            (unsigned long long)stream->frames, goose_stream_stats_rate(stream),
+            (unsigned long long)stream->state_changes, (unsigned long long)stream->missed_state_changes,
+            (unsigned long long)stream->sq_num_gaps, (unsigned long long)stream->out_of_order,
+            (unsigned long long)stream->tatl_violations, (double)stream->max_interval_ns / 1e6, stream->gocbref);
+    }
+    printf("%llu frames, %zu streams, %llu not GOOSE, %llu malformed\n",
+        (unsigned long long)frames, stream_count, (unsigned long long)non_goose, (unsigned long long)malformed);
+
+    double megabytes = (double)reader.size / (1024.0 * 1024.0);
+    fprintf(stderr, "%.1f MiB in %.3f s (%.0f MiB/s): split %.3f s, %zu workers %.3f s\n",
+        megabytes, end - start, megabytes / (end - start > 0 ? end - start : 1e-9), split - start, workers_count, end - split);
+
+    free(streams);
+    for (size_t i = 0; i < workers_count; i++)
+    {
+        goose_analysis_free(&workers[i].analysis);
+        free(workers[i].records);
+    }
+    free(workers);
+    goose_pcap_reader_close(&reader);
+
+    if (failed)
+    {
+        fprintf(stderr, "%s: out of memory\n", path);
+        return 1;
+    }
+    return result < 0 ? 1 : 0;
+}
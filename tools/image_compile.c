@@ -0,0 +1,81 @@
+#include "goose_image.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+// goose_image_compile DESCRIPTION IMAGE
+// Compiles a text description of datasets, publishers and subscriptions into an
+// image for goose_image_open. The format is described in goose_image_compile.c.
+
+static char* read_text(const char* path)
+{
+    FILE* file = fopen(path, "rb");
+    if (!file)
+    {
+        return NULL;
+    }
+
+    fseek(file, 0, SEEK_END);
+    long size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+
+    char* text = size >= 0 ? (char*)malloc((size_t)size + 1) : NULL;
+    if (text && fread(text, 1, (size_t)size, file) == (size_t)size)
+    {
+        text[size] = '\0';
+    }
+    else
+    {
+        free(text);
+        text = NULL;
+    }
+
+    fclose(file);
+    return text;
+}
+
+int main(int argc, char** argv)
+{
+    char error[256];
+    uint8_t* image = NULL;
+    size_t size = 0;
+
+    if (argc != 3)
+    {
+        fprintf(stderr, "usage: %s DESCRIPTION IMAGE\n", argv[0]);
+        return 2;
+    }
+
+    char* text = read_text(argv[1]);
+    if (!text)
+    {
+        perror(argv[1]);
+        return 1;
+    }
+
+    if (goose_image_compile(text, &image, &size, error, sizeof(error)) != 0)
+    {
+        fprintf(stderr, "%s:%s\n", argv[1], error);
+        free(text);
+        return 1;
+    }
+    free(text);
+
+    FILE* out = fopen(argv[2], "wb");
+    if (!out || fwrite(image, 1, size, out) != size || fclose(out) != 0)
+    {
+        perror(argv[2]);
+        free(image);
+        return 1;
+    }
+
+    goose_image image_view;
+    printf("%s: %zu bytes\n", argv[2], size);
+    if (goose_image_attach(image, size, &image_view) == 0)
+    {
+        printf("  %u datasets, %u publishers, %u subscriptions\n",
+            image_view.header->dataset_count, image_view.header->publisher_count, image_view.header->subscription_count);
+    }
+
+    free(image);
+    return 0;
+}